@@ -55,6 +55,9 @@ typedef enum kk_tag_e {
   KK_TAG_CFUNPTR,     // C function pointer
   KK_TAG_SIZE_T,      // boxed size_t
   KK_TAG_EVV_VECTOR,  // evidence vector (used in std/core/hnd)
+  KK_TAG_VECTOR_INT32,  // a vector of unboxed int32_t (see `kklib/pvector.h`)
+  KK_TAG_VECTOR_INT64,  // a vector of unboxed int64_t
+  KK_TAG_VECTOR_DOUBLE, // a vector of unboxed doubles
   // raw tags have a free function together with a `void*` to the data
   KK_TAG_CPTR_RAW,    // full void* (must be first, see kk_tag_is_raw())
   KK_TAG_STRING_RAW,  // pointer to a valid UTF8 string
@@ -74,13 +77,16 @@ static inline bool kk_tag_is_raw(kk_tag_t tag) {
 typedef kk_decl_align(8) struct kk_header_s {
   uint8_t   scan_fsize;       // number of fields that should be scanned when releasing (`scan_fsize <= 0xFF`, if 0xFF, the full scan size is the first field)
   uint8_t   thread_shared : 1;
+  uint8_t   heap_sampled : 1;     // sampled by the heap profiler (see `KK_HEAP_PROFILE`)
+  uint8_t   pool_wsize : 3;       // size class in words for the block pool, or 0 (see `kk_block_pool_free`)
   uint16_t  tag;              // header tag
   uint32_t  refcount;         // reference count  (last to reduce code size constants in kk_block_init)
 } kk_header_t;
 
 #define KK_SCAN_FSIZE_MAX (0xFF)
-#define KK_HEADER(scan_fsize,tag)         { scan_fsize, 0, tag, 0}             // start with refcount of 0
-#define KK_HEADER_STATIC(scan_fsize,tag)  { scan_fsize, 0, tag, KU32(0xFF00)}  // start with recognisable refcount (anything > 1 is ok)
+#define KK_HEADER(scan_fsize,tag)         { scan_fsize, 0, 0, 0, tag, 0}             // start with refcount of 0
+#define KK_HEADER_STATIC(scan_fsize,tag)  { scan_fsize, 0, 0, 0, tag, KU32(0xFF00)}  // start with recognisable refcount (anything > 1 is ok)
+#define KK_HEADER_STATIC_STICKY(scan_fsize,tag)  { scan_fsize, 0, 0, 0, tag, KU32(0xE0000000)}  // sticky refcount: dup and drop are no-ops (so it can be shared among threads)
 
 
 // Polymorphic operations work on boxed values. (We use a struct for extra checks on accidental conversion)
@@ -259,8 +265,16 @@ typedef struct kk_box_any_s {
   kk_block_t  _block;
 } *kk_box_any_t;
 
-//A yield context allows up to 8 continuations to be stored in-place
+// Maximum number of blocks freed by a single drop; any remaining blocks stay on the
+// `delayed_free` list and are freed incrementally at allocation (use 0 for no limit)
+#ifndef KK_FREE_BUDGET
+#define KK_FREE_BUDGET (10000)
+#endif
+
+// A yield context stores up to 8 continuations in-place; beyond that it grows a heap allocated array
+#ifndef KK_YIELD_CONT_MAX
 #define KK_YIELD_CONT_MAX (8)
+#endif
 
 typedef enum kk_yield_kind_e {
   KK_YIELD_NONE,
@@ -272,14 +286,68 @@ typedef struct kk_yield_s {
   int32_t       marker;          // marker of the handler to yield to
   kk_function_t clause;          // the operation clause to execute when the handler is found
   size_t        conts_count;     // number of continuations in `conts`
-  kk_function_t conts[KK_YIELD_CONT_MAX]; // fixed array of continuations. The final continuation `k` is
-                                          // composed as `fN ○ ... ○ f2 ○ f1` if `conts = { f1, f2, ..., fN }`
-                                          // if the array becomes full, a fresh array is allocated and the first
-                                          // entry points to its composition.
+  size_t        conts_size;      // available entries in `conts`
+  kk_function_t* conts;          // array of continuations. The final continuation `k` is
+                                 // composed as `fN ○ ... ○ f2 ○ f1` if `conts = { f1, f2, ..., fN }`.
+                                 // Points to `conts_inline`, or when that becomes full, to a heap allocated
+                                 // array that doubles in size as needed (and is kept for the lifetime of the context).
+  kk_function_t conts_inline[KK_YIELD_CONT_MAX];
 } kk_yield_t;
 
 extern kk_ptr_t kk_evv_empty_singleton;
 
+// A cache of the last evidence index of each handler tag (see `std/core/hnd-inline.c`)
+#ifndef KK_EVV_CACHE_SIZE
+#define KK_EVV_CACHE_SIZE  (16)        // must be a power of 2
+#endif
+
+typedef struct kk_evv_cache_s {
+  uintptr_t tag;                       // the (interned) tag name
+  size_t    index;                     // is validated before use
+} kk_evv_cache_t;
+
+
+// Maximum number of freed blocks per size class that a context keeps for reuse (use 0 to disable)
+#ifndef KK_BLOCK_POOL_MAX
+#define KK_BLOCK_POOL_MAX (0)
+#endif
+#define KK_BLOCK_POOL_MIN_WORDS (3)   // pool blocks with a header and 2 till 6 fields
+#define KK_BLOCK_POOL_MAX_WORDS (7)   // at most 7 to fit the `pool_wsize` header field
+
+typedef struct kk_block_pool_s {
+  kk_block_t*  free[KK_BLOCK_POOL_MAX_WORDS+1];   // LIFO list of free blocks per size (in words)
+  uint32_t     count[KK_BLOCK_POOL_MAX_WORDS+1];  // length of each list
+} kk_block_pool_t;
+
+// Pending reference count deltas of thread-shared blocks (see `refcount.c`)
+#ifndef KK_SHARED_DEFER
+#define KK_SHARED_DEFER   (256)     // entries in the per-context delta table (must be a power of 2; 0 to always use atomics)
+#endif
+
+typedef struct kk_shared_delta_s {
+  kk_block_t*  block;
+  int32_t      delta;
+} kk_shared_delta_t;
+
+// Runtime statistics (if `KK_STATS` is enabled)
+#define KK_STATS_CON_TAGS (64)      // constructor tags that are counted separately (higher tags share the last entry)
+
+typedef struct kk_stats_s {
+  int64_t  dup;                     // reference count increments
+  int64_t  drop;                    // reference count decrements
+  int64_t  dup_atomic;              // slow path: atomic increment of a thread-shared reference count
+  int64_t  drop_atomic;             // slow path: atomic decrement of a thread-shared reference count
+  int64_t  sticky;                  // slow path: increment or decrement of a sticky reference count
+  int64_t  free;                    // dropped blocks that were freed
+  int64_t  reuse;                   // drop-reuse that returned the memory for reuse
+  int64_t  reuse_miss;              // drop-reuse that could not reuse the memory
+  int64_t  delayed;                 // current length of the delayed free list
+  int64_t  delayed_peak;            // peak length of the delayed free list
+  int64_t  alloc;                   // total block allocations
+  int64_t  alloc_con[KK_STATS_CON_TAGS];          // allocations by constructor tag
+  int64_t  alloc_special[KK_TAG_LAST - KK_TAG_OPEN];  // allocations by special tag (from `KK_TAG_OPEN`)
+} kk_stats_t;
+
      
 // The thread local context.
 // The fields `yielding`, `heap` and `evv` should come first for efficiency
@@ -288,15 +356,38 @@ typedef struct kk_context_s {
   kk_heap_t      heap;             // the (thread-local) heap to allocate in; todo: put in a register?
   kk_ptr_t       evv;              // the current evidence vector for effect handling: vector for size 0 and N>1, direct evidence for one element vector
   kk_yield_t     yield;            // inlined yield structure (for efficiency)
+  kk_evv_cache_t evv_cache[KK_EVV_CACHE_SIZE]; // last evidence index per handler tag
   int32_t        marker_unique;    // unique marker generation
   kk_block_t*    delayed_free;     // list of blocks that still need to be freed
+  struct kk_region_s* region;      // current allocation region (or NULL)
+  struct kk_task_deque_s* task_deque; // work-stealing deque of this thread (or NULL)
+  kk_ssize_t     free_budget;      // remaining number of blocks that can be freed before delaying
+#if KK_RECLAIM_THREAD
+  _Atomic(uintptr_t) reclaim_back; // decrements handed back by the reclaimer thread
+#endif
+#if (KK_BLOCK_POOL_MAX > 0)
+  kk_block_pool_t pool;            // freed small blocks for reuse
+#endif
+#if KK_STATS
+  kk_stats_t     stats;            // runtime statistics
+  bool           stats_print;      // print statistics at the end (`--kkstats`)
+#endif
+#if KK_HEAP_PROFILE
+  kk_ssize_t     heap_sample_next; // bytes to allocate before taking the next heap sample
+  uint64_t       heap_sample_rnd;  // random state for the sample intervals
+#endif
+#if KK_TRACE
+  struct kk_trace_buf_s* trace;    // trace event buffer (or NULL when not tracing)
+#endif
   kk_integer_t   unique;           // thread local unique number generation
   uintptr_t      thread_id;        // unique thread id
   kk_box_any_t   kk_box_any;       // used when yielding as a value of any type
   kk_function_t  log;              // logging function
   kk_function_t  out;              // std output
+  struct kk_outbuf_s* outbuf;      // buffered console output, initialized on demand
 
   struct kk_random_ctx_s* srandom_ctx; // strong random using chacha20, initialized on demand
+  struct kk_integer_cache_s* integer_cache; // cached powers for integer conversions, initialized on demand
   size_t         argc;             // command line argument count 
   const char**   argv;             // command line arguments
   kk_timer_t     process_start;    // time at start of the process
@@ -305,14 +396,42 @@ typedef struct kk_context_s {
   kk_duration_t  timer_delta;      // applied timer delta
   int64_t        time_freq;        // unix time frequency
   kk_duration_t  time_unix_prev;   // last requested unix time
+  struct kk_shared_epoch_s*   shared_epoch;   // announces the quiescent states of this thread (see `refcount.c`)
+  struct kk_shared_retired_s* shared_retired; // retired references waiting to be dropped (or NULL)
+#if (KK_SHARED_DEFER > 0)
+  uint32_t       shared_ops;       // deferred shared reference count operations since the last flush
+  kk_shared_delta_t shared_deltas[KK_SHARED_DEFER]; // pending deltas of thread-shared blocks
+#endif
 } kk_context_t;
 
 // Get the current (thread local) runtime context (should always equal the `_ctx` parameter)
 kk_decl_export kk_context_t* kk_get_context(void);
+kk_decl_export void          kk_context_done(void);  // free the context of the current thread when it ends (and add its statistics to the process)
 
 kk_decl_export kk_context_t* kk_main_start(int argc, char** argv);
 kk_decl_export void          kk_main_end(kk_context_t* ctx);
 
+kk_decl_export void          kk_stats_print(const kk_stats_t* stats, kk_context_t* ctx);
+kk_decl_export void          kk_stats_add(kk_stats_t* total, const kk_stats_t* stats);
+
+#if KK_STATS
+#define kk_stats_inc(ctx,field)   ((ctx)->stats.field++)
+#else
+#define kk_stats_inc(ctx,field)   ((void)0)
+#endif
+
+kk_decl_export const char*   kk_tag_name(kk_tag_t tag);  // name of a special tag (or NULL)
+
+static inline void kk_stats_alloc(kk_tag_t tag, kk_context_t* ctx) {
+#if KK_STATS
+  ctx->stats.alloc++;
+  if (tag >= KK_TAG_OPEN && tag < KK_TAG_LAST) ctx->stats.alloc_special[tag - KK_TAG_OPEN]++;
+  else ctx->stats.alloc_con[tag < KK_STATS_CON_TAGS ? tag : KK_STATS_CON_TAGS - 1]++;
+#else
+  KK_UNUSED(tag); KK_UNUSED(ctx);
+#endif
+}
+
 kk_decl_export void          kk_debugger_break(kk_context_t* ctx);
 
 // The current context is passed as a _ctx parameter in the generated code
@@ -389,6 +508,10 @@ static inline void kk_free(void* p) {
 static inline void kk_free_local(void* p) {
   kk_free(p);
 }
+
+static inline size_t kk_malloc_usable_size(void* p) {
+  return mi_usable_size(p);
+}
 #else
 static inline void* kk_malloc(size_t sz, kk_context_t* ctx) {
   KK_UNUSED(ctx);
@@ -417,69 +540,194 @@ static inline void kk_free(void* p) {
 static inline void kk_free_local(void* p) {
   kk_free(p);
 }
+
+#if (KK_BLOCK_POOL_MAX > 0)
+#if defined(_WIN32)
+#include <malloc.h>
+static inline size_t kk_malloc_usable_size(void* p) { return _msize(p); }
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+static inline size_t kk_malloc_usable_size(void* p) { return malloc_size(p); }
+#elif defined(__GLIBC__)
+#include <malloc.h>
+static inline size_t kk_malloc_usable_size(void* p) { return malloc_usable_size(p); }
+#else
+static inline size_t kk_malloc_usable_size(void* p) { KK_UNUSED(p); return 0; }  // unknown: blocks are never pooled
+#endif
+#endif
 #endif
 
 
-static inline void kk_block_init(kk_block_t* b, size_t size, size_t scan_fsize, kk_tag_t tag) {
+// The block pool size class (in words) of a block of `size` bytes, or 0 if it is not pooled
+static inline size_t kk_block_pool_wsize(size_t size) {
+#if (KK_BLOCK_POOL_MAX > 0)
+  const size_t wsize = (size + sizeof(kk_box_t) - 1) / sizeof(kk_box_t);
+  return (wsize >= KK_BLOCK_POOL_MIN_WORDS && wsize <= KK_BLOCK_POOL_MAX_WORDS ? wsize : 0);
+#else
   KK_UNUSED(size);
+  return 0;
+#endif
+}
+
+static inline void kk_block_init(kk_block_t* b, size_t size, size_t scan_fsize, kk_tag_t tag) {
   kk_assert_internal(scan_fsize < KK_SCAN_FSIZE_MAX);
+  const size_t pool_wsize = kk_block_pool_wsize(size);
 #if (KK_ARCH_LITTLE_ENDIAN)
   // explicit shifts lead to better codegen
-  *((uint64_t*)b) = ((uint64_t)scan_fsize | (uint64_t)tag << 16);                    
+  *((uint64_t*)b) = ((uint64_t)scan_fsize | (uint64_t)pool_wsize << 10 | (uint64_t)tag << 16);
 #else
-  kk_header_t header = { (uint8_t)scan_fsize, 0, (uint16_t)tag, 0 };
+  kk_header_t header = { (uint8_t)scan_fsize, 0, 0, (uint8_t)pool_wsize, (uint16_t)tag, 0 };
   b->header = header;
 #endif
 }
 
 static inline void kk_block_large_init(kk_block_large_t* b, size_t size, size_t scan_fsize, kk_tag_t tag) {
   KK_UNUSED(size);
-  kk_header_t header = { KK_SCAN_FSIZE_MAX, 0, (uint16_t)tag, 0 };
+  kk_header_t header = { KK_SCAN_FSIZE_MAX, 0, 0, 0, (uint16_t)tag, 0 };
   b->_block.header = header;
   b->large_scan_fsize = kk_enum_box(scan_fsize);
 }
 
 typedef kk_block_t* kk_reuse_t;
 
+kk_decl_export void kk_block_drop_free_delayed(kk_ssize_t budget, kk_context_t* ctx);  // free at most `budget` delayed blocks (or all if `budget <= 0`)
+kk_decl_export void kk_block_pool_collect(kk_context_t* ctx);  // free all blocks in the pool of `ctx`
+
+// Allocate a small block, reusing a pooled block of the same size class if possible
+static inline void* kk_block_pool_malloc(size_t size, kk_context_t* ctx) {
+#if (KK_BLOCK_POOL_MAX > 0)
+  const size_t wsize = kk_block_pool_wsize(size);
+  if (wsize != 0) {
+    kk_block_t* b = ctx->pool.free[wsize];
+    if (b != NULL) {
+      ctx->pool.free[wsize] = *((kk_block_t**)b);
+      ctx->pool.count[wsize]--;
+      return b;
+    }
+  }
+#endif
+  return kk_malloc_small(size, ctx);
+}
+
+// Allocation safepoint: incrementally free blocks that were delayed by a drop
+static inline void kk_block_free_delayed_safepoint(kk_context_t* ctx) {
+  if (kk_unlikely(ctx->delayed_free != NULL)) {
+    kk_block_drop_free_delayed(KK_FREE_BUDGET, ctx);
+  }
+}
+
 #define kk_reuse_null  ((kk_reuse_t)NULL)
 
+/*--------------------------------------------------------------------------------------
+  Heap profiling
+  With `KK_HEAP_PROFILE` a block is sampled on average every `KK_HEAP_SAMPLE_RATE`
+  allocated bytes; freeing a block then only tests the `heap_sampled` header bit.
+  Region blocks are never sampled.
+--------------------------------------------------------------------------------------*/
+#ifndef KK_HEAP_SAMPLE_RATE
+#define KK_HEAP_SAMPLE_RATE  (512*1024)  // average bytes between samples
+#endif
+
+kk_decl_export void kk_heap_profile_set_rate(size_t rate);       // 0 disables sampling (other threads pick it up at their next sample)
+kk_decl_export int  kk_heap_profile_write(const char* fname);    // write a pprof (legacy `heap_v2`) profile; returns 0 or an error code
+kk_decl_export void kk_heap_profile_print(kk_context_t* ctx);    // print the estimated live and allocated bytes per tag
+
+#if KK_HEAP_PROFILE
+kk_decl_export kk_decl_noinline void kk_heap_sample_alloc(kk_block_t* b, size_t size, kk_context_t* ctx);
+kk_decl_export kk_decl_noinline void kk_heap_sample_free(kk_block_t* b);
+#endif
+
+static inline void kk_heap_profile_alloc(kk_block_t* b, size_t size, kk_context_t* ctx) {
+#if KK_HEAP_PROFILE
+  ctx->heap_sample_next -= (kk_ssize_t)size;
+  if (kk_unlikely(ctx->heap_sample_next < 0)) kk_heap_sample_alloc(b, size, ctx);
+#else
+  KK_UNUSED(b); KK_UNUSED(size); KK_UNUSED(ctx);
+#endif
+}
+
+static inline void kk_heap_profile_free(kk_block_t* b) {
+#if KK_HEAP_PROFILE
+  if (kk_unlikely(b->header.heap_sampled)) kk_heap_sample_free(b);
+#else
+  KK_UNUSED(b);
+#endif
+}
+
+/*--------------------------------------------------------------------------------------
+  Regions
+  Inside a region scope all blocks are bump allocated in the region and have a
+  `KK_RC_REGION` reference count. This is in the sticky range (see `refcount.c`)
+  so dup and drop on region blocks are no-ops. The region is released as a whole
+  at the end of the scope where the result value is copied out.
+  No other reference into the region may escape the scope.
+--------------------------------------------------------------------------------------*/
+#define KK_RC_REGION  KU32(0xE8000000)
+
+kk_decl_export void        kk_region_enter(kk_context_t* ctx);
+kk_decl_export kk_box_t    kk_region_exit(kk_box_t result, kk_context_t* ctx);
+kk_decl_export kk_block_t* kk_region_alloc(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx);
+kk_decl_export kk_block_large_t* kk_region_large_alloc(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx);
+
 static inline kk_block_t* kk_block_alloc_at(kk_reuse_t at, size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_assert_internal(scan_fsize < KK_SCAN_FSIZE_MAX);
   kk_block_t* b;
   if (at==kk_reuse_null) {
-    b = (kk_block_t*)kk_malloc_small(size, ctx);
+    if (kk_unlikely(ctx->region != NULL)) return kk_region_alloc(size, scan_fsize, tag, ctx);
+    kk_block_free_delayed_safepoint(ctx);
+    kk_stats_alloc(tag, ctx);
+    b = (kk_block_t*)kk_block_pool_malloc(size, ctx);
+    kk_block_init(b, size, scan_fsize, tag);
+    kk_heap_profile_alloc(b, size, ctx);
   }
   else {
     kk_assert_internal(kk_block_is_unique(at)); // TODO: check usable size of `at`
+    kk_heap_profile_free(at);  // a reused block counts as freed and allocated again
     b = at;
+    kk_block_init(b, size, scan_fsize, tag);
+    kk_heap_profile_alloc(b, size, ctx);
   }
-  kk_block_init(b, size, scan_fsize, tag);
   return b;
 }
 
 static inline kk_block_t* kk_block_alloc(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_assert_internal(scan_fsize < KK_SCAN_FSIZE_MAX);
-  kk_block_t* b = (kk_block_t*)kk_malloc_small(size, ctx);
+  if (kk_unlikely(ctx->region != NULL)) return kk_region_alloc(size, scan_fsize, tag, ctx);
+  kk_block_free_delayed_safepoint(ctx);
+  kk_stats_alloc(tag, ctx);
+  kk_block_t* b = (kk_block_t*)kk_block_pool_malloc(size, ctx);
   kk_block_init(b, size, scan_fsize, tag);
+  kk_heap_profile_alloc(b, size, ctx);
   return b;
 }
 
 static inline kk_block_t* kk_block_alloc_any(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
   kk_assert_internal(scan_fsize < KK_SCAN_FSIZE_MAX);
+  if (kk_unlikely(ctx->region != NULL)) return kk_region_alloc(size, scan_fsize, tag, ctx);
+  kk_block_free_delayed_safepoint(ctx);
+  kk_stats_alloc(tag, ctx);
   kk_block_t* b = (kk_block_t*)kk_malloc(size, ctx);
   kk_block_init(b, size, scan_fsize, tag);
+  kk_heap_profile_alloc(b, size, ctx);
   return b;
 }
 
 static inline kk_block_large_t* kk_block_large_alloc(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
+  if (kk_unlikely(ctx->region != NULL)) return kk_region_large_alloc(size, scan_fsize, tag, ctx);
+  kk_block_free_delayed_safepoint(ctx);
+  kk_stats_alloc(tag, ctx);
   kk_block_large_t* b = (kk_block_large_t*)kk_malloc(size + 1 /* the scan_large_fsize field */, ctx);
   kk_block_large_init(b, size, scan_fsize, tag);
+  kk_heap_profile_alloc(&b->_block, size, ctx);
   return b;
 }
 
 static inline kk_block_t* kk_block_realloc(kk_block_t* b, size_t size, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_unique(b));
-  return (kk_block_t*)kk_realloc(b, size, ctx);
+  kk_heap_profile_free(b);
+  b = (kk_block_t*)kk_realloc(b, size, ctx);
+  if (b != NULL) b->header.pool_wsize = (uint8_t)kk_block_pool_wsize(size);
+  return b;
 }
 
 static inline kk_block_t* kk_block_assertx(kk_block_t* b, kk_tag_t tag) {
@@ -489,10 +737,30 @@ static inline kk_block_t* kk_block_assertx(kk_block_t* b, kk_tag_t tag) {
 }
 
 static inline void kk_block_free(kk_block_t* b) {
+  kk_heap_profile_free(b);
   kk_block_set_invalid(b);
   kk_free(b);
 }
 
+// Free a block owned by `ctx`, keeping it in the pool for reuse if there is space.
+// The size class was recorded in the header when the block was initialized.
+static inline void kk_block_pool_free(kk_block_t* b, kk_context_t* ctx) {
+#if (KK_BLOCK_POOL_MAX > 0)
+  const size_t wsize = b->header.pool_wsize;
+  if (wsize != 0 && ctx->pool.count[wsize] < KK_BLOCK_POOL_MAX) {
+    kk_heap_profile_free(b);
+    kk_block_set_invalid(b);
+    *((kk_block_t**)b) = ctx->pool.free[wsize];  // link through the header
+    ctx->pool.free[wsize] = b;
+    ctx->pool.count[wsize]++;
+    return;
+  }
+#else
+  KK_UNUSED(ctx);
+#endif
+  kk_block_free(b);
+}
+
 #define kk_block_alloc_as(struct_tp,scan_fsize,tag,ctx)        ((struct_tp*)kk_block_alloc_at(kk_reuse_null, sizeof(struct_tp),scan_fsize,tag,ctx))
 #define kk_block_alloc_at_as(struct_tp,at,scan_fsize,tag,ctx)  ((struct_tp*)kk_block_alloc_at(at, sizeof(struct_tp),scan_fsize,tag,ctx))
 
@@ -509,9 +777,28 @@ kk_decl_export void        kk_block_check_decref(kk_block_t* b, uint32_t rc, kk_
 kk_decl_export kk_block_t* kk_block_check_dup(kk_block_t* b, uint32_t rc);
 kk_decl_export kk_reuse_t  kk_block_check_drop_reuse(kk_block_t* b, uint32_t rc0, kk_context_t* ctx);
 
+// Mark a block and all blocks reachable from it as thread-shared (before publishing it to another thread)
+kk_decl_export void        kk_block_mark_shared(kk_block_t* b, kk_context_t* ctx);
+kk_decl_export void        kk_box_mark_shared(kk_box_t b, kk_context_t* ctx);
+
+// Apply pending reference count deltas of thread-shared blocks; a reference that is dup'd
+// from one that another thread may drop must be committed before it is used.
+kk_decl_export void        kk_block_shared_flush(kk_context_t* ctx);
+kk_decl_export void        kk_block_shared_commit(kk_block_t* b, kk_context_t* ctx);
+kk_decl_export void        kk_box_shared_commit(kk_box_t b, kk_context_t* ctx);
+
+// Drop a reference that was overwritten in a thread-shared location (like a `ref`) once no
+// other thread can still be reading it. A thread is offline while it cannot read any
+// thread-shared value (like an idle worker) and does not delay the reclamation then.
+kk_decl_export void        kk_box_shared_retire(kk_box_t b, kk_context_t* ctx);
+kk_decl_export void        kk_shared_online(kk_context_t* ctx);
+kk_decl_export void        kk_shared_offline(kk_context_t* ctx);   // (flushes first)
+kk_decl_export void        kk_shared_release(kk_context_t* ctx);   // (when the context is freed)
+
 
 static inline kk_block_t* kk_block_dup(kk_block_t* b) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(kk_get_context(), dup);
   const uint32_t rc = b->header.refcount;
   if (kk_likely((int32_t)rc >= 0)) {    // note: assume two's complement  (we can skip this check if we never overflow a reference count or use thread-shared objects.)
     b->header.refcount = rc+1;
@@ -524,8 +811,9 @@ static inline kk_block_t* kk_block_dup(kk_block_t* b) {
 
 static inline void kk_block_drop(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(ctx, drop);
   const uint32_t rc = b->header.refcount;
-  if ((int32_t)(rc > 0)) {          // note: assume two's complement
+  if ((int32_t)rc > 0) {            // note: assume two's complement
     b->header.refcount = rc-1;
   }
   else {
@@ -535,8 +823,9 @@ static inline void kk_block_drop(kk_block_t* b, kk_context_t* ctx) {
 
 static inline void kk_block_decref(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(ctx, drop);
   const uint32_t rc = b->header.refcount;  
-  if (kk_likely((int32_t)(rc > 0))) {     // note: assume two's complement
+  if (kk_likely((int32_t)rc > 0)) {       // note: assume two's complement
     b->header.refcount = rc - 1;
   }
   else {
@@ -547,11 +836,13 @@ static inline void kk_block_decref(kk_block_t* b, kk_context_t* ctx) {
 // Decrement the reference count, and return the memory for reuse if it drops to zero
 static inline kk_reuse_t kk_block_drop_reuse(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(ctx, drop);
   const uint32_t rc = b->header.refcount;
   if ((int32_t)rc <= 0) {                 // note: assume two's complement
     return kk_block_check_drop_reuse(b, rc, ctx); // thread-shared, sticky (overflowed), or can be reused?
   }
   else {
+    kk_stats_inc(ctx, reuse_miss);
     b->header.refcount = rc-1;
     return kk_reuse_null;
   }
@@ -563,13 +854,15 @@ static inline void kk_box_drop(kk_box_t b, kk_context_t* ctx);
 // Drop with inlined dropping of children 
 static inline void kk_block_dropi(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(ctx, drop);
   const uint32_t rc = b->header.refcount;
   if (rc == 0) {
     const size_t scan_fsize = kk_block_scan_fsize(b);
     for (size_t i = 0; i < scan_fsize; i++) {
       kk_box_drop(kk_block_field(b, i), ctx);
     }
-    kk_block_free(b);
+    kk_stats_inc(ctx, free);
+    kk_block_pool_free(b, ctx);
   }
   else if (kk_unlikely((int32_t)rc < 0)) {     // note: assume two's complement
     kk_block_check_drop(b, rc, ctx);           // thread-share or sticky (overflowed) ?    
@@ -588,9 +881,12 @@ static inline kk_reuse_t kk_block_dropi_reuse(kk_block_t* b, kk_context_t* ctx)
     for (size_t i = 0; i < scan_fsize; i++) {
       kk_box_drop(kk_block_field(b, i), ctx);
     }
+    kk_stats_inc(ctx, drop);
+    kk_stats_inc(ctx, reuse);
     return b;
   }
   else {
+    kk_stats_inc(ctx, reuse_miss);
     kk_block_drop(b, ctx);
     return kk_reuse_null;
   }
@@ -599,13 +895,15 @@ static inline kk_reuse_t kk_block_dropi_reuse(kk_block_t* b, kk_context_t* ctx)
 // Drop with known scan size 
 static inline void kk_block_dropn(kk_block_t* b, size_t scan_fsize, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(ctx, drop);
   const uint32_t rc = b->header.refcount;
   if (rc == 0) {                 // note: assume two's complement
     kk_assert_internal(scan_fsize == kk_block_scan_fsize(b));
     for (size_t i = 0; i < scan_fsize; i++) {
       kk_box_drop(kk_block_field(b, i), ctx);
     }
-    kk_block_free(b);
+    kk_stats_inc(ctx, free);
+    kk_block_pool_free(b, ctx);
   }
   else if (kk_unlikely((int32_t)rc < 0)) {
     kk_block_check_drop(b, rc, ctx); // thread-shared, sticky (overflowed)?
@@ -620,19 +918,23 @@ static inline void kk_block_dropn(kk_block_t* b, size_t scan_fsize, kk_context_t
 // Drop-reuse with known scan size
 static inline kk_reuse_t kk_block_dropn_reuse(kk_block_t* b, size_t scan_fsize, kk_context_t* ctx) {
   kk_assert_internal(kk_block_is_valid(b));
+  kk_stats_inc(ctx, drop);
   const uint32_t rc = b->header.refcount;
   if (rc == 0) {                 
     kk_assert_internal(kk_block_scan_fsize(b) == scan_fsize);
     for (size_t i = 0; i < scan_fsize; i++) {
       kk_box_drop(kk_block_field(b, i), ctx);
     }
+    kk_stats_inc(ctx, reuse);
     return b;
   }
   else if (kk_unlikely((int32_t)rc < 0)) {     // note: assume two's complement
+    kk_stats_inc(ctx, reuse_miss);
     kk_block_check_drop(b, rc, ctx);           // thread-shared or sticky (overflowed)?
     return kk_reuse_null;
   }
   else {
+    kk_stats_inc(ctx, reuse_miss);
     b->header.refcount = rc-1;
     return kk_reuse_null;
   }
@@ -652,10 +954,9 @@ static inline kk_block_t* kk_block_dup_assert(kk_block_t* b, kk_tag_t tag) {
 }
 
 static inline void kk_reuse_drop(kk_reuse_t r, kk_context_t* ctx) {
-  KK_UNUSED(ctx);
   if (r != NULL) {
     kk_assert_internal(kk_block_is_unique(r));
-    kk_free(r);
+    kk_block_pool_free(r, ctx);
   }
 }
 
@@ -870,8 +1171,12 @@ typedef enum kk_unit_e {
 #include "kklib/box.h"
 #include "kklib/integer.h"
 #include "kklib/string.h"
+#include "kklib/pvector.h"
 #include "kklib/random.h"
 #include "kklib/os.h"
+#include "kklib/task.h"
+#include "kklib/reactor.h"
+#include "kklib/trace.h"
 
 /*----------------------------------------------------------------------
   TLD operations
@@ -954,9 +1259,11 @@ static inline kk_function_t kk_function_dup(kk_function_t f) {
 
 typedef struct kk_vector_large_s {  // always use a large block for a vector so the offset to the elements is fixed
   struct kk_block_large_s _base;
-  kk_box_t                vec[1];               // vec[(large_)scan_fsize]
+  kk_box_t                capacity;             // available element entries (as a boxed enum so it can be scanned)
+  kk_box_t                vec[1];               // vec[(large_)scan_fsize - 2]
 } *kk_vector_large_t;
 
+#define KK_VECTOR_HEADER_FSIZE  (2)           // `large_scan_fsize` + `capacity`
 
 static inline kk_vector_t kk_vector_empty(void) {
   return kk_datatype_from_tag(1);
@@ -979,12 +1286,19 @@ static inline kk_vector_t kk_vector_dup(kk_vector_t v) {
   return kk_datatype_dup(v);
 }
 
-static inline kk_vector_t kk_vector_alloc(size_t length, kk_box_t def, kk_context_t* ctx) {
-  if (length==0) {
+static inline size_t kk_vector_alloc_size(size_t capacity) {
+  return (sizeof(struct kk_vector_large_s) + (capacity-1)*sizeof(kk_box_t));
+}
+
+// Allocate a vector of `length` elements with room for `capacity` elements.
+static inline kk_vector_t kk_vector_alloc_capacity(size_t length, size_t capacity, kk_box_t def, kk_context_t* ctx) {
+  kk_assert_internal(capacity >= length);
+  if (capacity==0) {
     return kk_vector_empty();
   }
   else {
-    kk_vector_large_t v = (kk_vector_large_t)kk_block_large_alloc(sizeof(struct kk_vector_large_s) + (length-1)*sizeof(kk_box_t), length + 1 /* kk_large_scan_fsize */, KK_TAG_VECTOR, ctx);
+    kk_vector_large_t v = (kk_vector_large_t)kk_block_large_alloc(kk_vector_alloc_size(capacity), length + KK_VECTOR_HEADER_FSIZE, KK_TAG_VECTOR, ctx);
+    v->capacity = kk_enum_box(capacity);
     if (def.box != kk_box_null.box) {
       for (size_t i = 0; i < length; i++) {
         v->vec[i] = def;
@@ -994,15 +1308,25 @@ static inline kk_vector_t kk_vector_alloc(size_t length, kk_box_t def, kk_contex
   }
 }
 
+static inline kk_vector_t kk_vector_alloc(size_t length, kk_box_t def, kk_context_t* ctx) {
+  return kk_vector_alloc_capacity(length, length, def, ctx);
+}
+
 static inline size_t kk_vector_len(const kk_vector_t vd) {
   kk_vector_large_t v = kk_vector_as_large(vd);
   if (v==NULL) return 0;
-  size_t len = kk_enum_unbox(v->_base.large_scan_fsize) - 1;
-  kk_assert_internal(len + 1 == kk_block_scan_fsize(&v->_base._block));
-  kk_assert_internal(len + 1 != 0);
+  size_t len = kk_enum_unbox(v->_base.large_scan_fsize) - KK_VECTOR_HEADER_FSIZE;
+  kk_assert_internal(len + KK_VECTOR_HEADER_FSIZE == kk_block_scan_fsize(&v->_base._block));
+  kk_assert_internal(len + KK_VECTOR_HEADER_FSIZE != 0);
   return len;
 }
 
+static inline size_t kk_vector_capacity(const kk_vector_t vd) {
+  kk_vector_large_t v = kk_vector_as_large(vd);
+  if (v==NULL) return 0;
+  return kk_enum_unbox(v->capacity);
+}
+
 static inline kk_box_t* kk_vector_buf(kk_vector_t vd, size_t* len) {
   if (len != NULL) *len = kk_vector_len(vd);
   kk_vector_large_t v = kk_vector_as_large(vd);
@@ -1025,11 +1349,40 @@ static inline kk_vector_t kk_vector_unbox(kk_box_t v, kk_context_t* ctx) {
   return kk_datatype_unbox(v);
 }
 
+// Resize the storage of a unique vector in place to `capacity` elements (which must be at least its length).
+kk_decl_export kk_vector_t kk_vector_realloc_capacity(kk_vector_t vec, size_t capacity, kk_context_t* ctx);
 
+// Resize a vector to `newlen` elements where new elements are initialized to `def`
+// (or uninitialized if `def` is `kk_box_null`). A unique vector is resized in place
+// with geometric growth of its capacity so repeated extension takes amortized constant time.
 static inline kk_vector_t kk_vector_realloc(kk_vector_t vec, size_t newlen, kk_box_t def, kk_context_t* ctx) {
   size_t len;
   kk_box_t* src = kk_vector_buf(vec, &len);
   if (len == newlen) return vec;
+  if (newlen > 0 && kk_datatype_is_unique(vec)) {
+    // resize in-place
+    kk_vector_large_t v = kk_vector_as_large(vec);
+    const size_t cap = kk_enum_unbox(v->capacity);
+    if (newlen > cap) {
+      // grow geometrically
+      vec = kk_vector_realloc_capacity(vec, (newlen > 2*cap ? newlen : 2*cap), ctx);
+      v = kk_vector_as_large(vec);
+    }
+    for (size_t i = newlen; i < len; i++) {
+      kk_box_drop(v->vec[i], ctx);
+    }
+    if (def.box != kk_box_null.box) {
+      for (size_t i = len; i < newlen; i++) {
+        v->vec[i] = def;
+      }
+    }
+    v->_base.large_scan_fsize = kk_enum_box(newlen + KK_VECTOR_HEADER_FSIZE);
+    if (newlen < cap/4) {
+      // release excess storage when shrinking a lot
+      vec = kk_vector_realloc_capacity(vec, newlen, ctx);
+    }
+    return vec;
+  }
   kk_vector_t vdest = kk_vector_alloc(newlen, def, ctx);
   kk_box_t* dest    = kk_vector_buf(vdest,NULL);
   const size_t n = (len > newlen ? newlen : len);
@@ -1038,8 +1391,16 @@ static inline kk_vector_t kk_vector_realloc(kk_vector_t vec, size_t newlen, kk_b
   }
   kk_vector_drop(vec, ctx);
   return vdest;
-} 
- 
+}
+
+// Append an element to a vector (in amortized constant time if the vector is unique).
+static inline kk_vector_t kk_vector_push(kk_vector_t vec, kk_box_t x, kk_context_t* ctx) {
+  const size_t len = kk_vector_len(vec);
+  vec = kk_vector_realloc(vec, len + 1, kk_box_null, ctx);
+  kk_vector_buf(vec, NULL)[len] = x;
+  return vec;
+}
+
 /*--------------------------------------------------------------------------------------
   References
 --------------------------------------------------------------------------------------*/
@@ -1050,6 +1411,8 @@ typedef struct kk_ref_s {
 
 kk_decl_export kk_box_t  kk_ref_get_thread_shared(kk_ref_t r, kk_context_t* ctx);
 kk_decl_export kk_box_t  kk_ref_swap_thread_shared(kk_ref_t r, kk_box_t value, kk_context_t* ctx);
+kk_decl_export kk_unit_t kk_ref_set_thread_shared(kk_ref_t r, kk_box_t value, kk_context_t* ctx);
+kk_decl_export kk_unit_t kk_ref_vector_assign_thread_shared(kk_ref_t r, kk_integer_t idx, kk_box_t value, kk_context_t* ctx);
 
 static inline kk_box_t kk_ref_box(kk_ref_t r, kk_context_t* ctx) {
   KK_UNUSED(ctx);
@@ -1104,9 +1467,15 @@ static inline kk_box_t kk_ref_swap(kk_ref_t r, kk_box_t value, kk_context_t* ctx
 
 
 static inline kk_unit_t kk_ref_set(kk_ref_t r, kk_box_t value, kk_context_t* ctx) {
-  kk_box_t b = kk_ref_swap(r, value, ctx);
-  kk_box_drop(b, ctx);
-  return kk_Unit;
+  if (kk_likely(r->_block.header.thread_shared == 0)) {
+    kk_box_t b = kk_ref_swap(r, value, ctx);
+    kk_box_drop(b, ctx);
+    return kk_Unit;
+  }
+  else {
+    // thread shared
+    return kk_ref_set_thread_shared(r, value, ctx);
+  }
 }
 
 static inline kk_unit_t kk_ref_vector_assign(kk_ref_t r, kk_integer_t idx, kk_box_t value, kk_context_t* ctx) {
@@ -1120,14 +1489,16 @@ static inline kk_unit_t kk_ref_vector_assign(kk_ref_t r, kk_integer_t idx, kk_bo
     if (i < len) {
       kk_box_drop(p[i], ctx);
       p[i] = value;
-    }  // TODO: return status for out-of-bounds access
+    }
+    else {
+      kk_box_drop(value, ctx);  // an out-of-bounds assignment is ignored
+    }
     kk_ref_drop(r, ctx);    // TODO: make references borrowed
     return kk_Unit;
   }
   else {
     // thread shared
-    kk_unsupported_external("kk_ref_vector_assign with a thread-shared reference");
-    return kk_Unit;
+    return kk_ref_vector_assign_thread_shared(r, idx, value, ctx);
   }
 }
 
@@ -1172,6 +1543,8 @@ struct kk_bytes_raw_s {             // pointer to bytes with free function
 
 
 kk_decl_export kk_string_t  kk_get_host(kk_context_t* ctx);
+kk_decl_export kk_string_t  kk_stats_to_string(kk_context_t* ctx);
+kk_decl_export int          kk_heap_profile_write_string(kk_string_t fname, kk_context_t* ctx);
 
 
 #endif // include guard
@@ -48,6 +48,9 @@
 #define kk_atomic_cas_strong_relaxed(p,exp,des) kk_atomic(compare_exchange_strong_explicit)(p,exp,des,kk_memory_order(relaxed),kk_memory_order(relaxed))
 #define kk_atomic_cas_strong_acq_rel(p,exp,des) kk_atomic(compare_exchange_strong_explicit)(p,exp,des,kk_memory_order(acq_rel),kk_memory_order(acquire))
 
+#define kk_atomic_exchange_acq_rel(p,x)       kk_atomic(exchange_explicit)(p,x,kk_memory_order(acq_rel))
+#define kk_atomic_fence_seq_cst()             kk_atomic(thread_fence)(kk_memory_order(seq_cst))
+
 #define kk_atomic_inc32_relaxed(p)            kk_atomic_add32_relaxed(p,1)
 #define kk_atomic_dec32_relaxed(p)            kk_atomic_sub32_relaxed(p,1)
 #define kk_atomic_inc32_acq_rel(p)            kk_atomic_add32_acq_rel(p,1)
@@ -110,6 +113,15 @@ static inline void kk_atomic_store_explicit(_Atomic(uintptr_t)*p, uintptr_t x, k
   WRAP64(_InterlockedExchange)((volatile msc_intptr_t*)p, (msc_intptr_t)x);
 }
 
+static inline uintptr_t kk_atomic_exchange_explicit(_Atomic(uintptr_t)*p, uintptr_t x, kk_memory_order_t mo) {
+  KK_UNUSED(mo);
+  return (uintptr_t)WRAP64(_InterlockedExchange)((volatile msc_intptr_t*)p, (msc_intptr_t)x);
+}
+static inline void kk_atomic_thread_fence(kk_memory_order_t mo) {
+  KK_UNUSED(mo);
+  MemoryBarrier();
+}
+
 static inline bool kk_atomic_compare_exchange_weak_explicit(_Atomic(uintptr_t)*p, uintptr_t* expected, uintptr_t desired, kk_memory_order_t mo, kk_memory_order_t mofail) {
   KK_UNUSED(mo); KK_UNUSED(mofail);
   uintptr_t prev;
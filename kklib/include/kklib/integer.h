@@ -254,6 +254,7 @@ static inline void kk_integer_drop(kk_integer_t i, kk_context_t* ctx) {
 kk_decl_export bool          kk_integer_parse(const char* num, kk_integer_t* result, kk_context_t* ctx);
 kk_decl_export bool          kk_integer_hex_parse(const char* s, kk_integer_t* res, kk_context_t* ctx);
 kk_decl_export kk_integer_t  kk_integer_from_str(const char* num, kk_context_t* ctx); // for known correct string number (returns 0 on wrong string)
+kk_decl_export void          kk_integer_cache_free(kk_context_t* ctx);  // release the cached powers used for conversions
 
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_from_big(kk_intx_t i, kk_context_t* ctx);         // for possibly large i
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_from_big64(int64_t i, kk_context_t* ctx);     // for possibly large i
@@ -268,6 +269,8 @@ kk_decl_export kk_decl_noinline double     kk_integer_as_double_generic(kk_integ
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_add_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx);
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_sub_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx);
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_mul_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx);
+kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_add_mul_generic(kk_integer_t x, kk_integer_t y, kk_integer_t z, kk_context_t* ctx);
+kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_mul_add_generic(kk_integer_t x, kk_integer_t y, kk_integer_t z, kk_context_t* ctx);
 
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_cdiv_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx);
 kk_decl_export kk_decl_noinline kk_integer_t  kk_integer_cmod_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx);
@@ -455,6 +458,18 @@ static inline kk_integer_t kk_integer_mul(kk_integer_t x, kk_integer_t y, kk_con
   return kk_integer_mul_generic(x, y, ctx);
 }
 
+// Fused `x + y*z`: adds the product in-place if `x` is a unique big integer.
+static inline kk_integer_t kk_integer_add_mul(kk_integer_t x, kk_integer_t y, kk_integer_t z, kk_context_t* ctx) {
+  if (kk_likely(kk_is_smallint(x) && kk_are_smallints(y, z))) return kk_integer_add(x, kk_integer_mul_small(y, z, ctx), ctx);
+  return kk_integer_add_mul_generic(x, y, z, ctx);
+}
+
+// Fused `x*y + z`: multiplies in-place if `x` is a unique big integer (and `y` and `z` are small).
+static inline kk_integer_t kk_integer_mul_add(kk_integer_t x, kk_integer_t y, kk_integer_t z, kk_context_t* ctx) {
+  if (kk_likely(kk_is_smallint(z) && kk_are_smallints(x, y))) return kk_integer_add(kk_integer_mul_small(x, y, ctx), z, ctx);
+  return kk_integer_mul_add_generic(x, y, z, ctx);
+}
+
 /* Fast divide on small integers. Since `boxed(n) = n*4 + 1`, we can divide as:
     4*((boxed(n)/2)/((boxed(m)/2) + 1
     = 4*((n*2)/(m*2)) + 1
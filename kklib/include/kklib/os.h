@@ -25,12 +25,63 @@ kk_decl_export kk_vector_t kk_os_get_env(kk_context_t* ctx);
 kk_decl_export int  kk_os_read_text_file(kk_string_t path, kk_string_t* result, kk_context_t* ctx);
 kk_decl_export int  kk_os_write_text_file(kk_string_t path, kk_string_t content, kk_context_t* ctx);
 
+// Streaming files: lines and chunks are returned as a `start` and `len` in a (shared) `buf`fer string.
+// The `found` result is `false` at the end of the file. All functions return an `errno` error code.
+typedef struct kk_os_file_s* kk_os_file_t;
+typedef enum kk_os_file_mode_e { KK_OS_FILE_READ, KK_OS_FILE_WRITE, KK_OS_FILE_APPEND } kk_os_file_mode_t;
+
+kk_decl_export int  kk_os_file_open(kk_string_t path, kk_os_file_mode_t mode, kk_os_file_t* file, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_close(kk_os_file_t file, kk_context_t* ctx);   // flushes; the handle stays valid until `kk_os_file_free`
+kk_decl_export void kk_os_file_free(kk_os_file_t file, kk_context_t* ctx);    // closes if needed
+kk_decl_export int  kk_os_file_read_line(kk_os_file_t file, kk_string_t* buf, size_t* start, size_t* len, bool* found, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_read_chunk(kk_os_file_t file, size_t max, kk_string_t* buf, size_t* start, size_t* len, bool* found, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_write_buf(kk_os_file_t file, const uint8_t* s, size_t len, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_write(kk_os_file_t file, kk_string_t s, kk_context_t* ctx);
+kk_decl_export int  kk_os_file_flush(kk_os_file_t file, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_os_file_box(kk_os_file_t file, kk_context_t* ctx);  // frees the file once the box is freed
+
+static inline kk_os_file_t kk_os_file_unbox(kk_box_t b) {
+  return (kk_os_file_t)kk_cptr_raw_unbox(b);
+}
+
 kk_decl_export int  kk_os_ensure_dir(kk_string_t dir, int mode, kk_context_t* ctx);
 kk_decl_export int  kk_os_copy_file(kk_string_t from, kk_string_t to, bool preserve_mtime, kk_context_t* ctx);
 kk_decl_export bool kk_os_is_directory(kk_string_t path, kk_context_t* ctx);
 kk_decl_export bool kk_os_is_file(kk_string_t path, kk_context_t* ctx);
 kk_decl_export int  kk_os_list_directory(kk_string_t dir, kk_vector_t* contents, kk_context_t* ctx);
 
+// Walk all entries under a directory (depth first, where the entries of a directory come before
+// those of its sub-directories). Symbolic links to directories are only followed with `follow_links`.
+typedef struct kk_os_walker_s* kk_os_walker_t;
+typedef enum kk_os_entry_kind_e { KK_OS_ENTRY_OTHER, KK_OS_ENTRY_FILE, KK_OS_ENTRY_DIR, KK_OS_ENTRY_LINK } kk_os_entry_kind_t;
+
+kk_decl_export int  kk_os_walker_open(kk_string_t dir, size_t max_depth, bool follow_links, kk_os_walker_t* walker, kk_context_t* ctx);
+kk_decl_export bool kk_os_walker_next(kk_os_walker_t walker, kk_string_t* path, kk_os_entry_kind_t* kind, kk_context_t* ctx);  // false at the end
+kk_decl_export void kk_os_walker_free(kk_os_walker_t walker, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_os_walker_box(kk_os_walker_t walker, kk_context_t* ctx);  // frees the walker once the box is freed
+
+static inline kk_os_walker_t kk_os_walker_unbox(kk_box_t b) {
+  return (kk_os_walker_t)kk_cptr_raw_unbox(b);
+}
+
+// Spawn a process from an argument vector of strings (without a shell) where `argv[0]` is searched
+// in the `PATH`. The output and error streams are captured in pipes if `capture_out` (`capture_err`)
+// is set; `kk_os_process_read` returns the next chunk of either stream (and `is_err` is set for
+// the error stream), where `found` is `false` once both streams are closed. Waiting discards any
+// unread output and returns the exit code and resource usage of the child (as in `kk_process_info`).
+typedef struct kk_os_process_s* kk_os_process_t;
+
+kk_decl_export int  kk_os_process_spawn(kk_vector_t argv, bool capture_out, bool capture_err, kk_os_process_t* proc, kk_context_t* ctx);
+kk_decl_export int  kk_os_process_read(kk_os_process_t proc, kk_string_t* chunk, bool* is_err, bool* found, kk_context_t* ctx);
+kk_decl_export intptr_t kk_os_process_fd(kk_os_process_t proc);  // a pipe to wait on before reading (or -1 once the streams are closed)
+kk_decl_export int  kk_os_process_wait(kk_os_process_t proc, int* exit_code, kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, kk_context_t* ctx);
+kk_decl_export void kk_os_process_free(kk_os_process_t proc, kk_context_t* ctx);  // does not kill (or wait for) the process
+kk_decl_export kk_box_t kk_os_process_box(kk_os_process_t proc, kk_context_t* ctx);  // frees the process handle once the box is freed
+
+static inline kk_os_process_t kk_os_process_unbox(kk_box_t b) {
+  return (kk_os_process_t)kk_cptr_raw_unbox(b);
+}
+
 kk_decl_export int  kk_os_run_command(kk_string_t cmd, kk_string_t* output, kk_context_t* ctx);
 kk_decl_export int  kk_os_run_system(kk_string_t cmd, kk_context_t* ctx);
 
@@ -19,5 +19,11 @@ kk_usecs_t kk_timer_end(kk_timer_t start);
 void       kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, 
                            size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit);
 
+// Wait for a child process to terminate and return its exit code (or minus the signal number if it was
+// killed by a signal) and its resource usage (as in `kk_process_info`). Returns an `errno` error code.
+// The `pid` is a process id on POSIX and a process `HANDLE` on Windows.
+int        kk_process_wait(intptr_t pid, int* exit_code, kk_msecs_t* utime, kk_msecs_t* stime,
+                           size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit);
+
 
 #endif // include guard
@@ -0,0 +1,119 @@
+#pragma once
+#ifndef KK_PVECTOR_H
+#define KK_PVECTOR_H
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Primitive vectors
+  A primitive vector stores unboxed `int32`, `int64`, `double`, or byte elements
+  contiguously (without scanned fields, like a raw string block). The element type is
+  given by the block tag. This avoids a box (and possibly a heap allocated double) per
+  element, and the kernels below are written so the C compiler can vectorize them.
+  As usual, functions take ownership of their primitive vector arguments, except for the
+  `_borrow` variants. Element wise kernels update a unique vector in place.
+--------------------------------------------------------------------------------------*/
+
+typedef struct kk_pvector_s {
+  kk_block_t  _block;              // KK_TAG_BYTES, KK_TAG_VECTOR_INT32, KK_TAG_VECTOR_INT64, or KK_TAG_VECTOR_DOUBLE
+  size_t      length;              // number of elements
+  union {
+    uint8_t   u8[1];
+    int32_t   i32[1];
+    int64_t   i64[1];
+    double    f64[1];
+  } data;                          // at a 16-byte offset so it is aligned for SIMD loads
+}* kk_pvector_t;
+
+static inline size_t kk_pvector_elem_size(kk_tag_t tag) {
+  switch (tag) {
+    case KK_TAG_VECTOR_INT32:  return sizeof(int32_t);
+    case KK_TAG_VECTOR_INT64:  return sizeof(int64_t);
+    case KK_TAG_VECTOR_DOUBLE: return sizeof(double);
+    default: kk_assert_internal(tag == KK_TAG_BYTES); return 1;
+  }
+}
+
+static inline kk_tag_t kk_pvector_tag(kk_pvector_t v) {
+  return kk_block_tag(&v->_block);
+}
+
+static inline size_t kk_pvector_len(kk_pvector_t v) {
+  return v->length;
+}
+
+static inline kk_pvector_t kk_pvector_dup(kk_pvector_t v) {
+  return kk_basetype_dup_as(kk_pvector_t, v);
+}
+
+static inline void kk_pvector_drop(kk_pvector_t v, kk_context_t* ctx) {
+  kk_basetype_drop(v, ctx);
+}
+
+static inline bool kk_pvector_is_unique(kk_pvector_t v) {
+  return kk_basetype_is_unique(v);
+}
+
+static inline kk_box_t kk_pvector_box(kk_pvector_t v, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  return kk_basetype_box(v);
+}
+
+static inline kk_pvector_t kk_pvector_unbox(kk_box_t b, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  return kk_basetype_unbox_as(kk_pvector_t, b);
+}
+
+static inline uint8_t* kk_pvector_bytes_buf(kk_pvector_t v) {
+  kk_assert_internal(kk_pvector_tag(v) == KK_TAG_BYTES);
+  return &v->data.u8[0];
+}
+
+static inline int32_t* kk_pvector_int32_buf(kk_pvector_t v) {
+  kk_assert_internal(kk_pvector_tag(v) == KK_TAG_VECTOR_INT32);
+  return &v->data.i32[0];
+}
+
+static inline int64_t* kk_pvector_int64_buf(kk_pvector_t v) {
+  kk_assert_internal(kk_pvector_tag(v) == KK_TAG_VECTOR_INT64);
+  return &v->data.i64[0];
+}
+
+static inline double* kk_pvector_double_buf(kk_pvector_t v) {
+  kk_assert_internal(kk_pvector_tag(v) == KK_TAG_VECTOR_DOUBLE);
+  return &v->data.f64[0];
+}
+
+// Allocation: the elements of `kk_pvector_alloc` are uninitialized.
+kk_decl_export kk_pvector_t kk_pvector_alloc(kk_tag_t tag, size_t length, kk_context_t* ctx);
+kk_decl_export kk_pvector_t kk_pvector_alloc_bytes(size_t length, uint8_t init, kk_context_t* ctx);
+kk_decl_export kk_pvector_t kk_pvector_alloc_int32(size_t length, int32_t init, kk_context_t* ctx);
+kk_decl_export kk_pvector_t kk_pvector_alloc_int64(size_t length, int64_t init, kk_context_t* ctx);
+kk_decl_export kk_pvector_t kk_pvector_alloc_double(size_t length, double init, kk_context_t* ctx);
+
+kk_decl_export kk_pvector_t kk_pvector_copy_borrow(kk_pvector_t v, kk_context_t* ctx);      // a fresh copy
+kk_decl_export kk_pvector_t kk_pvector_unique(kk_pvector_t v, kk_context_t* ctx);           // `v` itself if unique, or a copy
+kk_decl_export kk_pvector_t kk_pvector_slice(kk_pvector_t v, size_t start, size_t length, kk_context_t* ctx);
+kk_decl_export kk_pvector_t kk_pvector_append(kk_pvector_t v, kk_pvector_t w, kk_context_t* ctx);
+
+// Conversion from and to boxed vectors. Elements are boxed as `int32` for bytes and `int32`
+// vectors, as an `int` (`kk_integer_t`) for `int64` vectors, and as a `double` for double vectors.
+kk_decl_export kk_pvector_t kk_pvector_from_vector(kk_vector_t v, kk_tag_t tag, kk_context_t* ctx);
+kk_decl_export kk_vector_t  kk_pvector_to_vector(kk_pvector_t v, kk_context_t* ctx);
+
+// Kernels
+kk_decl_export int64_t      kk_pvector_int32_sum_borrow(kk_pvector_t v);
+kk_decl_export int64_t      kk_pvector_int64_sum_borrow(kk_pvector_t v);
+kk_decl_export double       kk_pvector_double_sum_borrow(kk_pvector_t v);
+kk_decl_export int64_t      kk_pvector_int64_dot_borrow(kk_pvector_t x, kk_pvector_t y);   // over the shortest length
+kk_decl_export double       kk_pvector_double_dot_borrow(kk_pvector_t x, kk_pvector_t y);  // over the shortest length
+kk_decl_export kk_pvector_t kk_pvector_double_scale(kk_pvector_t x, double a, kk_context_t* ctx);                     // `a*x`
+kk_decl_export kk_pvector_t kk_pvector_double_axpy(double a, kk_pvector_t x, kk_pvector_t y, kk_context_t* ctx);      // `a*x + y`
+kk_decl_export kk_pvector_t kk_pvector_double_map(kk_pvector_t x, double (*f)(double), kk_context_t* ctx);           // `f(x)` element wise
+
+#endif // include guard
@@ -10,9 +10,14 @@
   found in the file "license.txt" at the root of this distribution.
 ---------------------------------------------------------------------------*/
 
+// Number of chacha20 blocks that are computed at once (in SIMD lanes)
+#ifndef KK_CHACHA_LANES
+#define KK_CHACHA_LANES  (4)
+#endif
+
 // Strong random state based on chacha20.
 typedef struct kk_random_ctx_s {
-  uint32_t output[16]; // current output
+  uint32_t output[16*KK_CHACHA_LANES]; // current output
   uint32_t input[16];  // current state
   int32_t  used;       // how many output fields are already used?
   bool     is_strong;  // initialized from strong random source?
@@ -24,7 +29,7 @@ kk_decl_export kk_random_ctx_t* kk_srandom_round(kk_context_t* ctx);
 // Initial randomness comes from the OS.
 static inline uint32_t kk_srandom_uint32(kk_context_t* ctx) {
   kk_random_ctx_t* rnd = ctx->srandom_ctx;
-  if (kk_unlikely(rnd == NULL || rnd->used >= 16)) {
+  if (kk_unlikely(rnd == NULL || rnd->used >= 16*KK_CHACHA_LANES)) {
     rnd = kk_srandom_round(ctx);
   }
   uint32_t x = rnd->output[rnd->used];
@@ -43,6 +48,44 @@ static inline uint64_t kk_srandom_uint64(kk_context_t* ctx) {
 kk_decl_export bool     kk_srandom_is_strong(kk_context_t* ctx);
 kk_decl_export uint32_t kk_srandom_range32(uint32_t max, kk_context_t* ctx);  // unbiased range
 kk_decl_export double   kk_srandom_double(kk_context_t* ctx);
+kk_decl_export void     kk_srandom_fill(void* buf, size_t size, kk_context_t* ctx);  // fill `size` bytes
+
+
+// Fast pseudo random number state (using sfc32); not secure.
+typedef struct kk_prandom_s {
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  uint32_t counter;
+} kk_prandom_t;
+
+// Pseudo random number using sfc32 by Chris Doty-Humphrey.
+// It is a "chaotic" pseudo random generator that uses 32-bit operations only
+// (so we can be deterministic across architectures in results and performance).
+// It has good statistical properties and passes PractRand and Big-crush.
+// It uses a 32-bit counter to guarantee a worst-case cycle
+// of 2^32. It has a 96-bit state, so the average period is 2^127.
+// <http://pracrand.sourceforge.net/RNG_engines.txt>
+static inline uint32_t kk_prandom_uint32(kk_prandom_t* rnd) {
+  uint32_t x = rnd->a + rnd->b + rnd->counter;
+  rnd->counter++;
+  rnd->a = rnd->b ^ (rnd->b >> 9);
+  rnd->b = rnd->c + (rnd->c << 3);
+  rnd->c = kk_bits_rotl32(rnd->c, 21) + x;
+  return x;
+}
+
+static inline uint64_t kk_prandom_uint64(kk_prandom_t* rnd) {
+  const uint64_t hi = kk_prandom_uint32(rnd);
+  return ((hi << 32) | kk_prandom_uint32(rnd));
+}
+
+kk_decl_export void     kk_prandom_init(uint64_t seed, kk_prandom_t* rnd);            // deterministic
+kk_decl_export void     kk_prandom_init_srandom(kk_prandom_t* rnd, kk_context_t* ctx); // seeded from the strong random source
+kk_decl_export void     kk_prandom_split(kk_prandom_t* rnd, kk_prandom_t* rnd_new);    // an independent stream, for example for a task
+kk_decl_export uint32_t kk_prandom_range32(uint32_t max, kk_prandom_t* rnd);           // unbiased range
+kk_decl_export double   kk_prandom_double(kk_prandom_t* rnd);
+kk_decl_export void     kk_prandom_fill(void* buf, size_t size, kk_prandom_t* rnd);
 
 
 #endif // include guard
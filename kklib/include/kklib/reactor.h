@@ -0,0 +1,39 @@
+#pragma once
+#ifndef KK_REACTOR_H
+#define KK_REACTOR_H
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  I/O reactor
+  A reactor waits for file descriptors to become readable or writable, and for timers
+  to expire. Each registration is one-shot and carries an (owned) boxed value that is
+  returned by `kk_reactor_wait` once its event happened; `std/async` registers the
+  resumption of a suspended strand and resumes it on completion.
+  Uses `epoll` on Linux, `kqueue` on BSD and macOS, and `poll` otherwise. Only timers
+  are supported on Windows (where file descriptor registrations return `ENOSYS`).
+  All functions return an `errno` error code.
+--------------------------------------------------------------------------------------*/
+
+typedef struct kk_reactor_s* kk_reactor_t;
+
+kk_decl_export int      kk_reactor_create(kk_reactor_t* reactor, kk_context_t* ctx);
+kk_decl_export void     kk_reactor_free(kk_reactor_t reactor, kk_context_t* ctx);     // drops the values of pending registrations
+kk_decl_export int      kk_reactor_add_fd(kk_reactor_t reactor, intptr_t fd, bool write, kk_box_t value, kk_context_t* ctx);
+kk_decl_export int      kk_reactor_add_timer(kk_reactor_t reactor, kk_msecs_t msecs, kk_box_t value, kk_context_t* ctx);
+kk_decl_export size_t   kk_reactor_pending(kk_reactor_t reactor);                     // number of pending registrations
+// Wait at most `timeout` milli-seconds (or indefinitely if negative) for at least one event and
+// return the values of the completed registrations in `ready` (empty if nothing is pending).
+kk_decl_export int      kk_reactor_wait(kk_reactor_t reactor, kk_msecs_t timeout, kk_vector_t* ready, kk_context_t* ctx);
+kk_decl_export kk_box_t kk_reactor_box(kk_reactor_t reactor, kk_context_t* ctx);     // frees the reactor once the box is freed
+
+static inline kk_reactor_t kk_reactor_unbox(kk_box_t b) {
+  return (kk_reactor_t)kk_cptr_raw_unbox(b);
+}
+
+#endif // include guard
@@ -67,7 +67,8 @@ typedef struct kk_string_small_s {
 typedef struct kk_string_normal_s {
   struct kk_string_s _base;
   size_t  length;
-  uint8_t str[1];  // UTF8 string in-place of `length+1` bytes ending in 0
+  size_t  capacity;  // available bytes in `str` (excluding the 0 terminator) so a unique string can be appended in-place
+  uint8_t str[1];    // UTF8 string in-place of `length+1` bytes ending in 0
 } *kk_string_normal_t;
 
 typedef struct kk_string_raw_s {
@@ -79,8 +80,8 @@ typedef struct kk_string_raw_s {
 
 // Define string literals
 #define kk_define_string_literal(decl,name,len,chars) \
-  static struct { struct kk_string_s _base; size_t length; char str[len+1]; } _static_##name = \
-    { { { KK_HEADER_STATIC(0,KK_TAG_STRING) } }, len, chars }; \
+  static struct { struct kk_string_s _base; size_t length; size_t capacity; char str[len+1]; } _static_##name = \
+    { { { KK_HEADER_STATIC(0,KK_TAG_STRING) } }, len, len, chars }; \
   decl kk_string_t name = { &_static_##name._base._block };  
 
 #define kk_define_string_literal_empty(decl,name) \
@@ -110,6 +111,7 @@ static inline kk_string_t kk_string_dup(kk_string_t str) {
 // Allocate a string of `len` bytes. `s` must be at least `len` bytes of valid UTF8, or NULL. Adds a terminating zero at the end.
 kk_decl_export kk_string_t kk_string_alloc_len_unsafe(size_t len, const char* s, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_string_adjust_length(kk_string_t str, size_t newlen, kk_context_t* ctx);
+kk_decl_export kk_string_t kk_string_validate_utf8(kk_string_t str, kk_context_t* ctx);  // replace invalid sequences by the replacement character
 
 static inline kk_string_t kk_string_alloc_buf(size_t len, kk_context_t* ctx) {
   return kk_string_alloc_len_unsafe(len, NULL, ctx);
@@ -128,17 +130,24 @@ static inline kk_string_t kk_string_alloc_dupn(size_t maxlen, const char* s, kk_
 }
 
 // Raw string that directly points to an external buffer.
-static inline kk_string_t kk_string_alloc_raw_len(size_t len, const char* s, bool free, kk_context_t* ctx) {
+// Create a raw string from `len` bytes at `s` (which must be followed by a zero byte);
+// the `free` function is called on `s` when the string is freed (if not NULL).
+static inline kk_string_t kk_string_alloc_raw_buf(size_t len, const char* s, kk_free_fun_t* free, kk_context_t* ctx) {
   if (len == 0 || s==NULL) return kk_string_empty();
-  kk_assert_internal(s[len]==0 && strlen(s)==len);
+  kk_assert_internal(s[len]==0);
   struct kk_string_raw_s* str = kk_block_alloc_as(struct kk_string_raw_s, 0, KK_TAG_STRING_RAW, ctx);
-  str->free = (free ? &kk_free_fun : NULL);
+  str->free = free;
   str->cstr = (const uint8_t*)s;
   str->length = len;
   // todo: kk_assert valid UTF8 in debug mode
   return kk_datatype_from_base(&str->_base);
 }
 
+static inline kk_string_t kk_string_alloc_raw_len(size_t len, const char* s, bool free, kk_context_t* ctx) {
+  kk_assert_internal(s==NULL || strlen(s)==len);
+  return kk_string_alloc_raw_buf(len, s, (free ? &kk_free_fun : NULL), ctx);
+}
+
 static inline kk_string_t kk_string_alloc_raw(const char* s, bool free, kk_context_t* ctx) {
   if (s==NULL) return kk_string_empty();
   return kk_string_alloc_raw_len(strlen(s), s, free, ctx);
@@ -190,8 +199,8 @@ static inline size_t kk_decl_pure kk_string_len_borrow(const kk_string_t str) {
 }
 
 static inline kk_string_t kk_string_copy(kk_string_t str, kk_context_t* ctx) {
-  if (kk_datatype_is_singleton(str) || kk_datatype_is_unique(str)) {
-    return str;
+  if (kk_datatype_is_singleton(str) || (kk_datatype_is_unique(str) && kk_datatype_has_tag(str, KK_TAG_STRING))) {
+    return str;  // can be mutated in-place (raw strings may point to read-only memory)
   }
   else {
     kk_string_t tstr = kk_string_alloc_dup( kk_string_cbuf_borrow(str), ctx);
@@ -254,7 +263,9 @@ static inline kk_char_t kk_utf8_read_validate(const uint8_t* s, size_t* count) {
   }
   // 3 byte encoding; reject overlong and UTF16 surrogate halves (0xD800 - 0xDFFF)
   else if ((b == 0xE0 && s[1] >= 0xA0 && s[1] <= 0xBF && kk_utf8_is_cont(s[2]))
-    || (b >= 0xE1 && b <= 0xEC && kk_utf8_is_cont(s[1]) && kk_utf8_is_cont(s[2])))
+    || (b >= 0xE1 && b <= 0xEC && kk_utf8_is_cont(s[1]) && kk_utf8_is_cont(s[2]))
+    || (b == 0xED && s[1] >= 0x80 && s[1] <= 0x9F && kk_utf8_is_cont(s[2]))
+    || (b >= 0xEE && b <= 0xEF && kk_utf8_is_cont(s[1]) && kk_utf8_is_cont(s[2])))
   {
     *count = 3;
     kk_char_t c = (((b & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F));
@@ -379,6 +390,19 @@ static inline void kk_utf8_write(kk_char_t c, uint8_t* s, size_t* count) {
   }
 }
 
+// Vectorized routines on `len` bytes of UTF8 (see `utf8.c`)
+kk_decl_export bool kk_decl_pure           kk_utf8_is_valid(const uint8_t* s, size_t len);   // valid modified UTF8 without raw zero bytes?
+kk_decl_export size_t kk_decl_pure         kk_utf8_count(const uint8_t* s, size_t len);      // number of code points
+kk_decl_export const uint8_t* kk_decl_pure kk_utf8_skip(const uint8_t* s, const uint8_t* end, size_t n);  // advance `n` code points (but not beyond `end`)
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__SSSE3__)
+extern bool kk_has_ssse3;  // initialized in init.c (used by `kk_utf8_is_valid`)
+#endif
+
+// Find the first (or last) occurrence of the byte sequence `pat` of length `m` in `s` of length `n` (or NULL) (see `utf8.c`)
+kk_decl_export const uint8_t* kk_decl_pure kk_memsearch(const uint8_t* s, size_t n, const uint8_t* pat, size_t m);
+kk_decl_export const uint8_t* kk_decl_pure kk_memsearch_last(const uint8_t* s, size_t n, const uint8_t* pat, size_t m);
+
 
 /*--------------------------------------------------------------------------------------------------
   
@@ -445,6 +469,7 @@ kk_decl_export kk_string_t  kk_string_trim_right(kk_string_t strs, kk_context_t*
 
 kk_decl_export kk_unit_t kk_println(kk_string_t s, kk_context_t* ctx);
 kk_decl_export kk_unit_t kk_print(kk_string_t s, kk_context_t* ctx);
+kk_decl_export kk_unit_t kk_print_flush(kk_context_t* ctx);   // write buffered output of `kk_print(ln)` to stdout
 kk_decl_export kk_unit_t kk_trace(kk_string_t s, kk_context_t* ctx);
 kk_decl_export kk_unit_t kk_trace_any(kk_string_t s, kk_box_t x, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_show_any(kk_box_t x, kk_context_t* ctx);
@@ -453,5 +478,53 @@ kk_decl_export kk_string_t kk_double_show_fixed(double d, int32_t prec, kk_conte
 kk_decl_export kk_string_t kk_double_show_exp(double d, int32_t prec, kk_context_t* ctx);
 kk_decl_export kk_string_t kk_double_show(double d, int32_t prec, kk_context_t* ctx);
 
+// Write the shortest round-trip representation of `d` in `%g` form with at most `|prec|` significant
+// digits (using `snprintf` if more digits are needed). Returns the length (excluding the terminating zero).
+#define KK_DOUBLE_SHORTEST_MAX  (64)   // required minimal buffer size
+kk_decl_export size_t kk_double_to_shortest(double d, int32_t prec, char* buf, size_t buflen);
+
+// Write `d` like `snprintf` with `"%.<prec><spec>"` where `spec` is `'f'`, `'e'`, or `'g'` (and `prec >= 0`),
+// using the shortest digits when those suffice. The buffer must have room for `KK_DOUBLE_SHORTEST_MAX` bytes.
+kk_decl_export size_t kk_double_to_prec(double d, int32_t prec, char spec, char* buf, size_t buflen);
+
+// Parse a double like `strtod` (but independent of the locale for common input).
+kk_decl_export double kk_double_parse(const char* s, const char** end);
+
+
+/*--------------------------------------------------------------------------------------------------
+  String builder
+  For building very long strings: appended strings of at least `KK_STRING_BUILDER_CHUNK` bytes
+  are kept by reference as a chunk while smaller ones are copied into a tail chunk. The chunks are
+  flattened (once) into a single string when the contents are needed.
+  Usage: `kk_string_builder_t sb = kk_string_builder_empty(); kk_string_builder_append(&sb, s, ctx); ...
+          kk_string_t result = kk_string_builder_finish(&sb, ctx);`
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_string_builder_s {
+  size_t       length;    // total length in bytes
+  size_t       count;     // number of chunks in use
+  size_t       capacity;  // allocated entries in `chunks`
+  kk_string_t* chunks;    // owned chunks (when `capacity > 0`)
+} kk_string_builder_t;
+
+static inline kk_string_builder_t kk_string_builder_empty(void) {
+  kk_string_builder_t sb = { 0, 0, 0, NULL };
+  return sb;
+}
+
+static inline size_t kk_string_builder_len_borrow(const kk_string_builder_t* sb) {
+  return sb->length;
+}
+
+kk_decl_export void        kk_string_builder_append(kk_string_builder_t* sb, kk_string_t s, kk_context_t* ctx);
+kk_decl_export void        kk_string_builder_append_buf(kk_string_builder_t* sb, const char* s, size_t len, kk_context_t* ctx);  // `s` must be `len` bytes of valid UTF8
+kk_decl_export const char* kk_string_builder_cbuf_borrow(kk_string_builder_t* sb, kk_context_t* ctx);  // flattens the builder
+kk_decl_export kk_string_t kk_string_builder_finish(kk_string_builder_t* sb, kk_context_t* ctx);       // return the result and reset the builder
+kk_decl_export void        kk_string_builder_drop(kk_string_builder_t* sb, kk_context_t* ctx);
+
+static inline void kk_string_builder_append_cstr(kk_string_builder_t* sb, const char* s, kk_context_t* ctx) {
+  kk_string_builder_append_buf(sb, s, strlen(s), ctx);
+}
+
 
 #endif // include guard
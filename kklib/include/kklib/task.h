@@ -0,0 +1,61 @@
+#pragma once
+#ifndef KK_TASK_H
+#define KK_TASK_H
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Tasks
+  `kk_task_spawn` pushes a task on the work-stealing deque of the current thread; a
+  pool of worker threads (each with their own context) steals and runs the tasks.
+  `kk_task_join` waits for the result of a task and runs other tasks meanwhile.
+  The action and its result are marked thread-shared as they cross threads, and an
+  action should not yield to (unhandled) effect handlers.
+  Without thread support (Windows for now) tasks run directly when spawned.
+--------------------------------------------------------------------------------------*/
+
+typedef struct kk_task_s* kk_task_t;
+
+kk_decl_export kk_task_t kk_task_spawn(kk_function_t action, kk_context_t* ctx);  // action : () -> a
+kk_decl_export kk_box_t  kk_task_join(kk_task_t task, kk_context_t* ctx);         // returns a (owned) result; can be called multiple times
+kk_decl_export void      kk_task_drop(kk_task_t task, kk_context_t* ctx);         // release the task handle
+kk_decl_export size_t    kk_task_worker_count(kk_context_t* ctx);
+kk_decl_export void      kk_task_pool_stop(kk_context_t* ctx);                   // stop the workers when they are done with their current task (at the end of main)
+
+// Boxed task handles for use from Koka (`std/os/task`)
+kk_decl_export kk_box_t  kk_task_spawn_box(kk_function_t action, kk_context_t* ctx);
+kk_decl_export kk_box_t  kk_task_join_box(kk_box_t task, kk_context_t* ctx);
+
+
+/*--------------------------------------------------------------------------------------
+  Parallel loops
+  `kk_task_for` splits the range `[0,n)` into `chunks` consecutive chunks and calls
+  `body` on each of them: all but the last in a task, while the current thread runs the
+  last one and then helps out until all are done. `kk_task_chunks` gives the number of
+  chunks to use for ranges where each chunk has at least `grain` indices (and is 1 if the
+  loop should run sequentially). Only if there is more than one chunk, any value that is
+  read by the body has to be marked as thread-shared beforehand. The values created by
+  the body belong to the current thread once `kk_task_for` returns and are not marked.
+--------------------------------------------------------------------------------------*/
+
+typedef void (kk_task_range_fun_t)(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx);
+
+kk_decl_export size_t kk_task_chunks(size_t n, size_t grain, kk_context_t* ctx);
+kk_decl_export void   kk_task_for(size_t n, size_t chunks, kk_task_range_fun_t* body, void* arg, kk_context_t* ctx);
+
+// Vectors of at least `KK_VECTOR_PAR_MIN` elements are processed in parallel. The functions
+// must be total (and `f` of `kk_vector_reduce_par` associative with `zero` as its unit).
+#ifndef KK_VECTOR_PAR_MIN
+#define KK_VECTOR_PAR_MIN  (4096)
+#endif
+
+kk_decl_export kk_vector_t kk_vector_init_par(size_t n, kk_function_t init, kk_context_t* ctx);              // init : size_t -> a
+kk_decl_export kk_vector_t kk_vector_map_par(kk_vector_t v, kk_function_t f, kk_context_t* ctx);             // f : a -> b
+kk_decl_export kk_box_t    kk_vector_reduce_par(kk_vector_t v, kk_box_t zero, kk_function_t f, kk_context_t* ctx);  // f : (a,a) -> a
+
+#endif // include guard
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef KK_TRACE_H
+#define KK_TRACE_H
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Tracing (only with `KK_TRACE`)
+  Begin and end events are recorded with a cycle counter (`rdtsc` or `cntvct`) in a ring
+  buffer per context that keeps the last `KK_TRACE_EVENTS` events. Tracing starts with
+  `kk_trace_start` (or `--kktrace=<file>`) and `kk_trace_write` writes all buffers in
+  the Chrome trace event format (viewable in Perfetto or `chrome://tracing`), where the
+  cycle counter is calibrated against `kk_timer_start`.
+  Event names must be static strings. Code compiled with `-finstrument-functions`
+  (`koka --ctrace`) records the entry and exit of every function as well.
+--------------------------------------------------------------------------------------*/
+#ifndef KK_TRACE_EVENTS
+#define KK_TRACE_EVENTS  (1<<16)  // events kept per context (a power of 2)
+#endif
+
+typedef struct kk_trace_event_s {
+  uint64_t     ticks;
+  const void*  name;      // a static string, or a code address if `is_addr`
+  char         phase;     // 'B'egin, 'E'nd, or 'i'nstant
+  bool         is_addr;
+} kk_trace_event_t;
+
+typedef struct kk_trace_buf_s {
+  struct kk_trace_buf_s* next;   // list of all buffers
+  uint64_t               count;  // total recorded events
+  uintptr_t              tid;
+  kk_trace_event_t       events[KK_TRACE_EVENTS];
+} kk_trace_buf_t;
+
+kk_decl_export void kk_trace_start(kk_context_t* ctx);
+kk_decl_export int  kk_trace_write(const char* fname);    // returns 0 or an error code
+kk_decl_export void kk_trace_thread_init(kk_context_t* ctx);
+
+static inline uint64_t kk_trace_ticks(void) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return __rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  return __builtin_ia32_rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+  uint64_t t;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+  return t;
+#else
+  return (uint64_t)kk_timer_start();
+#endif
+}
+
+static inline void kk_trace_event(char phase, const void* name, bool is_addr, kk_trace_buf_t* buf) {
+  kk_trace_event_t* ev = &buf->events[buf->count++ & (KK_TRACE_EVENTS - 1)];
+  ev->ticks = kk_trace_ticks();
+  ev->name = name;
+  ev->phase = phase;
+  ev->is_addr = is_addr;
+}
+
+static inline void kk_trace_begin(const char* name, kk_context_t* ctx) {
+#if KK_TRACE
+  if (kk_unlikely(ctx->trace != NULL)) kk_trace_event('B', name, false, ctx->trace);
+#else
+  KK_UNUSED(name); KK_UNUSED(ctx);
+#endif
+}
+
+static inline void kk_trace_end(const char* name, kk_context_t* ctx) {
+#if KK_TRACE
+  if (kk_unlikely(ctx->trace != NULL)) kk_trace_event('E', name, false, ctx->trace);
+#else
+  KK_UNUSED(name); KK_UNUSED(ctx);
+#endif
+}
+
+static inline void kk_trace_instant(const char* name, kk_context_t* ctx) {
+#if KK_TRACE
+  if (kk_unlikely(ctx->trace != NULL)) kk_trace_event('i', name, false, ctx->trace);
+#else
+  KK_UNUSED(name); KK_UNUSED(ctx);
+#endif
+}
+
+#endif // include guard
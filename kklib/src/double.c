@@ -0,0 +1,510 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+#include <float.h>   // FLT_EVAL_METHOD, DBL_MIN
+#include <math.h>    // isfinite
+
+/*--------------------------------------------------------------------------------------------------
+  Shortest double formatting (see also `string.h`)
+  We use the Grisu3 algorithm of Florian Loitsch ("Printing floating-point numbers quickly and
+  accurately with integers", PLDI 2010) as also used in the double-conversion library of V8.
+  It produces the shortest digits that round-trip, and among those the closest to the exact value.
+  For about 0.5% of the doubles Grisu3 cannot decide and we fall back to `snprintf`.
+--------------------------------------------------------------------------------------------------*/
+
+// A "do-it-yourself" floating point number `f * 2^e`.
+typedef struct kk_diyfp_s {
+  uint64_t f;
+  int      e;
+} kk_diyfp_t;
+
+static inline kk_diyfp_t diyfp(uint64_t f, int e) {
+  kk_diyfp_t x = { f, e };
+  return x;
+}
+
+// Multiply and round the upper 64 bits (portable, using 32-bit halves)
+static kk_diyfp_t diyfp_mul(kk_diyfp_t x, kk_diyfp_t y) {
+  const uint64_t M32 = KU64(0xFFFFFFFF);
+  const uint64_t a = x.f >> 32;
+  const uint64_t b = x.f & M32;
+  const uint64_t c = y.f >> 32;
+  const uint64_t d = y.f & M32;
+  const uint64_t ac = a*c;
+  const uint64_t bc = b*c;
+  const uint64_t ad = a*d;
+  const uint64_t bd = b*d;
+  uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+  tmp += KU64(1) << 31;  // round
+  return diyfp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static inline kk_diyfp_t diyfp_normalize(kk_diyfp_t x) {
+  kk_assert_internal(x.f != 0);
+  const int shift = kk_bits_clz64(x.f);
+  return diyfp(x.f << shift, x.e - shift);
+}
+
+#define KK_DOUBLE_HIDDEN_BIT   (KU64(1) << 52)
+#define KK_DOUBLE_DENORMAL_EXP (-1074)
+
+static kk_diyfp_t diyfp_from_double(double d) {
+  uint64_t u;
+  memcpy(&u, &d, sizeof(u));
+  const uint64_t sig = u & (KK_DOUBLE_HIDDEN_BIT - 1);
+  const int bexp = (int)((u >> 52) & 0x7FF);
+  if (bexp == 0) return diyfp(sig, KK_DOUBLE_DENORMAL_EXP);
+            else return diyfp(sig | KK_DOUBLE_HIDDEN_BIT, bexp - 1075);
+}
+
+// The normalized boundaries `m-` and `m+` halfway to the neighbouring doubles (with the exponent of `m+`).
+// The lower boundary is closer if `v` is a power of two (and not the smallest normal number).
+static void diyfp_boundaries(kk_diyfp_t v, kk_diyfp_t* mminus, kk_diyfp_t* mplus) {
+  const kk_diyfp_t p = diyfp_normalize(diyfp((v.f << 1) + 1, v.e - 1));
+  kk_diyfp_t m;
+  if (v.f == KK_DOUBLE_HIDDEN_BIT && v.e != KK_DOUBLE_DENORMAL_EXP) {
+    m = diyfp((v.f << 2) - 1, v.e - 2);
+  }
+  else {
+    m = diyfp((v.f << 1) - 1, v.e - 1);
+  }
+  m.f <<= (m.e - p.e);
+  m.e = p.e;
+  *mminus = m;
+  *mplus = p;
+}
+
+// Normalized powers of ten `10^k` for `k` in `-348, -340, ..., 340` (rounded to 64 bits)
+typedef struct kk_cached_power_s {
+  uint64_t f;
+  int16_t  e;
+} kk_cached_power_t;
+
+static const kk_cached_power_t kk_cached_powers[] = {
+  { KU64(0xFA8FD5A0081C0288), -1220 }, { KU64(0xBAAEE17FA23EBF76), -1193 },
+  { KU64(0x8B16FB203055AC76), -1166 }, { KU64(0xCF42894A5DCE35EA), -1140 },
+  { KU64(0x9A6BB0AA55653B2D), -1113 }, { KU64(0xE61ACF033D1A45DF), -1087 },
+  { KU64(0xAB70FE17C79AC6CA), -1060 }, { KU64(0xFF77B1FCBEBCDC4F), -1034 },
+  { KU64(0xBE5691EF416BD60C), -1007 }, { KU64(0x8DD01FAD907FFC3C), -980 },
+  { KU64(0xD3515C2831559A83), -954 }, { KU64(0x9D71AC8FADA6C9B5), -927 },
+  { KU64(0xEA9C227723EE8BCB), -901 }, { KU64(0xAECC49914078536D), -874 },
+  { KU64(0x823C12795DB6CE57), -847 }, { KU64(0xC21094364DFB5637), -821 },
+  { KU64(0x9096EA6F3848984F), -794 }, { KU64(0xD77485CB25823AC7), -768 },
+  { KU64(0xA086CFCD97BF97F4), -741 }, { KU64(0xEF340A98172AACE5), -715 },
+  { KU64(0xB23867FB2A35B28E), -688 }, { KU64(0x84C8D4DFD2C63F3B), -661 },
+  { KU64(0xC5DD44271AD3CDBA), -635 }, { KU64(0x936B9FCEBB25C996), -608 },
+  { KU64(0xDBAC6C247D62A584), -582 }, { KU64(0xA3AB66580D5FDAF6), -555 },
+  { KU64(0xF3E2F893DEC3F126), -529 }, { KU64(0xB5B5ADA8AAFF80B8), -502 },
+  { KU64(0x87625F056C7C4A8B), -475 }, { KU64(0xC9BCFF6034C13053), -449 },
+  { KU64(0x964E858C91BA2655), -422 }, { KU64(0xDFF9772470297EBD), -396 },
+  { KU64(0xA6DFBD9FB8E5B88F), -369 }, { KU64(0xF8A95FCF88747D94), -343 },
+  { KU64(0xB94470938FA89BCF), -316 }, { KU64(0x8A08F0F8BF0F156B), -289 },
+  { KU64(0xCDB02555653131B6), -263 }, { KU64(0x993FE2C6D07B7FAC), -236 },
+  { KU64(0xE45C10C42A2B3B06), -210 }, { KU64(0xAA242499697392D3), -183 },
+  { KU64(0xFD87B5F28300CA0E), -157 }, { KU64(0xBCE5086492111AEB), -130 },
+  { KU64(0x8CBCCC096F5088CC), -103 }, { KU64(0xD1B71758E219652C), -77 },
+  { KU64(0x9C40000000000000), -50 }, { KU64(0xE8D4A51000000000), -24 },
+  { KU64(0xAD78EBC5AC620000), 3 }, { KU64(0x813F3978F8940984), 30 },
+  { KU64(0xC097CE7BC90715B3), 56 }, { KU64(0x8F7E32CE7BEA5C70), 83 },
+  { KU64(0xD5D238A4ABE98068), 109 }, { KU64(0x9F4F2726179A2245), 136 },
+  { KU64(0xED63A231D4C4FB27), 162 }, { KU64(0xB0DE65388CC8ADA8), 189 },
+  { KU64(0x83C7088E1AAB65DB), 216 }, { KU64(0xC45D1DF942711D9A), 242 },
+  { KU64(0x924D692CA61BE758), 269 }, { KU64(0xDA01EE641A708DEA), 295 },
+  { KU64(0xA26DA3999AEF774A), 322 }, { KU64(0xF209787BB47D6B85), 348 },
+  { KU64(0xB454E4A179DD1877), 375 }, { KU64(0x865B86925B9BC5C2), 402 },
+  { KU64(0xC83553C5C8965D3D), 428 }, { KU64(0x952AB45CFA97A0B3), 455 },
+  { KU64(0xDE469FBD99A05FE3), 481 }, { KU64(0xA59BC234DB398C25), 508 },
+  { KU64(0xF6C69A72A3989F5C), 534 }, { KU64(0xB7DCBF5354E9BECE), 561 },
+  { KU64(0x88FCF317F22241E2), 588 }, { KU64(0xCC20CE9BD35C78A5), 614 },
+  { KU64(0x98165AF37B2153DF), 641 }, { KU64(0xE2A0B5DC971F303A), 667 },
+  { KU64(0xA8D9D1535CE3B396), 694 }, { KU64(0xFB9B7CD9A4A7443C), 720 },
+  { KU64(0xBB764C4CA7A44410), 747 }, { KU64(0x8BAB8EEFB6409C1A), 774 },
+  { KU64(0xD01FEF10A657842C), 800 }, { KU64(0x9B10A4E5E9913129), 827 },
+  { KU64(0xE7109BFBA19C0C9D), 853 }, { KU64(0xAC2820D9623BF429), 880 },
+  { KU64(0x80444B5E7AA7CF85), 907 }, { KU64(0xBF21E44003ACDD2D), 933 },
+  { KU64(0x8E679C2F5E44FF8F), 960 }, { KU64(0xD433179D9C8CB841), 986 },
+  { KU64(0x9E19DB92B4E31BA9), 1013 }, { KU64(0xEB96BF6EBADF77D9), 1039 },
+  { KU64(0xAF87023B9BF0EE6B), 1066 },
+};
+
+#define KK_CACHED_POWERS_MIN_K    (-348)
+#define KK_CACHED_POWERS_K_STEP   (8)
+#define KK_GRISU_MIN_EXP          (-60)   // target exponent range of the scaled number
+#define KK_GRISU_MAX_EXP          (-32)
+
+// Find a cached power `10^k` such that its binary exponent is between `min_exp` and `min_exp + 27`.
+static kk_diyfp_t cached_power(int min_exp, int* k) {
+  const double dk = ceil((double)(min_exp + 63) * 0.30102999566398114);  // 1/log2(10)
+  const int index = (-KK_CACHED_POWERS_MIN_K + (int)dk - 1) / KK_CACHED_POWERS_K_STEP + 1;
+  kk_assert_internal(index >= 0 && index < (int)(sizeof(kk_cached_powers)/sizeof(kk_cached_powers[0])));
+  const kk_cached_power_t p = kk_cached_powers[index];
+  kk_assert_internal(p.e >= min_exp && p.e <= min_exp + (KK_GRISU_MAX_EXP - KK_GRISU_MIN_EXP));
+  *k = KK_CACHED_POWERS_MIN_K + index*KK_CACHED_POWERS_K_STEP;
+  return diyfp(p.f, p.e);
+}
+
+// Largest power of ten `<= n` (or 0 if `n==0`) and its number of digits
+static uint32_t biggest_pow10(uint32_t n, int* digits) {
+  static const uint32_t pow10[] = { 0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+  int k = 10;
+  while (k > 0 && n < pow10[k]) k--;
+  *digits = k;
+  return pow10[k];
+}
+
+// Adjust the last digit towards `w` and check if the result is guaranteed to be the closest.
+static bool grisu_round_weed(char* buf, int len, uint64_t dist_high_w, uint64_t unsafe, uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+  const uint64_t small_dist = dist_high_w - unit;
+  const uint64_t big_dist = dist_high_w + unit;
+  while (rest < small_dist && unsafe - rest >= ten_kappa &&
+         (rest + ten_kappa < small_dist || small_dist - rest >= rest + ten_kappa - small_dist)) {
+    buf[len-1]--;
+    rest += ten_kappa;
+  }
+  if (rest < big_dist && unsafe - rest >= ten_kappa &&
+      (rest + ten_kappa < big_dist || big_dist - rest > rest + ten_kappa - big_dist)) {
+    return false;
+  }
+  return (2*unit <= rest && rest <= unsafe - 4*unit);
+}
+
+// Generate the shortest digits of `w` in the (unsafe) interval `(low,high)`.
+static bool grisu_digits(kk_diyfp_t low, kk_diyfp_t w, kk_diyfp_t high, char* buf, int* len, int* kappa) {
+  kk_assert_internal(low.e == w.e && w.e == high.e);
+  kk_assert_internal(w.e >= KK_GRISU_MIN_EXP && w.e <= KK_GRISU_MAX_EXP);
+  uint64_t unit = 1;
+  const uint64_t too_low = low.f - unit;
+  const uint64_t too_high = high.f + unit;
+  uint64_t unsafe = too_high - too_low;
+  const int shift = -w.e;
+  const uint64_t one = KU64(1) << shift;
+  uint32_t integrals = (uint32_t)(too_high >> shift);
+  uint64_t fractionals = too_high & (one - 1);
+  int n = 0;
+  int k;
+  uint32_t divisor = biggest_pow10(integrals, &k);
+  while (k > 0) {
+    buf[n++] = (char)('0' + integrals / divisor);
+    integrals %= divisor;
+    k--;
+    const uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+    if (rest < unsafe) {
+      *len = n;
+      *kappa = k;
+      return grisu_round_weed(buf, n, too_high - w.f, unsafe, rest, (uint64_t)divisor << shift, unit);
+    }
+    divisor /= 10;
+  }
+  while (true) {
+    fractionals *= 10;
+    unit *= 10;
+    unsafe *= 10;
+    buf[n++] = (char)('0' + (fractionals >> shift));
+    fractionals &= (one - 1);
+    k--;
+    if (fractionals < unsafe) {
+      *len = n;
+      *kappa = k;
+      return grisu_round_weed(buf, n, (too_high - w.f)*unit, unsafe, fractionals, one, unit);
+    }
+  }
+}
+
+// Shortest digits of a positive finite `d` such that `d == 0.<digits> * 10^(*dexp + len)`.
+static bool grisu3(double d, char* buf, int* len, int* dexp) {
+  const kk_diyfp_t v = diyfp_from_double(d);
+  kk_diyfp_t mminus, mplus;
+  diyfp_boundaries(v, &mminus, &mplus);
+  const kk_diyfp_t w = diyfp_normalize(v);
+  kk_assert_internal(w.e == mplus.e);
+  int k;
+  const kk_diyfp_t c = cached_power(KK_GRISU_MIN_EXP - (w.e + 64), &k);
+  int kappa;
+  const bool ok = grisu_digits(diyfp_mul(mminus, c), diyfp_mul(w, c), diyfp_mul(mplus, c), buf, len, &kappa);
+  *dexp = kappa - k;
+  return ok;
+}
+
+// Fall back to `snprintf` and try to round-trip with increasing precision.
+static int shortest_snprintf(double d, char* buf, int* dexp) {
+  char tmp[40];
+  for (int prec = 0; prec < 17; prec++) {
+    snprintf(tmp, sizeof(tmp), "%.*e", prec, d);
+    if (prec == 16 || strtod(tmp, NULL) == d) break;  // note: strtod and snprintf are both locale dependent
+  }
+  // extract the digits and the exponent (as `d.ddde[+-]xx`, where the dot may be another character)
+  int n = 0;
+  const char* p = tmp;
+  for (; *p != 0 && *p != 'e'; p++) {
+    if (*p >= '0' && *p <= '9') buf[n++] = *p;
+  }
+  const int exp = (*p == 'e' ? atoi(p+1) : 0);
+  *dexp = exp - n + 1;
+  return n;
+}
+
+// Shortest round-trip digits of a positive finite `d`: returns the number of digits `n` where
+// `d == <digits> * 10^(*dexp)`, and `buf` must have room for at least 18 digits.
+static int double_shortest(double d, char* buf, int* dexp) {
+  int n;
+  if (!grisu3(d, buf, &n, dexp)) {
+    n = shortest_snprintf(d, buf, dexp);
+  }
+  while (n > 1 && buf[n-1] == '0') { n--; (*dexp)++; }
+  return n;
+}
+
+// Write an exponent `x` as `e[+-]dd` (with at least two digits, like `printf`).
+static size_t double_format_exp(int x, char* out) {
+  size_t i = 0;
+  out[i++] = 'e';
+  out[i++] = (x < 0 ? '-' : '+');
+  const int ax = (x < 0 ? -x : x);
+  if (ax >= 100) out[i++] = (char)('0' + ax/100);
+  out[i++] = (char)('0' + (ax/10)%10);
+  out[i++] = (char)('0' + ax%10);
+  return i;
+}
+
+// Write `n` digits at a decimal exponent `dexp` in `%g` form for a given precision `prec`.
+static size_t double_format_g(const char* digits, int n, int dexp, int prec, bool neg, char* out) {
+  size_t i = 0;
+  if (neg) out[i++] = '-';
+  const int x = dexp + n - 1;   // the exponent in scientific notation
+  if (x < -4 || x >= prec) {
+    out[i++] = digits[0];
+    if (n > 1) {
+      out[i++] = '.';
+      for (int j = 1; j < n; j++) out[i++] = digits[j];
+    }
+    i += double_format_exp(x, out + i);
+  }
+  else if (x < 0) {
+    out[i++] = '0';
+    out[i++] = '.';
+    for (int j = x + 1; j < 0; j++) out[i++] = '0';
+    for (int j = 0; j < n; j++) out[i++] = digits[j];
+  }
+  else if (x + 1 >= n) {
+    for (int j = 0; j < n; j++) out[i++] = digits[j];
+    for (int j = n; j <= x; j++) out[i++] = '0';
+  }
+  else {
+    for (int j = 0; j <= x; j++) out[i++] = digits[j];
+    out[i++] = '.';
+    for (int j = x + 1; j < n; j++) out[i++] = digits[j];
+  }
+  return i;
+}
+
+// The digit at position `j` of `n` digits (padded with zeros on both sides).
+static inline char double_digit_at(const char* digits, int n, int j) {
+  return (j >= 0 && j < n ? digits[j] : '0');
+}
+
+// Write `n` digits at a decimal exponent `dexp` in `%.<prec>f` form.
+static size_t double_format_f(const char* digits, int n, int dexp, int prec, bool neg, char* out) {
+  size_t i = 0;
+  if (neg) out[i++] = '-';
+  const int x = dexp + n - 1;   // the position of the first digit relative to the dot
+  if (x < 0) {
+    out[i++] = '0';
+  }
+  else {
+    for (int j = 0; j <= x; j++) out[i++] = double_digit_at(digits, n, j);
+  }
+  if (prec > 0) {
+    out[i++] = '.';
+    for (int j = x + 1; j <= x + prec; j++) out[i++] = double_digit_at(digits, n, j);
+  }
+  return i;
+}
+
+// Write `n` digits at a decimal exponent `dexp` in `%.<prec>e` form.
+static size_t double_format_e(const char* digits, int n, int dexp, int prec, bool neg, char* out) {
+  size_t i = 0;
+  if (neg) out[i++] = '-';
+  out[i++] = digits[0];
+  if (prec > 0) {
+    out[i++] = '.';
+    for (int j = 1; j <= prec; j++) out[i++] = double_digit_at(digits, n, j);
+  }
+  i += double_format_exp(dexp + n - 1, out + i);
+  return i;
+}
+
+size_t kk_double_to_prec(double d, int32_t prec, char spec, char* buf, size_t buflen) {
+  kk_assert(buflen >= KK_DOUBLE_SHORTEST_MAX);
+  kk_assert(spec == 'f' || spec == 'e' || spec == 'g');
+  if (prec < 0) prec = -prec;
+  if (prec > 48) prec = 48;
+  if (d != 0.0 && isfinite(d)) {
+    char digits[24];
+    int dexp;
+    const bool neg = (d < 0.0);
+    const int n = double_shortest(neg ? -d : d, digits, &dexp);
+    const int x = dexp + n - 1;
+    // the number of significant digits that is requested
+    const int sig = (spec == 'f' ? x + 1 + prec : (spec == 'e' ? prec + 1 : (prec == 0 ? 1 : prec)));
+    // with at most 15 significant digits, the shortest digits are within half a unit of the last
+    // requested digit, so padding them with zeros is exactly what `snprintf` would produce
+    // (but not for subnormals whose shortest digits may have less precision)
+    if (n <= sig && sig <= 15 && fabs(d) >= DBL_MIN) {
+      size_t len;
+      if (spec == 'f')      len = double_format_f(digits, n, dexp, prec, neg, buf);
+      else if (spec == 'e') len = double_format_e(digits, n, dexp, prec, neg, buf);
+      else                  len = double_format_g(digits, n, dexp, sig, neg, buf);
+      buf[len] = 0;
+      return len;
+    }
+  }
+  const int len = (spec == 'f' ? snprintf(buf, buflen, "%.*f", (int)prec, d)
+                : (spec == 'e' ? snprintf(buf, buflen, "%.*e", (int)prec, d)
+                               : snprintf(buf, buflen, "%.*g", (int)prec, d)));
+  if (len < 0) { buf[0] = 0; return 0; }
+  return ((size_t)len >= buflen ? buflen - 1 : (size_t)len);
+}
+
+size_t kk_double_to_shortest(double d, int32_t prec, char* buf, size_t buflen) {
+  kk_assert(buflen >= KK_DOUBLE_SHORTEST_MAX);
+  if (prec < 0) prec = -prec;
+  if (prec == 0) prec = 1;
+  if (prec > 48) prec = 48;
+  if (d == 0.0) {
+    size_t i = 0;
+    if (signbit(d)) buf[i++] = '-';
+    buf[i++] = '0';
+    buf[i] = 0;
+    return i;
+  }
+  if (!isfinite(d)) {
+    return (size_t)snprintf(buf, buflen, "%g", d);
+  }
+  char digits[24];
+  int dexp;
+  const bool neg = (d < 0.0);
+  const int n = double_shortest(neg ? -d : d, digits, &dexp);
+  size_t len;
+  if (n <= prec) {
+    len = double_format_g(digits, n, dexp, prec, neg, buf);
+    buf[len] = 0;
+  }
+  else {
+    len = (size_t)snprintf(buf, buflen, "%.*g", (int)prec, d);
+  }
+  return len;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Double parsing
+  We use the fast path of Clinger ("How to read floating point numbers accurately", PLDI 1990):
+  if the decimal significand fits in 53 bits and the power of ten is at most 22 both are exactly
+  representable and a single multiply or divide is correctly rounded. This covers most
+  input in practice (like JSON) and otherwise we fall back to `strtod`.
+--------------------------------------------------------------------------------------------------*/
+
+// The fast path is only exact without extended precision for intermediate results (like x87)
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+#define KK_DOUBLE_PARSE_FAST  1
+#endif
+
+#if KK_DOUBLE_PARSE_FAST
+static const double kk_pow10_exact[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_digit(char c) {
+  return (c >= '0' && c <= '9');
+}
+
+static bool double_parse_fast(const char* s, double* result, const char** end) {
+  const char* p = s;
+  bool neg = false;
+  if (*p == '-') { neg = true; p++; }
+  else if (*p == '+') { p++; }
+  uint64_t m = 0;
+  int digits = 0;     // significant digits in `m`
+  int exp10 = 0;
+  bool any = false;
+  while (*p == '0') { p++; any = true; }
+  if (any && (*p == 'x' || *p == 'X')) return false;   // hexadecimal
+  for (; is_digit(*p); p++) {
+    m = 10*m + (uint64_t)(*p - '0');
+    digits++;
+    any = true;
+  }
+  if (*p == '.') {
+    p++;
+    if (m == 0) {
+      for (; *p == '0'; p++) { exp10--; any = true; }
+    }
+    for (; is_digit(*p); p++) {
+      m = 10*m + (uint64_t)(*p - '0');
+      digits++;
+      exp10--;
+      any = true;
+    }
+  }
+  if (!any || digits > 19) return false;
+  if (*p == 'e' || *p == 'E') {
+    const char* q = p + 1;
+    bool eneg = false;
+    if (*q == '-') { eneg = true; q++; }
+    else if (*q == '+') { q++; }
+    if (is_digit(*q)) {
+      int e = 0;
+      for (; is_digit(*q); q++) {
+        if (e < 10000) e = 10*e + (*q - '0');
+      }
+      exp10 += (eneg ? -e : e);
+      p = q;
+    }
+  }
+  double d;
+  if (m == 0) {
+    d = 0.0;
+  }
+  else if (m > (KU64(1) << 53) || exp10 < -22 || exp10 > 22+15) {
+    return false;
+  }
+  else if (exp10 < 0) {
+    d = (double)m / kk_pow10_exact[-exp10];
+  }
+  else if (exp10 <= 22) {
+    d = (double)m * kk_pow10_exact[exp10];
+  }
+  else {
+    // move some of the power into the significand if it stays exact, like `12e30`
+    for (; exp10 > 22; exp10--) {
+      if (m > (KU64(1) << 53) / 10) return false;
+      m *= 10;
+    }
+    d = (double)m * kk_pow10_exact[exp10];
+  }
+  *result = (neg ? -d : d);
+  *end = p;
+  return true;
+}
+#endif
+
+double kk_double_parse(const char* s, const char** end) {
+  const char* p = s;
+  double d;
+  #if KK_DOUBLE_PARSE_FAST
+  if (!double_parse_fast(s, &d, &p))
+  #endif
+  {
+    char* q;
+    d = strtod(s, &q);
+    p = q;
+  }
+  if (end != NULL) *end = p;
+  return d;
+}
@@ -0,0 +1,333 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#define __USE_MINGW_ANSI_STDIO 1  // so %lld is valid on mingw
+#include "kklib.h"
+#include <inttypes.h>
+#include <math.h>
+
+/*--------------------------------------------------------------------------------------------------
+  Sampling heap profiler (only with `KK_HEAP_PROFILE`, see also `kklib.h`).
+  On average every `rate` allocated bytes a block is sampled: we record its tag and the
+  call stack in a bucket and mark the block `heap_sampled` in its header so that freeing it
+  only has to test a bit. Sample intervals are exponentially distributed, just like
+  tcmalloc, so that the profile can be written in the legacy `heap_v2` text format that
+  `pprof` un-samples. All profile state is global and protected by a spin lock; only
+  sampled allocations and frees ever take it.
+--------------------------------------------------------------------------------------------------*/
+
+#if KK_HEAP_PROFILE
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define KK_HAS_BACKTRACE  1
+#endif
+
+#define KK_HEAP_MAX_FRAMES  (32)
+
+typedef struct kk_heap_bucket_s {
+  struct kk_heap_bucket_s* next;        // hash chain
+  uintptr_t    hash;
+  kk_tag_t     tag;
+  size_t       depth;
+  int64_t      alloc_count;
+  int64_t      alloc_bytes;
+  int64_t      free_count;
+  int64_t      free_bytes;
+  void*        frames[KK_HEAP_MAX_FRAMES];
+} kk_heap_bucket_t;
+
+typedef struct kk_heap_live_s {         // a live sampled block
+  struct kk_heap_live_s* next;          // hash chain
+  kk_block_t*       block;
+  size_t            size;
+  kk_heap_bucket_t* bucket;
+} kk_heap_live_t;
+
+typedef struct kk_heap_table_s {
+  void**  entries;
+  size_t  size;                         // power of 2 (or 0)
+  size_t  count;
+} kk_heap_table_t;
+
+static _Atomic(uintptr_t) heap_lock;
+static kk_heap_table_t    heap_buckets;
+static kk_heap_table_t    heap_live;
+static kk_heap_live_t*    heap_live_free;  // free list of live records
+static _Atomic(uintptr_t) heap_rate = ATOMIC_VAR_INIT(KK_HEAP_SAMPLE_RATE);
+
+static void kk_heap_lock(void) {
+  uintptr_t expected = 0;
+  while (!kk_atomic_cas_weak_acq_rel(&heap_lock, &expected, 1)) {
+    expected = 0;
+  }
+}
+
+static void kk_heap_unlock(void) {
+  kk_atomic_store_release(&heap_lock, 0);
+}
+
+static uintptr_t kk_heap_hash_ptr(const void* p) {
+  uintptr_t x = (uintptr_t)p >> 3;
+  x ^= x >> 17; x *= (uintptr_t)KU64(0x9E3779B97F4A7C15); x ^= x >> 15;
+  return x;
+}
+
+// Grow a table once it is 3/4 full; `hashof` recomputes the hash of an entry
+static void kk_heap_table_grow(kk_heap_table_t* t, uintptr_t (*hashof)(void* e), void** (*nextof)(void* e)) {
+  if (t->count < (t->size/4)*3) return;
+  const size_t newsize = (t->size == 0 ? 256 : 2*t->size);
+  void** entries = (void**)calloc(newsize, sizeof(void*));
+  if (entries == NULL) return;  // just keep the longer chains
+  for (size_t i = 0; i < t->size; i++) {
+    void* e = t->entries[i];
+    while (e != NULL) {
+      void* next = *nextof(e);
+      const size_t j = hashof(e) & (newsize - 1);
+      *nextof(e) = entries[j];
+      entries[j] = e;
+      e = next;
+    }
+  }
+  free(t->entries);
+  t->entries = entries;
+  t->size = newsize;
+}
+
+static uintptr_t kk_heap_bucket_hashof(void* e) { return ((kk_heap_bucket_t*)e)->hash; }
+static void**    kk_heap_bucket_nextof(void* e) { return (void**)&((kk_heap_bucket_t*)e)->next; }
+static uintptr_t kk_heap_live_hashof(void* e)   { return kk_heap_hash_ptr(((kk_heap_live_t*)e)->block); }
+static void**    kk_heap_live_nextof(void* e)   { return (void**)&((kk_heap_live_t*)e)->next; }
+
+static kk_heap_bucket_t* kk_heap_bucket_get(kk_tag_t tag, void** frames, size_t depth) {
+  uintptr_t hash = (uintptr_t)tag + 1;
+  for (size_t i = 0; i < depth; i++) {
+    hash = (hash ^ kk_heap_hash_ptr(frames[i])) * 31;
+  }
+  if (heap_buckets.size > 0) {
+    for (kk_heap_bucket_t* b = (kk_heap_bucket_t*)heap_buckets.entries[hash & (heap_buckets.size - 1)]; b != NULL; b = b->next) {
+      if (b->hash == hash && b->tag == tag && b->depth == depth && memcmp(b->frames, frames, depth*sizeof(void*)) == 0) return b;
+    }
+  }
+  kk_heap_table_grow(&heap_buckets, &kk_heap_bucket_hashof, &kk_heap_bucket_nextof);
+  if (heap_buckets.size == 0) return NULL;
+  kk_heap_bucket_t* b = (kk_heap_bucket_t*)calloc(1, sizeof(kk_heap_bucket_t));
+  if (b == NULL) return NULL;
+  b->hash = hash;
+  b->tag = tag;
+  b->depth = depth;
+  memcpy(b->frames, frames, depth*sizeof(void*));
+  const size_t i = hash & (heap_buckets.size - 1);
+  b->next = (kk_heap_bucket_t*)heap_buckets.entries[i];
+  heap_buckets.entries[i] = b;
+  heap_buckets.count++;
+  return b;
+}
+
+// Next sample interval: exponentially distributed with mean `rate`
+static kk_ssize_t kk_heap_sample_interval(kk_context_t* ctx) {
+  const uintptr_t rate = kk_atomic_load_relaxed(&heap_rate);
+  if (rate == 0) return KK_SSIZE_MAX;  // sampling is disabled
+  uint64_t x = ctx->heap_sample_rnd;
+  if (x == 0) x = (uint64_t)ctx->thread_id | 1;
+  x ^= x << 13; x ^= x >> 7; x ^= x << 17;  // xorshift64
+  ctx->heap_sample_rnd = x;
+  const double u = ((double)(x >> 11) + 1.0) / 9007199254740993.0;  // in (0,1]
+  const double next = -log(u) * (double)rate;
+  return (next >= (double)KK_SSIZE_MAX ? KK_SSIZE_MAX : (kk_ssize_t)next);
+}
+
+void kk_heap_sample_alloc(kk_block_t* b, size_t size, kk_context_t* ctx) {
+  const bool first = (ctx->heap_sample_rnd == 0);
+  ctx->heap_sample_next = kk_heap_sample_interval(ctx);
+  if (first) return;  // the first call only starts the sampling
+  void* frames[KK_HEAP_MAX_FRAMES + 1];
+  size_t depth = 0;
+#if KK_HAS_BACKTRACE
+  const int n = backtrace(frames, KK_HEAP_MAX_FRAMES + 1);
+  if (n > 1) {
+    depth = (size_t)n - 1;
+    memmove(frames, frames + 1, depth*sizeof(void*));   // skip this function
+  }
+#elif defined(__GNUC__)
+  frames[0] = __builtin_return_address(0);
+  depth = 1;
+#endif
+  kk_heap_lock();
+  kk_heap_bucket_t* bucket = kk_heap_bucket_get(kk_block_tag(b), frames, depth);
+  kk_heap_live_t* live = heap_live_free;
+  if (live != NULL) { heap_live_free = live->next; }
+               else { live = (kk_heap_live_t*)malloc(sizeof(kk_heap_live_t)); }
+  if (bucket != NULL && live != NULL) {
+    kk_heap_table_grow(&heap_live, &kk_heap_live_hashof, &kk_heap_live_nextof);
+  }
+  if (bucket == NULL || live == NULL || heap_live.size == 0) {
+    if (live != NULL) { live->next = heap_live_free; heap_live_free = live; }
+    kk_heap_unlock();
+    return;  // out of memory: skip this sample
+  }
+  bucket->alloc_count++;
+  bucket->alloc_bytes += (int64_t)size;
+  live->block = b;
+  live->size = size;
+  live->bucket = bucket;
+  const size_t i = kk_heap_hash_ptr(b) & (heap_live.size - 1);
+  live->next = (kk_heap_live_t*)heap_live.entries[i];
+  heap_live.entries[i] = live;
+  heap_live.count++;
+  b->header.heap_sampled = 1;
+  kk_heap_unlock();
+}
+
+void kk_heap_sample_free(kk_block_t* b) {
+  b->header.heap_sampled = 0;
+  kk_heap_lock();
+  if (heap_live.size > 0) {
+    kk_heap_live_t** plive = (kk_heap_live_t**)&heap_live.entries[kk_heap_hash_ptr(b) & (heap_live.size - 1)];
+    while (*plive != NULL) {
+      kk_heap_live_t* live = *plive;
+      if (live->block == b) {
+        *plive = live->next;
+        heap_live.count--;
+        live->bucket->free_count++;
+        live->bucket->free_bytes += (int64_t)live->size;
+        live->next = heap_live_free;
+        heap_live_free = live;
+        break;
+      }
+      plive = &live->next;
+    }
+  }
+  kk_heap_unlock();
+}
+
+void kk_heap_profile_set_rate(size_t rate) {
+  kk_atomic_store_relaxed(&heap_rate, rate);
+  kk_context_t* ctx = kk_get_context();
+  ctx->heap_sample_next = kk_heap_sample_interval(ctx);  // restart the interval of the current thread
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Reporting
+--------------------------------------------------------------------------------------------------*/
+
+// The estimated number of allocations represented by `count` samples of `bytes` in total
+static double kk_heap_unsample(int64_t count, int64_t bytes, uintptr_t rate) {
+  if (count <= 0 || rate == 0) return (double)count;
+  const double avg = (double)bytes / (double)count;
+  return (double)count / (1.0 - exp(-avg / (double)rate));
+}
+
+int kk_heap_profile_write(const char* fname) {
+  FILE* f = fopen(fname, "w");
+  if (f == NULL) return (errno != 0 ? errno : -1);
+  const uintptr_t rate = kk_atomic_load_relaxed(&heap_rate);
+  kk_heap_lock();
+  int64_t live_count = 0, live_bytes = 0, alloc_count = 0, alloc_bytes = 0;
+  for (size_t i = 0; i < heap_buckets.size; i++) {
+    for (kk_heap_bucket_t* b = (kk_heap_bucket_t*)heap_buckets.entries[i]; b != NULL; b = b->next) {
+      live_count  += b->alloc_count - b->free_count;
+      live_bytes  += b->alloc_bytes - b->free_bytes;
+      alloc_count += b->alloc_count;
+      alloc_bytes += b->alloc_bytes;
+    }
+  }
+  fprintf(f, "heap profile: %" PRId64 ": %" PRId64 " [%" PRId64 ": %" PRId64 "] @ heap_v2/%zu\n",
+             live_count, live_bytes, alloc_count, alloc_bytes, (size_t)rate);
+  for (size_t i = 0; i < heap_buckets.size; i++) {
+    for (kk_heap_bucket_t* b = (kk_heap_bucket_t*)heap_buckets.entries[i]; b != NULL; b = b->next) {
+      fprintf(f, "%" PRId64 ": %" PRId64 " [%" PRId64 ": %" PRId64 "] @",
+                 b->alloc_count - b->free_count, b->alloc_bytes - b->free_bytes, b->alloc_count, b->alloc_bytes);
+      for (size_t j = 0; j < b->depth; j++) {
+        fprintf(f, " %p", b->frames[j]);
+      }
+      fprintf(f, "\n");
+    }
+  }
+  kk_heap_unlock();
+#if defined(__linux__)
+  // include the memory map for symbolization
+  FILE* maps = fopen("/proc/self/maps", "r");
+  if (maps != NULL) {
+    fprintf(f, "\nMAPPED_LIBRARIES:\n");
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), maps)) > 0) {
+      fwrite(buf, 1, n, f);
+    }
+    fclose(maps);
+  }
+#endif
+  const bool ok = (ferror(f) == 0);
+  fclose(f);
+  return (ok ? 0 : EIO);
+}
+
+// Index into the per-tag totals: constructor tags first (clamped), then the special tags
+#define KK_HEAP_TAG_COUNT  (KK_STATS_CON_TAGS + (KK_TAG_LAST - KK_TAG_OPEN))
+
+static size_t kk_heap_tag_index(kk_tag_t tag) {
+  if (tag >= KK_TAG_OPEN && tag < KK_TAG_LAST) return (KK_STATS_CON_TAGS + (tag - KK_TAG_OPEN));
+  return (tag < KK_STATS_CON_TAGS ? tag : KK_STATS_CON_TAGS - 1);
+}
+
+void kk_heap_profile_print(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  double live_count[KK_HEAP_TAG_COUNT] = { 0 };
+  double live_bytes[KK_HEAP_TAG_COUNT] = { 0 };
+  double alloc_bytes[KK_HEAP_TAG_COUNT] = { 0 };
+  const uintptr_t rate = kk_atomic_load_relaxed(&heap_rate);
+  kk_heap_lock();
+  for (size_t i = 0; i < heap_buckets.size; i++) {
+    for (kk_heap_bucket_t* b = (kk_heap_bucket_t*)heap_buckets.entries[i]; b != NULL; b = b->next) {
+      if (b->alloc_count == 0) continue;
+      const size_t t = kk_heap_tag_index(b->tag);
+      const double scale = kk_heap_unsample(b->alloc_count, b->alloc_bytes, rate) / (double)b->alloc_count;
+      live_count[t]  += scale * (double)(b->alloc_count - b->free_count);
+      live_bytes[t]  += scale * (double)(b->alloc_bytes - b->free_bytes);
+      alloc_bytes[t] += scale * (double)b->alloc_bytes;
+    }
+  }
+  kk_heap_unlock();
+  kk_info_message("heap profile (estimated, sample rate %zu bytes):\n  %-16s %12s %14s %14s\n", (size_t)rate, "tag", "live", "live bytes", "alloc bytes");
+  for (size_t t = 0; t < KK_HEAP_TAG_COUNT; t++) {
+    if (alloc_bytes[t] <= 0.0) continue;
+    char name[32];
+    if (t >= KK_STATS_CON_TAGS) {
+      snprintf(name, sizeof(name), "%s", kk_tag_name((kk_tag_t)(KK_TAG_OPEN + (t - KK_STATS_CON_TAGS))));
+    }
+    else {
+      snprintf(name, sizeof(name), "tag %zu%s", t, (t == KK_STATS_CON_TAGS - 1 ? "+" : ""));
+    }
+    kk_info_message("  %-16s %12.0f %14.0f %14.0f\n", name, live_count[t], live_bytes[t], alloc_bytes[t]);
+  }
+}
+
+#else
+
+void kk_heap_profile_set_rate(size_t rate) {
+  KK_UNUSED(rate);
+}
+
+int kk_heap_profile_write(const char* fname) {
+  KK_UNUSED(fname);
+  return ENOTSUP;
+}
+
+void kk_heap_profile_print(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  kk_warning_message("no heap profile as kklib was compiled without KK_HEAP_PROFILE\n");
+}
+
+#endif
+
+int kk_heap_profile_write_string(kk_string_t fname, kk_context_t* ctx) {
+  const int err = kk_heap_profile_write(kk_string_cbuf_borrow(fname));
+  kk_string_drop(fname, ctx);
+  return err;
+}
@@ -47,6 +47,32 @@ void kk_free_fun(void* p, kk_block_t* b) {
 }
 
 
+// Resize the storage of a vector (used by `kk_vector_realloc`); only a unique vector is resized in place
+kk_vector_t kk_vector_realloc_capacity(kk_vector_t vec, size_t capacity, kk_context_t* ctx) {
+  kk_vector_large_t v = kk_vector_as_large(vec);
+  kk_assert_internal(v != NULL);
+  kk_assert_internal(capacity > 0 && capacity >= kk_vector_len(vec));
+  if (!kk_datatype_is_unique(vec)) {
+    // a shared, static, or region block (which has a sticky reference count) cannot be
+    // reallocated: copy the elements into a fresh vector instead
+    size_t len;
+    const kk_box_t* src = kk_vector_buf(vec, &len);
+    kk_vector_t vdest = kk_vector_alloc_capacity(len, capacity, kk_box_null, ctx);
+    kk_box_t* dest = kk_vector_buf(vdest, NULL);
+    for (size_t i = 0; i < len; i++) {
+      dest[i] = kk_box_dup(src[i]);
+    }
+    kk_vector_drop(vec, ctx);
+    return vdest;
+  }
+  const size_t size = kk_vector_alloc_size(capacity);
+  v = (kk_vector_large_t)kk_block_realloc(&v->_base._block, size, ctx);
+  if (v == NULL) kk_fatal_error(ENOMEM, "unable to resize a vector");
+  kk_heap_profile_alloc(&v->_base._block, size, ctx);
+  v->capacity = kk_enum_box(capacity);
+  return kk_datatype_from_base(&v->_base);
+}
+
 kk_string_t kk_get_host(kk_context_t* ctx) {
   KK_UNUSED(ctx);
   kk_define_string_literal(static, host, 5, "libc")
@@ -110,7 +136,9 @@ void kk_fatal_error(int err, const char* fmt, ...) {
   KK_UNUSED(err);
   va_list args;
   va_start(args, fmt);
-  kk_log_message_fmt(kk_get_context(), KK_LOG_FATAL, fmt, args);
+  kk_context_t* ctx = kk_get_context();
+  kk_print_flush(ctx);  // write buffered output first
+  kk_log_message_fmt(ctx, KK_LOG_FATAL, fmt, args);
   va_end(args);
   abort();   // todo: call error handler
 }
@@ -146,6 +174,9 @@ static void kklib_done(void) {
 bool __has_popcnt = false;
 bool __has_lzcnt = false;
 #endif
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__SSSE3__)
+bool kk_has_ssse3 = false;  // used for utf8 validation
+#endif
 
 static void kklib_init(void) {
   if (process_initialized) return;
@@ -160,6 +191,9 @@ static void kklib_init(void) {
   __has_popcnt = ((cpu_info[2] & (KI32(1)<<23)) != 0);
   __cpuid(cpu_info, (int)(0x80000001));
   __has_lzcnt  = ((cpu_info[2] & (KI32(1)<<5)) != 0);
+#endif
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__SSSE3__)
+  kk_has_ssse3 = (__builtin_cpu_supports("ssse3") != 0);
 #endif
   atexit(&kklib_done);
   //fexcept_t fexn;
@@ -180,6 +214,10 @@ static struct { kk_block_t _block; kk_integer_t cfc; } kk_evv_empty_static = {
 };
 kk_ptr_t kk_evv_empty_singleton = &kk_evv_empty_static._block;
 
+// `box_any` carries no data so all contexts share a static block (and no allocation is needed at startup);
+// it has a sticky reference count so the (non-atomic) dup and drop on every yield never write to it
+static struct kk_box_any_s kk_box_any_static = { { KK_HEADER_STATIC_STICKY(0,KK_TAG_BOX_ANY) } };
+
 // Get the thread local context (also initializes on demand)
 kk_context_t* kk_get_context(void) {
   kk_context_t* ctx = context;
@@ -192,11 +230,18 @@ kk_context_t* kk_get_context(void) {
 #else
   ctx = (kk_context_t*)calloc(1, sizeof(kk_context_t));
 #endif
+  context = ctx;  // set early as `kk_block_dup` may need it (with `KK_STATS`)
   ctx->evv = kk_block_dup(kk_evv_empty_singleton);
   ctx->thread_id = (uintptr_t)(&context);
   ctx->unique = kk_integer_one;
-  context = ctx;
-  ctx->kk_box_any = kk_block_alloc_as(struct kk_box_any_s, 0, KK_TAG_BOX_ANY, ctx);  
+  ctx->kk_box_any = kk_basetype_dup_as(kk_box_any_t, &kk_box_any_static);
+  ctx->yield.conts = &ctx->yield.conts_inline[0];
+  ctx->yield.conts_size = KK_YIELD_CONT_MAX;
+  // a context goes online for the reclamation of thread-shared references only once it reads or
+  // writes a thread-shared reference (see `ref.c`)
+#if KK_TRACE
+  kk_trace_thread_init(ctx);  // record trace events if tracing was started
+#endif
   // todo: register a thread_done function to release the context on thread terminatation.
   return ctx;
 }
@@ -204,9 +249,15 @@ kk_context_t* kk_get_context(void) {
 static void free_context(void) {
   if (context != NULL) {
     kk_block_drop(context->evv, context);
-    kk_basetype_free(context->kk_box_any);
-    // kk_basetype_drop_assert(context->kk_box_any, KK_TAG_BOX_ANY, context);
-    // TODO: process delayed_free
+    kk_basetype_drop(context->kk_box_any, context);
+    kk_integer_cache_free(context);
+    kk_print_flush(context);
+    kk_free(context->outbuf);
+    if (context->yield.conts != &context->yield.conts_inline[0]) { kk_free(context->yield.conts); }
+    kk_block_shared_flush(context);          // apply pending shared reference counts
+    kk_shared_release(context);              // and hand off retired thread-shared references
+    kk_block_drop_free_delayed(0, context);  // free all remaining delayed blocks
+    kk_block_pool_collect(context);
 #ifdef KK_MIMALLOC
     // mi_heap_t* heap = context->heap;
     mi_free(context);
@@ -218,10 +269,36 @@ static void free_context(void) {
   }
 }
 
+#if KK_STATS
+static kk_stats_t process_stats;             // statistics aggregated over all contexts
+static _Atomic(uintptr_t) process_stats_lock;
+
+static void kk_process_stats_add(const kk_stats_t* stats) {
+  uintptr_t expected = 0;
+  while (!kk_atomic_cas_weak_acq_rel(&process_stats_lock, &expected, 1)) { expected = 0; }
+  kk_stats_add(&process_stats, stats);
+  kk_atomic_store_release(&process_stats_lock, 0);
+}
+#endif
+
+// Free the context of a thread that ends (like a task worker)
+void kk_context_done(void) {
+  if (context == NULL) return;
+#if KK_STATS
+  kk_process_stats_add(&context->stats);
+#endif
+  free_context();
+}
+
 /*--------------------------------------------------------------------------------------------------
   Called from main
 --------------------------------------------------------------------------------------------------*/
 
+#if KK_HEAP_PROFILE
+static const char* heap_profile_fname;  // write a heap profile at the end (`--kkheapprof=<file>`)
+#endif
+static const char* trace_fname;         // write a trace at the end (`--kktrace=<file>`)
+
 kk_decl_export kk_context_t* kk_main_start(int argc, char** argv) {
   kk_context_t* ctx = kk_get_context();
   // process kklib options
@@ -232,6 +309,31 @@ kk_decl_export kk_context_t* kk_main_start(int argc, char** argv) {
       if (strcmp(arg, "--kktime")==0) {
         ctx->process_start = kk_timer_start();
       }
+      else if (strcmp(arg, "--kkstats")==0) {
+#if KK_STATS
+        ctx->stats_print = true;
+#else
+        kk_warning_message("--kkstats is ignored as kklib was compiled without KK_STATS\n");
+#endif
+      }
+      else if (strncmp(arg, "--kkheapprof=", 13)==0) {
+#if KK_HEAP_PROFILE
+        heap_profile_fname = arg + 13;
+#else
+        kk_warning_message("--kkheapprof is ignored as kklib was compiled without KK_HEAP_PROFILE\n");
+#endif
+      }
+      else if (strncmp(arg, "--kkheaprate=", 13)==0) {
+        kk_heap_profile_set_rate((size_t)strtoull(arg + 13, NULL, 10));
+      }
+      else if (strncmp(arg, "--kktrace=", 10)==0) {
+#if KK_TRACE
+        trace_fname = arg + 10;
+        kk_trace_start(ctx);
+#else
+        kk_warning_message("--kktrace is ignored as kklib was compiled without KK_TRACE\n");
+#endif
+      }
       else {
         break;
       }
@@ -247,6 +349,27 @@ kk_decl_export kk_context_t* kk_main_start(int argc, char** argv) {
 }
 
 kk_decl_export void  kk_main_end(kk_context_t* ctx) {
+  kk_task_pool_stop(ctx);              // stop the task workers (which adds their statistics)
+  kk_print_flush(ctx);                 // write buffered console output
+  kk_block_shared_flush(ctx);          // apply pending shared reference counts
+  kk_block_drop_free_delayed(0, ctx);  // free all remaining delayed blocks
+  kk_block_pool_collect(ctx);          // and release the block pool
+#if KK_STATS
+  kk_process_stats_add(&ctx->stats);
+  if (ctx->stats_print) {  // started with --kkstats option
+    kk_stats_print(&process_stats, ctx);
+  }
+#endif
+#if KK_HEAP_PROFILE
+  if (heap_profile_fname != NULL) {
+    const int err = kk_heap_profile_write(heap_profile_fname);
+    if (err != 0) kk_warning_message("unable to write the heap profile to: %s (error %d)\n", heap_profile_fname, err);
+  }
+#endif
+  if (trace_fname != NULL) {
+    const int err = kk_trace_write(trace_fname);
+    if (err != 0) kk_warning_message("unable to write the trace to: %s (error %d)\n", trace_fname, err);
+  }
   if (ctx->process_start != 0) {  // started with --kktime option
     kk_usecs_t wall_time = kk_timer_end(ctx->process_start);
     kk_msecs_t user_time;
@@ -22,7 +22,7 @@ Big integers. For our purposes, we need an implementation that does not
 have to be the fastest possible; we instead aim for portable, simple,
 well performing, and with fast conversion to/from decimal strings.
 Still, it performs quite respectable and does have various optimizations
-including Karatsuba multiplication.
+including Karatsuba, Toom-3, and NTT multiplication.
 
   Big integers are arrays of `digits` with a `count` and `is_neg` flag.
   For a number `n` we have:
@@ -80,6 +80,17 @@ static inline kk_ddigit_t ddigit_mul_add(kk_digit_t x, kk_digit_t y, kk_digit_t
   return r;
 }
 
+// Divide by `BASE` (for `d < 2^122`) by multiplying with a scaled reciprocal (`2^122 / BASE`).
+// The estimate is at most 3 too low which we correct with the remainder.
+static inline kk_digit_t ddigit_cdiv_base(kk_ddigit_t d, kk_digit_t* rem) {
+  const uint64_t t = (d.hi << 6) | (d.lo >> 58);
+  kk_digit_t q = __umulh(t, KU64(0x49C97747490EAE83));
+  kk_digit_t r = d.lo - q*BASE;
+  while (r >= BASE) { q++; r -= BASE; }
+  *rem = r;
+  return q;
+}
+
 #elif (KK_INTPTR_SIZE >= 8) && defined(__GNUC__) 
 // Use 64-bit digits with gcc/clang/icc
 #define BASE          KI64(1000000000000000000)
@@ -108,6 +119,18 @@ static inline kk_ddigit_t ddigit_mul_add(kk_digit_t x, kk_digit_t y, kk_digit_t
   return ((kk_ddigit_t)x * y) + z;
 }
 
+// Divide by `BASE` (for `d < 2^122`) by multiplying with a scaled reciprocal (`2^122 / BASE`) as
+// compilers do not optimize a 128-bit division by a constant (and call `__udivti3` instead).
+// The estimate is at most 3 too low which we correct with the remainder.
+static inline kk_digit_t ddigit_cdiv_base(kk_ddigit_t d, kk_digit_t* rem) {
+  const uint64_t t = (uint64_t)(d >> 58);
+  kk_digit_t q = (kk_digit_t)(((kk_ddigit_t)t * KU64(0x49C97747490EAE83)) >> 64);
+  kk_digit_t r = (kk_digit_t)d - q*BASE;
+  while (r >= BASE) { q++; r -= BASE; }
+  *rem = r;
+  return q;
+}
+
 #else
 // Default: use 32-bit digits
 #if KK_INTPTR_SIZE > 4
@@ -138,6 +161,11 @@ static inline kk_digit_t ddigit_cdiv(kk_ddigit_t d, kk_digit_t divisor, kk_digit
   return (kk_digit_t)(d/divisor);
 }
 
+static inline kk_digit_t ddigit_cdiv_base(kk_ddigit_t d, kk_digit_t* rem) {
+  *rem = (kk_digit_t)(d%BASE);
+  return (kk_digit_t)(d/BASE);
+}
+
 #endif
 
 #define KK_LOG16_DIV_LOG10  (1.20411998266)
@@ -178,7 +206,7 @@ static size_t bigint_available_(const kk_bigint_t* b) {
 }
 
 static kk_digit_t bigint_last_digit_(const kk_bigint_t* b) {
-  return b->digits[b->count-1];
+  return (b->count == 0 ? 0 : b->digits[b->count-1]);
 }
 
 static kk_integer_t integer_bigint(kk_bigint_t* x, kk_context_t* ctx);
@@ -318,6 +346,7 @@ static kk_bigint_t* bigint_push(kk_bigint_t* x, kk_digit_t d, kk_context_t* ctx)
 // Bigint to integer. Possibly converting to a small int.
 static kk_integer_t integer_bigint(kk_bigint_t* x, kk_context_t* ctx) {
   if (x->count==0) {
+    drop_bigint(x,ctx);
     return kk_integer_zero;
   }
   else if (x->count==1
@@ -401,26 +430,40 @@ kk_integer_t kk_integer_from_big(kk_intx_t i, kk_context_t* ctx) {
   To string
 ----------------------------------------------------------------------*/
 
+// Two decimal digits for each number below 100.
+static const char kk_digits100[201] =
+  "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+  "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+  "80818283848586878889" "90919293949596979899";
+
+// Write exactly `n` decimal digits of `u` to `buf` (with leading zeros), two digits at a time.
+static inline void kk_uint_to_digits(uint64_t u, size_t n, char* buf) {
+  char* p = buf + n;
+  while (n >= 2) {
+    const size_t d = (size_t)(u % 100);
+    u /= 100;
+    p -= 2;
+    p[0] = kk_digits100[2*d];
+    p[1] = kk_digits100[2*d + 1];
+    n -= 2;
+  }
+  if (n > 0) {
+    *--p = (char)('0' + (u % 10));
+  }
+}
+
 // Convert a digit to LOG_BASE characters.
-// note: gets compiled without divisions on clang and GCC.
 static size_t kk_digit_to_str_full(kk_digit_t d, char* buf) {
-  for (size_t i = LOG_BASE; i > 0; d /= 10) {
-    i--;
-    buf[i] = '0' + (d % 10);
-  }
+  kk_uint_to_digits(d, LOG_BASE, buf);
   return LOG_BASE;
 }
+
 // convert digit to characters but skip leading zeros. No output if `d==0`.
 static size_t kk_digit_to_str_partial(kk_digit_t d, char* buf) {
-  char tmp[LOG_BASE];
   if (d==0) return 0;
-  kk_digit_to_str_full(d, tmp);
-  size_t i = 0;
-  while (i < LOG_BASE && tmp[i]=='0') { i++; }
-  for (size_t j = i; j < LOG_BASE; j++) {
-    buf[j - i] = tmp[j];
-  }
-  return (LOG_BASE - i);
+  const size_t n = kk_bits_digits64(d);
+  kk_uint_to_digits(d, n, buf);
+  return n;
 }
 
 // Efficient conversion to a string buffer. Use `buf == NULL` to get the required size.
@@ -458,41 +501,29 @@ static size_t kk_bigint_to_buf_(const kk_bigint_t* b, char* buf, size_t kk_buf_s
 }
 
 static kk_string_t kk_bigint_to_string(kk_bigint_t* b, kk_context_t* ctx) {
+  kk_trace_begin("bigint to string", ctx);
   size_t needed = kk_bigint_to_buf_(b, NULL, 0);
   kk_string_t s = kk_string_alloc_buf(needed-1,ctx); // don't count terminator
   size_t used = kk_bigint_to_buf_(b, (char*)kk_string_cbuf_borrow(s), needed);
   drop_bigint(b,ctx);
   s = kk_string_adjust_length(s, used-1, ctx);  // don't count the ending zero included in used
+  kk_trace_end("bigint to string", ctx);
   return s;
 }
 
 // kk_int_t to string
+// The length is computed up front such that we can write the digits directly into the
+// allocated string (which is in-place for a small string of at most 7 characters).
 static kk_string_t kk_int_to_string(kk_intx_t n, kk_context_t* ctx) {
-  kk_assert_internal(KK_INTPTR_SIZE <= 26);
-  char buf[64];  // enough for 2^212
-  bool neg = (n < 0);
-  if (neg) n = -n;
-  // output to buf in reverse order
-  size_t i = 0;
-  if (n == 0) {
-    buf[i++] = '0';
-  }
-  else {
-    for (; i < 63 && n != 0; i++, n /= 10) {
-      buf[i] = '0' + n%10;
-    }
-    if (neg) {
-      buf[i++] = '-';
-    }
-  }
-  // write to the allocated string
-  kk_string_t s = kk_string_alloc_buf(i,ctx);
+  const bool neg = (n < 0);
+  const kk_uintx_t u = (neg ? (kk_uintx_t)0 - (kk_uintx_t)n : (kk_uintx_t)n);
+  const size_t digits = kk_bits_digits(u);
+  const size_t len = digits + (neg ? 1 : 0);
+  kk_string_t s = kk_string_alloc_buf(len, ctx);
   char* p = (char*)kk_string_cbuf_borrow(s);
-  size_t j;
-  for (j = 0; j < i; j++) {
-    p[j] = buf[i - j - 1];
-  }
-  p[j] = 0;
+  if (neg) *p++ = '-';
+  kk_uint_to_digits(u, digits, p);
+  p[digits] = 0;
   return s;
 }
 
@@ -634,6 +665,48 @@ kk_integer_t kk_integer_from_str(const char* num, kk_context_t* ctx) {
 }
 
 
+/*----------------------------------------------------------------------
+  Cached powers of `BASE_HEX` for hexadecimal conversion.
+  These are initialized on demand and kept per context as they are
+  reused for every conversion.
+----------------------------------------------------------------------*/
+
+#define KK_HEX_POWERS   (48)
+
+typedef struct kk_integer_cache_s {
+  kk_bigint_t* hex_powers[KK_HEX_POWERS];  // `hex_powers[i] == BASE_HEX^(2^i)`
+} kk_integer_cache_t;
+
+static kk_bigint_t* kk_bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx);
+static kk_bigint_t* kk_bigint_sqr(kk_bigint_t* x, kk_context_t* ctx);
+static kk_bigint_t* bigint_add(kk_bigint_t* x, kk_bigint_t* y, bool y_isneg, kk_context_t* ctx);
+
+// Return `BASE_HEX^(2^i)` (borrowed)
+static kk_bigint_t* bigint_hex_power(size_t i, kk_context_t* ctx) {
+  kk_assert_internal(i < KK_HEX_POWERS);
+  kk_integer_cache_t* cache = ctx->integer_cache;
+  if (cache == NULL) {
+    cache = (kk_integer_cache_t*)kk_zalloc(sizeof(kk_integer_cache_t), ctx);
+    if (cache == NULL) kk_fatal_error(ENOMEM, "unable to allocate the integer cache");
+    ctx->integer_cache = cache;
+  }
+  if (cache->hex_powers[i] == NULL) {
+    cache->hex_powers[i] = (i == 0 ? bigint_from_uint64(BASE_HEX, ctx) : kk_bigint_sqr(dup_bigint(bigint_hex_power(i-1, ctx)), ctx));
+  }
+  return cache->hex_powers[i];
+}
+
+void kk_integer_cache_free(kk_context_t* ctx) {
+  kk_integer_cache_t* cache = ctx->integer_cache;
+  if (cache == NULL) return;
+  for (size_t i = 0; i < KK_HEX_POWERS; i++) {
+    if (cache->hex_powers[i] != NULL) drop_bigint(cache->hex_powers[i], ctx);
+  }
+  kk_free(cache);
+  ctx->integer_cache = NULL;
+}
+
+
 /*----------------------------------------------------------------------
   Parse an integer as hexadecimal
 ----------------------------------------------------------------------*/
@@ -641,6 +714,33 @@ kk_integer_t kk_integer_from_str(const char* num, kk_context_t* ctx) {
 static kk_bigint_t* kk_bigint_mul_small(kk_bigint_t* x, kk_digit_t y, kk_context_t* ctx);
 static kk_bigint_t* kk_bigint_add_abs_small(kk_bigint_t* x, kk_digit_t y, kk_context_t* ctx);
 
+#ifndef KK_HEX_PARSE_DC_CUTOFF
+#define KK_HEX_PARSE_DC_CUTOFF  (64)   // in chunks of LOG_BASE_HEX hex digits
+#endif
+
+// Convert `m` chunks of `BASE_HEX` (least significant first) to a bigint.
+// Large numbers are converted by divide-and-conquer as `hi*BASE_HEX^(2^i) + lo`.
+static kk_bigint_t* bigint_from_hex_chunks(const kk_digit_t* chunks, size_t m, kk_context_t* ctx) {
+  if (m <= KK_HEX_PARSE_DC_CUTOFF) {
+    const size_t count = (size_t)(ceil((double)(m*LOG_BASE_HEX) * KK_LOG16_DIV_LOG10 / LOG_BASE)) + 1; // conservatively overallocate
+    kk_bigint_t* b = bigint_alloc(count, false, ctx);
+    b = kk_bigint_trim_to(b, 1, false, ctx);
+    b->digits[0] = 0;
+    for (size_t j = m; j > 0; j--) {
+      b = kk_bigint_mul_small(b, BASE_HEX, ctx);
+      b = kk_bigint_add_abs_small(b, chunks[j-1], ctx);
+    }
+    return kk_bigint_trim(b, true, ctx);
+  }
+  size_t i = 0;
+  while (((size_t)2 << i) < m) { i++; }   // 2^i < m <= 2^(i+1)
+  const size_t h = (size_t)1 << i;
+  kk_bigint_t* lo = bigint_from_hex_chunks(chunks, h, ctx);
+  kk_bigint_t* hi = bigint_from_hex_chunks(chunks + h, m - h, ctx);
+  hi = kk_bigint_mul(hi, dup_bigint(bigint_hex_power(i, ctx)), ctx);
+  return bigint_add(hi, lo, lo->is_neg, ctx);
+}
+
 bool kk_integer_hex_parse(const char* s, kk_integer_t* res, kk_context_t* ctx) {
   kk_assert_internal(s!=NULL && res != NULL);
   if (res==NULL) return false;
@@ -692,22 +792,18 @@ bool kk_integer_hex_parse(const char* s, kk_integer_t* res, kk_context_t* ctx) {
     return true;
   }
   
-  // otherwise construct a big int
-  const size_t count = (size_t)(ceil((double)hdigits * KK_LOG16_DIV_LOG10)) + 1; // conservatively overallocate to max needed.
-  kk_extra_t ecount = (count >= MAX_EXTRA ? MAX_EXTRA-1 : (kk_extra_t)count);
-  kk_bigint_t* b = bigint_alloc(ecount, is_neg, ctx);
-  b->extra += (ecount-1);
-  b->count -= (ecount-1);
-  b->digits[0] = 0;
-
-  // create in chucks of LOG_BASE_HEX digits
+  // otherwise construct a big int from chunks of LOG_BASE_HEX digits
+  const size_t m = (hdigits + LOG_BASE_HEX - 1) / LOG_BASE_HEX;
+  kk_digit_t* chunks = (kk_digit_t*)kk_malloc(m * sizeof(kk_digit_t), ctx);
+  if (chunks == NULL) kk_fatal_error(ENOMEM, "unable to parse a hexadecimal integer");
+  size_t k = m;
   size_t chunk = hdigits%LOG_BASE_HEX; if (chunk==0) chunk = LOG_BASE_HEX; // initial number of digits to read
   const char* p = start;
   while (p < end) {
     kk_digit_t d = 0;
-    // read a full digit
+    // read a full chunk
     for (size_t j = 0; j < chunk && p < end; ) {
-      char c = *p++; // fill out with zeros
+      char c = *p++;
       if (kk_ascii_is_hexdigit(c)) {
         j++;
         kk_digit_t hd = (kk_digit_t)(kk_ascii_is_digit(c) ? c - '0' : 10 + (kk_ascii_is_lower(c) ? c - 'a' : c - 'A'));
@@ -715,11 +811,14 @@ bool kk_integer_hex_parse(const char* s, kk_integer_t* res, kk_context_t* ctx) {
         kk_assert_internal(d<BASE);
       }
     }
-    // and multiply-add
-    b = kk_bigint_mul_small(b, BASE_HEX, ctx);
-    b = kk_bigint_add_abs_small(b, d, ctx);
+    kk_assert_internal(k > 0);
+    chunks[--k] = d;
     chunk = LOG_BASE_HEX;  // after the first chunk, the chunk is always a full LOG_BASE_HEX
   }
+  kk_assert_internal(k == 0);
+  kk_bigint_t* b = bigint_from_hex_chunks(chunks, m, ctx);
+  kk_free(chunks);
+  b->is_neg = (is_neg ? 1 : 0);
   *res = integer_bigint(b, ctx);
   return true;
 }
@@ -933,9 +1032,27 @@ static kk_bigint_t* kk_bigint_sub_abs(kk_bigint_t* x, kk_bigint_t* y, kk_context
 }
 
 /*----------------------------------------------------------------------
-  Multiply & Sqr. including Karatsuba multiplication
+  Multiply & Sqr.
+  We use long multiplication for small numbers, then Karatsuba, then
+  Toom-3, and finally a number theoretic transform (NTT) for huge numbers.
+  The cutoffs are in digits of the smaller operand and can be tuned at
+  build time.
 ----------------------------------------------------------------------*/
 
+#ifndef KK_BIGINT_KARATSUBA_CUTOFF
+#define KK_BIGINT_KARATSUBA_CUTOFF   (24)
+#endif
+#ifndef KK_BIGINT_TOOM3_CUTOFF
+#define KK_BIGINT_TOOM3_CUTOFF       (120)
+#endif
+#ifndef KK_BIGINT_NTT_CUTOFF
+#define KK_BIGINT_NTT_CUTOFF         (1000)
+#endif
+
+static kk_bigint_t* kk_bigint_cdiv_cmod_small(kk_bigint_t* x, kk_digit_t y, kk_digit_t* pmod, kk_context_t* ctx);
+static kk_bigint_t* kk_bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx);
+static kk_bigint_t* kk_bigint_sqr(kk_bigint_t* x, kk_context_t* ctx);
+
 static kk_bigint_t* bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
   size_t cx = bigint_count_(x);
   size_t cy = bigint_count_(y);
@@ -948,7 +1065,7 @@ static kk_bigint_t* bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx
       kk_digit_t dy = y->digits[j];
       kk_ddigit_t prod = ddigit_mul_add(dx,dy,z->digits[i+j]);
       kk_digit_t rem;
-      kk_digit_t carry = ddigit_cdiv(prod, BASE, &rem);
+      kk_digit_t carry = ddigit_cdiv_base(prod, &rem);
       z->digits[i+j]    = rem;
       z->digits[i+j+1] += carry;
     }
@@ -969,7 +1086,7 @@ static kk_bigint_t* kk_bigint_mul_small(kk_bigint_t* x, kk_digit_t y, kk_context
   for (i = 0; i < cx; i++) {
     kk_ddigit_t prod = ddigit_mul_add(x->digits[i], y, carry);
     kk_digit_t rem;
-    carry = ddigit_cdiv(prod, BASE, &rem);
+    carry = ddigit_cdiv_base(prod, &rem);
     kk_assert_internal(rem < BASE);
     z->digits[i] = rem;
   }
@@ -983,13 +1100,47 @@ static kk_bigint_t* kk_bigint_mul_small(kk_bigint_t* x, kk_digit_t y, kk_context
   return kk_bigint_trim_to(z, i, true, ctx);
 }
 
-static kk_bigint_t* kk_bigint_sqr(kk_bigint_t* x, kk_context_t* ctx) {
-  dup_bigint(x);
-  return bigint_mul(x, x, ctx);
+// Long squaring: compute the cross products once, double them, and add the squares.
+static kk_bigint_t* bigint_sqr(kk_bigint_t* x, kk_context_t* ctx) {
+  const size_t cx = bigint_count_(x);
+  const size_t cz = 2*cx;
+  kk_bigint_t* z = bigint_alloc_zero(cz, false, ctx);
+  for (size_t i = 0; i < cx; i++) {
+    const kk_digit_t dx = x->digits[i];
+    kk_digit_t carry = 0;
+    for (size_t j = i+1; j < cx; j++) {
+      kk_ddigit_t prod = ddigit_mul_add(dx, x->digits[j], z->digits[i+j] + carry);
+      kk_digit_t rem;
+      carry = ddigit_cdiv_base(prod, &rem);
+      z->digits[i+j] = rem;
+    }
+    z->digits[i+cx] = carry;
+  }
+  kk_digit_t carry = 0;
+  for (size_t i = 0; i < cz; i++) {
+    kk_digit_t d = 2*z->digits[i] + carry;
+    carry = (d >= BASE ? 1 : 0);
+    z->digits[i] = (carry ? d - BASE : d);
+  }
+  kk_assert_internal(carry == 0);
+  carry = 0;
+  for (size_t i = 0; i < cx; i++) {
+    kk_ddigit_t prod = ddigit_mul_add(x->digits[i], x->digits[i], z->digits[2*i] + carry);
+    kk_digit_t rem;
+    kk_digit_t hi = ddigit_cdiv_base(prod, &rem);
+    z->digits[2*i] = rem;
+    kk_digit_t d = z->digits[2*i+1] + hi;
+    carry = (d >= BASE ? 1 : 0);
+    z->digits[2*i+1] = (carry ? d - BASE : d);
+  }
+  kk_assert_internal(carry == 0);
+  drop_bigint(x, ctx);
+  return kk_bigint_trim(z, true, ctx);
 }
 
 static kk_bigint_t* kk_bigint_shift_left(kk_bigint_t* x, size_t digits, kk_context_t* ctx) {
   const size_t cx = x->count;
+  if (cx == 0 || digits == 0) return x;
   kk_bigint_t* z = bigint_alloc_reuse_(x, x->count + digits, ctx);
   memmove(&z->digits[digits], &x->digits[0], sizeof(kk_digit_t)*cx);
   memset(&z->digits[0], 0, sizeof(kk_digit_t)*digits);
@@ -997,39 +1148,45 @@ static kk_bigint_t* kk_bigint_shift_left(kk_bigint_t* x, size_t digits, kk_conte
   return z;
 }
 
+// Take the digits from `lo` up to `hi` (trimmed); the result has the sign of `x`.
 static kk_bigint_t* kk_bigint_slice(kk_bigint_t* x, size_t lo, size_t hi, kk_context_t* ctx) {
+  if (hi > x->count) hi = x->count;
+  if (lo > hi) lo = hi;
+  kk_bigint_t* z;
   if (lo == 0 && bigint_is_unique_(x)) {
-    return kk_bigint_trim_to(x, hi, false, ctx);
-  }
-  if (lo >= x->count) lo = x->count;
-  if (hi > x->count)  hi = x->count;
-  const size_t cz = hi - lo;
-  kk_bigint_t* z = bigint_alloc(cz, x->is_neg, ctx);
-  if (cz==0) {
-    z->digits[0] = 0;
-    z->count = 1;
-    z->extra--;
+    z = kk_bigint_trim_to(x, hi, true, ctx);
   }
-  else if (lo < x->count) {
-    memcpy(&z->digits[0], &x->digits[lo], sizeof(kk_digit_t)*cz);
+  else {
+    z = bigint_alloc(hi - lo, x->is_neg, ctx);
+    memcpy(&z->digits[0], &x->digits[lo], sizeof(kk_digit_t)*(hi - lo));
+    drop_bigint(x, ctx);
   }
-  return z;
+  return kk_bigint_trim(z, true, ctx);
 }
 
+// Karatsuba multiplication; if `y == NULL` we square `x`.
 static kk_bigint_t* bigint_mul_karatsuba(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
-  size_t n = (x->count >= y->count ? x->count : y->count);
-  if (n <= 25) return bigint_mul(x, y, ctx);
+  size_t n = (y == NULL || x->count >= y->count ? x->count : y->count);
   n = ((n + 1) / 2);
 
   kk_bigint_t* b = kk_bigint_slice(dup_bigint(x), n, x->count, ctx);
   kk_bigint_t* a = kk_bigint_slice(x, 0, n, ctx);
-  kk_bigint_t* d = kk_bigint_slice(dup_bigint(y), n, y->count, ctx);
-  kk_bigint_t* c = kk_bigint_slice(y, 0, n, ctx);
-
-  kk_bigint_t* ac = bigint_mul_karatsuba(dup_bigint(a), dup_bigint(c), ctx);
-  kk_bigint_t* bd = bigint_mul_karatsuba(dup_bigint(b), dup_bigint(d), ctx);
-  kk_bigint_t* abcd = bigint_mul_karatsuba( bigint_add(a, b, b->is_neg, ctx),
-                                         bigint_add(c, d, d->is_neg, ctx), ctx);
+  kk_bigint_t* ac;
+  kk_bigint_t* bd;
+  kk_bigint_t* abcd;
+  if (y == NULL) {
+    ac   = kk_bigint_sqr(dup_bigint(a), ctx);
+    bd   = kk_bigint_sqr(dup_bigint(b), ctx);
+    abcd = kk_bigint_sqr(bigint_add(a, b, b->is_neg, ctx), ctx);
+  }
+  else {
+    kk_bigint_t* d = kk_bigint_slice(dup_bigint(y), n, y->count, ctx);
+    kk_bigint_t* c = kk_bigint_slice(y, 0, n, ctx);
+    ac   = kk_bigint_mul(dup_bigint(a), dup_bigint(c), ctx);
+    bd   = kk_bigint_mul(dup_bigint(b), dup_bigint(d), ctx);
+    abcd = kk_bigint_mul(bigint_add(a, b, b->is_neg, ctx),
+                         bigint_add(c, d, d->is_neg, ctx), ctx);
+  }
   kk_bigint_t* p1 = kk_bigint_shift_left(kk_bigint_sub(kk_bigint_sub(abcd, dup_bigint(ac), ac->is_neg, ctx),
                                               dup_bigint(bd), bd->is_neg, ctx), n, ctx);
   kk_bigint_t* p2 = kk_bigint_shift_left(bd, 2 * n, ctx);
@@ -1037,6 +1194,296 @@ static kk_bigint_t* bigint_mul_karatsuba(kk_bigint_t* x, kk_bigint_t* y, kk_cont
   return kk_bigint_trim(prod,true, ctx);
 }
 
+// Split `x` in three parts `x0 + x1*B^k + x2*B^2k` and evaluate at 0, 1, -1, -2, and infinity.
+static void bigint_toom3_eval(kk_bigint_t* x, size_t k, kk_bigint_t* v[5], kk_context_t* ctx) {
+  kk_bigint_t* x2 = kk_bigint_slice(dup_bigint(x), 2*k, x->count, ctx);
+  kk_bigint_t* x1 = kk_bigint_slice(dup_bigint(x), k, 2*k, ctx);
+  kk_bigint_t* x0 = kk_bigint_slice(x, 0, k, ctx);
+  kk_bigint_t* p  = bigint_add(dup_bigint(x0), dup_bigint(x2), x2->is_neg, ctx);
+  v[0] = x0;
+  v[1] = bigint_add(dup_bigint(p), dup_bigint(x1), x1->is_neg, ctx);   // x0 + x1 + x2
+  v[2] = kk_bigint_sub(p, x1, x1->is_neg, ctx);                          // x0 - x1 + x2
+  v[3] = kk_bigint_mul_small(bigint_add(dup_bigint(v[2]), dup_bigint(x2), x2->is_neg, ctx), 2, ctx);
+  v[3] = kk_bigint_sub(v[3], dup_bigint(x0), x0->is_neg, ctx);           // x0 - 2*x1 + 4*x2
+  v[4] = x2;
+}
+
+// Toom-3 multiplication (using the interpolation sequence of Bodrato); if `y == NULL` we square `x`.
+static kk_bigint_t* bigint_mul_toom3(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
+  size_t n = (y == NULL || x->count >= y->count ? x->count : y->count);
+  const size_t k = (n + 2) / 3;
+  kk_bigint_t* vx[5];
+  kk_bigint_t* r[5];
+  bigint_toom3_eval(x, k, vx, ctx);
+  if (y == NULL) {
+    for (size_t i = 0; i < 5; i++) { r[i] = kk_bigint_sqr(vx[i], ctx); }
+  }
+  else {
+    kk_bigint_t* vy[5];
+    bigint_toom3_eval(y, k, vy, ctx);
+    for (size_t i = 0; i < 5; i++) { r[i] = kk_bigint_mul(vx[i], vy[i], ctx); }
+  }
+  // interpolate (all divisions are exact)
+  kk_bigint_t* r0 = r[0];
+  kk_bigint_t* rinf = r[4];
+  kk_bigint_t* r3 = kk_bigint_cdiv_cmod_small(kk_bigint_sub(r[3], dup_bigint(r[1]), r[1]->is_neg, ctx), 3, NULL, ctx);
+  kk_bigint_t* r1 = kk_bigint_cdiv_cmod_small(kk_bigint_sub(r[1], dup_bigint(r[2]), r[2]->is_neg, ctx), 2, NULL, ctx);
+  kk_bigint_t* r2 = kk_bigint_sub(r[2], dup_bigint(r0), r0->is_neg, ctx);
+  r3 = kk_bigint_cdiv_cmod_small(kk_bigint_sub(dup_bigint(r2), r3, r3->is_neg, ctx), 2, NULL, ctx);
+  kk_bigint_t* rinf2 = kk_bigint_mul_small(dup_bigint(rinf), 2, ctx);
+  r3 = bigint_add(r3, rinf2, rinf2->is_neg, ctx);
+  r2 = bigint_add(r2, dup_bigint(r1), r1->is_neg, ctx);
+  r2 = kk_bigint_sub(r2, dup_bigint(rinf), rinf->is_neg, ctx);
+  r1 = kk_bigint_sub(r1, dup_bigint(r3), r3->is_neg, ctx);
+  // and recompose
+  kk_bigint_t* prod = r0;
+  r1   = kk_bigint_shift_left(r1, k, ctx);
+  prod = bigint_add(prod, r1, r1->is_neg, ctx);
+  r2   = kk_bigint_shift_left(r2, 2*k, ctx);
+  prod = bigint_add(prod, r2, r2->is_neg, ctx);
+  r3   = kk_bigint_shift_left(r3, 3*k, ctx);
+  prod = bigint_add(prod, r3, r3->is_neg, ctx);
+  rinf = kk_bigint_shift_left(rinf, 4*k, ctx);
+  prod = bigint_add(prod, rinf, rinf->is_neg, ctx);
+  return kk_bigint_trim(prod, true, ctx);
+}
+
+// Multiply a long `x` with a shorter `y` by multiplying `y` with slices of `x` of the same length.
+static kk_bigint_t* bigint_mul_unbalanced(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
+  const size_t cx = bigint_count_(x);
+  const size_t cy = bigint_count_(y);
+  kk_assert_internal(cx >= cy && cy > 0);
+  kk_bigint_t* z = bigint_alloc_zero(cx + cy, (bigint_is_neg_(x) != bigint_is_neg_(y)), ctx);
+  for (size_t lo = 0; lo < cx; lo += cy) {
+    kk_bigint_t* p = kk_bigint_mul(kk_bigint_slice(dup_bigint(x), lo, lo + cy, ctx), dup_bigint(y), ctx);
+    // add the digits of `p` at `lo`
+    kk_digit_t carry = 0;
+    size_t i;
+    for (i = 0; i < p->count; i++) {
+      kk_digit_t sum = z->digits[lo + i] + p->digits[i] + carry;
+      carry = (sum >= BASE ? 1 : 0);
+      z->digits[lo + i] = (carry ? sum - BASE : sum);
+    }
+    for (i += lo; carry != 0; i++) {
+      kk_assert_internal(i < cx + cy);
+      kk_digit_t sum = z->digits[i] + carry;
+      carry = (sum >= BASE ? 1 : 0);
+      z->digits[i] = (carry ? sum - BASE : sum);
+    }
+    drop_bigint(p, ctx);
+  }
+  drop_bigint(x, ctx);
+  drop_bigint(y, ctx);
+  return kk_bigint_trim(z, true, ctx);
+}
+
+
+/*----------------------------------------------------------------------
+  NTT multiplication
+  The digits are split in pieces of 10^9 which are convolved modulo three
+  primes below 2^30 that support transforms up to 2^23 elements. The
+  product of the primes (about 2^86) exceeds the largest coefficient
+  (`2^22 * (10^9)^2`) so we can reconstruct the exact result with the
+  Chinese remainder theorem.
+----------------------------------------------------------------------*/
+
+#define KK_NTT_PIECE        (1000000000UL)
+#define KK_NTT_PIECES       (LOG_BASE/9)   // pieces per digit
+#define KK_NTT_MAX          ((size_t)1 << 23)
+
+static const uint32_t kk_ntt_primes[3] = { 998244353, 167772161, 469762049 };  // c*2^k + 1, all with primitive root 3
+
+static uint32_t ntt_mulmod(uint32_t x, uint32_t y, uint32_t p) {
+  return (uint32_t)(((uint64_t)x * y) % p);
+}
+
+static uint32_t ntt_powmod(uint32_t x, uint64_t n, uint32_t p) {
+  uint32_t r = 1;
+  while (n > 0) {
+    if ((n&1) != 0) r = ntt_mulmod(r, x, p);
+    x = ntt_mulmod(x, x, p);
+    n >>= 1;
+  }
+  return r;
+}
+
+// The transforms use Montgomery multiplication (with R = 2^32) to avoid divisions
+typedef struct kk_ntt_mod_s {
+  uint32_t p;
+  uint32_t pneg_inv;  // -1/p mod R
+  uint32_t r2;        // R^2 mod p
+} kk_ntt_mod_t;
+
+static kk_ntt_mod_t ntt_mod(uint32_t p) {
+  uint32_t inv = p;   // Newton iteration for 1/p mod 2^32
+  for (int i = 0; i < 5; i++) { inv *= 2 - p*inv; }
+  kk_ntt_mod_t m;
+  m.p = p;
+  m.pneg_inv = (uint32_t)(0 - inv);
+  const uint64_t r = ((uint64_t)1 << 32) % p;
+  m.r2 = (uint32_t)((r * r) % p);
+  return m;
+}
+
+static inline uint32_t ntt_mont_mul(uint32_t x, uint32_t y, const kk_ntt_mod_t* m) {
+  const uint64_t t = (uint64_t)x * y;
+  const uint32_t q = (uint32_t)t * m->pneg_inv;
+  const uint32_t u = (uint32_t)((t + (uint64_t)q * m->p) >> 32);
+  return (u >= m->p ? u - m->p : u);
+}
+
+static inline uint32_t ntt_to_mont(uint32_t x, const kk_ntt_mod_t* m) {
+  return ntt_mont_mul(x, m->r2, m);
+}
+
+// Transform `a` (of length `n`, a power of 2, in Montgomery form) using `tw` (of length `n/2`) for the roots.
+// The inverse also divides by `n` and converts back from Montgomery form.
+static void ntt_transform(uint32_t* a, size_t n, bool invert, const kk_ntt_mod_t* m, uint32_t* tw) {
+  const uint32_t p = m->p;
+  // bit reversal permutation
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; (j & bit) != 0; bit >>= 1) { j ^= bit; }
+    j ^= bit;
+    if (i < j) { uint32_t t = a[i]; a[i] = a[j]; a[j] = t; }
+  }
+  // butterflies
+  const uint32_t one = ntt_to_mont(1, m);
+  for (size_t len = 2; len <= n; len <<= 1) {
+    uint32_t w = ntt_powmod(3, (p - 1) / len, p);
+    if (invert) { w = ntt_powmod(w, p - 2, p); }
+    w = ntt_to_mont(w, m);
+    const size_t half = len/2;
+    tw[0] = one;
+    for (size_t j = 1; j < half; j++) { tw[j] = ntt_mont_mul(tw[j-1], w, m); }
+    for (size_t i = 0; i < n; i += len) {
+      uint32_t* lo = a + i;
+      uint32_t* hi = a + i + half;
+      for (size_t j = 0; j < half; j++) {
+        const uint32_t u = lo[j];
+        const uint32_t v = ntt_mont_mul(hi[j], tw[j], m);
+        lo[j] = (u + v >= p ? u + v - p : u + v);
+        hi[j] = (u >= v ? u - v : u + p - v);
+      }
+    }
+  }
+  if (invert) {
+    const uint32_t ninv = ntt_powmod((uint32_t)(n % p), p - 2, p);  // not in Montgomery form
+    for (size_t i = 0; i < n; i++) { a[i] = ntt_mont_mul(a[i], ninv, m); }
+  }
+}
+
+static void ntt_pieces(const kk_bigint_t* x, uint32_t* pieces) {
+  for (size_t i = 0; i < x->count; i++) {
+    kk_digit_t d = x->digits[i];
+    for (size_t j = 0; j < KK_NTT_PIECES; j++) {
+      pieces[i*KK_NTT_PIECES + j] = (uint32_t)(d % KK_NTT_PIECE);
+      d /= KK_NTT_PIECE;
+    }
+  }
+}
+
+static bool bigint_ntt_fits(size_t cx, size_t cy) {
+  return ((cx + cy)*KK_NTT_PIECES <= KK_NTT_MAX);
+}
+
+// NTT multiplication; if `y == NULL` we square `x`.
+static kk_bigint_t* bigint_mul_ntt(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
+  const size_t cx = bigint_count_(x);
+  const size_t cy = (y == NULL ? cx : bigint_count_(y));
+  kk_assert_internal(bigint_ntt_fits(cx, cy));
+  const size_t nx = cx*KK_NTT_PIECES;
+  const size_t ny = cy*KK_NTT_PIECES;
+  size_t n = 1;
+  while (n < nx + ny) { n *= 2; }
+  uint32_t* buf = (uint32_t*)kk_malloc(sizeof(uint32_t)*(nx + ny + 5*n + n/2), ctx);
+  if (buf == NULL) kk_fatal_error(ENOMEM, "unable to allocate memory for an integer multiplication");
+  uint32_t* px  = buf;
+  uint32_t* py  = px + nx;
+  uint32_t* fa  = py + ny;
+  uint32_t* fb  = fa + n;
+  uint32_t* res = fb + n;   // 3*n: the convolution modulo each prime
+  uint32_t* tw  = res + 3*n;
+  ntt_pieces(x, px);
+  if (y != NULL) ntt_pieces(y, py);
+  for (size_t k = 0; k < 3; k++) {
+    const kk_ntt_mod_t m = ntt_mod(kk_ntt_primes[k]);
+    uint32_t* r = res + k*n;
+    for (size_t i = 0; i < n; i++) { fa[i] = (i < nx ? ntt_to_mont(px[i] % m.p, &m) : 0); }
+    ntt_transform(fa, n, false, &m, tw);
+    if (y == NULL) {
+      for (size_t i = 0; i < n; i++) { r[i] = ntt_mont_mul(fa[i], fa[i], &m); }
+    }
+    else {
+      for (size_t i = 0; i < n; i++) { fb[i] = (i < ny ? ntt_to_mont(py[i] % m.p, &m) : 0); }
+      ntt_transform(fb, n, false, &m, tw);
+      for (size_t i = 0; i < n; i++) { r[i] = ntt_mont_mul(fa[i], fb[i], &m); }
+    }
+    ntt_transform(r, n, true, &m, tw);
+  }
+  // reconstruct each coefficient with the CRT (Garner) and propagate the carries
+  const uint32_t p1 = kk_ntt_primes[0];
+  const uint32_t p2 = kk_ntt_primes[1];
+  const uint32_t p3 = kk_ntt_primes[2];
+  const uint64_t p12 = (uint64_t)p1 * p2;
+  const uint64_t p12_lo = p12 % KK_NTT_PIECE;
+  const uint64_t p12_hi = p12 / KK_NTT_PIECE;
+  const uint32_t inv_p1 = ntt_powmod(p1 % p2, p2 - 2, p2);                 // 1/p1 mod p2
+  const uint32_t inv_p12 = ntt_powmod((uint32_t)(p12 % p3), p3 - 2, p3);   // 1/(p1*p2) mod p3
+  const size_t cz = cx + cy;
+  kk_bigint_t* z = bigint_alloc_zero(cz, (y != NULL && bigint_is_neg_(x) != bigint_is_neg_(y)), ctx);
+  uint64_t carry = 0;
+  for (size_t i = 0; i < cz*KK_NTT_PIECES; i++) {
+    uint64_t sum = carry;
+    carry = 0;
+    if (i < n) {
+      const uint32_t r1 = res[i];
+      const uint32_t r2 = res[n + i];
+      const uint32_t r3 = res[2*n + i];
+      const uint32_t t2 = ntt_mulmod((r2 + p2 - (r1 % p2)) % p2, inv_p1, p2);
+      const uint64_t x12 = r1 + (uint64_t)p1 * t2;                       // < p1*p2
+      const uint32_t t3 = ntt_mulmod((uint32_t)((r3 + p3 - (x12 % p3)) % p3), inv_p12, p3);
+      // coefficient = x12 + p12*t3 = x12 + p12_lo*t3 + p12_hi*t3*10^9
+      sum += x12 + p12_lo*t3;
+      carry = p12_hi*t3;
+    }
+    carry += sum / KK_NTT_PIECE;
+    const kk_digit_t piece = (kk_digit_t)(sum % KK_NTT_PIECE);
+    const size_t j = i % KK_NTT_PIECES;
+    kk_digit_t scale = 1;
+    for (size_t s = 0; s < j; s++) { scale *= KK_NTT_PIECE; }
+    z->digits[i / KK_NTT_PIECES] += piece * scale;
+  }
+  kk_assert_internal(carry == 0);
+  kk_free(buf);
+  drop_bigint(x, ctx);
+  if (y != NULL) drop_bigint(y, ctx);
+  return kk_bigint_trim(z, true, ctx);
+}
+
+
+/*----------------------------------------------------------------------
+  Select a multiplication algorithm
+----------------------------------------------------------------------*/
+
+static kk_bigint_t* kk_bigint_mul(kk_bigint_t* x, kk_bigint_t* y, kk_context_t* ctx) {
+  if (x->count < y->count) { kk_bigint_t* t = x; x = y; y = t; }
+  const size_t n = y->count;  // the shorter one
+  if (n < KK_BIGINT_KARATSUBA_CUTOFF) return bigint_mul(x, y, ctx);
+  if (n >= KK_BIGINT_NTT_CUTOFF && bigint_ntt_fits(x->count, n)) return bigint_mul_ntt(x, y, ctx);
+  if (x->count >= 2*n) return bigint_mul_unbalanced(x, y, ctx);
+  if (n < KK_BIGINT_TOOM3_CUTOFF) return bigint_mul_karatsuba(x, y, ctx);
+  return bigint_mul_toom3(x, y, ctx);
+}
+
+static kk_bigint_t* kk_bigint_sqr(kk_bigint_t* x, kk_context_t* ctx) {
+  const size_t n = x->count;
+  if (n < KK_BIGINT_KARATSUBA_CUTOFF) return bigint_sqr(x, ctx);
+  if (n >= KK_BIGINT_NTT_CUTOFF && bigint_ntt_fits(n, n)) return bigint_mul_ntt(x, NULL, ctx);
+  if (n < KK_BIGINT_TOOM3_CUTOFF) return bigint_mul_karatsuba(x, NULL, ctx);
+  return bigint_mul_toom3(x, NULL, ctx);
+}
+
 
 /*----------------------------------'------------------------------------
   Pow
@@ -1147,7 +1594,7 @@ static kk_bigint_t* bigint_cdiv_cmod(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t
     for (size_t i = 0; i < cd; i++) {
       kk_ddigit_t dcarry = ddigit_mul_add( qd, div->digits[i], carry );
       kk_digit_t carry_rem;
-      carry = ddigit_cdiv(dcarry, BASE, &carry_rem);
+      carry = ddigit_cdiv_base(dcarry, &carry_rem);
       borrow += (rem->digits[shift + i] - carry_rem);
       if (borrow >= BASE) {  // unsigned wrap
         kk_assert_internal(borrow + BASE < BASE);
@@ -1192,6 +1639,229 @@ static kk_bigint_t* bigint_cdiv_cmod(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t
 }
 
 
+/*----------------------------------------------------------------------
+  Fast division
+  For large divisors we use the recursive division of Burnikel and
+  Ziegler which divides a `2n` digit number by an `n` digit number using
+  two `3n/2` by `n` divisions (each costing a multiplication of `n/2`
+  digits). For very large divisors we instead compute a reciprocal with
+  Newton iteration once and divide by multiplying with it.
+  All functions in this section work on non-negative numbers only.
+----------------------------------------------------------------------*/
+
+#ifndef KK_BIGINT_BZ_CUTOFF
+#define KK_BIGINT_BZ_CUTOFF       (60)     // in digits of the divisor
+#endif
+#ifndef KK_BIGINT_NEWTON_CUTOFF
+#define KK_BIGINT_NEWTON_CUTOFF   (2000)   // in digits of the divisor
+#endif
+
+static bool bigint_is_zero_(kk_bigint_t* x) {
+  return (x->count == 0);
+}
+
+static bool bigint_is_strict_neg_(kk_bigint_t* x) {
+  return (x->is_neg && x->count > 0);
+}
+
+static kk_bigint_t* bigint_zero(kk_context_t* ctx) {
+  return bigint_alloc(0, false, ctx);
+}
+
+// `BASE^n - 1`
+static kk_bigint_t* bigint_base_pow_dec(size_t n, kk_context_t* ctx) {
+  kk_bigint_t* z = bigint_alloc(n, false, ctx);
+  for (size_t i = 0; i < n; i++) { z->digits[i] = BASE - 1; }
+  return z;
+}
+
+static kk_bigint_t* bigint_inc(kk_bigint_t* x, kk_context_t* ctx) {
+  return bigint_add(x, bigint_from_int(1, ctx), false, ctx);
+}
+
+static kk_bigint_t* bigint_dec(kk_bigint_t* x, kk_context_t* ctx) {
+  return kk_bigint_sub(x, bigint_from_int(1, ctx), false, ctx);
+}
+
+// Long division that also allows `x < y`.
+static kk_bigint_t* bigint_cdiv_cmod_long(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t** pmod, kk_context_t* ctx) {
+  if (bigint_compare_abs_(x, y) < 0) {
+    drop_bigint(y, ctx);
+    *pmod = x;
+    return bigint_zero(ctx);
+  }
+  return bigint_cdiv_cmod(x, y, pmod, ctx);
+}
+
+static kk_bigint_t* bigint_div2n1n(kk_bigint_t* a, kk_bigint_t* b, size_t n, kk_bigint_t** pmod, kk_context_t* ctx);
+
+// Divide `a12*BASE^n + a3` by `b = b1*BASE^n + b2` where `a12 < b*BASE^n` (and `b` is normalized).
+// `b`, `b1`, and `b2` are borrowed.
+static kk_bigint_t* bigint_div3n2n(kk_bigint_t* a12, kk_bigint_t* a3, kk_bigint_t* b, kk_bigint_t* b1, kk_bigint_t* b2, size_t n, kk_bigint_t** pmod, kk_context_t* ctx) {
+  kk_bigint_t* q;
+  kk_bigint_t* r;
+  kk_bigint_t* a1 = kk_bigint_slice(dup_bigint(a12), n, a12->count, ctx);
+  const bool a1_eq_b1 = (bigint_compare_abs_(a1, b1) == 0);
+  drop_bigint(a1, ctx);
+  if (a1_eq_b1) {
+    // q = BASE^n - 1, r = a12 - b1*BASE^n + b1
+    q = bigint_base_pow_dec(n, ctx);
+    r = kk_bigint_sub(a12, kk_bigint_shift_left(dup_bigint(b1), n, ctx), false, ctx);
+    r = bigint_add(r, dup_bigint(b1), false, ctx);
+  }
+  else {
+    q = bigint_div2n1n(a12, dup_bigint(b1), n, &r, ctx);
+  }
+  r = bigint_add(kk_bigint_shift_left(r, n, ctx), a3, false, ctx);
+  r = kk_bigint_sub(r, kk_bigint_mul(dup_bigint(q), dup_bigint(b2), ctx), false, ctx);
+  while (bigint_is_strict_neg_(r)) {   // at most twice
+    q = bigint_dec(q, ctx);
+    r = bigint_add(r, dup_bigint(b), false, ctx);
+  }
+  *pmod = r;
+  return q;
+}
+
+// Divide `a` by `b` where `b` has `n` digits, is normalized (`b->digits[n-1] >= BASE/2`), and `a < b*BASE^n`.
+static kk_bigint_t* bigint_div2n1n(kk_bigint_t* a, kk_bigint_t* b, size_t n, kk_bigint_t** pmod, kk_context_t* ctx) {
+  if (n <= KK_BIGINT_BZ_CUTOFF || a->count <= n + KK_BIGINT_BZ_CUTOFF) {
+    return bigint_cdiv_cmod_long(a, b, pmod, ctx);
+  }
+  const bool pad = ((n & 1) != 0);
+  if (pad) {
+    a = kk_bigint_shift_left(a, 1, ctx);
+    b = kk_bigint_shift_left(b, 1, ctx);
+    n++;
+  }
+  const size_t half = n / 2;
+  kk_bigint_t* b1 = kk_bigint_slice(dup_bigint(b), half, n, ctx);
+  kk_bigint_t* b2 = kk_bigint_slice(dup_bigint(b), 0, half, ctx);
+  kk_bigint_t* a12 = kk_bigint_slice(dup_bigint(a), n, a->count, ctx);
+  kk_bigint_t* a3  = kk_bigint_slice(dup_bigint(a), half, n, ctx);
+  kk_bigint_t* a4  = kk_bigint_slice(a, 0, half, ctx);
+  kk_bigint_t* r;
+  kk_bigint_t* q1 = bigint_div3n2n(a12, a3, b, b1, b2, half, &r, ctx);
+  kk_bigint_t* q2 = bigint_div3n2n(r, a4, b, b1, b2, half, &r, ctx);
+  drop_bigint(b1, ctx);
+  drop_bigint(b2, ctx);
+  drop_bigint(b, ctx);
+  if (pad) {
+    r = kk_bigint_slice(r, 1, r->count, ctx);
+  }
+  *pmod = r;
+  return bigint_add(kk_bigint_shift_left(q1, half, ctx), q2, false, ctx);
+}
+
+// Approximate `BASE^(2n) / y` (within a few units) where `y` has `n` digits and is normalized (`y` is borrowed).
+static kk_bigint_t* bigint_recip(kk_bigint_t* y, kk_context_t* ctx) {
+  const size_t n = y->count;
+  if (n <= KK_BIGINT_NEWTON_CUTOFF/2) {
+    kk_bigint_t* p = kk_bigint_shift_left(bigint_from_int(1, ctx), 2*n, ctx);
+    kk_bigint_t* r;
+    kk_bigint_t* v = bigint_div2n1n(p, dup_bigint(y), n, &r, ctx);
+    drop_bigint(r, ctx);
+    return v;
+  }
+  // take the reciprocal of the top `h` digits (with a few guard digits) and do one Newton step:
+  // v = v0 + v0*(BASE^(2n) - y*v0)/BASE^(2n)
+  const size_t h = (n+1)/2 + 2;
+  kk_bigint_t* yh = kk_bigint_slice(dup_bigint(y), n - h, n, ctx);
+  kk_bigint_t* v0 = kk_bigint_shift_left(bigint_recip(yh, ctx), n - h, ctx);
+  drop_bigint(yh, ctx);
+  kk_bigint_t* e = kk_bigint_shift_left(bigint_from_int(1, ctx), 2*n, ctx);
+  e = kk_bigint_sub(e, kk_bigint_mul(dup_bigint(y), dup_bigint(v0), ctx), false, ctx);
+  const bool eneg = bigint_is_neg_(e);
+  kk_bigint_t* corr = kk_bigint_mul(dup_bigint(v0), e, ctx);
+  corr = kk_bigint_slice(corr, 2*n, corr->count, ctx);
+  return bigint_add(v0, corr, eneg, ctx);
+}
+
+// Divide `a` by `b` where `b` has `n` digits and `a < b*BASE^n`, using the reciprocal `v` of `b` (borrowed).
+static kk_bigint_t* bigint_div2n1n_recip(kk_bigint_t* a, kk_bigint_t* b, kk_bigint_t* v, size_t n, kk_bigint_t** pmod, kk_context_t* ctx) {
+  kk_bigint_t* q = kk_bigint_mul(dup_bigint(a), dup_bigint(v), ctx);
+  q = kk_bigint_slice(q, 2*n, q->count, ctx);
+  kk_bigint_t* r = kk_bigint_sub(a, kk_bigint_mul(dup_bigint(q), dup_bigint(b), ctx), false, ctx);
+  // correct the (small) error of the estimate
+  for (int i = 0; i < 4 && bigint_is_strict_neg_(r); i++) {
+    q = bigint_dec(q, ctx);
+    r = bigint_add(r, dup_bigint(b), false, ctx);
+  }
+  for (int i = 0; i < 4 && bigint_compare_abs_(r, b) >= 0 && !bigint_is_neg_(r); i++) {
+    q = bigint_inc(q, ctx);
+    r = kk_bigint_sub(r, dup_bigint(b), false, ctx);
+  }
+  if (bigint_is_strict_neg_(r) || bigint_compare_abs_(r, b) >= 0) {
+    // should not happen, but fall back to exact division of the remainder
+    const bool rneg = bigint_is_neg_(r);
+    r->is_neg = 0;
+    kk_bigint_t* rr;
+    kk_bigint_t* qq = bigint_div2n1n(r, dup_bigint(b), n, &rr, ctx);
+    if (!rneg) {
+      q = bigint_add(q, qq, false, ctx);
+      r = rr;
+    }
+    else if (bigint_is_zero_(rr)) {
+      q = kk_bigint_sub(q, qq, false, ctx);
+      r = rr;
+    }
+    else {
+      q = kk_bigint_sub(q, bigint_inc(qq, ctx), false, ctx);
+      r = kk_bigint_sub(dup_bigint(b), rr, false, ctx);
+    }
+  }
+  drop_bigint(b, ctx);
+  *pmod = r;
+  return q;
+}
+
+// Divide non-negative `x` by positive `y` (with at least 2 digits) and return the quotient and remainder.
+static kk_bigint_t* bigint_cdiv_cmod_fast(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t** pmod, kk_context_t* ctx) {
+  // normalize such that `y->digits[n-1] >= BASE/2`
+  const kk_digit_t lambda = BASE / (bigint_last_digit_(y) + 1);
+  if (lambda > 1) {
+    x = kk_bigint_mul_small(x, lambda, ctx);
+    y = kk_bigint_mul_small(y, lambda, ctx);
+  }
+  const size_t n = y->count;
+  kk_assert_internal(y->digits[n-1] >= BASE/2);
+  // long division in base `BASE^n`; with many such digits it pays off to compute the reciprocal first
+  const size_t m = (x->count + n - 1) / n;
+  kk_bigint_t* v = (n >= KK_BIGINT_NEWTON_CUTOFF && m > 4 ? bigint_recip(y, ctx) : NULL);
+  kk_bigint_t* q = bigint_alloc_zero(m*n, false, ctx);
+  kk_bigint_t* r = bigint_zero(ctx);
+  for (size_t i = m; i > 0; i--) {
+    kk_bigint_t* a = kk_bigint_slice(dup_bigint(x), (i-1)*n, i*n, ctx);
+    a = bigint_add(kk_bigint_shift_left(r, n, ctx), a, false, ctx);
+    kk_bigint_t* qd = (v != NULL ? bigint_div2n1n_recip(a, dup_bigint(y), v, n, &r, ctx)
+                                 : bigint_div2n1n(a, dup_bigint(y), n, &r, ctx));
+    kk_assert_internal(qd->count <= n);
+    memcpy(&q->digits[(i-1)*n], &qd->digits[0], qd->count * sizeof(kk_digit_t));
+    drop_bigint(qd, ctx);
+  }
+  if (v != NULL) drop_bigint(v, ctx);
+  drop_bigint(x, ctx);
+  drop_bigint(y, ctx);
+  *pmod = (lambda > 1 ? kk_bigint_cdiv_cmod_small(r, lambda, NULL, ctx) : r);  // denormalize the remainder
+  return kk_bigint_trim(q, true, ctx);
+}
+
+// Divide `x` by `y` (with `|x| >= |y|`); the signs of the results are set by the caller.
+static kk_bigint_t* kk_bigint_cdiv_cmod(kk_bigint_t* x, kk_bigint_t* y, kk_bigint_t** pmod, kk_context_t* ctx) {
+  if (y->count <= KK_BIGINT_BZ_CUTOFF || x->count - y->count <= KK_BIGINT_BZ_CUTOFF) {
+    return bigint_cdiv_cmod(x, y, pmod, ctx);
+  }
+  if (bigint_is_neg_(x)) { x = bigint_ensure_unique(x, ctx); x->is_neg = 0; }
+  if (bigint_is_neg_(y)) { y = bigint_ensure_unique(y, ctx); y->is_neg = 0; }
+  kk_trace_begin("bigint divmod", ctx);
+  kk_bigint_t* mod;
+  kk_bigint_t* q = bigint_cdiv_cmod_fast(x, y, &mod, ctx);
+  kk_trace_end("bigint divmod", ctx);
+  if (pmod != NULL) { *pmod = mod; }
+               else { drop_bigint(mod, ctx); }
+  return q;
+}
+
+
 /*----------------------------------------------------------------------
   Addition and substraction
 ----------------------------------------------------------------------*/
@@ -1286,16 +1956,152 @@ kk_integer_t kk_integer_sub_generic(kk_integer_t x, kk_integer_t y, kk_context_t
   return integer_bigint(kk_bigint_sub(bx, by, by->is_neg, ctx), ctx);
 }
 
-static bool use_karatsuba(size_t i, size_t j) {
-  return ((0.000012*(double)(i*j) - 0.0025*(double)(i+j)) >= 0.0);
-}
-
 kk_integer_t kk_integer_mul_generic(kk_integer_t x, kk_integer_t y, kk_context_t* ctx) {
   kk_assert_internal(kk_is_integer(x)&&kk_is_integer(y));
   kk_bigint_t* bx = kk_integer_to_bigint(x, ctx);
   kk_bigint_t* by = kk_integer_to_bigint(y, ctx);
-  bool usek = use_karatsuba(bx->count, by->count);
-  return integer_bigint((usek ? bigint_mul_karatsuba(bx,by, ctx) : bigint_mul(bx, by, ctx)), ctx);
+  kk_trace_begin("bigint mul", ctx);
+  kk_bigint_t* z;
+  if (bx == by) {
+    drop_bigint(by, ctx);
+    z = kk_bigint_sqr(bx, ctx);
+  }
+  else {
+    z = kk_bigint_mul(bx, by, ctx);
+  }
+  kk_trace_end("bigint mul", ctx);
+  return integer_bigint(z, ctx);
+}
+
+
+/*----------------------------------------------------------------------
+  Fused multiply-add
+  Accumulations like `acc + x*y` or `acc*x + c` update the digits of
+  the accumulator in-place when it is a unique big integer; the capacity
+  grows geometrically such that a loop of accumulations mostly avoids
+  any allocation (and the intermediate product is never allocated).
+----------------------------------------------------------------------*/
+
+// Ensure a unique `x` has room for `count` digits and extend it with zero digits to that count.
+static kk_bigint_t* bigint_reserve_(kk_bigint_t* x, size_t count, kk_context_t* ctx) {
+  kk_assert_internal(bigint_is_unique_(x));
+  const size_t xcount = bigint_count_(x);
+  if (count <= xcount) return x;
+  size_t available = bigint_available_(x);
+  if (count > available) {
+    // grow by 50% (but keep the extra digits representable)
+    size_t extra = count/2;
+    if (extra > MAX_EXTRA/2) extra = MAX_EXTRA/2;
+    available = bigint_roundup_count(count + extra);
+    x = (kk_bigint_t*)kk_block_realloc(bigint_ptr_(x), sizeof(kk_bigint_t) - sizeof(kk_digit_t) + available*sizeof(kk_digit_t), ctx);
+  }
+  memset(&x->digits[xcount], 0, (count - xcount)*sizeof(kk_digit_t));
+  x->count = count;
+  x->extra = (kk_extra_t)(available - count);
+  return x;
+}
+
+// Add `|y|*|z|` to the digits of a unique `x` in-place (where `cy >= cz`).
+static kk_bigint_t* bigint_add_mul_abs_(kk_bigint_t* x, const kk_digit_t* ys, size_t cy, const kk_digit_t* zs, size_t cz, kk_context_t* ctx) {
+  kk_assert_internal(cy >= cz && cz > 0);
+  const size_t cx = bigint_count_(x);
+  x = bigint_reserve_(x, (cx > cy + cz ? cx : cy + cz) + 1, ctx);
+  for (size_t i = 0; i < cz; i++) {
+    const kk_digit_t dz = zs[i];
+    for (size_t j = 0; j < cy; j++) {
+      kk_ddigit_t prod = ddigit_mul_add(ys[j], dz, x->digits[i+j]);
+      kk_digit_t rem;
+      kk_digit_t carry = ddigit_cdiv_base(prod, &rem);
+      x->digits[i+j]    = rem;
+      x->digits[i+j+1] += carry;
+    }
+  }
+  // only the top digit of the last row can still be `>= BASE`; propagate its carry
+  for (size_t i = cy + cz - 1; x->digits[i] >= BASE; i++) {
+    kk_assert_internal(i+1 < bigint_count_(x));
+    x->digits[i+1] += x->digits[i] / BASE;
+    x->digits[i] %= BASE;
+  }
+  return kk_bigint_trim(x, false, ctx);
+}
+
+// Compute `x*y + z` in-place for a unique `x` and small positive `y` and `z` (`< BASE`).
+static kk_bigint_t* kk_bigint_mul_add_small(kk_bigint_t* x, kk_digit_t y, kk_digit_t z, kk_context_t* ctx) {
+  kk_assert_internal(y < BASE && z < BASE);
+  const size_t cx = bigint_count_(x);
+  x = bigint_reserve_(x, cx + 1, ctx);
+  kk_digit_t carry = z;
+  for (size_t i = 0; i < cx; i++) {
+    kk_ddigit_t prod = ddigit_mul_add(x->digits[i], y, carry);
+    kk_digit_t rem;
+    carry = ddigit_cdiv_base(prod, &rem);
+    x->digits[i] = rem;
+  }
+  x->digits[cx] = carry;
+  return kk_bigint_trim(x, false, ctx);
+}
+
+// The digits of an integer: either of a big integer, or written to `buf` for a small integer (without the sign).
+static const kk_digit_t* integer_digits_(kk_integer_t x, kk_digit_t* buf, size_t* count, bool* is_neg, kk_context_t* ctx) {
+  if (kk_is_bigint(x)) {
+    kk_bigint_t* bx = kk_integer_to_bigint(x, ctx);
+    *count = bigint_count_(bx);
+    *is_neg = bigint_is_neg_(bx);
+    return bx->digits;
+  }
+  kk_intx_t i = kk_smallint_from_integer(x);
+  *is_neg = (i < 0);
+  kk_uintx_t u = (i < 0 ? (kk_uintx_t)(-(i+1)) + 1 : (kk_uintx_t)i);
+  size_t n = 0;
+  do {
+    buf[n++] = (kk_digit_t)(u % BASE);
+    u /= BASE;
+  } while (u != 0);
+  *count = n;
+  return buf;
+}
+
+kk_integer_t kk_integer_add_mul_generic(kk_integer_t x, kk_integer_t y, kk_integer_t z, kk_context_t* ctx) {
+  kk_assert_internal(kk_is_integer(x)&&kk_is_integer(y)&&kk_is_integer(z));
+  if (kk_is_bigint(x) && bigint_is_unique_(kk_integer_to_bigint(x, ctx))) {
+    kk_digit_t ybuf[4];
+    kk_digit_t zbuf[4];
+    size_t cy;
+    size_t cz;
+    bool yneg;
+    bool zneg;
+    const kk_digit_t* ys = integer_digits_(y, ybuf, &cy, &yneg, ctx);
+    const kk_digit_t* zs = integer_digits_(z, zbuf, &cz, &zneg, ctx);
+    kk_bigint_t* bx = kk_integer_to_bigint(x, ctx);
+    if (cy < cz) {
+      const kk_digit_t* ts = ys; ys = zs; zs = ts;
+      size_t tc = cy; cy = cz; cz = tc;
+    }
+    if (cz < KK_BIGINT_KARATSUBA_CUTOFF && (yneg != zneg) == bigint_is_neg_(bx)) {
+      // add the product in-place (the sign stays the same)
+      bx = bigint_add_mul_abs_(bx, ys, cy, zs, cz, ctx);
+      kk_integer_drop(y, ctx);
+      kk_integer_drop(z, ctx);
+      return integer_bigint(bx, ctx);
+    }
+  }
+  return kk_integer_add(x, kk_integer_mul(y, z, ctx), ctx);
+}
+
+kk_integer_t kk_integer_mul_add_generic(kk_integer_t x, kk_integer_t y, kk_integer_t z, kk_context_t* ctx) {
+  kk_assert_internal(kk_is_integer(x)&&kk_is_integer(y)&&kk_is_integer(z));
+  if (kk_is_bigint(x) && kk_are_smallints(y, z) && bigint_is_unique_(kk_integer_to_bigint(x, ctx))) {
+    const kk_intx_t iy = kk_smallint_from_integer(y);
+    const kk_intx_t iz = kk_smallint_from_integer(z);
+    kk_bigint_t* bx = kk_integer_to_bigint(x, ctx);
+    const bool xyneg = (bigint_is_neg_(bx) != (iy < 0));
+    if (iy != 0 && iy > -BASE && iy < BASE && iz > -BASE && iz < BASE && (iz == 0 || xyneg == (iz < 0))) {
+      bx = kk_bigint_mul_add_small(bx, (kk_digit_t)(iy < 0 ? -iy : iy), (kk_digit_t)(iz < 0 ? -iz : iz), ctx);
+      bx->is_neg = (xyneg ? 1 : 0);
+      return integer_bigint(bx, ctx);
+    }
+  }
+  return kk_integer_add(kk_integer_mul(x, y, ctx), z, ctx);
 }
 
 
@@ -1355,7 +2161,7 @@ kk_integer_t kk_integer_cdiv_cmod_generic(kk_integer_t x, kk_integer_t y, kk_int
   bool qneg = (bigint_is_neg_(bx) != bigint_is_neg_(by));
   bool mneg = bigint_is_neg_(bx);
   kk_bigint_t* bmod = NULL;
-  kk_bigint_t* bz = bigint_cdiv_cmod(bx, by, (mod!=NULL ? &bmod : NULL), ctx);
+  kk_bigint_t* bz = kk_bigint_cdiv_cmod(bx, by, (mod!=NULL ? &bmod : NULL), ctx);
   bz->is_neg = qneg;
   if (mod!=NULL && bmod != NULL) {
     bmod->is_neg = mneg;
@@ -1460,43 +2266,57 @@ static kk_string_t kk_int_to_hex_string(kk_intx_t i, bool use_capitals, kk_conte
   return kk_string_alloc_dup(buf, ctx);
 }
 
-static size_t kk_bigint_to_hex_buf(kk_bigint_t* b, char* buf, size_t size, bool use_capitals, kk_context_t* ctx) {
-  // TODO: can we improve the performance using the Chinese remainder theorem? 
-  // and avoid the reversal? and per digit divide?
-  kk_assert_internal(!b->is_neg);
-  const char baseA = (use_capitals ? 'A' : 'a');
-  size_t len = 0;
-  while (len < size && ((b->count > 1) || (b->digits[0] != 0))) {
-    // convert per BASE_HEX chunk in reverse order
+#ifndef KK_HEX_PRINT_DC_CUTOFF
+#define KK_HEX_PRINT_DC_CUTOFF  (64)   // in digits
+#endif
+
+// Write exactly `width` hex digits of `b` (with `|b| < 16^width`) to `buf` (padded with zeros).
+// Large numbers are converted by divide-and-conquer on `BASE_HEX^(2^i)`.
+static void kk_bigint_to_hex_fixed(kk_bigint_t* b, char* buf, size_t width, char baseA, kk_context_t* ctx) {
+  if (b->count > KK_HEX_PRINT_DC_CUTOFF) {
+    // find the largest power with at most half the digits of `b`
+    size_t i = 0;
+    while (i+1 < KK_HEX_POWERS && 2*bigint_hex_power(i+1, ctx)->count <= b->count) { i++; }
+    const size_t w = ((size_t)LOG_BASE_HEX << i);   // hex digits in the lower part
+    kk_assert_internal(w < width);
+    kk_bigint_t* mod = NULL;
+    kk_bigint_t* q = kk_bigint_cdiv_cmod(b, dup_bigint(bigint_hex_power(i, ctx)), &mod, ctx);
+    kk_bigint_to_hex_fixed(q, buf, width - w, baseA, ctx);
+    kk_bigint_to_hex_fixed(mod, buf + width - w, w, baseA, ctx);
+    return;
+  }
+  // convert per BASE_HEX chunk in reverse order
+  size_t len = width;
+  while (len > 0 && b->count > 0) {
     kk_digit_t mod;
     b = kk_bigint_cdiv_cmod_small(b, BASE_HEX, &mod, ctx);
-    for (size_t i = 0; i < LOG_BASE_HEX && len < size; i++) {
-      // convert the mod per hex digit in reverse order
+    for (size_t i = 0; i < LOG_BASE_HEX && len > 0; i++) {
       kk_digit_t d = mod % 16;
       mod /= 16;
-      buf[len++] = (char)(d < 10 ? d + '0' : d - 10 + (kk_digit_t)baseA);
+      buf[--len] = (char)(d < 10 ? d + '0' : d - 10 + (kk_digit_t)baseA);
     }
   }
-  if (len == 0) {
-    buf[len++] = '0';
-  }
-  while (len > 0 && buf[len - 1] == '0') { // remove trailing zeros  
-    len--;  
-  }
-  buf[len] = 0;
-
-  // reverse the digits (careful with alignment restrictions if trying optimizing this)
-  for (size_t i = 0; i < len/2; i++) {
-    char c = buf[i];
-    char d = buf[len - 1 - i];
-    buf[len - 1 - i] = c;
-    buf[i] = d;
-  }
+  kk_assert_internal(b->count == 0);
+  while (len > 0) { buf[--len] = '0'; }
+  drop_bigint(b, ctx);
+}
 
-  drop_bigint(b,ctx);
+static size_t kk_bigint_to_hex_buf(kk_bigint_t* b, char* buf, size_t size, bool use_capitals, kk_context_t* ctx) {
+  kk_assert_internal(!b->is_neg);
+  kk_assert_internal(size > 1);
+  const char baseA = (use_capitals ? 'A' : 'a');
+  const size_t width = size - 1;
+  kk_bigint_to_hex_fixed(b, buf, width, baseA, ctx);
+  // remove leading zeros
+  size_t i = 0;
+  while (i + 1 < width && buf[i] == '0') { i++; }
+  const size_t len = width - i;
+  memmove(buf, buf + i, len);
+  buf[len] = 0;
   return len;
 }
 
+
 static kk_string_t kk_bigint_to_hex_string(kk_bigint_t* b, bool use_capitals, kk_context_t* ctx) {
   size_t dec_needed = kk_bigint_to_buf_(b, NULL, 0);   
   size_t needed = (size_t)(ceil((double)dec_needed * KK_LOG10_DIV_LOG16)) + 2; // conservative estimate
@@ -1522,7 +2342,7 @@ void kk_integer_fprint(FILE* f, kk_integer_t x, kk_context_t* ctx) {
 }
 
 void kk_integer_print(kk_integer_t x, kk_context_t* ctx) {
-  kk_integer_fprint(stdout, x, ctx);
+  kk_print(kk_integer_to_string(x, ctx), ctx);
 }
 
 /*----------------------------------------------------------------------
@@ -17,10 +17,102 @@ static bool kk_os_is_directory_cstr(const char* path);
   Text files
 --------------------------------------------------------------------------------------------------*/
 
+// Files of at least `KK_OS_MMAP_MIN` bytes are memory mapped into a raw string (instead of being copied).
+// The string is unmapped by the free function of the raw string. We always need a zero byte
+// after the contents: this is given by the zero filled remainder of the last page, except if the
+// file size is a multiple of the page size. On POSIX we reserve an extra (anonymous) page in that case,
+// while on Windows we then use the copying path.
+// Note: just like the copying path we do not lock the file, and truncating the file while
+// it is mapped can lead to a bus error on access.
+#ifndef KK_OS_MMAP_MIN
+#define KK_OS_MMAP_MIN  (KUZ(256)*1024)
+#endif
+
+#if defined(WIN32) || defined(__MINGW32__)
+#include <Windows.h>
+
+static void os_unmap_fun(void* p, kk_block_t* b) {
+  KK_UNUSED(b);
+  UnmapViewOfFile(p);
+}
+
+static bool os_map_text_file(const char* path, kk_string_t* result, kk_context_t* ctx) {
+  HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (f == INVALID_HANDLE_VALUE) return false;
+  bool ok = false;
+  LARGE_INTEGER fsize;
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  if (GetFileSizeEx(f, &fsize) && fsize.QuadPart >= (LONGLONG)KK_OS_MMAP_MIN && (uint64_t)fsize.QuadPart < (uint64_t)KK_SSIZE_MAX &&
+      (fsize.QuadPart % info.dwPageSize) != 0) {
+    HANDLE m = CreateFileMappingA(f, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (m != NULL) {
+      const char* p = (const char*)MapViewOfFile(m, FILE_MAP_COPY, 0, 0, 0);  // copy-on-write so a write never faults
+      if (p != NULL) {
+        *result = kk_string_alloc_raw_buf((size_t)fsize.QuadPart, p, &os_unmap_fun, ctx);
+        ok = true;
+      }
+      CloseHandle(m);  // the view keeps the mapping alive
+    }
+  }
+  CloseHandle(f);
+  return ok;
+}
+
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS  MAP_ANON
+#endif
+
+static size_t os_map_size(size_t len) {
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  return (((len + 1) + page - 1) / page) * page;  // including a terminating zero
+}
+
+static void os_unmap_fun(void* p, kk_block_t* b) {
+  kk_string_raw_t str = (kk_string_raw_t)b;
+  munmap(p, os_map_size(str->length));
+}
+
+static bool os_map_text_file(const char* path, kk_string_t* result, kk_context_t* ctx) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  bool ok = false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= (off_t)KK_OS_MMAP_MIN && (uint64_t)st.st_size < (uint64_t)KK_SSIZE_MAX) {
+    const size_t fsize = (size_t)st.st_size;
+    const size_t msize = os_map_size(fsize);
+    // reserve zero pages first and map the file on top (copy-on-write so a write never faults)
+    char* p = (char*)mmap(NULL, msize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED) {
+      if (mmap(p, fsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+        *result = kk_string_alloc_raw_buf(fsize, p, &os_unmap_fun, ctx);
+        ok = true;
+      }
+      else {
+        munmap(p, msize);
+      }
+    }
+  }
+  close(fd);
+  return ok;
+}
+#endif
+
 kk_decl_export int kk_os_read_text_file(kk_string_t path, kk_string_t* result, kk_context_t* ctx)
 {
   kk_string_t s = kk_string_empty();
   *result = s;
+  if (os_map_text_file(kk_string_cbuf_borrow(path), &s, ctx)) {
+    kk_string_drop(path, ctx);
+    *result = kk_string_validate_utf8(s, ctx);  // (copies if the file is not valid UTF8)
+    return 0;
+  }
   FILE* f = fopen(kk_string_cbuf_borrow(path), "rb");
   kk_string_drop(path, ctx);
 
@@ -36,11 +128,10 @@ kk_decl_export int kk_os_read_text_file(kk_string_t path, kk_string_t* result, k
   s = kk_string_alloc_buf(fsize, ctx);
   size_t nread = fread((char*)kk_string_cbuf_borrow(s), 1, fsize, f);
   if (ferror(f)) goto fail;
-  if (nread < fsize) { kk_string_adjust_length(s, nread, ctx); }
+  if (nread < fsize) { s = kk_string_adjust_length(s, nread, ctx); }
   fclose(f); f = NULL;
 
-  // TODO: validate UTF8 to UTF8
-  *result = s;
+  *result = kk_string_validate_utf8(s, ctx);
   return 0;
 
 fail:
@@ -71,6 +162,234 @@ fail:
 
 
 
+/*--------------------------------------------------------------------------------------------------
+  Streaming files
+  A file is read in chunks of `KK_OS_FILE_BUFFER` bytes into a buffer string, and lines (or chunks)
+  are returned as a range in that buffer without copying. The buffer is reused in place at the
+  next read from the file, unless a line is still referenced in which case a fresh buffer is allocated.
+  Since a line never splits a code point we only need to validate the line itself.
+  Writes are buffered and go directly to the file for large strings.
+--------------------------------------------------------------------------------------------------*/
+
+#ifndef KK_OS_FILE_BUFFER
+#define KK_OS_FILE_BUFFER  (KUZ(64)*1024)
+#endif
+
+struct kk_os_file_s {
+  FILE*       file;    // NULL once closed
+  bool        write;
+  bool        eof;
+  size_t      pos;     // unread (or unwritten) bytes are in `[pos,len)` of the buffer
+  size_t      len;
+  size_t      cap;     // capacity of the buffer
+  kk_string_t buf;     // read buffer (a normal string)
+  uint8_t*    wbuf;    // write buffer
+};
+
+kk_decl_export int kk_os_file_open(kk_string_t path, kk_os_file_mode_t mode, kk_os_file_t* file, kk_context_t* ctx) {
+  *file = NULL;
+  const char* fmode = (mode == KK_OS_FILE_READ ? "rb" : (mode == KK_OS_FILE_APPEND ? "ab" : "wb"));
+  FILE* f = fopen(kk_string_cbuf_borrow(path), fmode);
+  kk_string_drop(path, ctx);
+  if (f == NULL) return (errno != 0 ? errno : -1);
+  setvbuf(f, NULL, _IONBF, 0);  // we do our own buffering
+  kk_os_file_t h = (kk_os_file_t)kk_zalloc(sizeof(struct kk_os_file_s), ctx);
+  if (h == NULL) {
+    fclose(f);
+    return ENOMEM;
+  }
+  h->file = f;
+  h->write = (mode != KK_OS_FILE_READ);
+  h->cap = KK_OS_FILE_BUFFER;
+  h->buf = kk_string_empty();
+  if (h->write) {
+    h->wbuf = (uint8_t*)kk_malloc(h->cap, ctx);
+    if (h->wbuf == NULL) {
+      kk_os_file_free(h, ctx);
+      return ENOMEM;
+    }
+  }
+  *file = h;
+  return 0;
+}
+
+kk_decl_export int kk_os_file_flush(kk_os_file_t file, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  if (file == NULL || file->file == NULL) return EBADF;
+  if (!file->write) return 0;
+  const size_t len = file->len;
+  if (len > 0) {
+    file->len = 0;
+    if (fwrite(file->wbuf, 1, len, file->file) < len) return (errno != 0 ? errno : EIO);
+  }
+  return (fflush(file->file) == 0 ? 0 : errno);
+}
+
+kk_decl_export int kk_os_file_close(kk_os_file_t file, kk_context_t* ctx) {
+  if (file == NULL || file->file == NULL) return EBADF;
+  int err = kk_os_file_flush(file, ctx);
+  if (fclose(file->file) != 0 && err == 0) err = errno;
+  file->file = NULL;
+  kk_string_drop(file->buf, ctx);
+  file->buf = kk_string_empty();
+  file->pos = file->len = 0;
+  return err;
+}
+
+kk_decl_export void kk_os_file_free(kk_os_file_t file, kk_context_t* ctx) {
+  if (file == NULL) return;
+  if (file->file != NULL) kk_os_file_close(file, ctx);
+  kk_free(file->wbuf);
+  kk_free(file);
+}
+
+static void kk_os_file_free_fun(void* p, kk_block_t* b) {
+  KK_UNUSED(b);
+  kk_os_file_free((kk_os_file_t)p, kk_get_context());
+}
+
+kk_decl_export kk_box_t kk_os_file_box(kk_os_file_t file, kk_context_t* ctx) {
+  return kk_cptr_raw_box(&kk_os_file_free_fun, file, ctx);
+}
+
+// Move the unread bytes to the front of the buffer (or to a fresh buffer) and read more.
+static int os_file_fill(kk_os_file_t file, kk_context_t* ctx) {
+  kk_assert_internal(!file->eof && !file->write);
+  const size_t rest = file->len - file->pos;
+  const size_t cap = (rest == file->cap ? 2*file->cap : file->cap);  // grow for long lines
+  if (!kk_string_is_empty_borrow(file->buf) && kk_datatype_is_unique(file->buf) && cap == file->cap) {
+    uint8_t* p = (uint8_t*)kk_string_buf_borrow(file->buf);
+    memmove(p, p + file->pos, rest);
+  }
+  else {
+    kk_string_t buf = kk_string_alloc_buf(cap, ctx);
+    memcpy((uint8_t*)kk_string_buf_borrow(buf), kk_string_buf_borrow(file->buf) + file->pos, rest);
+    kk_string_drop(file->buf, ctx);
+    file->buf = buf;
+    file->cap = cap;
+  }
+  kk_string_normal_t s = kk_datatype_as_assert(kk_string_normal_t, file->buf, KK_TAG_STRING);
+  const size_t n = fread(s->str + rest, 1, cap - rest, file->file);
+  int err = 0;
+  if (n < cap - rest) {
+    if (ferror(file->file)) err = (errno != 0 ? errno : EIO);
+    file->eof = true;
+  }
+  file->pos = 0;
+  file->len = rest + n;
+  s->length = file->len;   // keep the string well formed
+  s->str[file->len] = 0;
+  return err;
+}
+
+// Return the range `[start,start+len)` of the buffer, or a validated copy if it is not valid UTF8.
+static void os_file_range(kk_os_file_t file, size_t start, size_t len, kk_string_t* buf, size_t* rstart, size_t* rlen, kk_context_t* ctx) {
+  const uint8_t* p = kk_string_buf_borrow(file->buf) + start;
+  if (kk_likely(kk_utf8_is_valid(p, len))) {
+    *buf = kk_string_dup(file->buf);
+    *rstart = start;
+    *rlen = len;
+  }
+  else {
+    kk_string_t s = kk_string_alloc_buf(len, ctx);
+    memcpy((uint8_t*)kk_string_buf_borrow(s), p, len);
+    s = kk_string_validate_utf8(s, ctx);
+    *rstart = 0;
+    *rlen = kk_string_len_borrow(s);
+    *buf = s;
+  }
+}
+
+kk_decl_export int kk_os_file_read_line(kk_os_file_t file, kk_string_t* buf, size_t* start, size_t* len, bool* found, kk_context_t* ctx) {
+  *buf = kk_string_empty();
+  *start = *len = 0;
+  *found = false;
+  if (file == NULL || file->file == NULL || file->write) return EBADF;
+  size_t scanned = 0;  // bytes after `pos` without a newline
+  while (true) {
+    const uint8_t* p = kk_string_buf_borrow(file->buf);
+    const uint8_t* nl = (const uint8_t*)memchr(p + file->pos + scanned, '\n', file->len - file->pos - scanned);
+    if (nl != NULL || file->eof) {
+      size_t end = (nl != NULL ? (size_t)(nl - p) : file->len);
+      if (nl == NULL && end == file->pos) return 0;  // end of file
+      const size_t next = (nl != NULL ? end + 1 : end);
+      if (end > file->pos && p[end-1] == '\r') end--;
+      os_file_range(file, file->pos, end - file->pos, buf, start, len, ctx);
+      file->pos = next;
+      *found = true;
+      return 0;
+    }
+    scanned = file->len - file->pos;
+    const int err = os_file_fill(file, ctx);
+    if (err != 0) return err;
+  }
+}
+
+static inline bool utf8_is_cont(uint8_t c) {
+  return ((c & 0xC0) == 0x80);
+}
+
+kk_decl_export int kk_os_file_read_chunk(kk_os_file_t file, size_t max, kk_string_t* buf, size_t* start, size_t* len, bool* found, kk_context_t* ctx) {
+  *buf = kk_string_empty();
+  *start = *len = 0;
+  *found = false;
+  if (file == NULL || file->file == NULL || file->write) return EBADF;
+  if (max == 0) max = 1;
+  while (true) {
+    const size_t avail = file->len - file->pos;
+    const uint8_t* p = kk_string_buf_borrow(file->buf) + file->pos;
+    size_t n = (max < avail ? max : avail);
+    if (n < avail) {
+      while (n > 0 && utf8_is_cont(p[n])) n--;       // do not split a code point
+    }
+    else if (n > 0 && !file->eof) {
+      size_t lead = n - 1;                             // do not end in an incomplete code point
+      while (lead > 0 && n - lead < 4 && utf8_is_cont(p[lead])) lead--;
+      const uint8_t c = p[lead];
+      const size_t clen = (c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : (c >= 0xC0 ? 2 : 1)));
+      if (lead + clen > n) n = lead;
+    }
+    if (n == 0 && avail > 0 && (file->eof || max < avail)) {
+      // `max` is smaller than the code point (or it is invalid)
+      n = 1;
+      while (n < avail && utf8_is_cont(p[n])) n++;
+    }
+    if (n > 0) {
+      os_file_range(file, file->pos, n, buf, start, len, ctx);
+      file->pos += n;
+      *found = true;
+      return 0;
+    }
+    if (file->eof) return 0;  // end of file
+    const int err = os_file_fill(file, ctx);
+    if (err != 0) return err;
+  }
+}
+
+kk_decl_export int kk_os_file_write_buf(kk_os_file_t file, const uint8_t* s, size_t len, kk_context_t* ctx) {
+  if (file == NULL || file->file == NULL || !file->write) return EBADF;
+  if (file->len + len > file->cap) {
+    const int err = kk_os_file_flush(file, ctx);
+    if (err != 0) return err;
+  }
+  if (len > file->cap/2) {
+    // write large strings directly
+    if (fwrite(s, 1, len, file->file) < len) return (errno != 0 ? errno : EIO);
+  }
+  else {
+    memcpy(file->wbuf + file->len, s, len);
+    file->len += len;
+  }
+  return 0;
+}
+
+kk_decl_export int kk_os_file_write(kk_os_file_t file, kk_string_t s, kk_context_t* ctx) {
+  const int err = kk_os_file_write_buf(file, kk_string_buf_borrow(s), kk_string_len_borrow(s), ctx);
+  kk_string_drop(s, ctx);
+  return err;
+}
+
+
 /*--------------------------------------------------------------------------------------------------
   Directories
 --------------------------------------------------------------------------------------------------*/
@@ -152,13 +471,84 @@ static int os_copy_file(const char* from, const char* to, bool preserve_mtime) {
 
 #if defined(__APPLE__) || defined(__FreeBSD__)
 #include <copyfile.h>
-#else
+#if defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+#elif defined(__linux__)
 #include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>  // FICLONE
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define KK_HAS_COPY_FILE_RANGE  1
+#endif
+#endif
+
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+// Copy the contents of `inp` to `out` (both at offset 0). We first try to let the kernel do the
+// work: a copy-on-write clone of the file (`FICLONE`), a copy within the kernel (`copy_file_range`,
+// which can also do server side copies on network file systems), or `sendfile`. Each of these may
+// be unsupported for the particular files (or stop early) and we continue with the next method from
+// the offset copied so far. Finally we copy through a buffer up to the end of the file.
+static int os_copy_fd(int inp, int out, off_t size) {
+  off_t copied = 0;
+#if defined(FICLONE)
+  if (ioctl(out, FICLONE, inp) == 0) return 0;
+#endif
+#if KK_HAS_COPY_FILE_RANGE
+  while (copied < size) {
+    loff_t off_in = copied;
+    loff_t off_out = copied;
+    const ssize_t n = copy_file_range(inp, &off_in, out, &off_out, (size_t)(size - copied), 0);
+    if (n > 0) copied += n;
+    else if (n < 0 && errno == EINTR) continue;
+    else break;  // not supported (like `EXDEV` or `ENOSYS`) or end of file
+  }
+#endif
+#if defined(__linux__)
+  if (copied < size && lseek(out, copied, SEEK_SET) == copied) {
+    while (copied < size) {
+      off_t offset = copied;
+      const ssize_t n = sendfile(out, inp, &offset, (size_t)(size - copied));
+      if (n > 0) copied += n;
+      else if (n < 0 && errno == EINTR) continue;
+      else break;
+    }
+  }
+#endif
+  // copy the rest through a buffer
+  char buf[32*1024];
+  while (true) {
+    const ssize_t n = pread(inp, buf, sizeof(buf), copied);
+    if (n == 0) break;  // end of file
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return errno;
+    }
+    for (ssize_t written = 0; written < n; ) {
+      const ssize_t m = pwrite(out, buf + written, (size_t)(n - written), copied + written);
+      if (m < 0) {
+        if (errno == EINTR) continue;
+        return errno;
+      }
+      written += m;
+    }
+    copied += n;
+  }
+  return 0;
+}
 #endif
 
 static int os_copy_file(const char* from, const char* to, bool preserve_mtime) {
   int inp, out;
 
+#if defined(__APPLE__)
+  // try a copy-on-write clone first (which fails if the target exists, or for other file systems)
+  if (clonefile(from, to, CLONE_NOFOLLOW) == 0) {
+    if (!preserve_mtime) utimes(to, NULL);  // like `fcopyfile` a clone keeps the times otherwise
+    return 0;
+  }
+#endif
+
   // stat and create/overwrite target
   struct stat finfo = { 0 };
   if ((inp = open(from, O_RDONLY)) == -1) {
@@ -179,13 +569,11 @@ static int os_copy_file(const char* from, const char* to, bool preserve_mtime) {
   if (fcopyfile(inp, out, 0, COPYFILE_ALL) != 0) {
     err = errno;
   }
-#elif defined(__linux__)
-  // Linux
-  off_t copied = 0;
-  if (sendfile(out, inp, &copied, finfo.st_size) == -1) {
-    err = errno;
-  }
+#else
+  err = os_copy_fd(inp, out, finfo.st_size);
+#endif
 
+#if defined(__linux__)
   // maintain access/mod time
   if (err == 0 && preserve_mtime) {
     struct timespec times[2];
@@ -195,8 +583,6 @@ static int os_copy_file(const char* from, const char* to, bool preserve_mtime) {
     times[1].tv_nsec = finfo.st_mtim.tv_nsec;
     futimens(out, times);  // in <sys/stat.h>
   }
-#else
-#pragma message("define file copy for this platform")
 #endif
 
   // close file descriptors
@@ -349,6 +735,253 @@ kk_decl_export int kk_os_list_directory(kk_string_t dir, kk_vector_t* contents,
 }
 
 
+/*--------------------------------------------------------------------------------------------------
+  Walk a directory tree
+  The kind of each entry is taken from the directory listing itself (`d_type` on POSIX and the
+  attributes on Windows) so we only need a `stat` on file systems that do not provide it, or to
+  follow symbolic links. Only one directory is open at a time and the pending sub-directories are
+  kept on a stack.
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct os_walk_dir_s {
+  char*  path;
+  size_t depth;
+} os_walk_dir_t;
+
+#if defined(WIN32)
+typedef HANDLE os_walk_cursor_t;
+#else
+typedef DIR*   os_walk_cursor_t;
+#endif
+
+struct kk_os_walker_s {
+  size_t            max_depth;
+  bool              follow_links;
+  bool              is_open;       // is `cursor` valid?
+  os_walk_cursor_t  cursor;        // the current directory
+#if defined(WIN32)
+  WIN32_FIND_DATAA  data;
+  bool              has_data;      // does `data` contain the next entry?
+#endif
+  size_t            depth;         // depth of the current directory
+  char*             path;          // the current directory followed by the current entry name
+  size_t            dir_len;
+  size_t            path_cap;
+  os_walk_dir_t*    pending;       // directories to visit
+  size_t            pending_count;
+  size_t            pending_cap;
+  size_t            subdirs;       // pending directories pushed by the current directory
+};
+
+static bool os_walk_reserve(kk_os_walker_t w, size_t len, kk_context_t* ctx) {
+  if (len < w->path_cap) return true;
+  const size_t cap = (2*w->path_cap > len + 1 ? 2*w->path_cap : len + 1);
+  char* p = (char*)kk_realloc(w->path, cap, ctx);
+  if (p == NULL) return false;
+  w->path = p;
+  w->path_cap = cap;
+  return true;
+}
+
+static bool os_walk_push(kk_os_walker_t w, const char* path, size_t len, size_t depth, kk_context_t* ctx) {
+  if (w->pending_count >= w->pending_cap) {
+    const size_t cap = (w->pending_cap == 0 ? 16 : 2*w->pending_cap);
+    os_walk_dir_t* p = (os_walk_dir_t*)kk_realloc(w->pending, cap * sizeof(os_walk_dir_t), ctx);
+    if (p == NULL) return false;
+    w->pending = p;
+    w->pending_cap = cap;
+  }
+  char* s = (char*)kk_malloc(len + 1, ctx);
+  if (s == NULL) return false;
+  memcpy(s, path, len);
+  s[len] = 0;
+  w->pending[w->pending_count].path = s;
+  w->pending[w->pending_count].depth = depth;
+  w->pending_count++;
+  w->subdirs++;
+  return true;
+}
+
+#if defined(WIN32)
+static int os_walk_opendir(kk_os_walker_t w, kk_context_t* ctx) {
+  if (!os_walk_reserve(w, w->dir_len + 2, ctx)) return ENOMEM;
+  memcpy(w->path + w->dir_len, "\\*", 3);
+  w->cursor = FindFirstFileExA(w->path, FindExInfoBasic, &w->data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  if (w->cursor == INVALID_HANDLE_VALUE) return ENOENT;
+  w->is_open = w->has_data = true;
+  return 0;
+}
+
+static void os_walk_closedir(kk_os_walker_t w) {
+  FindClose(w->cursor);
+  w->is_open = false;
+}
+
+static const char* os_walk_readdir(kk_os_walker_t w, kk_os_entry_kind_t* kind, bool* known) {
+  *known = true;
+  if (!w->has_data && !FindNextFileA(w->cursor, &w->data)) return NULL;
+  w->has_data = false;
+  const DWORD attr = w->data.dwFileAttributes;
+  if ((attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0) {
+    *kind = ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0 && w->follow_links ? KK_OS_ENTRY_DIR : KK_OS_ENTRY_LINK);
+  }
+  else {
+    *kind = ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0 ? KK_OS_ENTRY_DIR : KK_OS_ENTRY_FILE);
+  }
+  return w->data.cFileName;
+}
+
+#else
+static int os_walk_opendir(kk_os_walker_t w, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  w->path[w->dir_len] = 0;
+  w->cursor = opendir(w->path);
+  if (w->cursor == NULL) return errno;
+  w->is_open = true;
+  return 0;
+}
+
+static void os_walk_closedir(kk_os_walker_t w) {
+  closedir(w->cursor);
+  w->is_open = false;
+}
+
+static kk_os_entry_kind_t os_walk_kind_of_mode(mode_t mode) {
+  if (S_ISDIR(mode)) return KK_OS_ENTRY_DIR;
+  if (S_ISREG(mode)) return KK_OS_ENTRY_FILE;
+  if (S_ISLNK(mode)) return KK_OS_ENTRY_LINK;
+  return KK_OS_ENTRY_OTHER;
+}
+
+// If the kind is not `known` the caller uses `stat` (once the full path is known).
+static const char* os_walk_readdir(kk_os_walker_t w, kk_os_entry_kind_t* kind, bool* known) {
+  struct dirent* entry = readdir(w->cursor);
+  if (entry == NULL) return NULL;
+  *known = true;
+#if defined(DT_DIR)
+  switch (entry->d_type) {
+    case DT_DIR: *kind = KK_OS_ENTRY_DIR; break;
+    case DT_REG: *kind = KK_OS_ENTRY_FILE; break;
+    case DT_LNK: *kind = KK_OS_ENTRY_LINK; break;
+    case DT_UNKNOWN: *kind = KK_OS_ENTRY_OTHER; *known = false; break;
+    default: *kind = KK_OS_ENTRY_OTHER; break;
+  }
+#else
+  *kind = KK_OS_ENTRY_OTHER;
+  *known = false;
+#endif
+  return entry->d_name;
+}
+#endif
+
+kk_decl_export int kk_os_walker_open(kk_string_t dir, size_t max_depth, bool follow_links, kk_os_walker_t* walker, kk_context_t* ctx) {
+  *walker = NULL;
+  kk_os_walker_t w = (kk_os_walker_t)kk_zalloc(sizeof(struct kk_os_walker_s), ctx);
+  if (w == NULL) {
+    kk_string_drop(dir, ctx);
+    return ENOMEM;
+  }
+  w->max_depth = max_depth;
+  w->follow_links = follow_links;
+  size_t len = kk_string_len_borrow(dir);
+  const char* cdir = kk_string_cbuf_borrow(dir);
+  while (len > 1 && (cdir[len-1] == '/' || cdir[len-1] == '\\')) len--;  // no trailing separator
+  int err = (os_walk_reserve(w, len + 1, ctx) ? 0 : ENOMEM);
+  if (err == 0) {
+    memcpy(w->path, cdir, len);
+    w->dir_len = len;
+    err = os_walk_opendir(w, ctx);
+  }
+  kk_string_drop(dir, ctx);
+  if (err != 0) {
+    kk_os_walker_free(w, ctx);
+    return err;
+  }
+  *walker = w;
+  return 0;
+}
+
+kk_decl_export bool kk_os_walker_next(kk_os_walker_t w, kk_string_t* path, kk_os_entry_kind_t* kind, kk_context_t* ctx) {
+  *path = kk_string_empty();
+  *kind = KK_OS_ENTRY_OTHER;
+  if (w == NULL) return false;
+  while (true) {
+    if (!w->is_open) {
+      // visit the next pending directory (skipping those that cannot be opened)
+      if (w->pending_count == 0) return false;
+      w->pending_count--;
+      os_walk_dir_t d = w->pending[w->pending_count];
+      const size_t len = strlen(d.path);
+      const bool ok = os_walk_reserve(w, len + 1, ctx);
+      if (ok) {
+        memcpy(w->path, d.path, len);
+        w->dir_len = len;
+        w->depth = d.depth;
+      }
+      kk_free(d.path);
+      if (!ok || os_walk_opendir(w, ctx) != 0) continue;
+    }
+    kk_os_entry_kind_t k;
+    bool known;
+    const char* name = os_walk_readdir(w, &k, &known);
+    if (name == NULL) {
+      // done with this directory: reverse its sub-directories so the first one is visited first
+      os_walk_closedir(w);
+      os_walk_dir_t* p = w->pending + w->pending_count - w->subdirs;
+      for (size_t i = 0, j = w->subdirs; i + 1 < j; i++, j--) {
+        os_walk_dir_t tmp = p[i]; p[i] = p[j-1]; p[j-1] = tmp;
+      }
+      w->subdirs = 0;
+      continue;
+    }
+    if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+    // full path
+    const size_t nlen = strlen(name);
+    const size_t len = w->dir_len + 1 + nlen;
+    if (!os_walk_reserve(w, len + 1, ctx)) return false;
+    w->path[w->dir_len] = '/';
+    memcpy(w->path + w->dir_len + 1, name, nlen + 1);
+#if !defined(WIN32)
+    if (!known || (k == KK_OS_ENTRY_LINK && w->follow_links)) {
+      struct stat st;
+      if ((w->follow_links ? stat(w->path, &st) : lstat(w->path, &st)) == 0) {
+        k = os_walk_kind_of_mode(st.st_mode);
+      }
+    }
+#else
+    KK_UNUSED(known);
+#endif
+    if (k == KK_OS_ENTRY_DIR && w->depth < w->max_depth) {
+      os_walk_push(w, w->path, len, w->depth + 1, ctx);
+    }
+    *path = kk_string_alloc_len_unsafe(len, w->path, ctx);
+    *kind = k;
+    return true;
+  }
+}
+
+kk_decl_export void kk_os_walker_free(kk_os_walker_t w, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  if (w == NULL) return;
+  if (w->is_open) os_walk_closedir(w);
+  for (size_t i = 0; i < w->pending_count; i++) {
+    kk_free(w->pending[i].path);
+  }
+  kk_free(w->pending);
+  kk_free(w->path);
+  kk_free(w);
+}
+
+static void kk_os_walker_free_fun(void* p, kk_block_t* b) {
+  KK_UNUSED(b);
+  kk_os_walker_free((kk_os_walker_t)p, kk_get_context());
+}
+
+kk_decl_export kk_box_t kk_os_walker_box(kk_os_walker_t walker, kk_context_t* ctx) {
+  return kk_cptr_raw_box(&kk_os_walker_free_fun, walker, ctx);
+}
+
+
 /*--------------------------------------------------------------------------------------------------
   Run system command
 --------------------------------------------------------------------------------------------------*/
@@ -365,15 +998,15 @@ kk_decl_export int kk_os_run_command(kk_string_t cmd, kk_string_t* output, kk_co
   FILE* f = popen(kk_string_cbuf_borrow(cmd), POPEN_READ);
   kk_string_drop(cmd, ctx);
   if (f==NULL) return errno;
-  kk_string_t out = kk_string_empty();
+  kk_string_builder_t out = kk_string_builder_empty();
   char buf[1025];
   while (fgets(buf, 1024, f) != NULL) {
     buf[1024] = 0; // paranoia
-    out = kk_string_cat_fromc(out, buf, ctx);
+    kk_string_builder_append_cstr(&out, buf, ctx);
   }
   if (feof(f)) errno = 0;
   pclose(f);
-  *output = out;
+  *output = kk_string_builder_finish(&out, ctx);
   return errno;
 }
 
@@ -465,6 +1098,306 @@ kk_decl_export kk_vector_t kk_os_get_env(kk_context_t* ctx) {
 #endif
 
 
+/*--------------------------------------------------------------------------------------------------
+  Spawn processes
+  A process is started directly from an argument vector (without a shell) using `posix_spawnp`,
+  which uses `vfork` (or `clone(CLONE_VFORK)`) and does not copy the page tables of a large heap.
+  The output and error streams can be captured in pipes and are read incrementally with `poll`
+  so a child never blocks on a full pipe of the stream that is not read.
+--------------------------------------------------------------------------------------------------*/
+
+#ifndef KK_OS_PROCESS_BUFFER
+#define KK_OS_PROCESS_BUFFER  (64*1024)   // maximal size of a chunk read from a process
+#endif
+
+struct kk_os_process_s {
+  intptr_t pid;
+  int      fds[2];         // read ends of the stdout and stderr pipes (or -1)
+  uint8_t  carry[2][4];    // an incomplete code point at the end of the last chunk of each stream
+  size_t   carry_len[2];
+  bool     waited;
+  int      exit_code;      // and the resource usage once `waited`
+  kk_msecs_t utime;
+  kk_msecs_t stime;
+  size_t   peak_rss;
+  size_t   page_faults;
+  size_t   page_reclaim;
+  uint8_t* buf;
+};
+
+#if !defined(WIN32) && !defined(__wasi__)
+#include <spawn.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <pthread.h>
+
+static void os_close_fd(int* fd) {
+  if (*fd >= 0) {
+    close(*fd);
+    *fd = -1;
+  }
+}
+
+static int os_pipe_cloexec(int fds[2]) {
+#if defined(__linux__) && defined(O_CLOEXEC)
+  if (pipe2(fds, O_CLOEXEC) == 0) return 0;
+  if (errno != ENOSYS) return errno;
+#endif
+  if (pipe(fds) != 0) return errno;
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+}
+
+kk_decl_export int kk_os_process_spawn(kk_vector_t argv, bool capture_out, bool capture_err, kk_os_process_t* proc, kk_context_t* ctx) {
+  *proc = NULL;
+  size_t argc;
+  kk_box_t* args = kk_vector_buf(argv, &argc);
+  if (argc == 0) {
+    kk_vector_drop(argv, ctx);
+    return EINVAL;
+  }
+  kk_os_process_t p = (kk_os_process_t)kk_zalloc(sizeof(struct kk_os_process_s), ctx);
+  const char** cargs = (const char**)kk_malloc((argc + 1)*sizeof(char*), ctx);
+  if (p == NULL || cargs == NULL) {
+    kk_free(p);
+    kk_free(cargs);
+    kk_vector_drop(argv, ctx);
+    return ENOMEM;
+  }
+  for (size_t i = 0; i < argc; i++) {
+    cargs[i] = kk_string_cbuf_borrow(kk_string_unbox(args[i]));
+  }
+  cargs[argc] = NULL;
+  p->fds[0] = p->fds[1] = -1;
+  int wfds[2] = { -1, -1 };  // write ends of the pipes
+  const bool capture[2] = { capture_out, capture_err };
+  posix_spawn_file_actions_t actions;
+  int err = posix_spawn_file_actions_init(&actions);
+  for (int i = 0; i < 2 && err == 0; i++) {
+    if (!capture[i]) continue;
+    int fds[2];
+    err = os_pipe_cloexec(fds);
+    if (err != 0) break;
+    p->fds[i] = fds[0];
+    wfds[i] = fds[1];
+    // the duplicated descriptor in the child is not close-on-exec
+    err = posix_spawn_file_actions_adddup2(&actions, wfds[i], i + 1);
+  }
+  if (err == 0) {
+    pid_t pid;
+    err = posix_spawnp(&pid, cargs[0], &actions, NULL, (char* const*)cargs, kk_get_environ());
+    if (err == 0) p->pid = pid;
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  os_close_fd(&wfds[0]);
+  os_close_fd(&wfds[1]);
+  kk_free(cargs);
+  kk_vector_drop(argv, ctx);
+  if (err != 0) {
+    p->waited = true;
+    kk_os_process_free(p, ctx);
+    return err;
+  }
+  *proc = p;
+  return 0;
+}
+
+// Read from a pipe into `buf` (after the carried bytes of the stream) and return the number of bytes (0 at the end).
+static int os_process_read_fd(kk_os_process_t p, int i, size_t* n) {
+  memcpy(p->buf, p->carry[i], p->carry_len[i]);
+  ssize_t m;
+  do {
+    m = read(p->fds[i], p->buf + p->carry_len[i], KK_OS_PROCESS_BUFFER);
+  } while (m < 0 && errno == EINTR);
+  if (m < 0) return errno;
+  *n = (size_t)m;
+  return 0;
+}
+
+static int os_process_poll(kk_os_process_t p, int* ready) {
+  struct pollfd pfds[2];
+  nfds_t count = 0;
+  for (int i = 0; i < 2; i++) {
+    if (p->fds[i] < 0) continue;
+    pfds[count].fd = p->fds[i];
+    pfds[count].events = POLLIN;
+    pfds[count].revents = 0;
+    count++;
+  }
+  if (count == 0) {
+    *ready = -1;
+    return 0;
+  }
+  while (poll(pfds, count, -1) < 0) {
+    if (errno != EINTR) return errno;
+  }
+  for (nfds_t j = 0; j < count; j++) {
+    if (pfds[j].revents != 0) {
+      *ready = (pfds[j].fd == p->fds[0] ? 0 : 1);
+      return 0;
+    }
+  }
+  *ready = -1;
+  return EIO;
+}
+
+static void os_process_drain(kk_os_process_t p) {
+  int ready;
+  size_t n = 0;
+  while (os_process_poll(p, &ready) == 0 && ready >= 0) {
+    p->carry_len[ready] = 0;
+    if (os_process_read_fd(p, ready, &n) != 0 || n == 0) os_close_fd(&p->fds[ready]);
+  }
+}
+
+#else
+static int os_process_read_fd(kk_os_process_t p, int i, size_t* n) {
+  KK_UNUSED(p); KK_UNUSED(i);
+  *n = 0;
+  return ENOSYS;
+}
+
+static int os_process_poll(kk_os_process_t p, int* ready) {
+  KK_UNUSED(p);
+  *ready = -1;
+  return 0;
+}
+
+static void os_process_drain(kk_os_process_t p) {
+  KK_UNUSED(p);
+}
+
+static void os_close_fd(int* fd) {
+  *fd = -1;
+}
+
+kk_decl_export int kk_os_process_spawn(kk_vector_t argv, bool capture_out, bool capture_err, kk_os_process_t* proc, kk_context_t* ctx) {
+  KK_UNUSED(capture_out); KK_UNUSED(capture_err);
+  *proc = NULL;
+  kk_vector_drop(argv, ctx);
+  return ENOSYS;
+}
+#endif
+
+kk_decl_export int kk_os_process_read(kk_os_process_t p, kk_string_t* chunk, bool* is_err, bool* found, kk_context_t* ctx) {
+  *chunk = kk_string_empty();
+  *is_err = false;
+  *found = false;
+  if (p == NULL) return EBADF;
+  if (p->buf == NULL) {
+    p->buf = (uint8_t*)kk_malloc(KK_OS_PROCESS_BUFFER + 4, ctx);
+    if (p->buf == NULL) return ENOMEM;
+  }
+  while (true) {
+    int i;
+    int err = os_process_poll(p, &i);
+    if (err != 0 || i < 0) return err;
+    size_t n = 0;
+    err = os_process_read_fd(p, i, &n);
+    if (err != 0) return err;
+    size_t len = p->carry_len[i] + n;
+    p->carry_len[i] = 0;
+    if (n == 0) {
+      os_close_fd(&p->fds[i]);
+    }
+    else {
+      // do not end in an incomplete code point
+      size_t lead = len - 1;
+      while (lead > 0 && len - lead < 4 && utf8_is_cont(p->buf[lead])) lead--;
+      const uint8_t c = p->buf[lead];
+      const size_t clen = (c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : (c >= 0xC0 ? 2 : 1)));
+      if (lead + clen > len) {
+        p->carry_len[i] = len - lead;
+        memcpy(p->carry[i], p->buf + lead, p->carry_len[i]);
+        len = lead;
+      }
+    }
+    if (len > 0) {
+      kk_string_t s = kk_string_alloc_buf(len, ctx);
+      memcpy((uint8_t*)kk_string_buf_borrow(s), p->buf, len);
+      *chunk = (kk_utf8_is_valid(p->buf, len) ? s : kk_string_validate_utf8(s, ctx));
+      *is_err = (i == 1);
+      *found = true;
+      return 0;
+    }
+  }
+}
+
+kk_decl_export intptr_t kk_os_process_fd(kk_os_process_t p) {
+  if (p == NULL) return -1;
+  return (p->fds[0] >= 0 ? p->fds[0] : p->fds[1]);
+}
+
+kk_decl_export int kk_os_process_wait(kk_os_process_t p, int* exit_code, kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, kk_context_t* ctx) {
+  if (p == NULL) return EBADF;
+  if (!p->waited) {
+    // discard the unread output so the child can finish
+    if (p->buf == NULL) p->buf = (uint8_t*)kk_malloc(KK_OS_PROCESS_BUFFER + 4, ctx);
+    if (p->buf != NULL) os_process_drain(p);
+    os_close_fd(&p->fds[0]);
+    os_close_fd(&p->fds[1]);
+    size_t peak_commit;
+    const int err = kk_process_wait(p->pid, &p->exit_code, &p->utime, &p->stime, &p->peak_rss, &p->page_faults, &p->page_reclaim, &peak_commit);
+    if (err != 0) return err;
+    p->waited = true;
+  }
+  *exit_code = p->exit_code;
+  *utime = p->utime;
+  *stime = p->stime;
+  *peak_rss = p->peak_rss;
+  *page_faults = p->page_faults;
+  *page_reclaim = p->page_reclaim;
+  return 0;
+}
+
+#if !defined(WIN32) && !defined(__wasi__)
+static void* os_process_reaper(void* arg) {
+  const pid_t pid = (pid_t)(intptr_t)arg;
+  while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) { }
+  return NULL;
+}
+
+// Reap a child so it does not linger as a zombie. It is not killed, but with its output pipes
+// closed it gets `SIGPIPE` on a further write. A child that is still running is waited for on a
+// (detached) background thread so we never block here. (We do not install a `SIGCHLD` handler
+// as that would interfere with the signal handling of the program.)
+static void os_process_reap(pid_t pid) {
+  pid_t res;
+  do {
+    res = waitpid(pid, NULL, WNOHANG);
+  } while (res < 0 && errno == EINTR);
+  if (res != 0) return;  // reaped (or not our child)
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, &os_process_reaper, (void*)(intptr_t)pid) == 0) {
+    pthread_detach(thread);
+  }
+}
+#endif
+
+kk_decl_export void kk_os_process_free(kk_os_process_t p, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  if (p == NULL) return;
+  os_close_fd(&p->fds[0]);
+  os_close_fd(&p->fds[1]);
+#if !defined(WIN32) && !defined(__wasi__)
+  if (!p->waited) os_process_reap((pid_t)p->pid);
+#endif
+  kk_free(p->buf);
+  kk_free(p);
+}
+
+static void kk_os_process_free_fun(void* p, kk_block_t* b) {
+  KK_UNUSED(b);
+  kk_os_process_free((kk_os_process_t)p, kk_get_context());
+}
+
+kk_decl_export kk_box_t kk_os_process_box(kk_os_process_t proc, kk_context_t* ctx) {
+  return kk_cptr_raw_box(&kk_os_process_free_fun, proc, ctx);
+}
+
+
 /*--------------------------------------------------------------------------------------------------
   Path max
 --------------------------------------------------------------------------------------------------*/
@@ -106,10 +106,33 @@ void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, siz
   *page_reclaim = 0;
 }
 
+int kk_process_wait(intptr_t pid, int* exit_code, kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit) {
+  HANDLE h = (HANDLE)pid;
+  if (WaitForSingleObject(h, INFINITE) == WAIT_FAILED) return EINVAL;
+  DWORD code = 0;
+  GetExitCodeProcess(h, &code);
+  *exit_code = (int)code;
+  FILETIME ct;
+  FILETIME ut;
+  FILETIME st;
+  FILETIME et;
+  GetProcessTimes(h, &ct, &et, &st, &ut);
+  *utime = kk_filetime_msecs(&ut);
+  *stime = kk_filetime_msecs(&st);
+  PROCESS_MEMORY_COUNTERS info;
+  GetProcessMemoryInfo(h, &info, sizeof(info));
+  *peak_rss = (size_t)info.PeakWorkingSetSize;
+  *page_faults = (size_t)info.PageFaultCount;
+  *peak_commit = (size_t)info.PeakPagefileUsage;
+  *page_reclaim = 0;
+  return 0;
+}
+
 #elif defined(__unix__) || defined(__unix) || defined(unix) || (defined(__APPLE__) && defined(__MACH__)) || defined(__HAIKU__)
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/resource.h>
+#include <sys/wait.h>
 
 #if defined(__APPLE__) && defined(__MACH__)
 #include <mach/mach.h>
@@ -123,18 +146,26 @@ static kk_msecs_t timeval_secs(const struct timeval* tv) {
   return ((kk_msecs_t)tv->tv_sec * 1000L) + ((kk_msecs_t)tv->tv_usec / 1000L);
 }
 
-void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit) {
-  struct rusage rusage;
-  getrusage(RUSAGE_SELF, &rusage);
 #if !defined(__HAIKU__)
+static void kk_rusage_info(const struct rusage* rusage, kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit) {
 #if defined(__APPLE__) && defined(__MACH__)
-  *peak_rss = rusage.ru_maxrss;  // apple reports in bytes
+  *peak_rss = rusage->ru_maxrss;  // apple reports in bytes
 #else
-  *peak_rss = rusage.ru_maxrss * 1024;
+  *peak_rss = rusage->ru_maxrss * 1024;
 #endif
-  *page_faults = rusage.ru_majflt;
-  *page_reclaim = rusage.ru_minflt;
+  *page_faults = rusage->ru_majflt;
+  *page_reclaim = rusage->ru_minflt;
   *peak_commit = 0;
+  *utime = timeval_secs(&rusage->ru_utime);
+  *stime = timeval_secs(&rusage->ru_stime);
+}
+#endif
+
+void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit) {
+  struct rusage rusage;
+  getrusage(RUSAGE_SELF, &rusage);
+#if !defined(__HAIKU__)
+  kk_rusage_info(&rusage, utime, stime, peak_rss, page_faults, page_reclaim, peak_commit);
 #else
   // Haiku does not have (yet?) a way to
   // get these stats per process
@@ -149,9 +180,31 @@ void kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, siz
   while (get_next_area_info(tid.team, &c, &mem) == B_OK) {
       *peak_rss += mem.ram_size;
   }
-#endif
   *utime = timeval_secs(&rusage.ru_utime);
   *stime = timeval_secs(&rusage.ru_stime);
+#endif
+}
+
+int kk_process_wait(intptr_t pid, int* exit_code, kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit) {
+  int status = 0;
+#if !defined(__HAIKU__)
+  struct rusage rusage;
+  while (wait4((pid_t)pid, &status, 0, &rusage) < 0) {
+    if (errno != EINTR) return errno;
+  }
+  kk_rusage_info(&rusage, utime, stime, peak_rss, page_faults, page_reclaim, peak_commit);
+#else
+  // no statistics of child processes on Haiku
+  while (waitpid((pid_t)pid, &status, 0) < 0) {
+    if (errno != EINTR) return errno;
+  }
+  *utime = *stime = 0;
+  *peak_rss = *page_faults = *page_reclaim = *peak_commit = 0;
+#endif
+  if (WIFEXITED(status)) *exit_code = WEXITSTATUS(status);
+  else if (WIFSIGNALED(status)) *exit_code = -WTERMSIG(status);
+  else *exit_code = -1;
+  return 0;
 }
 
 #else
@@ -168,4 +221,11 @@ static kk_process_info(kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, s
   *utime = 0;
   *stime = 0;
 }
+
+int kk_process_wait(intptr_t pid, int* exit_code, kk_msecs_t* utime, kk_msecs_t* stime, size_t* peak_rss, size_t* page_faults, size_t* page_reclaim, size_t* peak_commit) {
+  KK_UNUSED(pid);
+  *exit_code = -1;
+  kk_process_info(utime, stime, peak_rss, page_faults, page_reclaim, peak_commit);
+  return ENOSYS;
+}
 #endif
@@ -0,0 +1,263 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Primitive vectors (see `kklib/pvector.h`)
+--------------------------------------------------------------------------------------------------*/
+
+kk_pvector_t kk_pvector_alloc(kk_tag_t tag, size_t length, kk_context_t* ctx) {
+  const size_t esize = kk_pvector_elem_size(tag);
+  if (length > (SIZE_MAX - sizeof(struct kk_pvector_s)) / esize) {
+    kk_fatal_error(EOVERFLOW, "primitive vector is too large: %zu elements", length);
+  }
+  kk_pvector_t v = (kk_pvector_t)kk_block_alloc(sizeof(struct kk_pvector_s) + (length*esize), 0, tag, ctx);
+  v->length = length;
+  return v;
+}
+
+kk_pvector_t kk_pvector_alloc_bytes(size_t length, uint8_t init, kk_context_t* ctx) {
+  kk_pvector_t v = kk_pvector_alloc(KK_TAG_BYTES, length, ctx);
+  memset(kk_pvector_bytes_buf(v), init, length);
+  return v;
+}
+
+kk_pvector_t kk_pvector_alloc_int32(size_t length, int32_t init, kk_context_t* ctx) {
+  kk_pvector_t v = kk_pvector_alloc(KK_TAG_VECTOR_INT32, length, ctx);
+  int32_t* p = kk_pvector_int32_buf(v);
+  for (size_t i = 0; i < length; i++) { p[i] = init; }
+  return v;
+}
+
+kk_pvector_t kk_pvector_alloc_int64(size_t length, int64_t init, kk_context_t* ctx) {
+  kk_pvector_t v = kk_pvector_alloc(KK_TAG_VECTOR_INT64, length, ctx);
+  int64_t* p = kk_pvector_int64_buf(v);
+  for (size_t i = 0; i < length; i++) { p[i] = init; }
+  return v;
+}
+
+kk_pvector_t kk_pvector_alloc_double(size_t length, double init, kk_context_t* ctx) {
+  kk_pvector_t v = kk_pvector_alloc(KK_TAG_VECTOR_DOUBLE, length, ctx);
+  double* p = kk_pvector_double_buf(v);
+  for (size_t i = 0; i < length; i++) { p[i] = init; }
+  return v;
+}
+
+kk_pvector_t kk_pvector_copy_borrow(kk_pvector_t v, kk_context_t* ctx) {
+  const kk_tag_t tag = kk_pvector_tag(v);
+  kk_pvector_t w = kk_pvector_alloc(tag, v->length, ctx);
+  memcpy(&w->data, &v->data, v->length * kk_pvector_elem_size(tag));
+  return w;
+}
+
+kk_pvector_t kk_pvector_unique(kk_pvector_t v, kk_context_t* ctx) {
+  if (kk_pvector_is_unique(v)) return v;
+  kk_pvector_t w = kk_pvector_copy_borrow(v, ctx);
+  kk_pvector_drop(v, ctx);
+  return w;
+}
+
+kk_pvector_t kk_pvector_slice(kk_pvector_t v, size_t start, size_t length, kk_context_t* ctx) {
+  if (start > v->length) start = v->length;
+  if (length > v->length - start) length = v->length - start;
+  const kk_tag_t tag = kk_pvector_tag(v);
+  const size_t esize = kk_pvector_elem_size(tag);
+  kk_pvector_t w;
+  if (kk_pvector_is_unique(v)) {
+    // shift down in place (keeping the storage)
+    memmove(&v->data, &v->data.u8[start*esize], length*esize);
+    v->length = length;
+    w = v;
+  }
+  else {
+    w = kk_pvector_alloc(tag, length, ctx);
+    memcpy(&w->data, &v->data.u8[start*esize], length*esize);
+    kk_pvector_drop(v, ctx);
+  }
+  return w;
+}
+
+kk_pvector_t kk_pvector_append(kk_pvector_t v, kk_pvector_t w, kk_context_t* ctx) {
+  const kk_tag_t tag = kk_pvector_tag(v);
+  if (kk_pvector_tag(w) != tag) {
+    kk_fatal_error(EINVAL, "cannot append primitive vectors with different element types");
+  }
+  const size_t esize = kk_pvector_elem_size(tag);
+  const size_t vlen = v->length;
+  const size_t wlen = w->length;
+  kk_pvector_t u;
+  if (kk_pvector_is_unique(v)) {
+    // extend in place
+    u = (kk_pvector_t)kk_block_realloc(&v->_block, sizeof(struct kk_pvector_s) + (vlen + wlen)*esize, ctx);
+    if (u == NULL) kk_fatal_error(ENOMEM, "unable to extend a primitive vector");
+    kk_heap_profile_alloc(&u->_block, sizeof(struct kk_pvector_s) + (vlen + wlen)*esize, ctx);
+  }
+  else {
+    u = kk_pvector_alloc(tag, vlen + wlen, ctx);
+    memcpy(&u->data, &v->data, vlen*esize);
+    kk_pvector_drop(v, ctx);
+  }
+  memcpy(&u->data.u8[vlen*esize], &w->data, wlen*esize);
+  u->length = vlen + wlen;
+  kk_pvector_drop(w, ctx);
+  return u;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Conversion from and to boxed vectors
+--------------------------------------------------------------------------------------------------*/
+
+kk_pvector_t kk_pvector_from_vector(kk_vector_t v, kk_tag_t tag, kk_context_t* ctx) {
+  size_t len;
+  kk_box_t* src = kk_vector_buf(v, &len);
+  kk_pvector_t w = kk_pvector_alloc(tag, len, ctx);
+  switch (tag) {
+    case KK_TAG_VECTOR_INT32: {
+      int32_t* p = kk_pvector_int32_buf(w);
+      for (size_t i = 0; i < len; i++) { p[i] = kk_int32_unbox(kk_box_dup(src[i]), ctx); }
+      break;
+    }
+    case KK_TAG_VECTOR_INT64: {
+      int64_t* p = kk_pvector_int64_buf(w);
+      for (size_t i = 0; i < len; i++) { p[i] = kk_integer_clamp64(kk_integer_unbox(kk_box_dup(src[i])), ctx); }
+      break;
+    }
+    case KK_TAG_VECTOR_DOUBLE: {
+      double* p = kk_pvector_double_buf(w);
+      for (size_t i = 0; i < len; i++) { p[i] = kk_double_unbox(kk_box_dup(src[i]), ctx); }
+      break;
+    }
+    default: {
+      uint8_t* p = kk_pvector_bytes_buf(w);
+      for (size_t i = 0; i < len; i++) { p[i] = (uint8_t)kk_int32_unbox(kk_box_dup(src[i]), ctx); }
+      break;
+    }
+  }
+  kk_vector_drop(v, ctx);
+  return w;
+}
+
+kk_vector_t kk_pvector_to_vector(kk_pvector_t v, kk_context_t* ctx) {
+  const size_t len = v->length;
+  kk_vector_t w = kk_vector_alloc(len, kk_box_null, ctx);
+  kk_box_t* dest = kk_vector_buf(w, NULL);
+  switch (kk_pvector_tag(v)) {
+    case KK_TAG_VECTOR_INT32: {
+      const int32_t* p = kk_pvector_int32_buf(v);
+      for (size_t i = 0; i < len; i++) { dest[i] = kk_int32_box(p[i], ctx); }
+      break;
+    }
+    case KK_TAG_VECTOR_INT64: {
+      const int64_t* p = kk_pvector_int64_buf(v);
+      for (size_t i = 0; i < len; i++) { dest[i] = kk_integer_box(kk_integer_from_int64(p[i], ctx)); }
+      break;
+    }
+    case KK_TAG_VECTOR_DOUBLE: {
+      const double* p = kk_pvector_double_buf(v);
+      for (size_t i = 0; i < len; i++) { dest[i] = kk_double_box(p[i], ctx); }
+      break;
+    }
+    default: {
+      const uint8_t* p = kk_pvector_bytes_buf(v);
+      for (size_t i = 0; i < len; i++) { dest[i] = kk_int32_box(p[i], ctx); }
+      break;
+    }
+  }
+  kk_pvector_drop(v, ctx);
+  return w;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Kernels
+  Simple loops over `restrict` pointers that compilers vectorize. Floating point reductions
+  use 4 independent accumulators: this is vectorizable without `-ffast-math` and the result
+  does not depend on the compiler (but may differ slightly from a sequential sum).
+--------------------------------------------------------------------------------------------------*/
+
+int64_t kk_pvector_int32_sum_borrow(kk_pvector_t v) {
+  const int32_t* restrict p = kk_pvector_int32_buf(v);
+  const size_t n = v->length;
+  int64_t sum = 0;
+  for (size_t i = 0; i < n; i++) { sum += p[i]; }
+  return sum;
+}
+
+int64_t kk_pvector_int64_sum_borrow(kk_pvector_t v) {
+  const int64_t* restrict p = kk_pvector_int64_buf(v);
+  const size_t n = v->length;
+  uint64_t sum = 0;  // wrap around on overflow
+  for (size_t i = 0; i < n; i++) { sum += (uint64_t)p[i]; }
+  return (int64_t)sum;
+}
+
+int64_t kk_pvector_int64_dot_borrow(kk_pvector_t x, kk_pvector_t y) {
+  const int64_t* restrict p = kk_pvector_int64_buf(x);
+  const int64_t* restrict q = kk_pvector_int64_buf(y);
+  const size_t n = (x->length < y->length ? x->length : y->length);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; i++) { sum += (uint64_t)p[i] * (uint64_t)q[i]; }
+  return (int64_t)sum;
+}
+
+double kk_pvector_double_sum_borrow(kk_pvector_t v) {
+  const double* restrict p = kk_pvector_double_buf(v);
+  const size_t n = v->length;
+  double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += p[i]; s1 += p[i+1]; s2 += p[i+2]; s3 += p[i+3];
+  }
+  for (; i < n; i++) { s0 += p[i]; }
+  return ((s0 + s1) + (s2 + s3));
+}
+
+double kk_pvector_double_dot_borrow(kk_pvector_t x, kk_pvector_t y) {
+  const double* restrict p = kk_pvector_double_buf(x);
+  const double* restrict q = kk_pvector_double_buf(y);
+  const size_t n = (x->length < y->length ? x->length : y->length);
+  double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += p[i]*q[i]; s1 += p[i+1]*q[i+1]; s2 += p[i+2]*q[i+2]; s3 += p[i+3]*q[i+3];
+  }
+  for (; i < n; i++) { s0 += p[i]*q[i]; }
+  return ((s0 + s1) + (s2 + s3));
+}
+
+kk_pvector_t kk_pvector_double_scale(kk_pvector_t x, double a, kk_context_t* ctx) {
+  x = kk_pvector_unique(x, ctx);
+  double* restrict p = kk_pvector_double_buf(x);
+  const size_t n = x->length;
+  for (size_t i = 0; i < n; i++) { p[i] = a*p[i]; }
+  return x;
+}
+
+kk_pvector_t kk_pvector_double_axpy(double a, kk_pvector_t x, kk_pvector_t y, kk_context_t* ctx) {
+  if (x == y) {
+    // avoid aliasing
+    kk_pvector_drop(x, ctx);
+    return kk_pvector_double_scale(y, a + 1.0, ctx);
+  }
+  y = kk_pvector_unique(y, ctx);
+  const double* restrict p = kk_pvector_double_buf(x);
+  double* restrict q = kk_pvector_double_buf(y);
+  const size_t n = (x->length < y->length ? x->length : y->length);
+  for (size_t i = 0; i < n; i++) { q[i] = a*p[i] + q[i]; }
+  kk_pvector_drop(x, ctx);
+  return y;
+}
+
+kk_pvector_t kk_pvector_double_map(kk_pvector_t x, double (*f)(double), kk_context_t* ctx) {
+  x = kk_pvector_unique(x, ctx);
+  double* p = kk_pvector_double_buf(x);
+  const size_t n = x->length;
+  for (size_t i = 0; i < n; i++) { p[i] = f(p[i]); }
+  return x;
+}
@@ -44,43 +44,73 @@ static void pcg_init(uint64_t init, uint64_t stream, kk_pcg_ctx_t* rnd) {
 }
 
 
-/*
-// pseudo random number context (using sfc32)
-typedef struct kk_sfc_ctx_s {
-  uint32_t a;
-  uint32_t b;
-  uint32_t c;
-  uint32_t counter;
-} kk_sfc_ctx_t;
-
-// Pseudo random number using sfc32 by Chris Doty-Humphrey.
-// It is a "chaotic" pseudo random generator that uses 32-bit operations only
-// (so we can be deterministic across architectures in results and performance).
-// It has good statistical properties and passes PractRand and Big-crush.
-// It uses a 32-bit counter to guarantee a worst-case cycle
-// of 2^32. It has a 96-bit state, so the average period is 2^127.
-// The chance of a cycle of less than 2^(32+max(96-k,0)) is 2^-(32+k),
-// (e.g. the chance of a cycle of less than 2^48 is 2^-80).
-// <http://pracrand.sourceforge.net/RNG_engines.txt>
-static inline uint32_t sfc_uint32(kk_sfc_ctx_t* rnd) {
-  uint32_t x = rnd->a + rnd->b + rnd->counter;
-  rnd->counter++;
-  rnd->a = rnd->b ^ (rnd->b >> 9);
-  rnd->b = rnd->c + (rnd->c << 3);
-  rnd->c = kk_bits_rotl32(rnd->c, 21) + x;
-  return x;
-}
+/* -----------------------------------------------------------
+  Fast pseudo random numbers using sfc32 (see `kklib/random.h`)
+----------------------------------------------------------- */
 
-static void sfc_init(uint64_t seed, kk_sfc_ctx_t* rnd) {
+void kk_prandom_init(uint64_t seed, kk_prandom_t* rnd) {
   rnd->a = 0;
   rnd->b = (uint32_t)(seed);
   rnd->c = (uint32_t)(seed >> 32);
   rnd->counter = 1;
   for (size_t i = 0; i < 12; i++) {
-    sfc_uint32(rnd);
+    kk_prandom_uint32(rnd);
+  }
+}
+
+void kk_prandom_init_srandom(kk_prandom_t* rnd, kk_context_t* ctx) {
+  kk_prandom_init(kk_srandom_uint64(ctx), rnd);
+}
+
+// Mix the seed of a split stream (the splitmix64 finalizer by Sebastiano Vigna)
+// so it is not correlated with the output of the parent stream.
+static uint64_t prandom_mix64(uint64_t x) {
+  x += KU64(0x9E3779B97F4A7C15);
+  x = (x ^ (x >> 30)) * KU64(0xBF58476D1CE4E5B9);
+  x = (x ^ (x >> 27)) * KU64(0x94D049BB133111EB);
+  return (x ^ (x >> 31));
+}
+
+void kk_prandom_split(kk_prandom_t* rnd, kk_prandom_t* rnd_new) {
+  kk_assert_internal(rnd != rnd_new);
+  kk_prandom_init(prandom_mix64(kk_prandom_uint64(rnd)), rnd_new);
+}
+
+uint32_t kk_prandom_range32(uint32_t max, kk_prandom_t* rnd) {
+  // see `kk_srandom_range32`
+  uint32_t x = kk_prandom_uint32(rnd);
+  uint64_t m = (uint64_t)x * (uint64_t)max;
+  uint32_t l = (uint32_t)m;
+  if (kk_unlikely(l < max)) {
+    uint32_t threshold = (~max+1) % max;
+    while (l < threshold) {
+      x = kk_prandom_uint32(rnd);
+      m = (uint64_t)x * (uint64_t)max;
+      l = (uint32_t)m;
+    }
+  }
+  return (uint32_t)(m >> 32);
+}
+
+double kk_prandom_double(kk_prandom_t* rnd) {
+  // use 52 random bits
+  const uint64_t x = KU64(0x3FF0000000000000) | (kk_prandom_uint64(rnd) >> 12);
+  double d;
+  memcpy(&d, &x, sizeof(double));
+  return (d - 1.0);
+}
+
+void kk_prandom_fill(void* buf, size_t size, kk_prandom_t* rnd) {
+  uint8_t* p = (uint8_t*)buf;
+  for (; size >= sizeof(uint32_t); size -= sizeof(uint32_t), p += sizeof(uint32_t)) {
+    const uint32_t x = kk_prandom_uint32(rnd);
+    memcpy(p, &x, sizeof(uint32_t));
+  }
+  if (size > 0) {
+    const uint32_t x = kk_prandom_uint32(rnd);
+    memcpy(p, &x, size);
   }
 }
-*/
 
 
 /* ----------------------------------------------------------------------------
@@ -100,63 +130,76 @@ Position 12 to 13: the counter.
 Position 14 to 15: the nonce.
 
 The implementation uses regular C code which compiles very well on modern compilers.
-(gcc x64 has no register spills, and clang 6+ uses SSE instructions)
+We compute `KK_CHACHA_LANES` consecutive blocks at once where each statement operates
+on all lanes: compilers vectorize this into SSE/AVX2/NEON instructions (4 lanes fill a
+128-bit register, use 8 lanes with `-mavx2`). The output is the same as computing the
+blocks one after another.
 -----------------------------------------------------------------------------*/
 
-static inline void qround(uint32_t x[16], size_t a, size_t b, size_t c, size_t d) {
-  x[a] += x[b]; x[d] = kk_bits_rotl32(x[d] ^ x[a], 16);
-  x[c] += x[d]; x[b] = kk_bits_rotl32(x[b] ^ x[c], 12);
-  x[a] += x[b]; x[d] = kk_bits_rotl32(x[d] ^ x[a], 8);
-  x[c] += x[d]; x[b] = kk_bits_rotl32(x[b] ^ x[c], 7);
-}
+#define KK_CHACHA_LANE_LOOP(stat)  for (size_t j = 0; j < KK_CHACHA_LANES; j++) { stat; }
 
-static inline void kk_chacha_shuffle(const size_t rounds, uint32_t* x)
+#define kk_chacha_qround(x,a,b,c,d) \
+  KK_CHACHA_LANE_LOOP( x[a][j] += x[b][j]; x[d][j] = kk_bits_rotl32(x[d][j] ^ x[a][j], 16); ) \
+  KK_CHACHA_LANE_LOOP( x[c][j] += x[d][j]; x[b][j] = kk_bits_rotl32(x[b][j] ^ x[c][j], 12); ) \
+  KK_CHACHA_LANE_LOOP( x[a][j] += x[b][j]; x[d][j] = kk_bits_rotl32(x[d][j] ^ x[a][j], 8);  ) \
+  KK_CHACHA_LANE_LOOP( x[c][j] += x[d][j]; x[b][j] = kk_bits_rotl32(x[b][j] ^ x[c][j], 7);  )
+
+static inline void kk_chacha_shuffle(const size_t rounds, uint32_t x[16][KK_CHACHA_LANES])
 {
   for (size_t i = 0; i < rounds; i += 2) {
-    qround(x, 0, 4, 8, 12);
-    qround(x, 1, 5, 9, 13);
-    qround(x, 2, 6, 10, 14);
-    qround(x, 3, 7, 11, 15);
-    qround(x, 0, 5, 10, 15);
-    qround(x, 1, 6, 11, 12);
-    qround(x, 2, 7, 8, 13);
-    qround(x, 3, 4, 9, 14);
+    kk_chacha_qround(x, 0, 4, 8, 12);
+    kk_chacha_qround(x, 1, 5, 9, 13);
+    kk_chacha_qround(x, 2, 6, 10, 14);
+    kk_chacha_qround(x, 3, 7, 11, 15);
+    kk_chacha_qround(x, 0, 5, 10, 15);
+    kk_chacha_qround(x, 1, 6, 11, 12);
+    kk_chacha_qround(x, 2, 7, 8, 13);
+    kk_chacha_qround(x, 3, 4, 9, 14);
   }
 }
 
-static inline void chacha_block(const size_t rounds, uint32_t* input, uint32_t* output)
+// Compute `KK_CHACHA_LANES` blocks into `output` (of `16*KK_CHACHA_LANES` words)
+static void chacha_blocks(const size_t rounds, uint32_t* input, uint32_t* output)
 {
-  // copy into `x`
-  uint32_t x[16];
+  // copy into `x` with consecutive counters in each lane
+  uint32_t in[16][KK_CHACHA_LANES];
+  const uint64_t counter = ((uint64_t)input[13] << 32) | input[12];
   for (size_t i = 0; i < 16; i++) {
-    x[i] = input[i];
+    KK_CHACHA_LANE_LOOP( in[i][j] = input[i] );
+  }
+  for (size_t j = 0; j < KK_CHACHA_LANES; j++) {
+    const uint64_t c = counter + j;
+    in[12][j] = (uint32_t)c;
+    in[13][j] = (uint32_t)(c >> 32);
+    if (c < counter) { in[14][j] += 1; }  // keep increasing into the nonce
   }
+  uint32_t x[16][KK_CHACHA_LANES];
+  memcpy(x, in, sizeof(x));
 
   // shuffle bits
   kk_chacha_shuffle(rounds, x);
 
   // add scrambled data to the initial state into the output
-  for (size_t i = 0; i < 16; i++) {
-    output[i] = x[i] + input[i];
+  for (size_t j = 0; j < KK_CHACHA_LANES; j++) {
+    for (size_t i = 0; i < 16; i++) {
+      output[16*j + i] = x[i][j] + in[i][j];
+    }
   }
 
   // increment the counter for the next round
-  input[12] += 1;
-  if (input[12] == 0) {
-    input[13] += 1;
-    if (input[13] == 0) {  // and keep increasing into the nonce
-      input[14] += 1;
-    }
-  }
+  const uint64_t next = counter + KK_CHACHA_LANES;
+  input[12] = (uint32_t)next;
+  input[13] = (uint32_t)(next >> 32);
+  if (next < counter) { input[14] += 1; }
 }
 
 static kk_decl_noinline void chacha20(kk_random_ctx_t* rnd) {
-  chacha_block(20, rnd->input, rnd->output);
+  chacha_blocks(20, rnd->input, rnd->output);
   rnd->used = 0;
 }
 /*
 static kk_decl_noinline void chacha8(kk_random_ctx_t* rnd) {
-  chacha_block(8, rnd->input, rnd->output);
+  chacha_blocks(8, rnd->input, rnd->output);
   rnd->used = 0;
 }
 */
@@ -181,7 +224,7 @@ static void chacha_init(kk_random_ctx_t* rnd, const uint8_t key[32], uint64_t no
   rnd->input[13] = 0;
   rnd->input[14] = (uint32_t)nonce;
   rnd->input[15] = (uint32_t)(nonce >> 32);
-  rnd->used = 128;
+  rnd->used = 16*KK_CHACHA_LANES;
 }
 
 /*
@@ -249,6 +292,31 @@ double kk_srandom_double(kk_context_t* ctx) {
   return (d - 1.0);
 }
 
+/*--------------------------------------------------------------------------------------
+  Secure random: fill a buffer
+  Every block is generated through `kk_srandom_round` and copied out of the context
+  (so the output is never written through a cast pointer into the buffer).
+--------------------------------------------------------------------------------------*/
+
+void kk_srandom_fill(void* buf, size_t size, kk_context_t* ctx) {
+  uint8_t* p = (uint8_t*)buf;
+  kk_random_ctx_t* rnd = ctx->srandom_ctx;
+  if (rnd == NULL) { rnd = kk_srandom_round(ctx); }
+  while (size > 0) {
+    if (rnd->used >= 16*KK_CHACHA_LANES) {
+      rnd = kk_srandom_round(ctx);
+    }
+    // use the remaining output (and clear it after use)
+    const size_t avail = (size_t)(16*KK_CHACHA_LANES - rnd->used) * sizeof(uint32_t);
+    const size_t n = (size < avail ? size : avail);
+    uint8_t* out = (uint8_t*)&rnd->output[rnd->used];
+    memcpy(p, out, n);
+    memset(out, 0, n);
+    rnd->used += (int32_t)((n + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    p += n;
+    size -= n;
+  }
+}
 
 
 /* ----------------------------------------------------------------------------
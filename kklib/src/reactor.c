@@ -0,0 +1,388 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Reactor (see also `kklib/reactor.h`)
+  Waiting values are kept in a table indexed by file descriptor with a value for each direction.
+  The interest registered with the backend is updated whenever a waiter is added or completed
+  (`kqueue` registrations are one-shot per filter so they only need to be added).
+  Timers are kept in a binary heap ordered by deadline (and registration order for ties).
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(__linux__)
+#define KK_REACTOR_EPOLL  1
+#include <sys/epoll.h>
+#include <unistd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define KK_REACTOR_KQUEUE 1
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#elif !defined(_WIN32) && !defined(__wasi__)
+#define KK_REACTOR_POLL   1
+#include <poll.h>
+#else
+#define KK_REACTOR_NONE   1
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+#endif
+
+#ifndef KK_REACTOR_EVENTS
+#define KK_REACTOR_EVENTS  (256)   // maximal number of backend events handled per wait
+#endif
+
+#define KK_REACTOR_READ    (1)
+#define KK_REACTOR_WRITE   (2)
+
+typedef struct kk_reactor_waiter_s {
+  kk_box_t values[2];   // read and write value (or `kk_box_null`)
+  int      interest;    // interest registered with the backend
+} kk_reactor_waiter_t;
+
+typedef struct kk_reactor_timer_s {
+  kk_usecs_t deadline;
+  uint64_t   seq;
+  kk_box_t   value;
+} kk_reactor_timer_t;
+
+struct kk_reactor_s {
+  int                  backend;      // `epoll` or `kqueue` descriptor (or -1)
+  kk_reactor_waiter_t* waiters;      // indexed by file descriptor
+  size_t               waiters_cap;
+  size_t               fd_pending;   // number of waiting values in `waiters`
+  kk_reactor_timer_t*  timers;       // a binary heap
+  size_t               timer_count;
+  size_t               timer_cap;
+  uint64_t             timer_seq;
+  kk_box_t*            ready;        // values completed during a `kk_reactor_wait`
+  size_t               ready_count;
+  size_t               ready_cap;
+};
+
+kk_decl_export int kk_reactor_create(kk_reactor_t* reactor, kk_context_t* ctx) {
+  *reactor = NULL;
+  kk_reactor_t r = (kk_reactor_t)kk_zalloc(sizeof(struct kk_reactor_s), ctx);
+  if (r == NULL) return ENOMEM;
+  r->backend = -1;
+#if defined(KK_REACTOR_EPOLL)
+  r->backend = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(KK_REACTOR_KQUEUE)
+  r->backend = kqueue();
+#endif
+#if defined(KK_REACTOR_EPOLL) || defined(KK_REACTOR_KQUEUE)
+  if (r->backend < 0) {
+    const int err = errno;
+    kk_free(r);
+    return err;
+  }
+#endif
+  *reactor = r;
+  return 0;
+}
+
+kk_decl_export void kk_reactor_free(kk_reactor_t r, kk_context_t* ctx) {
+  if (r == NULL) return;
+#if defined(KK_REACTOR_EPOLL) || defined(KK_REACTOR_KQUEUE)
+  if (r->backend >= 0) close(r->backend);
+#endif
+  for (size_t fd = 0; fd < r->waiters_cap && r->fd_pending > 0; fd++) {
+    for (int dir = 0; dir < 2; dir++) {
+      if (!kk_box_is_null(r->waiters[fd].values[dir])) {
+        kk_box_drop(r->waiters[fd].values[dir], ctx);
+        r->fd_pending--;
+      }
+    }
+  }
+  for (size_t i = 0; i < r->timer_count; i++) {
+    kk_box_drop(r->timers[i].value, ctx);
+  }
+  kk_free(r->waiters);
+  kk_free(r->timers);
+  kk_free(r->ready);
+  kk_free(r);
+}
+
+static void kk_reactor_free_fun(void* p, kk_block_t* b) {
+  KK_UNUSED(b);
+  kk_reactor_free((kk_reactor_t)p, kk_get_context());
+}
+
+kk_decl_export kk_box_t kk_reactor_box(kk_reactor_t reactor, kk_context_t* ctx) {
+  return kk_cptr_raw_box(&kk_reactor_free_fun, reactor, ctx);
+}
+
+kk_decl_export size_t kk_reactor_pending(kk_reactor_t r) {
+  return (r == NULL ? 0 : r->fd_pending + r->timer_count);
+}
+
+static bool kk_reactor_push_ready(kk_reactor_t r, kk_box_t value, kk_context_t* ctx) {
+  if (r->ready_count >= r->ready_cap) {
+    const size_t cap = (r->ready_cap == 0 ? 16 : 2*r->ready_cap);
+    kk_box_t* ready = (kk_box_t*)kk_realloc(r->ready, cap*sizeof(kk_box_t), ctx);
+    if (ready == NULL) return false;
+    r->ready = ready;
+    r->ready_cap = cap;
+  }
+  r->ready[r->ready_count++] = value;
+  return true;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  File descriptors
+--------------------------------------------------------------------------------------------------*/
+
+static bool kk_reactor_reserve_fd(kk_reactor_t r, size_t fd, kk_context_t* ctx) {
+  if (fd < r->waiters_cap) return true;
+  size_t cap = (r->waiters_cap == 0 ? 64 : r->waiters_cap);
+  while (cap <= fd) cap *= 2;
+  kk_reactor_waiter_t* waiters = (kk_reactor_waiter_t*)kk_realloc(r->waiters, cap*sizeof(kk_reactor_waiter_t), ctx);
+  if (waiters == NULL) return false;
+  for (size_t i = r->waiters_cap; i < cap; i++) {
+    waiters[i].values[0] = kk_box_null;
+    waiters[i].values[1] = kk_box_null;
+    waiters[i].interest = 0;
+  }
+  r->waiters = waiters;
+  r->waiters_cap = cap;
+  return true;
+}
+
+static int kk_reactor_desired(kk_reactor_waiter_t* w) {
+  return ((kk_box_is_null(w->values[0]) ? 0 : KK_REACTOR_READ) | (kk_box_is_null(w->values[1]) ? 0 : KK_REACTOR_WRITE));
+}
+
+// Update the backend interest of a file descriptor to the current waiters.
+static int kk_reactor_update(kk_reactor_t r, size_t fd) {
+  kk_reactor_waiter_t* w = &r->waiters[fd];
+  const int desired = kk_reactor_desired(w);
+#if defined(KK_REACTOR_EPOLL)
+  if (desired == w->interest) return 0;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = ((desired & KK_REACTOR_READ) != 0 ? EPOLLIN : 0) | ((desired & KK_REACTOR_WRITE) != 0 ? EPOLLOUT : 0);
+  ev.data.fd = (int)fd;
+  const int op = (w->interest == 0 ? EPOLL_CTL_ADD : (desired == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD));
+  if (epoll_ctl(r->backend, op, (int)fd, &ev) != 0) return errno;
+  w->interest = desired;
+#elif defined(KK_REACTOR_KQUEUE)
+  const int add = desired & ~w->interest;
+  if (add == 0) return 0;
+  struct kevent evs[2];
+  int n = 0;
+  if ((add & KK_REACTOR_READ) != 0)  { EV_SET(&evs[n], fd, EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, NULL); n++; }
+  if ((add & KK_REACTOR_WRITE) != 0) { EV_SET(&evs[n], fd, EVFILT_WRITE, EV_ADD | EV_ONESHOT, 0, 0, NULL); n++; }
+  if (kevent(r->backend, evs, n, NULL, 0, NULL) != 0) return errno;
+  w->interest |= add;
+#else
+  w->interest = desired;
+#endif
+  return 0;
+}
+
+kk_decl_export int kk_reactor_add_fd(kk_reactor_t r, intptr_t fd, bool write, kk_box_t value, kk_context_t* ctx) {
+  int err = 0;
+  const int dir = (write ? 1 : 0);
+#if defined(KK_REACTOR_NONE)
+  KK_UNUSED(r); KK_UNUSED(fd); KK_UNUSED(dir);
+  err = ENOSYS;
+#else
+  if (r == NULL || fd < 0) err = EBADF;
+  else if (!kk_reactor_reserve_fd(r, (size_t)fd, ctx)) err = ENOMEM;
+  else if (!kk_box_is_null(r->waiters[fd].values[dir])) err = EBUSY;  // already waited for
+  else {
+    r->waiters[fd].values[dir] = value;
+    err = kk_reactor_update(r, (size_t)fd);
+    if (err == 0) {
+      r->fd_pending++;
+      return 0;
+    }
+    r->waiters[fd].values[dir] = kk_box_null;
+  }
+#endif
+  kk_box_drop(value, ctx);
+  return err;
+}
+
+#if !defined(KK_REACTOR_NONE)
+static void kk_reactor_complete(kk_reactor_t r, size_t fd, int dir, kk_context_t* ctx) {
+  kk_reactor_waiter_t* w = &r->waiters[fd];
+  if (kk_box_is_null(w->values[dir])) return;
+  if (!kk_reactor_push_ready(r, w->values[dir], ctx)) return;  // try again on the next wait
+  w->values[dir] = kk_box_null;
+  r->fd_pending--;
+}
+#endif
+
+#if defined(KK_REACTOR_EPOLL)
+static int kk_reactor_poll(kk_reactor_t r, int timeout, kk_context_t* ctx) {
+  struct epoll_event evs[KK_REACTOR_EVENTS];
+  const int n = epoll_wait(r->backend, evs, KK_REACTOR_EVENTS, timeout);
+  if (n < 0) return (errno == EINTR ? 0 : errno);
+  for (int i = 0; i < n; i++) {
+    const size_t fd = (size_t)evs[i].data.fd;
+    const uint32_t events = evs[i].events;
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)  kk_reactor_complete(r, fd, 0, ctx);
+    if ((events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0) kk_reactor_complete(r, fd, 1, ctx);
+    kk_reactor_update(r, fd);
+  }
+  return 0;
+}
+
+#elif defined(KK_REACTOR_KQUEUE)
+static int kk_reactor_poll(kk_reactor_t r, int timeout, kk_context_t* ctx) {
+  struct kevent evs[KK_REACTOR_EVENTS];
+  struct timespec ts;
+  if (timeout >= 0) {
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (long)(timeout % 1000) * 1000000L;
+  }
+  const int n = kevent(r->backend, NULL, 0, evs, KK_REACTOR_EVENTS, (timeout < 0 ? NULL : &ts));
+  if (n < 0) return (errno == EINTR ? 0 : errno);
+  for (int i = 0; i < n; i++) {
+    const size_t fd = (size_t)evs[i].ident;
+    if (fd >= r->waiters_cap) continue;
+    const int dir = (evs[i].filter == EVFILT_WRITE ? 1 : 0);
+    r->waiters[fd].interest &= ~(dir == 0 ? KK_REACTOR_READ : KK_REACTOR_WRITE);  // one-shot
+    kk_reactor_complete(r, fd, dir, ctx);
+  }
+  return 0;
+}
+
+#elif defined(KK_REACTOR_POLL)
+static int kk_reactor_poll(kk_reactor_t r, int timeout, kk_context_t* ctx) {
+  struct pollfd* pfds = NULL;
+  nfds_t count = 0;
+  if (r->fd_pending > 0) {
+    pfds = (struct pollfd*)kk_malloc(r->fd_pending * sizeof(struct pollfd), ctx);
+    if (pfds == NULL) return ENOMEM;
+    for (size_t fd = 0; fd < r->waiters_cap && count < r->fd_pending; fd++) {
+      const int desired = kk_reactor_desired(&r->waiters[fd]);
+      if (desired == 0) continue;
+      pfds[count].fd = (int)fd;
+      pfds[count].events = ((desired & KK_REACTOR_READ) != 0 ? POLLIN : 0) | ((desired & KK_REACTOR_WRITE) != 0 ? POLLOUT : 0);
+      pfds[count].revents = 0;
+      count++;
+    }
+  }
+  const int n = poll(pfds, count, timeout);
+  int err = (n < 0 && errno != EINTR ? errno : 0);
+  for (nfds_t i = 0; n > 0 && i < count; i++) {
+    const short events = pfds[i].revents;
+    const size_t fd = (size_t)pfds[i].fd;
+    if ((events & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) != 0)  kk_reactor_complete(r, fd, 0, ctx);
+    if ((events & (POLLOUT | POLLHUP | POLLERR | POLLNVAL)) != 0) kk_reactor_complete(r, fd, 1, ctx);
+  }
+  kk_free(pfds);
+  return err;
+}
+
+#else
+static int kk_reactor_poll(kk_reactor_t r, int timeout, kk_context_t* ctx) {
+  KK_UNUSED(r); KK_UNUSED(ctx);
+#if defined(_WIN32)
+  if (timeout > 0) Sleep((DWORD)timeout);
+#else
+  KK_UNUSED(timeout);
+#endif
+  return 0;
+}
+#endif
+
+
+/*--------------------------------------------------------------------------------------------------
+  Timers
+--------------------------------------------------------------------------------------------------*/
+
+static bool kk_reactor_timer_before(const kk_reactor_timer_t* x, const kk_reactor_timer_t* y) {
+  return (x->deadline < y->deadline || (x->deadline == y->deadline && x->seq < y->seq));
+}
+
+kk_decl_export int kk_reactor_add_timer(kk_reactor_t r, kk_msecs_t msecs, kk_box_t value, kk_context_t* ctx) {
+  if (r == NULL) {
+    kk_box_drop(value, ctx);
+    return EBADF;
+  }
+  if (r->timer_count >= r->timer_cap) {
+    const size_t cap = (r->timer_cap == 0 ? 16 : 2*r->timer_cap);
+    kk_reactor_timer_t* timers = (kk_reactor_timer_t*)kk_realloc(r->timers, cap*sizeof(kk_reactor_timer_t), ctx);
+    if (timers == NULL) {
+      kk_box_drop(value, ctx);
+      return ENOMEM;
+    }
+    r->timers = timers;
+    r->timer_cap = cap;
+  }
+  kk_reactor_timer_t t;
+  t.deadline = kk_timer_start() + (msecs <= 0 ? 0 : msecs*1000);
+  t.seq = r->timer_seq++;
+  t.value = value;
+  // sift up
+  size_t i = r->timer_count++;
+  while (i > 0) {
+    const size_t parent = (i - 1)/2;
+    if (!kk_reactor_timer_before(&t, &r->timers[parent])) break;
+    r->timers[i] = r->timers[parent];
+    i = parent;
+  }
+  r->timers[i] = t;
+  return 0;
+}
+
+// Remove the first timer (whose value is now owned by the caller).
+static void kk_reactor_timer_pop(kk_reactor_t r) {
+  kk_assert_internal(r->timer_count > 0);
+  const kk_reactor_timer_t last = r->timers[--r->timer_count];
+  // sift down
+  size_t i = 0;
+  while (true) {
+    size_t child = 2*i + 1;
+    if (child >= r->timer_count) break;
+    if (child + 1 < r->timer_count && kk_reactor_timer_before(&r->timers[child+1], &r->timers[child])) child++;
+    if (!kk_reactor_timer_before(&r->timers[child], &last)) break;
+    r->timers[i] = r->timers[child];
+    i = child;
+  }
+  if (r->timer_count > 0) r->timers[i] = last;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Wait
+--------------------------------------------------------------------------------------------------*/
+
+kk_decl_export int kk_reactor_wait(kk_reactor_t r, kk_msecs_t timeout, kk_vector_t* ready, kk_context_t* ctx) {
+  *ready = kk_vector_empty();
+  if (r == NULL) return EBADF;
+  if (kk_reactor_pending(r) == 0) return 0;
+  if (r->timer_count > 0) {
+    // wait no longer than the first timer (rounded up to milli-seconds)
+    const kk_usecs_t until = r->timers[0].deadline - kk_timer_start();
+    const kk_msecs_t msecs = (until <= 0 ? 0 : (until + 999)/1000);
+    if (timeout < 0 || msecs < timeout) timeout = msecs;
+  }
+  if (timeout > INT_MAX) timeout = INT_MAX;
+  int err = kk_reactor_poll(r, (int)timeout, ctx);
+  if (r->timer_count > 0) {
+    const kk_usecs_t now = kk_timer_start();
+    while (r->timer_count > 0 && r->timers[0].deadline <= now) {
+      if (!kk_reactor_push_ready(r, r->timers[0].value, ctx)) break;
+      kk_reactor_timer_pop(r);
+    }
+  }
+  if (r->ready_count > 0) {
+    kk_vector_t v = kk_vector_alloc(r->ready_count, kk_box_null, ctx);
+    memcpy(kk_vector_buf(v, NULL), r->ready, r->ready_count * sizeof(kk_box_t));
+    r->ready_count = 0;
+    *ready = v;
+  }
+  return err;
+}
@@ -7,43 +7,77 @@
 ---------------------------------------------------------------------------*/
 #include "kklib.h"
 
+/*--------------------------------------------------------------------------------------
+  Atomic path for mutable references
+  A thread-shared reference is read by just loading and dup'ing its value: a writer
+  never drops an overwritten value directly but retires it (`kk_box_shared_retire`),
+  and it is only dropped once every thread that may have read it has committed its
+  dup's. Reads are thus wait-free and do not write to the reference itself.
+--------------------------------------------------------------------------------------*/
 
-// Atomic path for mutable references
-kk_decl_export kk_box_t kk_ref_get_thread_shared(kk_ref_t r, kk_context_t* ctx) {
-  // careful: we cannot first read and then dup the read value as it may be 
-  // overwritten and _dropped_ by another thread in between. To avoid this
-  // situation we first atomically swap with a guard value 0, then dup, and 
-  // write back the old value again.
-again: ;
-  kk_box_t b; 
-  b.box = kk_atomic_load_relaxed(&r->value);
-  do {
-    if (kk_box_is_value(b)) return b;  // optimize: if it is a raw value (that is not heap allocated), we can immediately return
-    if (b.box == 0) { b.box = 1; }     // expect any value but 0
-  } while (!kk_atomic_cas_weak_relaxed(&r->value, &b.box, 0));
-  // we got it, and hold the "locked" reference (`r->value == 0`)
-  kk_box_dup(b);
-  // and release our lock by writing back `b`    
-  uintptr_t guard = 0;
-  while (!kk_atomic_cas_strong_relaxed(&r->value, &guard, b.box)) { 
-    assert(false); 
-    // should never happen! as a last resort, restart the operation
-    kk_box_drop(b,ctx);
-    goto again;
+// Make a value visible to other threads
+static void kk_box_publish(kk_box_t value, kk_context_t* ctx) {
+  if (kk_box_is_non_null_ptr(value)) {
+    kk_block_t* b = kk_ptr_unbox(value);
+    if (!b->header.thread_shared) {
+      kk_block_mark_shared(b, ctx);   // other threads can read it from now on
+    }
+    else {
+      kk_block_shared_commit(b, ctx); // other threads can dup and drop it from now on
+    }
   }
+}
+
+// A context announces its quiescent states (see `refcount.c`) from the first time it reads a
+// thread-shared reference; before that it cannot hold any value that another thread may retire.
+static inline void kk_ref_online(kk_context_t* ctx) {
+  if (kk_unlikely(ctx->shared_epoch == NULL)) kk_shared_online(ctx);
+}
+
+kk_decl_export kk_box_t kk_ref_get_thread_shared(kk_ref_t r, kk_context_t* ctx) {
+  kk_ref_online(ctx);
+  kk_box_t b;
+  b.box = kk_atomic_load_acquire(&r->value);
+  kk_box_dup(b);  // safe: if another thread overwrites `b` it is retired until we flush
   kk_ref_drop(r, ctx);
   return b;
 }
 
 kk_decl_export kk_box_t kk_ref_swap_thread_shared(kk_ref_t r, kk_box_t value, kk_context_t* ctx) {
-  KK_UNUSED(ctx);
-  // atomically swap, but not if guarded with 0 (to not interfere with a `ref_get`)
-  uintptr_t exp = kk_atomic_load_relaxed(&r->value);
-  do {
-    if (exp==0) { exp = 1; }  // any value but 0
-  } while (!kk_atomic_cas_weak_relaxed(&r->value, &exp, value.box));
+  kk_box_publish(value, ctx);
+  kk_box_t old = _kk_box_new(kk_atomic_exchange_acq_rel(&r->value, value.box));
+  kk_box_dup(old);                   // our result,
+  kk_box_shared_retire(old, ctx);    // and the reference that was held by `r`
   kk_ref_drop(r, ctx);
-  return _kk_box_new(exp);
+  return old;
 }
 
+kk_decl_export kk_unit_t kk_ref_set_thread_shared(kk_ref_t r, kk_box_t value, kk_context_t* ctx) {
+  kk_box_publish(value, ctx);
+  kk_box_t old = _kk_box_new(kk_atomic_exchange_acq_rel(&r->value, value.box));
+  kk_box_shared_retire(old, ctx);
+  kk_ref_drop(r, ctx);
+  return kk_Unit;
+}
 
+kk_decl_export kk_unit_t kk_ref_vector_assign_thread_shared(kk_ref_t r, kk_integer_t idx, kk_box_t value, kk_context_t* ctx) {
+  kk_ref_online(ctx);
+  kk_box_t b;
+  b.box = kk_atomic_load_acquire(&r->value);
+  kk_vector_t v = kk_vector_unbox(kk_box_dup(b), ctx);
+  size_t len;
+  kk_box_t* p = kk_vector_buf(v, &len);
+  size_t i = kk_integer_clamp_size_t(idx, ctx);
+  if (i < len) {
+    kk_box_publish(value, ctx);
+    kk_box_t old = _kk_box_new(kk_atomic_exchange_acq_rel((_Atomic(uintptr_t)*)&p[i], value.box));
+    kk_box_shared_retire(old, ctx);
+  }
+  else {
+    // an out-of-bounds assignment is ignored (as in the fast path of `kk_ref_vector_assign`)
+    kk_box_drop(value, ctx);
+  }
+  kk_vector_drop(v, ctx);
+  kk_ref_drop(r, ctx);
+  return kk_Unit;
+}
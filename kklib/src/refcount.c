@@ -7,8 +7,19 @@
 ---------------------------------------------------------------------------*/
 #include "kklib.h"
 
-static void kk_block_drop_free_delayed(kk_context_t* ctx);
 static kk_decl_noinline void kk_block_drop_free_rec(kk_block_t* b, size_t scan_fsize, const size_t depth, kk_context_t* ctx);
+static void block_drop_free_delayed(kk_context_t* ctx);
+static void kk_shared_quiescent(kk_context_t* ctx);
+#if (KK_SHARED_DEFER > 0)
+static void kk_shared_defer(kk_block_t* b, int32_t delta, kk_context_t* ctx);
+static void kk_shared_commit_inc(kk_block_t* b, kk_context_t* ctx);
+static void kk_shared_flush_inc(kk_context_t* ctx);
+#endif
+#if KK_RECLAIM_THREAD
+static bool kk_reclaim_submit(kk_context_t* ctx);
+static void kk_reclaim_back_drop(kk_context_t* ctx);
+static void kk_reclaim_wait(kk_context_t* ctx);
+#endif
 
 static void kk_block_free_raw(kk_block_t* b) {
   kk_assert_internal(kk_tag_is_raw(kk_block_tag(b)));
@@ -21,14 +32,30 @@ static void kk_block_free_raw(kk_block_t* b) {
 // Free a block and recursively decrement reference counts on children.
 static void kk_block_drop_free(kk_block_t* b, kk_context_t* ctx) {
   kk_assert_internal(b->header.refcount == 0);
+  kk_stats_inc(ctx, free);
   const size_t scan_fsize = b->header.scan_fsize;
   if (scan_fsize==0) {
     if (kk_tag_is_raw(kk_block_tag(b))) { kk_block_free_raw(b); }
-    kk_block_free(b); // deallocate directly if nothing to scan
+    kk_block_pool_free(b, ctx); // deallocate directly if nothing to scan
   }
   else {
+#if KK_RECLAIM_THREAD
+    kk_reclaim_back_drop(ctx);                                  // first perform decrements handed back by the reclaimer
+#endif
+    const kk_ssize_t budget = ctx->free_budget;                 // save the budget of a free we are nested in (through a raw `free` function)
+    ctx->free_budget = (KK_FREE_BUDGET > 0 ? KK_FREE_BUDGET : KK_SSIZE_MAX);
     kk_block_drop_free_rec(b, scan_fsize, 0 /* depth */, ctx);  // free recursively
-    kk_block_drop_free_delayed(ctx);     // process delayed frees
+#if KK_RECLAIM_THREAD
+#if (KK_SHARED_DEFER > 0)
+    if (ctx->delayed_free != NULL) kk_shared_flush_inc(ctx);   // the reclaimer decrements shared blocks immediately
+#endif
+    if (ctx->delayed_free != NULL && kk_reclaim_submit(ctx)) {  // hand off the rest to the reclaimer thread
+      ctx->free_budget = budget;
+      return;
+    }
+#endif
+    block_drop_free_delayed(ctx);                               // process delayed frees (within the budget)
+    ctx->free_budget = budget;
   }
 }
 
@@ -48,7 +75,7 @@ static void kk_block_drop_free(kk_block_t* b, kk_context_t* ctx) {
   0x00000001 - 0x7FFFFFFF   : reference (in a single thread)
   0x80000000 - 0xCFFFFFFF   : reference or thread-shared reference (if `kk_thread_shared`). Use atomic operations
   0xD0000000 - 0xDFFFFFFF   : sticky range: still increments, but no decrements
-  0xE0000000 - 0xEFFFFFFF   : sticky range: neither increment, nor decrement
+  0xE0000000 - 0xEFFFFFFF   : sticky range: neither increment, nor decrement (also used for region blocks, `KK_RC_REGION`)
   0xF0000000 - 0xFFFFFFFF   : invalid; used for debug checks
 --------------------------------------------------------------------------------------*/
 
@@ -67,15 +94,22 @@ static inline uint32_t kk_atomic_decr(kk_block_t* b) {
 // Check if a reference decrement caused the block to be free or needs atomic operations
 kk_decl_noinline void kk_block_check_drop(kk_block_t* b, uint32_t rc0, kk_context_t* ctx) {
   kk_assert_internal(b!=NULL);
-  kk_assert_internal(b->header.refcount == rc0);
+  // note: we cannot assert `b->header.refcount == rc0` as a thread-shared block may be updated concurrently
   kk_assert_internal(rc0 == 0 || (rc0 >= RC_SHARED && rc0 < RC_INVALID));
   if (kk_likely(rc0==0)) {
     kk_block_drop_free(b, ctx);  // no more references, free it.
   }
   else if (kk_unlikely(rc0 >= RC_STICKY_LO)) {
     // sticky: do not decrement further
+    kk_stats_inc(ctx, sticky);
   }
+#if (KK_SHARED_DEFER > 0)
+  else if (b->header.thread_shared) {
+    kk_shared_defer(b, -1, ctx);  // decrement later
+  }
+#endif
   else {
+    kk_stats_inc(ctx, drop_atomic);
     const uint32_t rc = kk_atomic_decr(b);
     if (rc == RC_SHARED && b->header.thread_shared) {  // with a shared reference dropping to RC_SHARED means no more references
       b->header.refcount = 0;        // no longer shared
@@ -88,19 +122,21 @@ kk_decl_noinline void kk_block_check_drop(kk_block_t* b, uint32_t rc0, kk_contex
 // Check if a reference decrement caused the block to be reused or needs atomic operations
 kk_decl_noinline kk_reuse_t kk_block_check_drop_reuse(kk_block_t* b, uint32_t rc0, kk_context_t* ctx) {
   kk_assert_internal(b!=NULL);
-  kk_assert_internal(b->header.refcount == rc0);
   kk_assert_internal(rc0 == 0 || (rc0 >= RC_SHARED && rc0 < RC_INVALID));
   if (kk_likely(rc0==0)) {
     // no more references, reuse it.
+    kk_stats_inc(ctx, reuse);
     size_t scan_fsize = kk_block_scan_fsize(b);
     for (size_t i = 0; i < scan_fsize; i++) {
       kk_box_drop(kk_block_field(b, i), ctx);
     }
+    kk_heap_profile_free(b);  // a reused block counts as freed
     memset(&b->header, 0, sizeof(kk_header_t)); // not really necessary
     return b;
   }
   else {
     // may be shared or sticky
+    kk_stats_inc(ctx, reuse_miss);
     kk_block_check_drop(b, rc0, ctx);
     return kk_reuse_null;
   }
@@ -110,20 +146,22 @@ kk_decl_noinline kk_reuse_t kk_block_check_drop_reuse(kk_block_t* b, uint32_t rc
 kk_decl_noinline void kk_block_check_decref(kk_block_t* b, uint32_t rc0, kk_context_t* ctx) {
   KK_UNUSED(ctx);
   kk_assert_internal(b!=NULL);
-  kk_assert_internal(b->header.refcount == rc0);
   kk_assert_internal(rc0 == 0 || (rc0 >= RC_SHARED && rc0 < RC_INVALID));
   if (kk_likely(rc0==0)) {
-    kk_free(b);  // no more references, free it (without dropping children!)
+    kk_block_pool_free(b, ctx);  // no more references, free it (without dropping children!)
   }
   else if (kk_unlikely(rc0 >= RC_STICKY_LO)) {
     // sticky: do not decrement further
   }
   else {
+#if (KK_SHARED_DEFER > 0)
+    kk_shared_commit_inc(b, ctx);  // as we decrement immediately
+#endif
     const uint32_t rc = kk_atomic_decr(b);
     if (rc == RC_SHARED && b->header.thread_shared) {  // with a shared reference dropping to RC_SHARED means no more references
       b->header.refcount = 0;        // no longer shared
       b->header.thread_shared = 0;
-      kk_free(b);               // no more references, free it.
+      kk_block_pool_free(b, ctx);  // no more references, free it.
     }
   }
 }
@@ -131,11 +169,21 @@ kk_decl_noinline void kk_block_check_decref(kk_block_t* b, uint32_t rc0, kk_cont
 
 kk_decl_noinline kk_block_t* kk_block_check_dup(kk_block_t* b, uint32_t rc0) {
   kk_assert_internal(b!=NULL);
-  kk_assert_internal(b->header.refcount == rc0 && rc0 >= RC_SHARED);
+  kk_assert_internal(rc0 >= RC_SHARED);  // (the current refcount may differ from `rc0` if `b` is thread-shared)
   if (kk_likely(rc0 < RC_STICKY_HI)) {
+#if (KK_SHARED_DEFER > 0)
+    if (b->header.thread_shared) {
+      kk_shared_defer(b, 1, kk_get_context());  // increment later
+      return b;
+    }
+#endif
+    kk_stats_inc(kk_get_context(), dup_atomic);
     kk_atomic_incr(b);
   }
   // else sticky: no longer increment (or decrement)
+  else {
+    kk_stats_inc(kk_get_context(), sticky);
+  }
   return b;
 }
 
@@ -164,73 +212,110 @@ static bool block_check_decref_no_free(kk_block_t* b) {
 }
 
 // Decrement a refcount without freeing the block yet. Returns true if there are no more references.
-static bool kk_block_decref_no_free(kk_block_t* b) {
-  uint32_t rc = b->header.refcount;
+static bool kk_block_decref_no_free(kk_block_t* b, kk_context_t* ctx) {
+  uint32_t rc = kk_atomic_load_relaxed((_Atomic(uint32_t)*)&b->header.refcount);  // shared blocks may be decremented concurrently
   if (rc==0) return true;
-  else if (rc >= RC_SHARED) return block_check_decref_no_free(b);
+  else if (rc >= RC_SHARED) {
+#if (KK_SHARED_DEFER > 0)
+    kk_shared_commit_inc(b, ctx);  // as we decrement immediately
+#else
+    KK_UNUSED(ctx);
+#endif
+    return block_check_decref_no_free(b);
+  }
   b->header.refcount = rc - 1;
   return false;
 }
 
-// Push a block on the delayed-free list
-static void kk_block_push_delayed_drop_free(kk_block_t* b, kk_context_t* ctx) {
+// Encode the next pointer of a delayed-free list into the block header (while keeping `scan_fsize` valid)
+static inline void kk_block_delayed_set_next(kk_block_t* b, kk_block_t* next) {
   kk_assert_internal(b->header.refcount == 0);
-  kk_block_t* delayed = ctx->delayed_free;
-  // encode the next pointer into the block header (while keeping `scan_fsize` valid)
-  b->header.refcount = (uint32_t)((kk_uintx_t)delayed);
+  b->header.refcount = (uint32_t)((kk_uintx_t)next);
 #if (KK_INTPTR_SIZE > 4)
-  b->header.tag = (uint16_t)(kk_sar((kk_intx_t)delayed,32));
-  kk_assert_internal(kk_sar((kk_intx_t)delayed,48) == 0 || kk_sar((kk_intx_t)delayed, 48) == -1);
+  b->header.tag = (uint16_t)(kk_sar((kk_intx_t)next,32));
+  kk_assert_internal(kk_sar((kk_intx_t)next,48) == 0 || kk_sar((kk_intx_t)next, 48) == -1);
 #endif
-  ctx->delayed_free = b;
 }
 
-
-// Free all delayed free blocks.
-// TODO: limit to a certain number to limit worst-case free times?
-static void kk_block_drop_free_delayed(kk_context_t* ctx) {
-  kk_block_t* delayed;
-  while ((delayed = ctx->delayed_free) != NULL) {
-    ctx->delayed_free = NULL;
-    do {
-      kk_block_t* b = delayed;
-      // decode the next element in the delayed list from the block header
-      kk_intx_t next = (kk_intx_t)b->header.refcount;
+// Decode the next element in a delayed-free list from the block header
+static inline kk_block_t* kk_block_delayed_next(kk_block_t* b) {
+  kk_intx_t next = (kk_intx_t)b->header.refcount;
 #if (KK_INTPTR_SIZE>4)
-      next += ((kk_intx_t)((int16_t)(b->header.tag)) << 32); // sign extended
+  next += ((kk_intx_t)((int16_t)(b->header.tag)) << 32); // sign extended
 #endif
 #ifndef NDEBUG
-      b->header.refcount = 0;
+  b->header.refcount = 0;
 #endif
-      delayed = (kk_block_t*)next;
-      // and free the block
-      kk_block_drop_free_rec(b, b->header.scan_fsize, 0, ctx);
-    } while (delayed != NULL);
+  return (kk_block_t*)next;
+}
+
+// Push a block on the delayed-free list
+static void kk_block_push_delayed_drop_free(kk_block_t* b, kk_context_t* ctx) {
+  kk_block_delayed_set_next(b, ctx->delayed_free);
+  ctx->delayed_free = b;
+#if KK_STATS
+  if (++ctx->stats.delayed > ctx->stats.delayed_peak) ctx->stats.delayed_peak = ctx->stats.delayed;
+#endif
+}
+
+
+// Free delayed free blocks. At most `budget` blocks are freed (or all if `budget <= 0`)
+// and any remaining blocks stay on the delayed free list. This bounds the worst-case
+// pause time when dropping a large structure; the rest is freed incrementally at
+// allocation (see `kk_block_alloc`) or when calling this function at an idle point.
+static void block_drop_free_delayed(kk_context_t* ctx) {
+  kk_block_t* b;
+  while (ctx->free_budget > 0 && (b = ctx->delayed_free) != NULL) {
+    ctx->delayed_free = kk_block_delayed_next(b);
+#if KK_STATS
+    ctx->stats.delayed--;
+#endif
+    // and free the block (which may push new blocks on the delayed free list)
+    kk_block_drop_free_rec(b, b->header.scan_fsize, 0, ctx);
   }
 }
 
+kk_decl_noinline void kk_block_drop_free_delayed(kk_ssize_t budget, kk_context_t* ctx) {
+#if KK_RECLAIM_THREAD
+  if (budget <= 0) kk_reclaim_wait(ctx);  // wait for the reclaimer thread to finish 
+              else kk_reclaim_back_drop(ctx);
+#endif
+  const kk_ssize_t saved = ctx->free_budget;
+  ctx->free_budget = (budget > 0 ? budget : KK_SSIZE_MAX);
+  kk_trace_begin("free delayed", ctx);
+  block_drop_free_delayed(ctx);
+  kk_trace_end("free delayed", ctx);
+  ctx->free_budget = saved;
+}
+
 #define MAX_RECURSE_DEPTH (100)
 
-// Free recursively a block -- if the recursion becomes too deep, push
-// blocks on the delayed free list to free them later. The delayed free list
-// is encoded in the headers and needs no further space.
+// Free recursively a block -- if the recursion becomes too deep, or if we
+// exceed the free budget, push blocks on the delayed free list to free them later.
+// The delayed free list is encoded in the headers and needs no further space.
 static kk_decl_noinline void kk_block_drop_free_rec(kk_block_t* b, size_t scan_fsize, const size_t depth, kk_context_t* ctx) {
   while(true) {
     kk_assert_internal(b->header.refcount == 0);
     if (scan_fsize == 0) {
       // nothing to scan, just free
       if (kk_tag_is_raw(kk_block_tag(b))) kk_block_free_raw(b); // potentially call custom `free` function on the data
-      kk_block_free(b);
+      kk_block_pool_free(b, ctx);
+      return;
+    }
+    else if (kk_unlikely(ctx->free_budget <= 0)) {
+      // exceeded the free budget, push this block onto the todo list
+      kk_block_push_delayed_drop_free(b, ctx);
       return;
     }
-    else if (scan_fsize == 1) {
+    ctx->free_budget--;
+    if (scan_fsize == 1) {
       // if just one field, we can recursively free without using stack space
       const kk_box_t v = kk_block_field(b, 0);
-      kk_block_free(b);
+      kk_block_pool_free(b, ctx);
       if (kk_box_is_non_null_ptr(v)) {
         // try to free the child now
         b = kk_ptr_unbox(v);
-        if (kk_block_decref_no_free(b)) {
+        if (kk_block_decref_no_free(b, ctx)) {
           // continue freeing on this block
           scan_fsize = b->header.scan_fsize;
           continue; // tailcall
@@ -251,17 +336,17 @@ static kk_decl_noinline void kk_block_drop_free_rec(kk_block_t* b, size_t scan_f
           kk_box_t v = kk_block_field(b, i);
           if (kk_box_is_non_null_ptr(v)) {
             kk_block_t* vb = kk_ptr_unbox(v);
-            if (kk_block_decref_no_free(vb)) {
+            if (kk_block_decref_no_free(vb, ctx)) {
               kk_block_drop_free_rec(vb, vb->header.scan_fsize, depth+1, ctx); // recurse with increased depth
             }
           }
         }
         // and recurse into the last one
         kk_box_t v = kk_block_field(b,scan_fsize - 1);
-        kk_block_free(b);
+        kk_block_pool_free(b, ctx);
         if (kk_box_is_non_null_ptr(v)) {
           b = kk_ptr_unbox(v);
-          if (kk_block_decref_no_free(b)) {
+          if (kk_block_decref_no_free(b, ctx)) {
             scan_fsize = b->header.scan_fsize;
             continue; // tailcall
           }
@@ -277,3 +362,602 @@ static kk_decl_noinline void kk_block_drop_free_rec(kk_block_t* b, size_t scan_f
   }
 }
 
+
+
+/*--------------------------------------------------------------------------------------
+  Thread sharing
+  Before a value is published to another thread, it and everything reachable from it
+  have to use atomic reference counts. We mark all reachable blocks as `thread_shared`
+  and move their reference count into the shared range (above `RC_SHARED`).
+  Already shared blocks are skipped: their children are shared already. We use an
+  explicit stack to avoid deep recursion on large structures.
+--------------------------------------------------------------------------------------*/
+
+#define MARK_STACK_INLINE (64)
+
+void kk_block_mark_shared(kk_block_t* b, kk_context_t* ctx) {
+  kk_block_shared_flush(ctx);  // other threads may dup any already shared blocks from now on
+  kk_block_t*  stack_inline[MARK_STACK_INLINE];
+  kk_block_t** stack = stack_inline;
+  size_t size = MARK_STACK_INLINE;
+  size_t count = 0;
+  while (true) {
+    if (!b->header.thread_shared) {
+      const uint32_t rc = b->header.refcount;
+      b->header.thread_shared = 1;
+      if (rc < RC_SHARED) {
+        b->header.refcount = (rc >= RC_STICKY_LO - RC_SHARED ? RC_STICKY_LO : rc + RC_SHARED);
+      }
+      // else: already sticky (or a region block), just mark
+      // and push all children that are not yet shared
+      size_t i = 0;
+      size_t scan_fsize = b->header.scan_fsize;
+      if (kk_unlikely(scan_fsize >= KK_SCAN_FSIZE_MAX)) {
+        scan_fsize = kk_enum_unbox(kk_block_field(b, 0));
+        i++;
+      }
+      for (; i < scan_fsize; i++) {
+        kk_box_t v = kk_block_field(b, i);
+        if (!kk_box_is_non_null_ptr(v)) continue;
+        kk_block_t* child = kk_ptr_unbox(v);
+        if (child->header.thread_shared) continue;
+        if (count >= size) {
+          size_t newsize = 2*size;
+          kk_block_t** newstack = (kk_block_t**)kk_malloc(newsize * sizeof(kk_block_t*), ctx);
+          if (newstack == NULL) kk_fatal_error(ENOMEM, "unable to mark a value as thread shared");
+          memcpy(newstack, stack, count * sizeof(kk_block_t*));
+          if (stack != stack_inline) kk_free(stack);
+          stack = newstack;
+          size = newsize;
+        }
+        stack[count++] = child;
+      }
+    }
+    if (count == 0) break;
+    b = stack[--count];
+  }
+  if (stack != stack_inline) kk_free(stack);
+}
+
+void kk_box_mark_shared(kk_box_t b, kk_context_t* ctx) {
+  if (kk_box_is_non_null_ptr(b)) {
+    kk_block_mark_shared(kk_ptr_unbox(b), ctx);
+  }
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Deferred reference counting of thread-shared blocks
+  Atomic increments and decrements of a shared block from many threads contend on
+  the same cache line. Instead, each context accumulates the dup's and drop's of
+  shared blocks as a delta in a small direct-mapped table, and applies a delta
+  atomically only when its entry is evicted or the table is flushed. Dup/drop pairs
+  within a thread (like traversing a shared read-only structure) thus never touch the
+  shared reference count at all.
+  This is safe as long as a thread never hands out a reference whose increment is
+  still pending: deferring decrements only delays freeing, and each thread only drops
+  references it holds. So we flush before publishing a value (`kk_block_mark_shared`),
+  and commit a dup of a reference that another thread may drop concurrently (like
+  reading a thread-shared `ref` or a task result). We also flush every
+  `KK_SHARED_FLUSH` operations and at idle points, so freeing is not delayed too long.
+--------------------------------------------------------------------------------------*/
+
+#if (KK_SHARED_DEFER > 0)
+#define KK_SHARED_FLUSH  (4096)
+
+// Apply a reference count delta to a shared block
+static void kk_shared_apply(kk_block_t* b, int32_t delta, kk_context_t* ctx) {
+  _Atomic(uint32_t)* rc = (_Atomic(uint32_t)*)&b->header.refcount;
+  if (delta > 0) {
+    kk_stats_inc(ctx, dup_atomic);
+    const uint32_t rc0 = kk_atomic_add32_relaxed(rc, (uint32_t)delta);
+    if (kk_unlikely(rc0 >= RC_STICKY_HI)) {
+      kk_atomic_sub32_relaxed(rc, (uint32_t)delta);  // sticky: undo
+    }
+  }
+  else if (delta < 0) {
+    kk_stats_inc(ctx, drop_atomic);
+    const uint32_t n = (uint32_t)(-delta);
+    const uint32_t rc0 = kk_atomic_sub32_relaxed(rc, n);
+    if (rc0 == RC_SHARED + n - 1) {
+      // that were all the remaining references
+      b->header.refcount = 0;
+      b->header.thread_shared = 0;
+      kk_block_drop_free(b, ctx);
+    }
+    else if (kk_unlikely(rc0 >= RC_STICKY_LO)) {
+      kk_atomic_add32_relaxed(rc, n);  // sticky: undo
+    }
+  }
+}
+
+static inline size_t kk_shared_index(kk_block_t* b) {
+  return (((uintptr_t)b >> 4) ^ ((uintptr_t)b >> 12)) & (KK_SHARED_DEFER - 1);
+}
+
+static void kk_shared_defer(kk_block_t* b, int32_t delta, kk_context_t* ctx) {
+  kk_shared_delta_t* e = &ctx->shared_deltas[kk_shared_index(b)];
+  if (kk_likely(e->block == b)) {
+    e->delta += delta;
+    if (e->delta == 0) e->block = NULL;
+  }
+  else {
+    const kk_shared_delta_t evict = *e;
+    e->block = b;
+    e->delta = delta;
+    if (evict.block != NULL) {
+      // a decrement may free the block and drop its children, so first apply the increments we
+      // may still have pending on those (as in `kk_block_shared_flush`)
+      if (evict.delta < 0) kk_shared_flush_inc(ctx);
+      kk_shared_apply(evict.block, evict.delta, ctx);  // may re-enter
+    }
+  }
+  if (kk_unlikely(++ctx->shared_ops >= KK_SHARED_FLUSH)) {
+    kk_block_shared_flush(ctx);
+  }
+}
+
+// Apply all pending increments: these cannot free and afterwards no reference is uncounted
+static void kk_shared_flush_inc(kk_context_t* ctx) {
+  for (size_t i = 0; i < KK_SHARED_DEFER; i++) {
+    kk_shared_delta_t* e = &ctx->shared_deltas[i];
+    if (e->block != NULL && e->delta > 0) {
+      kk_shared_apply(e->block, e->delta, ctx);
+      e->block = NULL;
+    }
+  }
+}
+
+// Apply a pending increment of `b` (before decrementing it immediately)
+static void kk_shared_commit_inc(kk_block_t* b, kk_context_t* ctx) {
+  kk_shared_delta_t* e = &ctx->shared_deltas[kk_shared_index(b)];
+  if (e->block == b && e->delta > 0) {
+    e->block = NULL;
+    kk_shared_apply(b, e->delta, ctx);
+  }
+}
+
+void kk_block_shared_flush(kk_context_t* ctx) {
+  ctx->shared_ops = 0;
+  kk_shared_flush_inc(ctx);
+  // and then the decrements; freeing may defer new decrements which are applied later
+  for (size_t i = 0; i < KK_SHARED_DEFER; i++) {
+    kk_shared_delta_t* e = &ctx->shared_deltas[i];
+    if (e->block != NULL) {
+      const kk_shared_delta_t d = *e;
+      e->block = NULL;
+      kk_shared_apply(d.block, d.delta, ctx);  // may re-enter
+    }
+  }
+  kk_shared_quiescent(ctx);  // all our references are counted now
+}
+
+void kk_block_shared_commit(kk_block_t* b, kk_context_t* ctx) {
+  kk_shared_delta_t* e = &ctx->shared_deltas[kk_shared_index(b)];
+  if (e->block == b) {
+    const int32_t delta = e->delta;
+    e->block = NULL;
+    if (delta < 0) kk_shared_flush_inc(ctx);  // as the decrement may free `b`
+    kk_shared_apply(b, delta, ctx);
+  }
+}
+
+#else
+
+void kk_block_shared_flush(kk_context_t* ctx) {
+  kk_shared_quiescent(ctx);
+}
+
+void kk_block_shared_commit(kk_block_t* b, kk_context_t* ctx) {
+  KK_UNUSED(b); KK_UNUSED(ctx);
+}
+
+#endif
+
+void kk_box_shared_commit(kk_box_t b, kk_context_t* ctx) {
+  if (kk_box_is_non_null_ptr(b)) {
+    kk_block_shared_commit(kk_ptr_unbox(b), ctx);
+  }
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Reclamation of thread-shared references
+  A thread reads a thread-shared `ref` (or vector element) by just loading the value and
+  dup'ing it, where the increment is usually deferred as well. Meanwhile, another thread
+  may overwrite the value and drop it. So an overwritten value is _retired_ instead, and
+  only dropped once every thread passed a quiescent state, where all the references it
+  holds are counted. We use quiescent-state based reclamation (McKenney and Slingwine,
+  "Read-copy update", PDCS'98): a thread is quiescent when it flushes its pending
+  reference counts (`kk_block_shared_flush`), and announces the global epoch in its
+  epoch record at that point. A value retired in epoch `e` is dropped once every thread
+  that is online announced a later epoch. Reads thus never write to shared memory. A
+  thread that runs for a long time without flushing delays reclamation (but no thread
+  ever waits for it). Idle workers go offline and do not delay reclamation.
+--------------------------------------------------------------------------------------*/
+
+#define KK_EPOCH_OFFLINE  (UINTPTR_MAX)
+#define KK_RETIRED_INIT   (64)
+
+typedef struct kk_shared_epoch_s {
+  _Atomic(uintptr_t)         epoch;      // last announced epoch, or `KK_EPOCH_OFFLINE`
+  _Atomic(uintptr_t)         in_use;     // claimed by a context?
+  struct kk_shared_epoch_s*  next;       // all records are in a list and never freed
+  uint8_t                    padding[64];  // avoid false sharing with the records of other threads
+} kk_shared_epoch_t;
+
+typedef struct kk_shared_retired_entry_s {
+  kk_block_t*  block;
+  uintptr_t    epoch;       // retired at this epoch
+} kk_shared_retired_entry_t;
+
+typedef struct kk_shared_retired_s {
+  struct kk_shared_retired_s* next; // in the orphan list
+  size_t                      count;
+  size_t                      size;
+  bool                        reclaiming;
+  kk_shared_retired_entry_t   entries[1];
+} kk_shared_retired_t;
+
+static _Atomic(uintptr_t) shared_epoch_global = ATOMIC_VAR_INIT(1);
+static _Atomic(uintptr_t) shared_epochs;   // list of `kk_shared_epoch_t*`
+static _Atomic(uintptr_t) shared_orphans;  // list of `kk_shared_retired_t*` left by contexts that went offline
+
+static kk_shared_epoch_t* kk_shared_epoch_claim(void) {
+  // reuse a released record
+  for (kk_shared_epoch_t* rec = (kk_shared_epoch_t*)kk_atomic_load_acquire(&shared_epochs); rec != NULL; rec = rec->next) {
+    uintptr_t expected = 0;
+    if (kk_atomic_load_relaxed(&rec->in_use) == 0 && kk_atomic_cas_strong_acq_rel(&rec->in_use, &expected, 1)) return rec;
+  }
+  // or allocate a new one
+  kk_shared_epoch_t* rec = (kk_shared_epoch_t*)calloc(1, sizeof(kk_shared_epoch_t));
+  if (rec == NULL) kk_fatal_error(ENOMEM, "unable to allocate an epoch record");
+  kk_atomic_store_relaxed(&rec->epoch, KK_EPOCH_OFFLINE);
+  kk_atomic_store_relaxed(&rec->in_use, 1);
+  uintptr_t head = kk_atomic_load_relaxed(&shared_epochs);
+  do {
+    rec->next = (kk_shared_epoch_t*)head;
+  } while (!kk_atomic_cas_weak_acq_rel(&shared_epochs, &head, (uintptr_t)rec));
+  return rec;
+}
+
+// The minimal epoch announced by any online thread
+static uintptr_t kk_shared_epoch_min(void) {
+  kk_atomic_fence_seq_cst();  // order after our retire (and pairs with the fence in `kk_shared_online`)
+  uintptr_t min = KK_EPOCH_OFFLINE;
+  for (kk_shared_epoch_t* rec = (kk_shared_epoch_t*)kk_atomic_load_acquire(&shared_epochs); rec != NULL; rec = rec->next) {
+    const uintptr_t e = kk_atomic_load_acquire(&rec->epoch);
+    if (e < min) min = e;
+  }
+  return min;
+}
+
+void kk_shared_online(kk_context_t* ctx) {
+  if (ctx->shared_epoch == NULL) ctx->shared_epoch = kk_shared_epoch_claim();
+  kk_shared_epoch_t* rec = ctx->shared_epoch;
+  if (kk_atomic_load_relaxed(&rec->epoch) != KK_EPOCH_OFFLINE) return;
+  // announce an epoch that is still current: a thread that retires a value afterwards either
+  // sees our announcement, or incremented the epoch before we read any thread-shared value
+  uintptr_t epoch = kk_atomic_load_acquire(&shared_epoch_global);
+  while (true) {
+    kk_atomic_store_relaxed(&rec->epoch, epoch);
+    kk_atomic_fence_seq_cst();
+    const uintptr_t current = kk_atomic_load_acquire(&shared_epoch_global);
+    if (current == epoch) break;
+    epoch = current;
+  }
+}
+
+static kk_shared_retired_t* kk_shared_retired_alloc(size_t size, kk_context_t* ctx) {
+  kk_shared_retired_t* r = (kk_shared_retired_t*)kk_malloc(sizeof(kk_shared_retired_t) + (size - 1)*sizeof(kk_shared_retired_entry_t), ctx);
+  if (r == NULL) kk_fatal_error(ENOMEM, "unable to retire a thread-shared reference");
+  r->next = NULL;
+  r->count = 0;
+  r->size = size;
+  r->reclaiming = false;
+  return r;
+}
+
+static void kk_shared_retired_push(kk_block_t* b, uintptr_t epoch, kk_context_t* ctx) {
+  kk_shared_retired_t* r = ctx->shared_retired;
+  if (r == NULL) {
+    r = ctx->shared_retired = kk_shared_retired_alloc(KK_RETIRED_INIT, ctx);
+  }
+  else if (r->count >= r->size) {
+    r->size *= 2;
+    r = ctx->shared_retired = (kk_shared_retired_t*)kk_realloc(r, sizeof(kk_shared_retired_t) + (r->size - 1)*sizeof(kk_shared_retired_entry_t), ctx);
+    if (r == NULL) kk_fatal_error(ENOMEM, "unable to retire a thread-shared reference");
+  }
+  r->entries[r->count].block = b;
+  r->entries[r->count].epoch = epoch;
+  r->count++;
+}
+
+void kk_box_shared_retire(kk_box_t b, kk_context_t* ctx) {
+  if (!kk_box_is_non_null_ptr(b)) return;
+  kk_block_t* block = kk_ptr_unbox(b);
+  if (!block->header.thread_shared) {
+    kk_block_drop(block, ctx);  // no other thread can read it
+    return;
+  }
+  if (kk_unlikely(ctx->shared_epoch == NULL)) kk_shared_online(ctx);  // a context goes online lazily
+  const uintptr_t epoch = kk_atomic(fetch_add_explicit)(&shared_epoch_global, 1, kk_memory_order(acq_rel));
+  kk_shared_retired_push(block, epoch, ctx);
+  kk_shared_retired_t* r = ctx->shared_retired;
+  if (r->count >= r->size / 2 && !r->reclaiming) {
+    kk_block_shared_flush(ctx);  // become quiescent ourselves, and reclaim
+  }
+}
+
+// Go offline: flush, and hand any retired references that cannot be dropped yet to the other threads
+void kk_shared_offline(kk_context_t* ctx) {
+  kk_block_shared_flush(ctx);
+  kk_shared_epoch_t* rec = ctx->shared_epoch;
+  if (rec == NULL) return;
+  kk_atomic_store_release(&rec->epoch, KK_EPOCH_OFFLINE);
+  kk_shared_retired_t* r = ctx->shared_retired;
+  if (r != NULL && r->count > 0) {
+    ctx->shared_retired = NULL;
+    uintptr_t head = kk_atomic_load_relaxed(&shared_orphans);
+    do {
+      r->next = (kk_shared_retired_t*)head;
+    } while (!kk_atomic_cas_weak_acq_rel(&shared_orphans, &head, (uintptr_t)r));
+  }
+}
+
+// Release the epoch record of a context that is freed
+void kk_shared_release(kk_context_t* ctx) {
+  kk_shared_offline(ctx);
+  if (ctx->shared_retired != NULL) {
+    kk_free(ctx->shared_retired);
+    ctx->shared_retired = NULL;
+  }
+  if (ctx->shared_epoch != NULL) {
+    kk_atomic_store_release(&ctx->shared_epoch->in_use, 0);
+    ctx->shared_epoch = NULL;
+  }
+}
+
+// Adopt the retired references of threads that went offline
+static void kk_shared_adopt_orphans(kk_context_t* ctx) {
+  kk_shared_retired_t* orphan = (kk_shared_retired_t*)kk_atomic(exchange_explicit)(&shared_orphans, 0, kk_memory_order(acq_rel));
+  while (orphan != NULL) {
+    kk_shared_retired_t* next = orphan->next;
+    for (size_t i = 0; i < orphan->count; i++) {
+      kk_shared_retired_push(orphan->entries[i].block, orphan->entries[i].epoch, ctx);
+    }
+    kk_free(orphan);
+    orphan = next;
+  }
+}
+
+// Drop the retired references that no other thread can read anymore
+static void kk_shared_reclaim(kk_context_t* ctx) {
+  if (ctx->shared_retired != NULL && ctx->shared_retired->reclaiming) return;
+  if (kk_unlikely(kk_atomic_load_relaxed(&shared_orphans) != 0)) kk_shared_adopt_orphans(ctx);
+  kk_shared_retired_t* r = ctx->shared_retired;
+  if (r == NULL || r->count == 0) return;
+  const uintptr_t min = kk_shared_epoch_min();
+  r->reclaiming = true;  // as dropping may flush again
+  size_t j = 0;
+  for (size_t i = 0; i < r->count; i++) {
+    kk_shared_retired_entry_t e = r->entries[i];
+    if (e.epoch < min) {
+      kk_block_drop(e.block, ctx);
+    }
+    else {
+      r->entries[j++] = e;
+    }
+  }
+  r->count = j;
+  r->reclaiming = false;
+}
+
+// Called when all references held by this thread are counted
+static void kk_shared_quiescent(kk_context_t* ctx) {
+  kk_shared_epoch_t* rec = ctx->shared_epoch;
+  if (rec == NULL) return;
+  if (kk_atomic_load_relaxed(&rec->epoch) != KK_EPOCH_OFFLINE) {
+    kk_atomic_store_release(&rec->epoch, kk_atomic_load_acquire(&shared_epoch_global));
+  }
+  kk_shared_reclaim(ctx);
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Block pool
+--------------------------------------------------------------------------------------*/
+
+// Release all pooled blocks back to the allocator
+void kk_block_pool_collect(kk_context_t* ctx) {
+#if (KK_BLOCK_POOL_MAX > 0)
+  for (size_t i = 0; i <= KK_BLOCK_POOL_MAX_WORDS; i++) {
+    kk_block_t* b = ctx->pool.free[i];
+    while (b != NULL) {
+      kk_block_t* next = *((kk_block_t**)b);
+      kk_free(b);
+      b = next;
+    }
+    ctx->pool.free[i] = NULL;
+    ctx->pool.count[i] = 0;
+  }
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Background reclamation (if `KK_RECLAIM_THREAD` is enabled)
+  Instead of freeing the remaining delayed free list on the mutator thread, we hand
+  the (header encoded) chain off to a process wide reclaimer thread. All blocks in the
+  chain have no more references and are thus owned exclusively by the reclaimer.
+  The same holds for any child with a zero reference count, and those are freed by the
+  reclaimer as well. Children with a thread-shared reference count are decremented
+  atomically. Any other child may still be referenced by the mutator, and such
+  decrements are handed back to the owning context which performs them at its next
+  drop (or at `kk_main_end`).
+--------------------------------------------------------------------------------------*/
+#if KK_RECLAIM_THREAD
+#include <pthread.h>
+
+typedef struct reclaim_job_s {
+  struct reclaim_job_s* next;
+  kk_block_t*           chain;    // header encoded chain of blocks to free
+  kk_context_t*         ctx;      // owning context
+} reclaim_job_t;
+
+#define RECLAIM_BACK_MAX (1020)
+
+// Decrements handed back to the owning context (in `ctx->reclaim_back`)
+typedef struct reclaim_back_s {
+  struct reclaim_back_s* next;
+  size_t                 count;
+  kk_block_t*            blocks[RECLAIM_BACK_MAX];
+} reclaim_back_t;
+
+static pthread_mutex_t reclaim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  reclaim_available = PTHREAD_COND_INITIALIZER;  // signaled when a job is submitted
+static pthread_cond_t  reclaim_idle = PTHREAD_COND_INITIALIZER;       // signaled when all jobs are done
+static reclaim_job_t*  reclaim_jobs;    // submitted jobs
+static size_t          reclaim_busy;    // count of submitted jobs that are not yet done
+static bool            reclaim_started;
+
+static void reclaim_back_publish(reclaim_back_t* back, kk_context_t* ctx) {
+  uintptr_t head = kk_atomic_load_relaxed(&ctx->reclaim_back);
+  do {
+    back->next = (reclaim_back_t*)head;
+  } while (!kk_atomic_cas_weak_acq_rel(&ctx->reclaim_back, &head, (uintptr_t)back));
+}
+
+static reclaim_back_t* reclaim_back_push(reclaim_back_t* back, kk_block_t* b, kk_context_t* ctx) {
+  if (back != NULL && back->count >= RECLAIM_BACK_MAX) {
+    reclaim_back_publish(back, ctx);
+    back = NULL;
+  }
+  if (back == NULL) {
+    back = (reclaim_back_t*)malloc(sizeof(reclaim_back_t));  // note: we cannot use the heap of `ctx` on this thread
+    if (back == NULL) kk_fatal_error(ENOMEM, "unable to allocate memory for the reclaimer thread");
+    back->count = 0;
+  }
+  back->blocks[back->count++] = b;
+  return back;
+}
+
+// Free all blocks in a chain; this runs on the reclaimer thread
+static void reclaim_chain(kk_block_t* todo, kk_context_t* ctx) {
+  reclaim_back_t* back = NULL;
+  while (todo != NULL) {
+    kk_block_t* b = todo;
+    todo = kk_block_delayed_next(b);
+    size_t scan_fsize = b->header.scan_fsize;
+    size_t i = 0;
+    if (kk_unlikely(scan_fsize >= KK_SCAN_FSIZE_MAX)) {
+      scan_fsize = kk_enum_unbox(kk_block_field(b, 0));
+      i++;
+    }
+    for (; i < scan_fsize; i++) {
+      kk_box_t v = kk_block_field(b, i);
+      if (!kk_box_is_non_null_ptr(v)) continue;
+      kk_block_t* vb = kk_ptr_unbox(v);
+      const uint32_t rc = kk_atomic_load_relaxed((_Atomic(uint32_t)*)&vb->header.refcount);
+      if (rc == 0 || (rc >= RC_SHARED && block_check_decref_no_free(vb))) {
+        // no more references: we own it exclusively
+        if (vb->header.scan_fsize == 0) {
+          if (kk_tag_is_raw(kk_block_tag(vb))) kk_block_free_raw(vb);
+          kk_block_free(vb);
+        }
+        else {
+          kk_block_delayed_set_next(vb, todo);
+          todo = vb;
+        }
+      }
+      else if (rc < RC_SHARED) {
+        // may still be referenced from the mutator thread: hand back the decrement
+        back = reclaim_back_push(back, vb, ctx);
+      }
+    }
+    kk_block_free(b);
+  }
+  if (back != NULL) {
+    reclaim_back_publish(back, ctx);
+  }
+}
+
+static void* reclaim_thread(void* arg) {
+  KK_UNUSED(arg);
+  pthread_mutex_lock(&reclaim_lock);
+  while (true) {
+    while (reclaim_jobs == NULL) {
+      pthread_cond_wait(&reclaim_available, &reclaim_lock);
+    }
+    reclaim_job_t* job = reclaim_jobs;
+    reclaim_jobs = job->next;
+    pthread_mutex_unlock(&reclaim_lock);
+    reclaim_chain(job->chain, job->ctx);
+    free(job);
+    pthread_mutex_lock(&reclaim_lock);
+    reclaim_busy--;
+    if (reclaim_busy == 0) pthread_cond_broadcast(&reclaim_idle);
+  }
+  return NULL;
+}
+
+// Hand off the delayed free list to the reclaimer thread. Returns `false` if this failed.
+static bool kk_reclaim_submit(kk_context_t* ctx) {
+  reclaim_job_t* job = (reclaim_job_t*)malloc(sizeof(reclaim_job_t));
+  if (job == NULL) return false;
+  pthread_mutex_lock(&reclaim_lock);
+  if (!reclaim_started) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &reclaim_thread, NULL) != 0) {
+      pthread_mutex_unlock(&reclaim_lock);
+      free(job);
+      return false;
+    }
+    pthread_detach(thread);
+    reclaim_started = true;
+  }
+  job->chain = ctx->delayed_free;
+  job->ctx = ctx;
+#if KK_STATS
+  ctx->stats.delayed = 0;
+#endif
+  job->next = reclaim_jobs;
+  reclaim_jobs = job;
+  reclaim_busy++;
+  ctx->delayed_free = NULL;
+  pthread_cond_signal(&reclaim_available);
+  pthread_mutex_unlock(&reclaim_lock);
+  return true;
+}
+
+// Perform the decrements handed back by the reclaimer thread
+static void kk_reclaim_back_drop(kk_context_t* ctx) {
+  if (kk_likely(kk_atomic_load_relaxed(&ctx->reclaim_back) == 0)) return;
+  uintptr_t head = kk_atomic_load_relaxed(&ctx->reclaim_back);
+  while (!kk_atomic_cas_weak_acq_rel(&ctx->reclaim_back, &head, 0)) { };
+  reclaim_back_t* back = (reclaim_back_t*)head;
+  while (back != NULL) {
+    for (size_t i = 0; i < back->count; i++) {
+      kk_block_drop(back->blocks[i], ctx);
+    }
+    reclaim_back_t* next = back->next;
+    free(back);
+    back = next;
+  }
+}
+
+// Wait until the reclaimer thread is idle and all handed back decrements are done
+static void kk_reclaim_wait(kk_context_t* ctx) {
+  while (true) {
+    pthread_mutex_lock(&reclaim_lock);
+    while (reclaim_busy > 0) {
+      pthread_cond_wait(&reclaim_idle, &reclaim_lock);
+    }
+    pthread_mutex_unlock(&reclaim_lock);
+    if (kk_atomic_load_relaxed(&ctx->reclaim_back) == 0) return;
+    kk_reclaim_back_drop(ctx);   // this may submit new jobs
+  }
+}
+#endif
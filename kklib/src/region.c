@@ -0,0 +1,218 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Regions (see also `kklib.h`)
+  A region is a list of chunks in which blocks are bump allocated. Each block is preceded
+  by a `kk_region_prefix_t` with its size so we can walk all blocks in a chunk.
+  Region blocks own their children just like heap blocks; since region blocks are
+  never dropped individually, we drop their (non-region) children when the region
+  is released.
+  When exiting a region scope the result is copied out into the enclosing region (or
+  the heap), iteratively and with forwarding pointers to preserve sharing.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_REGION_CHUNK_SIZE  (64*1024)
+
+typedef struct kk_region_chunk_s {
+  struct kk_region_chunk_s* next;
+  size_t                    used;     // used bytes in `data`
+  size_t                    size;     // available bytes in `data`
+  kk_box_t                  data[1];  // ensure alignment
+} kk_region_chunk_t;
+
+typedef struct kk_region_s {
+  struct kk_region_s*       parent;   // enclosing region scope (or NULL)
+  kk_region_chunk_t*        chunks;   // the first chunk is the current allocation chunk
+} kk_region_t;
+
+typedef struct kk_region_prefix_s {
+  kk_region_t*  region;               // owning region
+  kk_block_t*   forward;              // copy of the block if it was copied out (or NULL)
+  size_t        size;                 // size of the block in bytes
+} kk_region_prefix_t;
+
+static inline kk_region_prefix_t* kk_region_prefix(kk_block_t* b) {
+  return ((kk_region_prefix_t*)b) - 1;
+}
+
+// Is `b` a block allocated in region `r`?
+static inline bool kk_block_in_region(kk_block_t* b, kk_region_t* r) {
+  return (b->header.refcount == KK_RC_REGION && kk_region_prefix(b)->region == r);
+}
+
+// Index of the first scanned field (skipping the `large_scan_fsize` field of large blocks)
+static inline size_t kk_region_first_field(kk_block_t* b) {
+  return (b->header.scan_fsize == KK_SCAN_FSIZE_MAX ? 1 : 0);
+}
+
+static kk_region_chunk_t* kk_region_chunk_alloc(size_t size, kk_region_chunk_t* next, kk_context_t* ctx) {
+  kk_region_chunk_t* chunk = (kk_region_chunk_t*)kk_malloc(sizeof(kk_region_chunk_t) - sizeof(kk_box_t) + size, ctx);
+  if (chunk == NULL) kk_fatal_error(ENOMEM, "unable to allocate a region chunk");
+  chunk->next = next;
+  chunk->used = 0;
+  chunk->size = size;
+  return chunk;
+}
+
+static void* kk_region_malloc(kk_region_t* r, size_t size, kk_context_t* ctx) {
+  const size_t bsize = KK_INTPTR_ALIGNUP(size);
+  const size_t needed = sizeof(kk_region_prefix_t) + bsize;
+  kk_region_chunk_t* chunk = r->chunks;
+  if (chunk == NULL || chunk->size - chunk->used < needed) {
+    if (needed > KK_REGION_CHUNK_SIZE/4) {
+      // large block: allocate a separate chunk after the current one
+      kk_region_chunk_t* large = kk_region_chunk_alloc(needed, (chunk == NULL ? NULL : chunk->next), ctx);
+      if (chunk == NULL) { r->chunks = large; }
+                    else { chunk->next = large; }
+      chunk = large;
+    }
+    else {
+      chunk = r->chunks = kk_region_chunk_alloc(KK_REGION_CHUNK_SIZE, r->chunks, ctx);
+    }
+  }
+  kk_region_prefix_t* prefix = (kk_region_prefix_t*)((uint8_t*)chunk->data + chunk->used);
+  chunk->used += needed;
+  prefix->region = r;
+  prefix->forward = NULL;
+  prefix->size = size;
+  return (prefix + 1);
+}
+
+kk_block_t* kk_region_alloc(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
+  kk_block_t* b = (kk_block_t*)kk_region_malloc(ctx->region, size, ctx);
+  kk_block_init(b, size, scan_fsize, tag);
+  b->header.refcount = KK_RC_REGION;
+  return b;
+}
+
+kk_block_large_t* kk_region_large_alloc(size_t size, size_t scan_fsize, kk_tag_t tag, kk_context_t* ctx) {
+  kk_block_large_t* b = (kk_block_large_t*)kk_region_malloc(ctx->region, size, ctx);
+  kk_block_large_init(b, size, scan_fsize, tag);
+  b->_block.header.refcount = KK_RC_REGION;
+  return b;
+}
+
+void kk_region_enter(kk_context_t* ctx) {
+  kk_region_t* r = (kk_region_t*)kk_malloc(sizeof(kk_region_t), ctx);
+  if (r == NULL) kk_fatal_error(ENOMEM, "unable to allocate a region");
+  r->parent = ctx->region;
+  r->chunks = NULL;
+  ctx->region = r;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Copy out
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_region_todo_s {
+  kk_block_t**  blocks;
+  size_t        count;
+  size_t        size;
+} kk_region_todo_t;
+
+static void kk_region_todo_push(kk_region_todo_t* todo, kk_block_t* b, kk_context_t* ctx) {
+  if (todo->count >= todo->size) {
+    const size_t newsize = (todo->size == 0 ? 64 : 2*todo->size);
+    kk_block_t** blocks = (kk_block_t**)kk_realloc(todo->blocks, newsize * sizeof(kk_block_t*), ctx);
+    if (blocks == NULL) kk_fatal_error(ENOMEM, "unable to copy a value out of a region");
+    todo->blocks = blocks;
+    todo->size = newsize;
+  }
+  todo->blocks[todo->count++] = b;
+}
+
+// Copy a block of region `r` into the current region (or heap); the fields are fixed up later.
+static kk_block_t* kk_region_copy_block(kk_block_t* b, kk_region_todo_t* todo, kk_context_t* ctx) {
+  kk_region_prefix_t* prefix = kk_region_prefix(b);
+  if (prefix->forward != NULL) return kk_block_dup(prefix->forward);
+  kk_block_t* c;
+  if (ctx->region != NULL) {
+    c = (kk_block_t*)kk_region_malloc(ctx->region, prefix->size, ctx);
+    memcpy(c, b, prefix->size);
+  }
+  else {
+    c = (kk_block_t*)kk_malloc(prefix->size, ctx);
+    memcpy(c, b, prefix->size);
+    c->header.refcount = 0;
+  }
+  prefix->forward = c;
+  kk_region_todo_push(todo, c, ctx);
+  return c;
+}
+
+static kk_box_t kk_region_copy_out(kk_box_t v, kk_region_t* r, kk_context_t* ctx) {
+  if (!kk_box_is_non_null_ptr(v) || !kk_block_in_region(kk_ptr_unbox(v), r)) return v;
+  kk_region_todo_t todo = { NULL, 0, 0 };
+  kk_block_t* root = kk_region_copy_block(kk_ptr_unbox(v), &todo, ctx);
+  while (todo.count > 0) {
+    kk_block_t* c = todo.blocks[--todo.count];
+    const size_t scan_fsize = kk_block_scan_fsize(c);
+    for (size_t i = kk_region_first_field(c); i < scan_fsize; i++) {
+      kk_box_t field = kk_block_field(c, i);
+      if (!kk_box_is_non_null_ptr(field)) continue;
+      kk_block_t* fb = kk_ptr_unbox(field);
+      if (kk_block_in_region(fb, r)) {
+        ((kk_block_fields_t*)c)->fields[i] = kk_ptr_box(kk_region_copy_block(fb, &todo, ctx));
+      }
+      else {
+        kk_block_dup(fb);  // the original field is dropped when the region is released
+      }
+    }
+  }
+  kk_free(todo.blocks);
+  return kk_ptr_box(root);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Release
+--------------------------------------------------------------------------------------------------*/
+
+static void kk_region_free(kk_region_t* r, kk_context_t* ctx) {
+  // first drop all children outside the region (while all region blocks are still valid)
+  for (kk_region_chunk_t* chunk = r->chunks; chunk != NULL; chunk = chunk->next) {
+    size_t ofs = 0;
+    while (ofs < chunk->used) {
+      kk_region_prefix_t* prefix = (kk_region_prefix_t*)((uint8_t*)chunk->data + ofs);
+      kk_block_t* b = (kk_block_t*)(prefix + 1);
+      ofs += sizeof(kk_region_prefix_t) + KK_INTPTR_ALIGNUP(prefix->size);
+      const size_t scan_fsize = kk_block_scan_fsize(b);
+      for (size_t i = kk_region_first_field(b); i < scan_fsize; i++) {
+        kk_box_t field = kk_block_field(b, i);
+        if (kk_box_is_non_null_ptr(field) && !kk_block_in_region(kk_ptr_unbox(field), r)) {
+          kk_block_drop(kk_ptr_unbox(field), ctx);
+        }
+      }
+      if (scan_fsize == 0 && prefix->forward == NULL && kk_tag_is_raw(kk_block_tag(b))) {
+        struct kk_cptr_raw_s* raw = (struct kk_cptr_raw_s*)b;  // all raw structures must overlap this!
+        if (raw->free != NULL) (*raw->free)(raw->cptr, b);
+      }
+    }
+  }
+  // and free the chunks
+  kk_region_chunk_t* chunk = r->chunks;
+  while (chunk != NULL) {
+    kk_region_chunk_t* next = chunk->next;
+    kk_free(chunk);
+    chunk = next;
+  }
+  kk_free(r);
+}
+
+kk_box_t kk_region_exit(kk_box_t result, kk_context_t* ctx) {
+  kk_region_t* r = ctx->region;
+  kk_assert_internal(r != NULL);
+  if (r == NULL) return result;
+  ctx->region = r->parent;
+  result = kk_region_copy_out(result, r, ctx);
+  kk_region_free(r, ctx);
+  return result;
+}
@@ -0,0 +1,88 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#define __USE_MINGW_ANSI_STDIO 1  // so %lld is valid on mingw
+#include "kklib.h"
+#include <inttypes.h>
+
+/*--------------------------------------------------------------------------------------------------
+  Runtime statistics. These are only gathered when kklib is compiled with `KK_STATS`
+  (see the `KK_STATS` cmake option); otherwise all counters stay zero.
+--------------------------------------------------------------------------------------------------*/
+
+static const char* kk_tag_names[KK_TAG_LAST - KK_TAG_OPEN] = {
+  "open", "box", "box-any", "ref", "function", "bigint", "string-small", "string",
+  "bytes", "vector", "int64", "double", "int32", "float", "cfunptr", "size_t",
+  "evv-vector", "vector-int32", "vector-int64", "vector-double",
+  "cptr-raw", "string-raw", "bytes-raw"
+};
+
+// Name of a special tag (or NULL for a constructor tag)
+const char* kk_tag_name(kk_tag_t tag) {
+  if (tag < KK_TAG_OPEN || tag >= KK_TAG_LAST) return NULL;
+  return kk_tag_names[tag - KK_TAG_OPEN];
+}
+
+void kk_stats_add(kk_stats_t* total, const kk_stats_t* stats) {
+  total->dup         += stats->dup;
+  total->drop        += stats->drop;
+  total->dup_atomic  += stats->dup_atomic;
+  total->drop_atomic += stats->drop_atomic;
+  total->sticky      += stats->sticky;
+  total->free        += stats->free;
+  total->reuse       += stats->reuse;
+  total->reuse_miss  += stats->reuse_miss;
+  total->delayed     += stats->delayed;
+  if (stats->delayed_peak > total->delayed_peak) total->delayed_peak = stats->delayed_peak;
+  total->alloc       += stats->alloc;
+  for (size_t i = 0; i < KK_STATS_CON_TAGS; i++) {
+    total->alloc_con[i] += stats->alloc_con[i];
+  }
+  for (size_t i = 0; i < (KK_TAG_LAST - KK_TAG_OPEN); i++) {
+    total->alloc_special[i] += stats->alloc_special[i];
+  }
+}
+
+// Print statistics into a buffer (truncates if it does not fit)
+static size_t kk_stats_snprint(char* buf, size_t len, const kk_stats_t* stats) {
+  size_t n = 0;
+  #define kk_stats_add_line(...)  { int m = snprintf(buf + n, len - n, __VA_ARGS__); if (m > 0) n += (size_t)m; if (n >= len) return len - 1; }
+  kk_stats_add_line("dup:        %" PRId64 " (atomic: %" PRId64 ")\n", stats->dup, stats->dup_atomic);
+  kk_stats_add_line("drop:       %" PRId64 " (atomic: %" PRId64 ", free: %" PRId64 ")\n", stats->drop, stats->drop_atomic, stats->free);
+  kk_stats_add_line("sticky:     %" PRId64 "\n", stats->sticky);
+  kk_stats_add_line("reuse:      %" PRId64 " (miss: %" PRId64 ")\n", stats->reuse, stats->reuse_miss);
+  kk_stats_add_line("delayed:    %" PRId64 " (peak: %" PRId64 ")\n", stats->delayed, stats->delayed_peak);
+  kk_stats_add_line("alloc:      %" PRId64 "\n", stats->alloc);
+  for (size_t i = 0; i < (KK_TAG_LAST - KK_TAG_OPEN); i++) {
+    if (stats->alloc_special[i] == 0) continue;
+    kk_stats_add_line("  %-12s %" PRId64 "\n", kk_tag_names[i], stats->alloc_special[i]);
+  }
+  for (size_t i = 0; i < KK_STATS_CON_TAGS; i++) {
+    if (stats->alloc_con[i] == 0) continue;
+    kk_stats_add_line("  tag %2zu%s     %" PRId64 "\n", i, (i == KK_STATS_CON_TAGS - 1 ? "+" : " "), stats->alloc_con[i]);
+  }
+  #undef kk_stats_add_line
+  return n;
+}
+
+void kk_stats_print(const kk_stats_t* stats, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  char buf[4096];
+  kk_stats_snprint(buf, sizeof(buf), stats);
+  kk_info_message("%s", buf);
+}
+
+// Statistics of the current context (as a string for use from Koka)
+kk_string_t kk_stats_to_string(kk_context_t* ctx) {
+#if KK_STATS
+  char buf[4096];
+  const size_t n = kk_stats_snprint(buf, sizeof(buf), &ctx->stats);
+  return kk_string_alloc_len_unsafe(n, buf, ctx);
+#else
+  return kk_string_empty();
+#endif
+}
@@ -11,9 +11,14 @@
 #define  __USE_MINGW_ANSI_STDIO 1  // so %z is valid on mingw
 #include "kklib.h"
 
+#if defined(_WIN32)
+#include <io.h>
+#define kk_isatty(f)  _isatty(_fileno(f))
+#else
+#include <unistd.h>
+#define kk_isatty(f)  isatty(fileno(f))
+#endif
 
-// Allow reading aligned words as long as some bytes in it are part of a valid C object
-#define ARCH_ALLOW_WORD_READS  (1)  
 
 static char kk_ascii_toupper(char c) {
   return (c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
@@ -69,6 +74,20 @@ int kk_string_icmp(kk_string_t str1, kk_string_t str2, kk_context_t* ctx) {
 }
 
 
+// Allocate a normal string of `len` bytes with room for `capacity >= len` bytes.
+static kk_string_normal_t string_alloc_normal(size_t len, size_t capacity, const char* s, kk_context_t* ctx) {
+  kk_assert_internal(capacity >= len);
+  kk_string_normal_t str = kk_block_assert(kk_string_normal_t, kk_block_alloc_any(sizeof(struct kk_string_normal_s) - 1 /* char str[1] */ + capacity + 1 /* 0 terminator */, 0, KK_TAG_STRING, ctx), KK_TAG_STRING);
+  if (s != NULL && len > 0) {
+    memcpy(&str->str[0], s, len);
+  }
+  str->length = len;
+  str->capacity = capacity;
+  str->str[len] = 0;
+  // todo: kk_assert valid UTF8 in debug mode
+  return str;
+}
+
 kk_decl_export kk_string_t kk_string_alloc_len_unsafe(size_t len, const char* s, kk_context_t* ctx) {
   kk_assert_internal(s == NULL || strlen(s) >= len);
   if (len == 0) {
@@ -83,13 +102,7 @@ kk_decl_export kk_string_t kk_string_alloc_len_unsafe(size_t len, const char* s,
     return kk_datatype_from_base(&str->_base);
   }
   else {
-    kk_string_normal_t str = kk_block_assert(kk_string_normal_t, kk_block_alloc_any(sizeof(struct kk_string_normal_s) - 1 /* char str[1] */ + len + 1 /* 0 terminator */, 0, KK_TAG_STRING, ctx), KK_TAG_STRING);
-    if (s != NULL && len > 0) {
-      memcpy(&str->str[0], s, len);
-    }
-    str->length = len;
-    str->str[len] = 0;
-    // todo: kk_assert valid UTF8 in debug mode
+    kk_string_normal_t str = string_alloc_normal(len, len, s, ctx);
     return kk_datatype_from_base(&str->_base);
   }
 }
@@ -97,57 +110,19 @@ kk_decl_export kk_string_t kk_string_alloc_len_unsafe(size_t len, const char* s,
 
 // Count code points in a UTF8 string.
 size_t kk_decl_pure kk_string_count(kk_string_t str) {
-  const uint8_t* s = kk_string_buf_borrow(str);
-  size_t cont = 0;      // continuation character counts
-  const uint8_t* t = s; // current position 
-
-#ifdef ARCH_ALLOW_WORD_READS
-  // advance per byte until aligned
-  for ( ; ((((uintptr_t)t) % sizeof(kk_uintx_t)) != 0) && (*t != 0); t++) {
-    // count continuation bytes
-    if (kk_utf8_is_cont(*t)) cont++;
-  }  
-  // advance per sizeof(kk_uintx_t). This may read (sizeof(kk_uintx_t)-1) bytes past the end
-  // but that should always be ok (as protection is word size aligned on all architectures (?))
-  if (*t != 0) {
-    kk_assert_internal(((uintptr_t)t) % sizeof(kk_uintx_t) == 0);
-    const kk_uintx_t* p;
-    for (p = (const kk_uintx_t*)t; !kk_bits_has_zero_byte(*p); p++) {
-      // count continuation bytes (0b10xxxxxx bytes) in parallel
-      const kk_uintx_t u = *p;
-      const kk_uintx_t m = ((u & kk_bits_high_mask) >> 7) & ((~u) >> 6); // each byte in `m` is 0x01 iff it was a continuation byte
-      cont += kk_bits_byte_sum(m);
-    }
-    t = (const uint8_t*)p; // restore t
-  }
-#endif
-
-  // advance per byte until 0
-  for (; *t != 0; t++) {
-    // count continuation characters
-    if (kk_utf8_is_cont(*t)) cont++;
-  }
-  kk_assert_internal(t >= s);
-  size_t count = (size_t)(t - s);
-  kk_assert_internal(count >= cont);
-  return (count - cont);
+  return kk_utf8_count(kk_string_buf_borrow(str), kk_string_len_borrow(str));
 }
 
 size_t kk_decl_pure kk_string_count_pattern_borrow(kk_string_t str, kk_string_t pattern) {
   if (kk_string_is_empty_borrow(pattern)) return kk_string_len_borrow(str);
-  const char* pat = kk_string_cbuf_borrow(pattern);
-  const char* s   = kk_string_cbuf_borrow(str);
-  
-  //todo: optimize by doing backward search?
-  //todo: fix it for embedded 0's? perhaps not as we use encoded 0's in our UTF8 encoding.
+  const uint8_t* pat = kk_string_buf_borrow(pattern);
+  const size_t   patlen = kk_string_len_borrow(pattern);
+  const uint8_t* p   = kk_string_buf_borrow(str);
+  const uint8_t* end = p + kk_string_len_borrow(str);
   size_t count = 0;
-  const char* p = s; 
-  while (p != NULL) {
-    p = strstr(p, pat);
-    if (p!=NULL) {
-      count++;
-      p++;
-    }
+  while ((p = kk_memsearch(p, (size_t)(end - p), pat, patlen)) != NULL) {
+    count++;
+    p++;  // count overlapping occurrences
   }
   return count;
 }
@@ -195,9 +170,42 @@ kk_vector_t kk_string_to_chars(kk_string_t s, kk_context_t* ctx) {
   return v;
 }
 
+#ifndef KK_STRING_GROW_MIN
+#define KK_STRING_GROW_MIN  (64)     // minimal capacity when a string is grown for appending
+#endif
+
+// Append `len2` bytes at `s2` (not pointing into `*s1`) in-place if `*s1` is a unique normal string,
+// growing its capacity by 50% if needed so repeated appends take amortized linear time.
+// Returns `false` (and leaves `*s1` as is) if the string cannot be appended in-place.
+static bool string_append_inplace(kk_string_t* s1, const uint8_t* s2, size_t len2, kk_context_t* ctx) {
+  if (!kk_datatype_is_unique(*s1) || !kk_datatype_has_tag(*s1, KK_TAG_STRING)) return false;
+  kk_string_normal_t s = kk_datatype_as_assert(kk_string_normal_t, *s1, KK_TAG_STRING);
+  const size_t len = s->length + len2;
+  if (len > s->capacity) {
+    size_t capacity = s->capacity + s->capacity/2;
+    if (capacity < len) capacity = len;
+    if (capacity < KK_STRING_GROW_MIN) capacity = KK_STRING_GROW_MIN;
+    s = (kk_string_normal_t)kk_block_realloc(&s->_base._block, sizeof(struct kk_string_normal_s) - 1 /* char str[1] */ + capacity + 1 /* 0 terminator */, ctx);
+    s->capacity = capacity;
+    *s1 = kk_datatype_from_base(&s->_base);
+  }
+  memcpy(&s->str[s->length], s2, len2);
+  s->length = len;
+  s->str[len] = 0;
+  return true;
+}
+
 kk_string_t kk_string_cat(kk_string_t s1, kk_string_t s2, kk_context_t* ctx) {
   const size_t len1 = kk_string_len_borrow(s1);
   const size_t len2 = kk_string_len_borrow(s2);
+  if (len2 == 0) {
+    kk_string_drop(s2, ctx);
+    return s1;
+  }
+  if (string_append_inplace(&s1, kk_string_buf_borrow(s2), len2, ctx)) {
+    kk_string_drop(s2, ctx);
+    return s1;
+  }
   kk_string_t t = kk_string_alloc_buf(len1 + len2, ctx );
   uint8_t* p = (uint8_t*)kk_string_buf_borrow(t);
   memcpy(p, kk_string_buf_borrow(s1), len1);
@@ -212,6 +220,7 @@ kk_string_t kk_string_cat_fromc(kk_string_t s1, const char* s2, kk_context_t* ct
   if (s2 == NULL || *s2 == 0) return s1;
   const size_t len1 = kk_string_len_borrow(s1);
   const size_t len2 = strlen(s2);
+  if (string_append_inplace(&s1, (const uint8_t*)s2, len2, ctx)) return s1;
   kk_string_t t = kk_string_alloc_buf(len1 + len2, ctx);
   uint8_t* p = (uint8_t*)kk_string_buf_borrow(t);
   memcpy(p, kk_string_buf_borrow(s1), len1);
@@ -221,6 +230,11 @@ kk_string_t kk_string_cat_fromc(kk_string_t s1, const char* s2, kk_context_t* ct
   return t;
 }
 
+// Find `pat` of length `patlen` in the bytes from `p` up to `end`
+static const char* string_search(const char* p, const char* end, const char* pat, size_t patlen) {
+  return (const char*)kk_memsearch((const uint8_t*)p, (size_t)(end - p), (const uint8_t*)pat, patlen);
+}
+
 kk_vector_t kk_string_splitv(kk_string_t s, kk_string_t sep, kk_context_t* ctx) {
   return kk_string_splitv_atmost(s, sep, UINT32_MAX, ctx);
 }
@@ -229,43 +243,49 @@ kk_vector_t kk_string_splitv_atmost(kk_string_t s, kk_string_t sep, size_t n, kk
   const char* p = kk_string_cbuf_borrow(s);
   const char* q = kk_string_cbuf_borrow(sep);
   if (n<1) n = 1;
-  size_t seplen = strlen(q);
+  size_t seplen = kk_string_len_borrow(sep);
+  const char* pend = p + kk_string_len_borrow(s);
   size_t count;   // count of parts
   if (seplen > 0) {
     // count parts
     count = 1;
     const char* r = p;
-    while (count < n && ((r = strstr(r, q)) != NULL)) {  
+    while (count < n && ((r = string_search(r, pend, q, seplen)) != NULL)) {
       count++;
       r += seplen;
     }
   }
   else {
     // split into characters
-    count = kk_string_count(kk_string_dup(s)); 
+    count = kk_string_count(s);
     if (count > n) count = n;
+    if (count == 0) count = 1;  // the empty string
   }
   kk_assert_internal(count >= 1 && count <= n);
   // copy to vector
   kk_vector_t v = kk_vector_alloc(count, kk_box_null, ctx);
   kk_box_t* ss = kk_vector_buf(v, NULL);
-  const char* pend = p + kk_string_len_borrow(s);
   for (size_t i = 0; i < (count-1) && p < pend; i++) {
     const char* r;
     if (seplen > 0) {
-      r = strstr(p, q);
+      r = string_search(p, pend, q, seplen);
     }
     else {
       r = (const char*)kk_utf8_next((const uint8_t*)p);
     }
     kk_assert_internal(r != NULL && r >= p);
     size_t len = (size_t)(r - p);
-    ss[i] = kk_string_box(kk_string_alloc_dupn(len, p, ctx));
+    ss[i] = kk_string_box(kk_string_alloc_len_unsafe(len, p, ctx));
     p = r + seplen;  // advance
   }
   kk_assert_internal(p <= pend);
-  ss[count-1] = kk_string_box(kk_string_alloc_dup(p, ctx));  // todo: share string if p == s ?
-  kk_string_drop(s,ctx);
+  if (count == 1) {
+    ss[0] = kk_string_box(s);  // no separator found: share the string
+  }
+  else {
+    ss[count-1] = kk_string_box(kk_string_alloc_len_unsafe((size_t)(pend - p), p, ctx));
+    kk_string_drop(s, ctx);
+  }
   kk_string_drop(sep, ctx);
   return v;
 }
@@ -285,12 +305,12 @@ kk_string_t kk_string_replace_atmost(kk_string_t s, kk_string_t pat, kk_string_t
   size_t ppat_len = kk_string_len_borrow(pat);
   size_t prep_len = kk_string_len_borrow(rep);
   const char* pend = p + plen;
-  // if unique s & |rep| == |pat|, update in-place
+  // if unique s & |rep| == |pat|, update in-place (but not raw strings as these may be read-only)
   // TODO: if unique s & |rep| <= |pat|, maybe update in-place if not too much waste?
-  if (kk_datatype_is_unique(s) && ppat_len == prep_len) {
+  if (kk_datatype_is_unique(s) && kk_datatype_has_tag(s, KK_TAG_STRING) && ppat_len == prep_len) {
     size_t count = 0;
     while (count < n && p < pend) {
-      const char* r = strstr(p, ppat);
+      const char* r = string_search(p, pend, ppat, ppat_len);
       if (r == NULL) break;
       memcpy((char*)r, prep, prep_len);
       count++;
@@ -301,7 +321,7 @@ kk_string_t kk_string_replace_atmost(kk_string_t s, kk_string_t pat, kk_string_t
     // count pat occurrences so we can pre-allocate the result buffer
     size_t count = 0;
     const char* r = p;
-    while (count < n && ((r = strstr(r, ppat)) != NULL)) {
+    while (count < n && ((r = string_search(r, pend, ppat, ppat_len)) != NULL)) {
       count++;
       r += ppat_len;
     }
@@ -313,7 +333,7 @@ kk_string_t kk_string_replace_atmost(kk_string_t s, kk_string_t pat, kk_string_t
     char* q = (char*)kk_string_cbuf_borrow(t);
     while (count > 0) {
       count--;
-      r = strstr(p, ppat);
+      r = string_search(p, pend, ppat, ppat_len);
       kk_assert_internal(r != NULL);
       size_t ofs = (size_t)(r - p);
       memcpy(q, p, ofs);
@@ -363,7 +383,7 @@ size_t kk_string_index_of1(kk_string_t str, kk_string_t sub, kk_context_t* ctx)
   else {
     const char* s = kk_string_cbuf_borrow(str);
     const char* t = kk_string_cbuf_borrow(sub);
-    const char* p = strstr(s, t);
+    const char* p = string_search(s, s + slen, t, tlen);
     idx = (p == NULL ? 0 : (size_t)(p - s) + 1);
   }
   kk_string_drop(str, ctx);
@@ -387,11 +407,8 @@ size_t kk_string_last_index_of1(kk_string_t str, kk_string_t sub, kk_context_t*
   else {
     const char* s = kk_string_cbuf_borrow(str);
     const char* t = kk_string_cbuf_borrow(sub);
-    const char* p;
-    for (p = s + slen - tlen; p >= s; p--) {  // todo: use reverse Boyer-Moore instead of one character at a time
-      if (strncmp(p, t, tlen) == 0) break;
-    }
-    idx = (p >= s ? (size_t)(p - s) + 1 : 0);
+    const char* p = (const char*)kk_memsearch_last((const uint8_t*)s, slen, (const uint8_t*)t, tlen);
+    idx = (p != NULL ? (size_t)(p - s) + 1 : 0);
   }
   kk_string_drop(str, ctx);
   kk_string_drop(sub, ctx);
@@ -523,16 +540,106 @@ kk_string_t kk_string_adjust_length(kk_string_t str, size_t newlen, kk_context_t
 
 --------------------------------------------------------------------------------------------------*/
 
+kk_string_t kk_string_validate_utf8(kk_string_t str, kk_context_t* ctx) {
+  const uint8_t* s = kk_string_buf_borrow(str);
+  const size_t len = kk_string_len_borrow(str);
+  if (kk_likely(kk_utf8_is_valid(s, len))) return str;
+  // re-encode; raw zero bytes become the modified UTF8 zero
+  const uint8_t* const end = s + len;
+  size_t n = 0;
+  for (const uint8_t* p = s; p < end; ) {
+    size_t count;
+    n += kk_utf8_len(kk_utf8_read_validate(p, &count));
+    p += count;
+  }
+  kk_string_t t = kk_string_alloc_buf(n, ctx);
+  uint8_t* q = (uint8_t*)kk_string_buf_borrow(t);
+  for (const uint8_t* p = s; p < end; ) {
+    size_t count;
+    size_t qcount;
+    kk_utf8_write(kk_utf8_read_validate(p, &count), q, &qcount);
+    p += count;
+    q += qcount;
+  }
+  kk_assert_internal(q == kk_string_buf_borrow(t) + n);
+  kk_string_drop(str, ctx);
+  return t;
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Console output
+  The output of `kk_print` and `kk_println` is buffered per context and written to stdout when the
+  buffer is full, on `kk_print_flush`, when a task completes, at the end of `kk_main_end`, and before a
+  fatal error. If stdout is a terminal, the output is also written at the end of every line.
+--------------------------------------------------------------------------------------------------*/
+
+#ifndef KK_OUTBUF_SIZE
+#define KK_OUTBUF_SIZE  (64*1024)
+#endif
+
+typedef struct kk_outbuf_s {
+  size_t len;               // bytes in `buf`
+  bool   line_buffered;     // write at the end of every line? (if stdout is a terminal)
+  char   buf[KK_OUTBUF_SIZE];
+} kk_outbuf_t;
+
+static kk_outbuf_t* kk_outbuf_get(kk_context_t* ctx) {
+  kk_outbuf_t* out = ctx->outbuf;
+  if (kk_likely(out != NULL)) return out;
+  out = (kk_outbuf_t*)kk_malloc(sizeof(kk_outbuf_t), ctx);
+  if (out == NULL) kk_fatal_error(ENOMEM, "unable to allocate the console output buffer");
+  out->len = 0;
+  out->line_buffered = (kk_isatty(stdout) != 0);
+  ctx->outbuf = out;
+  return out;
+}
+
+static void kk_outbuf_flush(kk_outbuf_t* out) {
+  if (out->len == 0) return;
+  fwrite(out->buf, 1, out->len, stdout);
+  fflush(stdout);
+  out->len = 0;
+}
+
+static void kk_outbuf_write(kk_outbuf_t* out, const char* s, size_t len) {
+  if (out->len + len > KK_OUTBUF_SIZE) {
+    kk_outbuf_flush(out);
+    if (len > KK_OUTBUF_SIZE/2) {  // write large strings directly
+      fwrite(s, 1, len, stdout);
+      fflush(stdout);
+      return;
+    }
+  }
+  memcpy(out->buf + out->len, s, len);
+  out->len += len;
+}
+
+kk_unit_t kk_print_flush(kk_context_t* ctx) {
+  if (ctx->outbuf != NULL) {
+    kk_outbuf_flush(ctx->outbuf);
+  }
+  else {
+    fflush(stdout);
+  }
+  return kk_Unit;
+}
+
 kk_unit_t kk_println(kk_string_t s, kk_context_t* ctx) {
   // TODO: set locale to UTF8?
-  puts(kk_string_cbuf_borrow(s));
+  kk_outbuf_t* out = kk_outbuf_get(ctx);
+  kk_outbuf_write(out, kk_string_cbuf_borrow(s), kk_string_len_borrow(s));
+  kk_outbuf_write(out, "\n", 1);
+  if (out->line_buffered) kk_outbuf_flush(out);
   kk_string_drop(s,ctx);
   return kk_Unit;
 }
 
 kk_unit_t kk_print(kk_string_t s, kk_context_t* ctx) {
   // TODO: set locale to UTF8?
-  fputs(kk_string_cbuf_borrow(s), stdout);
+  kk_outbuf_t* out = kk_outbuf_get(ctx);
+  const size_t len = kk_string_len_borrow(s);
+  kk_outbuf_write(out, kk_string_cbuf_borrow(s), len);
+  if (out->line_buffered && memchr(kk_string_cbuf_borrow(s), '\n', len) != NULL) kk_outbuf_flush(out);
   kk_string_drop(s,ctx);
   return kk_Unit;
 }
@@ -553,13 +660,16 @@ kk_unit_t kk_trace_any(kk_string_t s, kk_box_t x, kk_context_t* ctx) {
 
 
 static kk_string_t kk_double_show_spec(double d, int32_t prec, char spec, kk_context_t* ctx) {
-  char buf[64];
-  char fmt[16];
-  if (prec < 0)  prec = -prec;
-  if (prec > 48) prec = 48;
-  snprintf(fmt, 16, "%%.%i%c", (int)prec, spec);
-  snprintf(buf, 64, fmt, d);
-  return kk_string_alloc_dup(buf, ctx);
+  char buf[KK_DOUBLE_SHORTEST_MAX];
+  size_t len;
+  if (prec < 0 && spec == 'g') {
+    // at most `|prec|` digits: use the shortest representation
+    len = kk_double_to_shortest(d, prec, buf, sizeof(buf));
+  }
+  else {
+    len = kk_double_to_prec(d, prec, spec, buf, sizeof(buf));
+  }
+  return kk_string_alloc_len_unsafe(len, buf, ctx);
 }
 
 kk_string_t kk_double_show_fixed(double d, int32_t prec, kk_context_t* ctx) {
@@ -619,3 +729,104 @@ kk_string_t kk_show_any(kk_box_t b, kk_context_t* ctx) {
     }
   }
 }
+
+
+/*--------------------------------------------------------------------------------------------------
+  String builder
+--------------------------------------------------------------------------------------------------*/
+
+#ifndef KK_STRING_BUILDER_CHUNK
+#define KK_STRING_BUILDER_CHUNK     (4*1024)     // appended strings of at least this size are kept by reference
+#endif
+#ifndef KK_STRING_BUILDER_TAIL_MAX
+#define KK_STRING_BUILDER_TAIL_MAX  (64*1024)    // maximal capacity of a new tail chunk
+#endif
+
+static void string_builder_push(kk_string_builder_t* sb, kk_string_t s, kk_context_t* ctx) {
+  if (sb->count >= sb->capacity) {
+    const size_t capacity = (sb->capacity == 0 ? 8 : 2*sb->capacity);
+    kk_string_t* chunks = (kk_string_t*)kk_realloc(sb->chunks, capacity * sizeof(kk_string_t), ctx);
+    if (chunks == NULL) kk_fatal_error(ENOMEM, "unable to extend a string builder");
+    sb->chunks = chunks;
+    sb->capacity = capacity;
+  }
+  sb->chunks[sb->count++] = s;
+}
+
+void kk_string_builder_append_buf(kk_string_builder_t* sb, const char* s, size_t len, kk_context_t* ctx) {
+  if (len == 0) return;
+  sb->length += len;
+  if (sb->count > 0) {
+    // copy into the tail chunk if it has room
+    kk_string_t tail = sb->chunks[sb->count-1];
+    if (kk_datatype_is_unique(tail) && kk_datatype_has_tag(tail, KK_TAG_STRING)) {
+      kk_string_normal_t t = kk_datatype_as_assert(kk_string_normal_t, tail, KK_TAG_STRING);
+      if (t->capacity - t->length >= len) {
+        memcpy(&t->str[t->length], s, len);
+        t->length += len;
+        t->str[t->length] = 0;
+        return;
+      }
+    }
+  }
+  // start a new tail chunk; its capacity grows with the total length (up to `KK_STRING_BUILDER_TAIL_MAX`)
+  size_t capacity = (sb->length < KK_STRING_BUILDER_TAIL_MAX ? sb->length : KK_STRING_BUILDER_TAIL_MAX);
+  if (capacity < 256) capacity = 256;
+  if (capacity < len) capacity = len;
+  kk_string_normal_t t = string_alloc_normal(len, capacity, s, ctx);
+  string_builder_push(sb, kk_datatype_from_base(&t->_base), ctx);
+}
+
+void kk_string_builder_append(kk_string_builder_t* sb, kk_string_t s, kk_context_t* ctx) {
+  const size_t len = kk_string_len_borrow(s);
+  if (len < KK_STRING_BUILDER_CHUNK) {
+    kk_string_builder_append_buf(sb, kk_string_cbuf_borrow(s), len, ctx);
+    kk_string_drop(s, ctx);
+  }
+  else {
+    // keep larger strings by reference
+    sb->length += len;
+    string_builder_push(sb, s, ctx);
+  }
+}
+
+// Concatenate all chunks into a single one
+static void string_builder_flatten(kk_string_builder_t* sb, kk_context_t* ctx) {
+  if (sb->count <= 1) return;
+  kk_string_t t = kk_string_alloc_buf(sb->length, ctx);
+  uint8_t* p = (uint8_t*)kk_string_buf_borrow(t);
+  for (size_t i = 0; i < sb->count; i++) {
+    const size_t len = kk_string_len_borrow(sb->chunks[i]);
+    memcpy(p, kk_string_buf_borrow(sb->chunks[i]), len);
+    p += len;
+    kk_string_drop(sb->chunks[i], ctx);
+  }
+  kk_assert_internal(p == kk_string_buf_borrow(t) + sb->length && *p == 0);
+  sb->chunks[0] = t;
+  sb->count = 1;
+}
+
+const char* kk_string_builder_cbuf_borrow(kk_string_builder_t* sb, kk_context_t* ctx) {
+  if (sb->count == 0) return "";
+  string_builder_flatten(sb, ctx);
+  return kk_string_cbuf_borrow(sb->chunks[0]);
+}
+
+kk_string_t kk_string_builder_finish(kk_string_builder_t* sb, kk_context_t* ctx) {
+  kk_string_t t = kk_string_empty();
+  if (sb->count > 0) {
+    string_builder_flatten(sb, ctx);
+    t = sb->chunks[0];
+  }
+  kk_free(sb->chunks);
+  *sb = kk_string_builder_empty();
+  return t;
+}
+
+void kk_string_builder_drop(kk_string_builder_t* sb, kk_context_t* ctx) {
+  for (size_t i = 0; i < sb->count; i++) {
+    kk_string_drop(sb->chunks[i], ctx);
+  }
+  kk_free(sb->chunks);
+  *sb = kk_string_builder_empty();
+}
@@ -0,0 +1,569 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Tasks (see also `kklib/task.h`)
+  A task is owned by its handle and by its runner; whoever releases it last frees it.
+  The result is published by setting `done` (with release semantics).
+--------------------------------------------------------------------------------------------------*/
+
+struct kk_task_s {
+  kk_function_t       action;   // the action to run (thread-shared); consumed by the runner
+  kk_box_t            result;   // the (thread-shared) result once `done`
+  _Atomic(uintptr_t)  done;
+  _Atomic(uintptr_t)  owners;   // the handle and the runner
+};
+
+static kk_task_t kk_task_create(kk_function_t action, kk_context_t* ctx) {
+  kk_task_t task = (kk_task_t)malloc(sizeof(struct kk_task_s));  // not in the heap of `ctx` as the task can outlive it
+  if (task == NULL) kk_fatal_error(ENOMEM, "unable to allocate a task");
+  kk_block_mark_shared(&action->_block, ctx);
+  task->action = action;
+  task->result = kk_box_null;
+  kk_atomic_store_relaxed(&task->done, 0);
+  kk_atomic_store_relaxed(&task->owners, 2);
+  return task;
+}
+
+static void kk_task_release(kk_task_t task, kk_context_t* ctx) {
+  if (kk_atomic(fetch_sub_explicit)(&task->owners, 1, kk_memory_order(acq_rel)) == 1) {
+    kk_box_drop(task->result, ctx);
+    free(task);
+  }
+}
+
+static void kk_task_run(kk_task_t task, kk_context_t* ctx) {
+  kk_function_t action = task->action;
+  task->action = NULL;
+  kk_box_t result = kk_function_call(kk_box_t, (kk_function_t, kk_context_t*), action, (action, ctx));
+  if (kk_yielding(ctx)) kk_fatal_error(ENOTSUP, "a task cannot yield to an effect handler outside of the task");
+  kk_box_mark_shared(result, ctx);
+  task->result = result;
+  kk_atomic_store_release(&task->done, 1);
+  kk_task_release(task, ctx);
+}
+
+static bool kk_task_is_done(kk_task_t task) {
+  return (kk_atomic_load_acquire(&task->done) != 0);
+}
+
+void kk_task_drop(kk_task_t task, kk_context_t* ctx) {
+  kk_task_release(task, ctx);
+}
+
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------------------------------------
+  Work-stealing deque.
+  Chase and Lev, "Dynamic circular work-stealing deque", SPAA'05, with the C11 memory orderings
+  of Lê, Pop, Cohen, and Zappa Nardelli, "Correct and efficient work-stealing for weak memory
+  models", PPoPP'13. Only the owner thread pushes and pops at the bottom; other threads steal
+  at the top. Arrays are never freed while running since a thief may still read from an old one.
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_task_array_s {
+  struct kk_task_array_s* prev;     // previous (smaller) array
+  size_t                  size;     // always a power of 2
+  _Atomic(uintptr_t)      tasks[1];
+} kk_task_array_t;
+
+typedef struct kk_task_deque_s {
+  _Atomic(uintptr_t)      top;      // index of the oldest task (as a signed integer)
+  _Atomic(uintptr_t)      bottom;   // index after the newest task
+  _Atomic(uintptr_t)      array;    // the current `kk_task_array_t*`
+} kk_task_deque_t;
+
+#define KK_TASK_ARRAY_INIT  (64)
+
+static kk_task_array_t* kk_task_array_alloc(size_t size, kk_task_array_t* prev) {
+  kk_task_array_t* a = (kk_task_array_t*)malloc(sizeof(kk_task_array_t) + (size - 1)*sizeof(uintptr_t));
+  if (a == NULL) kk_fatal_error(ENOMEM, "unable to allocate a task deque");
+  a->prev = prev;
+  a->size = size;
+  return a;
+}
+
+static kk_task_deque_t* kk_task_deque_alloc(void) {
+  kk_task_deque_t* q = (kk_task_deque_t*)malloc(sizeof(kk_task_deque_t));
+  if (q == NULL) kk_fatal_error(ENOMEM, "unable to allocate a task deque");
+  kk_atomic_store_relaxed(&q->top, 0);
+  kk_atomic_store_relaxed(&q->bottom, 0);
+  kk_atomic_store_relaxed(&q->array, (uintptr_t)kk_task_array_alloc(KK_TASK_ARRAY_INIT, NULL));
+  return q;
+}
+
+static kk_task_array_t* kk_task_deque_grow(kk_task_deque_t* q, kk_task_array_t* a, kk_ssize_t top, kk_ssize_t bottom) {
+  kk_task_array_t* b = kk_task_array_alloc(2*a->size, a);
+  for (kk_ssize_t i = top; i < bottom; i++) {
+    kk_atomic_store_relaxed(&b->tasks[(size_t)i & (b->size - 1)], kk_atomic_load_relaxed(&a->tasks[(size_t)i & (a->size - 1)]));
+  }
+  kk_atomic_store_release(&q->array, (uintptr_t)b);
+  return b;
+}
+
+// Push at the bottom (owner only)
+static void kk_task_deque_push(kk_task_deque_t* q, kk_task_t task) {
+  const kk_ssize_t b = (kk_ssize_t)kk_atomic_load_relaxed(&q->bottom);
+  const kk_ssize_t t = (kk_ssize_t)kk_atomic_load_acquire(&q->top);
+  kk_task_array_t* a = (kk_task_array_t*)kk_atomic_load_relaxed(&q->array);
+  if (b - t > (kk_ssize_t)a->size - 1) {
+    a = kk_task_deque_grow(q, a, t, b);
+  }
+  kk_atomic_store_relaxed(&a->tasks[(size_t)b & (a->size - 1)], (uintptr_t)task);
+  kk_atomic_store_release(&q->bottom, (uintptr_t)(b + 1));  // instead of a release fence and relaxed store
+}
+
+// Pop from the bottom (owner only)
+static kk_task_t kk_task_deque_pop(kk_task_deque_t* q) {
+  const kk_ssize_t b = (kk_ssize_t)kk_atomic_load_relaxed(&q->bottom) - 1;
+  kk_task_array_t* a = (kk_task_array_t*)kk_atomic_load_relaxed(&q->array);
+  kk_atomic_store_relaxed(&q->bottom, (uintptr_t)b);
+  kk_atomic(thread_fence)(kk_memory_order(seq_cst));
+  kk_ssize_t t = (kk_ssize_t)kk_atomic_load_relaxed(&q->top);
+  kk_task_t task = NULL;
+  if (t <= b) {
+    task = (kk_task_t)kk_atomic_load_relaxed(&a->tasks[(size_t)b & (a->size - 1)]);
+    if (t == b) {
+      // last element: race against thieves
+      uintptr_t expected = (uintptr_t)t;
+      if (!kk_atomic(compare_exchange_strong_explicit)(&q->top, &expected, (uintptr_t)(t + 1), kk_memory_order(seq_cst), kk_memory_order(relaxed))) {
+        task = NULL;
+      }
+      kk_atomic_store_relaxed(&q->bottom, (uintptr_t)(b + 1));
+    }
+  }
+  else {
+    kk_atomic_store_relaxed(&q->bottom, (uintptr_t)(b + 1));
+  }
+  return task;
+}
+
+// Steal from the top (any thread)
+static kk_task_t kk_task_deque_steal(kk_task_deque_t* q) {
+  kk_ssize_t t = (kk_ssize_t)kk_atomic_load_acquire(&q->top);
+  kk_atomic(thread_fence)(kk_memory_order(seq_cst));
+  const kk_ssize_t b = (kk_ssize_t)kk_atomic_load_acquire(&q->bottom);
+  if (t >= b) return NULL;
+  kk_task_array_t* a = (kk_task_array_t*)kk_atomic_load_acquire(&q->array);
+  kk_task_t task = (kk_task_t)kk_atomic_load_relaxed(&a->tasks[(size_t)t & (a->size - 1)]);
+  uintptr_t expected = (uintptr_t)t;
+  if (!kk_atomic(compare_exchange_strong_explicit)(&q->top, &expected, (uintptr_t)(t + 1), kk_memory_order(seq_cst), kk_memory_order(relaxed))) {
+    return NULL;  // lost the race
+  }
+  return task;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Worker pool.
+  Every thread that spawns a task registers its deque; workers are started on the first spawn
+  (one less than the number of processors) and sleep on a condition when there is no work.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_TASK_MAX_DEQUES  (256)
+
+static _Atomic(uintptr_t) task_deques[KK_TASK_MAX_DEQUES];  // registered `kk_task_deque_t*`
+static _Atomic(uintptr_t) task_deque_count;
+static _Atomic(uintptr_t) task_idle;                        // number of sleeping workers
+static size_t             task_workers;                     // number of worker threads
+static size_t             task_running;                     // number of worker threads that did not yet exit (under `task_lock`)
+static _Atomic(uintptr_t) task_stop;                        // set to stop the workers
+static pthread_once_t     task_pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t    task_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     task_available = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t     task_stopped = PTHREAD_COND_INITIALIZER;
+
+// Get the deque of the current thread (or NULL if too many threads registered a deque)
+static kk_task_deque_t* kk_task_deque_get(kk_context_t* ctx) {
+  if (kk_likely(ctx->task_deque != NULL)) return ctx->task_deque;
+  const uintptr_t i = kk_atomic(fetch_add_explicit)(&task_deque_count, 1, kk_memory_order(acq_rel));
+  if (i >= KK_TASK_MAX_DEQUES) {
+    kk_atomic(fetch_sub_explicit)(&task_deque_count, 1, kk_memory_order(acq_rel));
+    return NULL;
+  }
+  kk_task_deque_t* q = kk_task_deque_alloc();
+  kk_atomic_store_release(&task_deques[i], (uintptr_t)q);
+  ctx->task_deque = q;
+  return q;
+}
+
+static uint32_t kk_task_rand(uint32_t* seed) {
+  uint32_t x = *seed;  // xorshift32
+  x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+  *seed = x;
+  return x;
+}
+
+// Find a task: first from our own deque, then steal from a random victim onwards
+static kk_task_t kk_task_find(kk_context_t* ctx, uint32_t* seed) {
+  kk_task_deque_t* own = ctx->task_deque;
+  if (own != NULL) {
+    kk_task_t task = kk_task_deque_pop(own);
+    if (task != NULL) return task;
+  }
+  size_t count = kk_atomic_load_acquire(&task_deque_count);
+  if (count > KK_TASK_MAX_DEQUES) count = KK_TASK_MAX_DEQUES;
+  if (count == 0) return NULL;
+  const size_t start = kk_task_rand(seed) % count;
+  for (size_t i = 0; i < count; i++) {
+    kk_task_deque_t* q = (kk_task_deque_t*)kk_atomic_load_acquire(&task_deques[(start + i) % count]);
+    if (q == NULL || q == own) continue;  // not yet published, or our own
+    kk_task_t task = kk_task_deque_steal(q);
+    if (task != NULL) return task;
+  }
+  return NULL;
+}
+
+static void* kk_task_worker(void* arg) {
+  kk_context_t* ctx = kk_get_context();  // a fresh context for this thread
+  uint32_t seed = (uint32_t)((uintptr_t)arg * KU32(2654435761) + 1);
+  size_t misses = 0;
+  while (kk_atomic_load_acquire(&task_stop) == 0) {
+    kk_task_t task = kk_task_find(ctx, &seed);
+    if (task != NULL) {
+      if (misses >= 64) kk_shared_online(ctx);  // we may read thread-shared values again
+      misses = 0;
+      kk_task_run(task, ctx);
+      if (ctx->outbuf != NULL) kk_print_flush(ctx);  // make the output of a task visible when it completes
+      kk_block_free_delayed_safepoint(ctx);
+    }
+    else if (++misses < 64) {
+      sched_yield();
+    }
+    else {
+      // sleep until a task is spawned; the timeout covers a wake-up that raced with going to sleep
+      if (misses == 64) {
+        // going idle: apply pending shared reference counts, go offline, and return pooled blocks
+        kk_shared_offline(ctx);
+        kk_block_pool_collect(ctx);
+      }
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += 1000000;  // 1ms
+      if (ts.tv_nsec >= 1000000000) { ts.tv_sec++; ts.tv_nsec -= 1000000000; }
+      pthread_mutex_lock(&task_lock);
+      kk_atomic(fetch_add_explicit)(&task_idle, 1, kk_memory_order(acq_rel));
+      if (kk_atomic_load_relaxed(&task_stop) == 0) pthread_cond_timedwait(&task_available, &task_lock, &ts);
+      kk_atomic(fetch_sub_explicit)(&task_idle, 1, kk_memory_order(acq_rel));
+      pthread_mutex_unlock(&task_lock);
+    }
+  }
+  kk_context_done();  // adds the statistics of this worker and frees its context
+  pthread_mutex_lock(&task_lock);
+  task_running--;
+  pthread_cond_signal(&task_stopped);
+  pthread_mutex_unlock(&task_lock);
+  return NULL;
+}
+
+static void kk_task_pool_start(void) {
+  const int cpus = kk_os_processor_count(kk_get_context());
+  const size_t n = (cpus > 1 ? (size_t)cpus - 1 : 1);
+  for (size_t i = 0; i < n; i++) {
+    pthread_t thread;
+    pthread_mutex_lock(&task_lock);
+    task_running++;
+    pthread_mutex_unlock(&task_lock);
+    if (pthread_create(&thread, NULL, &kk_task_worker, (void*)(i + 1)) != 0) {
+      pthread_mutex_lock(&task_lock);
+      task_running--;
+      pthread_mutex_unlock(&task_lock);
+      break;
+    }
+    pthread_detach(thread);
+    task_workers++;
+  }
+  if (task_workers == 0) kk_warning_message("unable to start task worker threads; tasks run sequentially\n");
+}
+
+size_t kk_task_worker_count(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  pthread_once(&task_pool_once, &kk_task_pool_start);
+  return task_workers;
+}
+
+// Stop the workers and wait until they exited (and freed their context); tasks that were
+// not yet started are not run anymore.
+void kk_task_pool_stop(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  pthread_mutex_lock(&task_lock);
+  kk_atomic_store_release(&task_stop, 1);
+  pthread_cond_broadcast(&task_available);
+  while (task_running > 0) {
+    pthread_cond_wait(&task_stopped, &task_lock);
+  }
+  pthread_mutex_unlock(&task_lock);
+}
+
+kk_task_t kk_task_spawn(kk_function_t action, kk_context_t* ctx) {
+  kk_task_t task = kk_task_create(action, ctx);
+  kk_task_deque_t* q = (kk_task_worker_count(ctx) == 0 ? NULL : kk_task_deque_get(ctx));
+  if (q == NULL) {
+    kk_task_run(task, ctx);
+  }
+  else {
+    kk_task_deque_push(q, task);
+    if (kk_atomic_load_relaxed(&task_idle) > 0) {
+      pthread_mutex_lock(&task_lock);
+      pthread_cond_signal(&task_available);
+      pthread_mutex_unlock(&task_lock);
+    }
+  }
+  return task;
+}
+
+kk_box_t kk_task_join(kk_task_t task, kk_context_t* ctx) {
+  uint32_t seed = (uint32_t)ctx->thread_id | 1;
+  while (!kk_task_is_done(task)) {
+    // help out while waiting
+    kk_task_t other = kk_task_find(ctx, &seed);
+    if (other != NULL) {
+      kk_task_run(other, ctx);
+    }
+    else {
+      kk_block_shared_flush(ctx);  // a quiescent state: lets other threads reclaim retired references
+      sched_yield();
+    }
+  }
+  kk_box_t result = kk_box_dup(task->result);
+  kk_box_shared_commit(result, ctx);  // as the task may be released by another thread
+  return result;
+}
+
+#else
+
+/*--------------------------------------------------------------------------------------------------
+  No thread support: run tasks directly
+--------------------------------------------------------------------------------------------------*/
+
+size_t kk_task_worker_count(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  return 0;
+}
+
+void kk_task_pool_stop(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+}
+
+kk_task_t kk_task_spawn(kk_function_t action, kk_context_t* ctx) {
+  kk_task_t task = kk_task_create(action, ctx);
+  kk_task_run(task, ctx);
+  return task;
+}
+
+kk_box_t kk_task_join(kk_task_t task, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  kk_assert_internal(kk_task_is_done(task));
+  return kk_box_dup(task->result);
+}
+
+#endif
+
+
+/*--------------------------------------------------------------------------------------------------
+  Parallel loops
+  Each chunk is run by a task whose action is a closure without scanned fields (besides the
+  function pointer). A worker flushes its pending shared reference counts when a chunk is done
+  so the values it created hold no uncounted references when the loop returns.
+--------------------------------------------------------------------------------------------------*/
+
+#define KK_TASK_FOR_INLINE  (64)
+
+struct kk_task_chunk_fun_s {
+  struct kk_function_s  _base;
+  kk_task_range_fun_t*  body;
+  void*                 arg;
+  size_t                chunk;
+  size_t                lo;
+  size_t                hi;
+};
+
+static kk_box_t kk_task_chunk_run(kk_function_t fself, kk_context_t* ctx) {
+  struct kk_task_chunk_fun_s* self = kk_function_as(struct kk_task_chunk_fun_s*, fself);
+  (self->body)(self->chunk, self->lo, self->hi, self->arg, ctx);
+  kk_function_drop(fself, ctx);
+  kk_block_shared_flush(ctx);
+  return kk_unit_box(kk_Unit);
+}
+
+size_t kk_task_chunks(size_t n, size_t grain, kk_context_t* ctx) {
+  if (grain == 0) grain = 1;
+  if (n < 2*grain || ctx->region != NULL) return 1;  // region blocks cannot be shared with other threads
+  if (kk_os_processor_count(ctx) <= 1) return 1;     // check first as asking for the workers starts the pool
+  const size_t workers = kk_task_worker_count(ctx);
+  if (workers == 0) return 1;
+  const size_t max_chunks = 4*(workers + 1);  // a few chunks per thread to balance the load
+  const size_t chunks = n / grain;
+  return (chunks > max_chunks ? max_chunks : chunks);
+}
+
+void kk_task_for(size_t n, size_t chunks, kk_task_range_fun_t* body, void* arg, kk_context_t* ctx) {
+  if (chunks > n) chunks = n;
+  if (chunks <= 1) {
+    if (n > 0) body(0, 0, n, arg, ctx);
+    return;
+  }
+  kk_task_t  tasks_inline[KK_TASK_FOR_INLINE];
+  kk_task_t* tasks = tasks_inline;
+  if (chunks - 1 > KK_TASK_FOR_INLINE) {
+    tasks = (kk_task_t*)kk_malloc((chunks - 1)*sizeof(kk_task_t), ctx);
+    if (tasks == NULL) kk_fatal_error(ENOMEM, "unable to allocate the tasks of a parallel loop");
+  }
+  const size_t size  = n / chunks;
+  const size_t extra = n % chunks;  // the first `extra` chunks get one more index
+  size_t lo = 0;
+  for (size_t i = 0; i < chunks - 1; i++) {
+    const size_t hi = lo + size + (i < extra ? 1 : 0);
+    struct kk_task_chunk_fun_s* f = kk_function_alloc_as(struct kk_task_chunk_fun_s, 1, ctx);
+    f->_base.fun = kk_cfun_ptr_box((kk_cfun_ptr_t)&kk_task_chunk_run, ctx);
+    f->body  = body;
+    f->arg   = arg;
+    f->chunk = i;
+    f->lo    = lo;
+    f->hi    = hi;
+    tasks[i] = kk_task_spawn(&f->_base, ctx);
+    lo = hi;
+  }
+  body(chunks - 1, lo, n, arg, ctx);
+  for (size_t i = 0; i < chunks - 1; i++) {
+    kk_box_drop(kk_task_join(tasks[i], ctx), ctx);
+    kk_task_drop(tasks[i], ctx);
+  }
+  if (tasks != tasks_inline) kk_free(tasks);
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Parallel vector operations
+  The inputs are marked as thread-shared only if the operation runs in parallel.
+--------------------------------------------------------------------------------------------------*/
+
+typedef struct kk_vector_par_s {
+  kk_function_t   f;
+  const kk_box_t* src;
+  kk_box_t*       dest;
+  kk_box_t        zero;
+} kk_vector_par_t;
+
+static void kk_vector_init_chunk(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx) {
+  KK_UNUSED(chunk);
+  kk_vector_par_t* par = (kk_vector_par_t*)arg;
+  kk_function_t init = par->f;
+  for (size_t i = lo; i < hi; i++) {
+    kk_function_dup(init);
+    par->dest[i] = kk_function_call(kk_box_t, (kk_function_t, size_t, kk_context_t*), init, (init, i, ctx));
+  }
+}
+
+kk_vector_t kk_vector_init_par(size_t n, kk_function_t init, kk_context_t* ctx) {
+  kk_vector_t v = kk_vector_alloc(n, kk_box_null, ctx);
+  kk_vector_par_t par = { init, NULL, kk_vector_buf(v, NULL), kk_box_null };
+  const size_t chunks = kk_task_chunks(n, KK_VECTOR_PAR_MIN/2, ctx);
+  if (chunks > 1) kk_block_mark_shared(&init->_block, ctx);
+  kk_task_for(n, chunks, &kk_vector_init_chunk, &par, ctx);
+  kk_function_drop(init, ctx);
+  return v;
+}
+
+static void kk_vector_map_chunk(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx) {
+  KK_UNUSED(chunk);
+  kk_vector_par_t* par = (kk_vector_par_t*)arg;
+  kk_function_t f = par->f;
+  for (size_t i = lo; i < hi; i++) {
+    kk_function_dup(f);
+    par->dest[i] = kk_function_call(kk_box_t, (kk_function_t, kk_box_t, kk_context_t*), f, (f, kk_box_dup(par->src[i]), ctx));
+  }
+}
+
+kk_vector_t kk_vector_map_par(kk_vector_t v, kk_function_t f, kk_context_t* ctx) {
+  size_t n;
+  kk_box_t* src = kk_vector_buf(v, &n);
+  kk_vector_t w = kk_vector_alloc(n, kk_box_null, ctx);
+  kk_vector_par_t par = { f, src, kk_vector_buf(w, NULL), kk_box_null };
+  const size_t chunks = kk_task_chunks(n, KK_VECTOR_PAR_MIN/2, ctx);
+  if (chunks > 1) {
+    kk_block_mark_shared(&f->_block, ctx);
+    kk_block_mark_shared(kk_datatype_as_ptr(v), ctx);
+  }
+  kk_task_for(n, chunks, &kk_vector_map_chunk, &par, ctx);
+  kk_function_drop(f, ctx);
+  kk_vector_drop(v, ctx);
+  return w;
+}
+
+static void kk_vector_reduce_chunk(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx) {
+  kk_vector_par_t* par = (kk_vector_par_t*)arg;
+  kk_function_t f = par->f;
+  kk_box_t acc = kk_box_dup(par->zero);
+  for (size_t i = lo; i < hi; i++) {
+    kk_function_dup(f);
+    acc = kk_function_call(kk_box_t, (kk_function_t, kk_box_t, kk_box_t, kk_context_t*), f, (f, acc, kk_box_dup(par->src[i]), ctx));
+  }
+  par->dest[chunk] = acc;
+}
+
+kk_box_t kk_vector_reduce_par(kk_vector_t v, kk_box_t zero, kk_function_t f, kk_context_t* ctx) {
+  size_t n;
+  kk_box_t* src = kk_vector_buf(v, &n);
+  const size_t chunks = kk_task_chunks(n, KK_VECTOR_PAR_MIN/2, ctx);
+  kk_box_t  results_inline[KK_TASK_FOR_INLINE];
+  kk_box_t* results = results_inline;
+  if (chunks > KK_TASK_FOR_INLINE) {
+    results = (kk_box_t*)kk_malloc(chunks*sizeof(kk_box_t), ctx);
+    if (results == NULL) kk_fatal_error(ENOMEM, "unable to allocate the results of a parallel reduction");
+  }
+  kk_vector_par_t par = { f, src, results, zero };
+  if (chunks > 1) {
+    kk_block_mark_shared(&f->_block, ctx);
+    kk_block_mark_shared(kk_datatype_as_ptr(v), ctx);
+    kk_box_mark_shared(zero, ctx);
+  }
+  kk_box_t acc;
+  if (n == 0) {
+    acc = kk_box_dup(zero);
+  }
+  else {
+    kk_task_for(n, chunks, &kk_vector_reduce_chunk, &par, ctx);
+    // combine the results of the chunks in order
+    acc = results[0];
+    for (size_t i = 1; i < chunks; i++) {
+      kk_function_dup(f);
+      acc = kk_function_call(kk_box_t, (kk_function_t, kk_box_t, kk_box_t, kk_context_t*), f, (f, acc, results[i], ctx));
+    }
+  }
+  if (results != results_inline) kk_free(results);
+  kk_box_drop(zero, ctx);
+  kk_function_drop(f, ctx);
+  kk_vector_drop(v, ctx);
+  return acc;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Boxed task handles
+--------------------------------------------------------------------------------------------------*/
+
+static void kk_task_free_fun(void* p, kk_block_t* b) {
+  KK_UNUSED(b);
+  kk_task_release((kk_task_t)p, kk_get_context());
+}
+
+kk_box_t kk_task_spawn_box(kk_function_t action, kk_context_t* ctx) {
+  return kk_cptr_raw_box(&kk_task_free_fun, kk_task_spawn(action, ctx), ctx);
+}
+
+kk_box_t kk_task_join_box(kk_box_t task, kk_context_t* ctx) {
+  kk_box_t result = kk_task_join((kk_task_t)kk_cptr_raw_unbox(task), ctx);
+  kk_box_drop(task, ctx);
+  return result;
+}
@@ -0,0 +1,162 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#define __USE_MINGW_ANSI_STDIO 1  // so %llu is valid on mingw
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  Tracing (only with `KK_TRACE`, see also `kklib/trace.h`).
+  Each context records into its own buffer without any synchronization; the buffers are
+  linked into a global list (protected by a spin lock) and are never freed so they can still
+  be written after their thread is done. The cycle counter is calibrated by taking the
+  timer at the start and again when writing the trace; the trace should be written once
+  the other threads are idle (as `kk_main_end` does).
+--------------------------------------------------------------------------------------------------*/
+
+#if KK_TRACE
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define KK_HAS_DLADDR  1
+#endif
+
+static _Atomic(uintptr_t) trace_lock;
+static _Atomic(uintptr_t) trace_started;
+static kk_trace_buf_t*    trace_bufs;
+static uint64_t           trace_ticks_start;
+static kk_timer_t         trace_timer_start;
+
+// the buffer of the current thread for the function entry and exit hooks
+static kk_decl_thread kk_trace_buf_t* trace_buf;
+
+static void kk_trace_lock(void) {
+  uintptr_t expected = 0;
+  while (!kk_atomic_cas_weak_acq_rel(&trace_lock, &expected, 1)) {
+    expected = 0;
+  }
+}
+
+static void kk_trace_unlock(void) {
+  kk_atomic_store_release(&trace_lock, 0);
+}
+
+void kk_trace_thread_init(kk_context_t* ctx) {
+  if (ctx->trace != NULL || kk_atomic_load_acquire(&trace_started) == 0) return;
+  kk_trace_buf_t* buf = (kk_trace_buf_t*)calloc(1, sizeof(kk_trace_buf_t));
+  if (buf == NULL) return;  // just don't trace this thread
+  buf->tid = ctx->thread_id;
+  kk_trace_lock();
+  buf->next = trace_bufs;
+  trace_bufs = buf;
+  kk_trace_unlock();
+  ctx->trace = buf;
+  trace_buf = buf;
+}
+
+void kk_trace_start(kk_context_t* ctx) {
+  kk_trace_lock();
+  if (kk_atomic_load_relaxed(&trace_started) == 0) {
+    trace_timer_start = kk_timer_start();
+    trace_ticks_start = kk_trace_ticks();
+    kk_atomic_store_release(&trace_started, 1);
+  }
+  kk_trace_unlock();
+  kk_trace_thread_init(ctx);
+}
+
+static void kk_trace_write_name(FILE* f, const kk_trace_event_t* ev) {
+  if (ev->is_addr) {
+#if KK_HAS_DLADDR
+    Dl_info info;
+    if (dladdr(ev->name, &info) != 0) {
+      if (info.dli_sname != NULL && info.dli_saddr == ev->name) {
+        fputs(info.dli_sname, f);  // C identifiers need no escaping
+        return;
+      }
+      else if (info.dli_fname != NULL && strpbrk(info.dli_fname, "\"\\") == NULL) {
+        // a static function: use the offset in the module (for `addr2line -e <module> <offset>`)
+        const char* base = strrchr(info.dli_fname, '/');
+        fprintf(f, "%s+0x%llx", (base == NULL ? info.dli_fname : base + 1),
+                (unsigned long long)((uintptr_t)ev->name - (uintptr_t)info.dli_fbase));
+        return;
+      }
+    }
+#endif
+    fprintf(f, "%p", ev->name);
+    return;
+  }
+  for (const char* p = (const char*)ev->name; *p != 0; p++) {
+    if (*p == '"' || *p == '\\') fputc('\\', f);
+    if ((unsigned char)*p >= ' ') fputc(*p, f);
+  }
+}
+
+int kk_trace_write(const char* fname) {
+  if (kk_atomic_load_acquire(&trace_started) == 0) return 0;
+  // calibrate the ticks against the timer
+  const uint64_t   ticks = kk_trace_ticks() - trace_ticks_start;
+  const kk_usecs_t usecs = kk_timer_end(trace_timer_start);
+  const double ticks_per_usec = (usecs > 0 && ticks > 0 ? (double)ticks / (double)usecs : 1.0);
+  FILE* f = fopen(fname, "w");
+  if (f == NULL) return errno;
+  fputs("{\"traceEvents\":[", f);
+  bool first = true;
+  kk_trace_lock();
+  for (const kk_trace_buf_t* buf = trace_bufs; buf != NULL; buf = buf->next) {
+    const uint64_t start = (buf->count > KK_TRACE_EVENTS ? buf->count - KK_TRACE_EVENTS : 0);
+    for (uint64_t i = start; i < buf->count; i++) {
+      const kk_trace_event_t* ev = &buf->events[i & (KK_TRACE_EVENTS - 1)];
+      const double ts = (double)(int64_t)(ev->ticks - trace_ticks_start) / ticks_per_usec;
+      fputs(first ? "\n{\"name\":\"" : ",\n{\"name\":\"", f);
+      kk_trace_write_name(f, ev);
+      fprintf(f, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%llu%s}",
+              ev->phase, ts, (unsigned long long)buf->tid, (ev->phase == 'i' ? ",\"s\":\"t\"" : ""));
+      first = false;
+    }
+  }
+  kk_trace_unlock();
+  fputs("\n],\"displayTimeUnit\":\"ns\"}\n", f);
+  const int err = (ferror(f) ? EIO : 0);
+  fclose(f);
+  return err;
+}
+
+// Hooks for code compiled with `-finstrument-functions`
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((no_instrument_function)) kk_decl_export void __cyg_profile_func_enter(void* fun, void* call_site);
+__attribute__((no_instrument_function)) kk_decl_export void __cyg_profile_func_exit(void* fun, void* call_site);
+
+void __cyg_profile_func_enter(void* fun, void* call_site) {
+  KK_UNUSED(call_site);
+  kk_trace_buf_t* buf = trace_buf;
+  if (kk_unlikely(buf != NULL)) kk_trace_event('B', fun, true, buf);
+}
+
+void __cyg_profile_func_exit(void* fun, void* call_site) {
+  KK_UNUSED(call_site);
+  kk_trace_buf_t* buf = trace_buf;
+  if (kk_unlikely(buf != NULL)) kk_trace_event('E', fun, true, buf);
+}
+#endif
+
+#else
+
+void kk_trace_thread_init(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+}
+
+void kk_trace_start(kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  kk_warning_message("tracing is ignored as kklib was compiled without KK_TRACE\n");
+}
+
+int kk_trace_write(const char* fname) {
+  KK_UNUSED(fname);
+  return ENOSYS;
+}
+
+#endif
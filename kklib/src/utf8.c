@@ -0,0 +1,499 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------------------
+  UTF8 validation, counting, and skipping (see also `string.h`)
+  These work on blocks of 16 bytes with SSE2/SSSE3 on x64 and NEON on arm64 (with a scalar
+  fallback). Validation uses the lookup algorithm of Keiser and Lemire ("Validating UTF-8 in less
+  than one instruction per byte", 2021) as also used in simdjson. Since we accept the modified UTF8
+  encoding of zero (`0xC0 0x80`) but reject raw zero bytes, any error found in a block is
+  (re)checked with the scalar validator which is always definitive.
+--------------------------------------------------------------------------------------------------*/
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define KK_UTF8_NEON  1
+#elif (defined(__x86_64__) || defined(_M_X64))
+#include <emmintrin.h>
+#define KK_UTF8_SSE2  1
+#if defined(__SSSE3__) || defined(__GNUC__)   // gcc and clang can target ssse3 per function
+#include <tmmintrin.h>
+#define KK_UTF8_SSSE3 1
+#endif
+#endif
+
+// Validate whole code points starting at `s` up to (at least) `upto` (but not beyond `end`).
+// Returns the end of the last validated code point (`>= upto`), or NULL if invalid.
+static const uint8_t* utf8_validate_scalar(const uint8_t* s, const uint8_t* end, const uint8_t* upto) {
+  while (s < upto) {
+    const uint8_t b = s[0];
+    if (b < 0x80) {
+      if (b == 0) return NULL;
+      s++;
+      // skip ASCII per 8 bytes
+      while (upto - s >= 8) {
+        uint64_t w;
+        memcpy(&w, s, 8);
+        if ((w & kk_bits_high_mask64) != 0 || kk_bits_has_zero_byte64(w)) break;
+        s += 8;
+      }
+      continue;
+    }
+    const ptrdiff_t avail = end - s;
+    if (b == 0xC0) {  // modified UTF8 zero
+      if (avail < 2 || s[1] != 0x80) return NULL;
+      s += 2;
+    }
+    else if (b >= 0xC2 && b <= 0xDF) {
+      if (avail < 2 || !kk_utf8_is_cont(s[1])) return NULL;
+      s += 2;
+    }
+    else if (b >= 0xE0 && b <= 0xEF) {  // reject overlong and surrogates
+      const uint8_t lo = (b == 0xE0 ? 0xA0 : 0x80);
+      const uint8_t hi = (b == 0xED ? 0x9F : 0xBF);
+      if (avail < 3 || s[1] < lo || s[1] > hi || !kk_utf8_is_cont(s[2])) return NULL;
+      s += 3;
+    }
+    else if (b >= 0xF0 && b <= 0xF4) {  // reject overlong and > 0x10FFFF
+      const uint8_t lo = (b == 0xF0 ? 0x90 : 0x80);
+      const uint8_t hi = (b == 0xF4 ? 0x8F : 0xBF);
+      if (avail < 4 || s[1] < lo || s[1] > hi || !kk_utf8_is_cont(s[2]) || !kk_utf8_is_cont(s[3])) return NULL;
+      s += 4;
+    }
+    else {
+      return NULL;
+    }
+  }
+  return s;
+}
+
+// Back up from a block start `p` to the start of the code point that contains `p[-1]`.
+static const uint8_t* utf8_backup(const uint8_t* s, const uint8_t* p) {
+  if (p <= s) return s;
+  const uint8_t* r = p;
+  do { r--; } while (r > s && (p - r) < 4 && kk_utf8_is_cont(*r));
+  return r;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Vectorized validation
+--------------------------------------------------------------------------------------------------*/
+
+#if KK_UTF8_SSSE3 || KK_UTF8_NEON
+
+// error classes of the lookup tables
+#define U8_TOO_SHORT      (1<<0)
+#define U8_TOO_LONG       (1<<1)
+#define U8_OVERLONG_3     (1<<2)
+#define U8_TOO_LARGE      (1<<3)
+#define U8_SURROGATE      (1<<4)
+#define U8_OVERLONG_2     (1<<5)
+#define U8_TOO_LARGE_1000 (1<<6)
+#define U8_OVERLONG_4     (1<<6)
+#define U8_TWO_CONTS      (1<<7)
+#define U8_CARRY          (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+// high nibble of the previous byte
+static const uint8_t utf8_byte_1_high[16] = {
+  U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,  // ASCII
+  U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,                                                  // continuation
+  U8_TOO_SHORT | U8_OVERLONG_2,                                                                            // 1100
+  U8_TOO_SHORT,                                                                                            // 1101
+  U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,                                                             // 1110
+  U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4                                          // 1111
+};
+
+// low nibble of the previous byte
+static const uint8_t utf8_byte_1_low[16] = {
+  U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,   // 0000
+  U8_CARRY | U8_OVERLONG_2,                                   // 0001
+  U8_CARRY, U8_CARRY,                                         // 001_
+  U8_CARRY | U8_TOO_LARGE,                                    // 0100
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,                // 0101
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,                // 1___
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE, // 1101
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000
+};
+
+// high nibble of the current byte
+static const uint8_t utf8_byte_2_high[16] = {
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,  // ASCII
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,                 // 1000
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,                                      // 1001
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE  | U8_TOO_LARGE,                                      // 101_
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE  | U8_TOO_LARGE,
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT                                                           // 11__
+};
+
+// the last bytes of a block that start a code point that is not yet complete
+static const uint8_t utf8_incomplete_max[16] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0-1, 0xE0-1, 0xC0-1
+};
+
+#endif
+
+#if KK_UTF8_SSSE3
+#if !defined(__SSSE3__)
+__attribute__((target("ssse3")))
+#endif
+static const uint8_t* utf8_validate_ssse3(const uint8_t* s, const uint8_t* end) {
+  const __m128i t1 = _mm_loadu_si128((const __m128i*)utf8_byte_1_high);
+  const __m128i t2 = _mm_loadu_si128((const __m128i*)utf8_byte_1_low);
+  const __m128i t3 = _mm_loadu_si128((const __m128i*)utf8_byte_2_high);
+  const __m128i maxv = _mm_loadu_si128((const __m128i*)utf8_incomplete_max);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i prev = zero;
+  __m128i prev_incomplete = zero;
+  const uint8_t* p = s;
+  while (end - p >= 16) {
+    const __m128i in = _mm_loadu_si128((const __m128i*)p);
+    __m128i err;
+    if (_mm_movemask_epi8(in) == 0) {
+      // ASCII: only check if the previous block ended in a complete code point
+      err = prev_incomplete;
+    }
+    else {
+      const __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+      const __m128i b1h = _mm_shuffle_epi8(t1, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+      const __m128i b1l = _mm_shuffle_epi8(t2, _mm_and_si128(prev1, nibble));
+      const __m128i b2h = _mm_shuffle_epi8(t3, _mm_and_si128(_mm_srli_epi16(in, 4), nibble));
+      const __m128i special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+      const __m128i prev2 = _mm_alignr_epi8(in, prev, 14);
+      const __m128i prev3 = _mm_alignr_epi8(in, prev, 13);
+      const __m128i third  = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0-0x80)));  // >= 0x80 iff 111_____
+      const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0-0x80)));  // >= 0x80 iff 1111____
+      const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+      err = _mm_xor_si128(must23, special);
+      prev_incomplete = _mm_subs_epu8(in, maxv);
+    }
+    err = _mm_or_si128(err, _mm_cmpeq_epi8(in, zero));  // reject raw zeros
+    if (kk_unlikely(_mm_movemask_epi8(_mm_cmpeq_epi8(err, zero)) != 0xFFFF)) {
+      // validate this block with the scalar validator and continue at the next code point
+      p = utf8_validate_scalar(utf8_backup(s, p), end, p + 16);
+      if (p == NULL) return NULL;
+      prev = zero;
+      prev_incomplete = zero;
+    }
+    else {
+      prev = in;
+      p += 16;
+    }
+  }
+  return utf8_validate_scalar(utf8_backup(s, p), end, end);
+}
+#endif
+
+#if KK_UTF8_NEON
+static const uint8_t* utf8_validate_neon(const uint8_t* s, const uint8_t* end) {
+  const uint8x16_t t1 = vld1q_u8(utf8_byte_1_high);
+  const uint8x16_t t2 = vld1q_u8(utf8_byte_1_low);
+  const uint8x16_t t3 = vld1q_u8(utf8_byte_2_high);
+  const uint8x16_t maxv = vld1q_u8(utf8_incomplete_max);
+  const uint8x16_t nibble = vdupq_n_u8(0x0F);
+  const uint8x16_t zero = vdupq_n_u8(0);
+  uint8x16_t prev = zero;
+  uint8x16_t prev_incomplete = zero;
+  const uint8_t* p = s;
+  while (end - p >= 16) {
+    const uint8x16_t in = vld1q_u8(p);
+    uint8x16_t err;
+    if (vmaxvq_u8(in) < 0x80) {
+      err = prev_incomplete;
+    }
+    else {
+      const uint8x16_t prev1 = vextq_u8(prev, in, 15);
+      const uint8x16_t b1h = vqtbl1q_u8(t1, vshrq_n_u8(prev1, 4));
+      const uint8x16_t b1l = vqtbl1q_u8(t2, vandq_u8(prev1, nibble));
+      const uint8x16_t b2h = vqtbl1q_u8(t3, vshrq_n_u8(in, 4));
+      const uint8x16_t special = vandq_u8(vandq_u8(b1h, b1l), b2h);
+      const uint8x16_t prev2 = vextq_u8(prev, in, 14);
+      const uint8x16_t prev3 = vextq_u8(prev, in, 13);
+      const uint8x16_t third  = vqsubq_u8(prev2, vdupq_n_u8(0xE0-0x80));
+      const uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0-0x80));
+      const uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+      err = veorq_u8(must23, special);
+      prev_incomplete = vqsubq_u8(in, maxv);
+    }
+    err = vorrq_u8(err, vceqq_u8(in, zero));
+    if (kk_unlikely(vmaxvq_u8(err) != 0)) {
+      p = utf8_validate_scalar(utf8_backup(s, p), end, p + 16);
+      if (p == NULL) return NULL;
+      prev = zero;
+      prev_incomplete = zero;
+    }
+    else {
+      prev = in;
+      p += 16;
+    }
+  }
+  return utf8_validate_scalar(utf8_backup(s, p), end, end);
+}
+#endif
+
+bool kk_utf8_is_valid(const uint8_t* s, size_t len) {
+  const uint8_t* const end = s + len;
+#if KK_UTF8_NEON
+  return (utf8_validate_neon(s, end) != NULL);
+#elif KK_UTF8_SSSE3 && defined(__SSSE3__)
+  return (utf8_validate_ssse3(s, end) != NULL);
+#elif KK_UTF8_SSSE3
+  if (kk_has_ssse3) return (utf8_validate_ssse3(s, end) != NULL);
+  return (utf8_validate_scalar(s, end, end) != NULL);
+#else
+  return (utf8_validate_scalar(s, end, end) != NULL);
+#endif
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Counting and skipping code points: count the continuation bytes (`0x80` to `0xBF`)
+--------------------------------------------------------------------------------------------------*/
+
+// Count the continuation bytes in `16*blocks` bytes at `s` (with `blocks <= 255`)
+static size_t utf8_count_cont_blocks(const uint8_t* s, size_t blocks) {
+  kk_assert_internal(blocks <= 255);
+#if KK_UTF8_SSE2
+  const __m128i lim = _mm_set1_epi8(-64);
+  __m128i acc = _mm_setzero_si128();
+  for (size_t i = 0; i < blocks; i++, s += 16) {
+    const __m128i in = _mm_loadu_si128((const __m128i*)s);
+    acc = _mm_sub_epi8(acc, _mm_cmplt_epi8(in, lim));  // continuation bytes are (signed) < -64
+  }
+  const __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+  return ((size_t)_mm_cvtsi128_si32(sum) + (size_t)_mm_extract_epi16(sum, 4));
+#elif KK_UTF8_NEON
+  const int8x16_t lim = vdupq_n_s8(-64);
+  uint8x16_t acc = vdupq_n_u8(0);
+  for (size_t i = 0; i < blocks; i++, s += 16) {
+    const int8x16_t in = vreinterpretq_s8_u8(vld1q_u8(s));
+    acc = vsubq_u8(acc, vcltq_s8(in, lim));
+  }
+  return (size_t)vaddlvq_u8(acc);
+#else
+  size_t cont = 0;
+  for (size_t i = 0; i < 16*blocks; i += 8) {
+    uint64_t u;
+    memcpy(&u, s + i, 8);
+    const uint64_t m = ((u & kk_bits_high_mask64) >> 7) & ((~u) >> 6);  // each byte in `m` is 0x01 iff it was a continuation byte
+    cont += kk_bits_byte_sum64(m);
+  }
+  return cont;
+#endif
+}
+
+size_t kk_utf8_count(const uint8_t* s, size_t len) {
+  const uint8_t* p = s;
+  const uint8_t* const end = s + len;
+  size_t cont = 0;
+  while (end - p >= 16) {
+    size_t blocks = (size_t)(end - p) / 16;
+    if (blocks > 255) blocks = 255;
+    cont += utf8_count_cont_blocks(p, blocks);
+    p += 16*blocks;
+  }
+  for (; p < end; p++) {
+    if (kk_utf8_is_cont(*p)) cont++;
+  }
+  kk_assert_internal(len >= cont);
+  return (len - cont);
+}
+
+const uint8_t* kk_utf8_skip(const uint8_t* s, const uint8_t* end, size_t n) {
+  if (n == 0 || s >= end) return s;
+  // find the `n`-th code point start after `s`
+  const uint8_t* p = s + 1;
+  while (end - p >= 16) {
+    const size_t starts = 16 - utf8_count_cont_blocks(p, 1);
+    if (starts >= n) break;
+    n -= starts;
+    p += 16;
+  }
+  for (; p < end; p++) {
+    if (!kk_utf8_is_cont(*p)) {
+      if (--n == 0) return p;
+    }
+  }
+  return end;
+}
+
+
+/*--------------------------------------------------------------------------------------------------
+  Substring search (see also `string.h`)
+  Short patterns use a SIMD filter on the first and last byte of the pattern (as described by
+  Wojciech Muła, "SIMD-friendly algorithms for substring searching") and only compare the
+  candidates. Longer patterns use the Two-Way algorithm of Crochemore and Perrin which runs in
+  linear time in the worst case and constant space (combined with a bad-character shift on the
+  last byte of the window as in the musl and glibc implementations).
+--------------------------------------------------------------------------------------------------*/
+
+#ifndef KK_SEARCH_SHORT_MAX
+#define KK_SEARCH_SHORT_MAX  (32)    // use the SIMD filter for patterns of at most this length
+#endif
+
+// Compare the `m - 2` inner bytes of a candidate (`memcmp` call overhead dominates for short patterns)
+static inline bool search_match_inner(const uint8_t* p, const uint8_t* pat, size_t m) {
+  for (size_t i = 1; i < m - 1; i++) {
+    if (p[i] != pat[i]) return false;
+  }
+  return true;
+}
+
+// Search for `pat` of length `2 <= m <= n`.
+static const uint8_t* search_short(const uint8_t* s, size_t n, const uint8_t* pat, size_t m) {
+  kk_assert_internal(m >= 2 && m <= n);
+  const uint8_t* p = s;
+  const uint8_t* const last = s + (n - m);   // last possible match
+  const uint8_t first_byte = pat[0];
+  const uint8_t last_byte  = pat[m-1];
+#if KK_UTF8_SSE2
+  const __m128i vfirst = _mm_set1_epi8((char)first_byte);
+  const __m128i vlast  = _mm_set1_epi8((char)last_byte);
+  for (; last - p >= 15; p += 16) {
+    const __m128i bfirst = _mm_loadu_si128((const __m128i*)p);
+    const __m128i blast  = _mm_loadu_si128((const __m128i*)(p + m - 1));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bfirst, vfirst), _mm_cmpeq_epi8(blast, vlast)));
+    while (mask != 0) {
+      const uint8_t i = kk_bits_ctz32(mask);
+      if (search_match_inner(p + i, pat, m)) return (p + i);
+      mask &= (mask - 1);
+    }
+  }
+#elif KK_UTF8_NEON
+  const uint8x16_t vfirst = vdupq_n_u8(first_byte);
+  const uint8x16_t vlast  = vdupq_n_u8(last_byte);
+  for (; last - p >= 15; p += 16) {
+    const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(p), vfirst), vceqq_u8(vld1q_u8(p + m - 1), vlast));
+    // narrow to 4 bits per byte
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    while (mask != 0) {
+      const uint8_t i = kk_bits_ctz64(mask) / 4;
+      if (search_match_inner(p + i, pat, m)) return (p + i);
+      mask &= ~((uint64_t)0xF << (4*i));
+    }
+  }
+#endif
+  while (p <= last) {
+    p = (const uint8_t*)memchr(p, first_byte, (size_t)(last - p) + 1);
+    if (p == NULL) return NULL;
+    if (p[m-1] == last_byte && search_match_inner(p, pat, m)) return p;
+    p++;
+  }
+  return NULL;
+}
+
+// Compute the maximal suffix of `pat` (for the ordering `rev` or not), return its start and set `*period`.
+static size_t search_max_suffix(const uint8_t* pat, size_t m, bool rev, size_t* period) {
+  size_t i = SIZE_MAX;   // start of the maximal suffix - 1
+  size_t j = 0;
+  size_t k = 1;
+  size_t p = 1;
+  while (j + k < m) {
+    const uint8_t a = pat[i + k];  // note: `i + k` wraps around for `i == SIZE_MAX`
+    const uint8_t b = pat[j + k];
+    if (a == b) {
+      if (k == p) { j += p; k = 1; }
+             else { k++; }
+    }
+    else if (rev ? a < b : a > b) {
+      j += k;
+      k = 1;
+      p = j - i;
+    }
+    else {
+      i = j++;
+      k = p = 1;
+    }
+  }
+  *period = p;
+  return (i + 1);
+}
+
+// Two-Way search for `pat` of length `m <= n`.
+static const uint8_t* search_two_way(const uint8_t* s, size_t n, const uint8_t* pat, size_t m) {
+  kk_assert_internal(m >= 2 && m <= n);
+  // critical factorization
+  size_t period, period_rev;
+  const size_t ms1 = search_max_suffix(pat, m, false, &period);
+  const size_t ms2 = search_max_suffix(pat, m, true, &period_rev);
+  size_t split = ms1;  // start of the right half
+  if (ms2 > ms1) {
+    split = ms2;
+    period = period_rev;
+  }
+  // periodic pattern? then remember the matched prefix (`mem`) on a shift by the period
+  size_t mem0;
+  if (split <= m - period && memcmp(pat, pat + period, split) == 0) {
+    mem0 = m - period;
+  }
+  else {
+    mem0 = 0;
+    period = (split > m - split ? split : m - split) + 1;
+  }
+  // bad character shift on the last byte of the window
+  size_t shift[256];
+  for (size_t c = 0; c < 256; c++) { shift[c] = m; }
+  for (size_t i = 0; i < m - 1; i++) { shift[pat[i]] = m - 1 - i; }
+
+  const uint8_t* h = s;
+  const uint8_t* const last = s + (n - m);
+  size_t mem = 0;
+  while (h <= last) {
+    size_t k;
+    if (h[m-1] != pat[m-1]) {
+      k = shift[h[m-1]];
+      h += (k < mem ? mem : k);  // (never shift less than the remembered prefix)
+      mem = 0;
+      continue;
+    }
+    // compare the right half
+    k = (split > mem ? split : mem);
+    while (k < m && pat[k] == h[k]) { k++; }
+    if (k < m) {
+      h += k - split + 1;
+      mem = 0;
+      continue;
+    }
+    // compare the left half
+    k = split;
+    while (k > mem && pat[k-1] == h[k-1]) { k--; }
+    if (k <= mem) return h;
+    h += period;
+    mem = mem0;
+  }
+  return NULL;
+}
+
+const uint8_t* kk_memsearch(const uint8_t* s, size_t n, const uint8_t* pat, size_t m) {
+  if (m == 0) return s;
+  if (m > n) return NULL;
+  if (m == 1) return (const uint8_t*)memchr(s, pat[0], n);
+  if (m <= KK_SEARCH_SHORT_MAX) return search_short(s, n, pat, m);
+  return search_two_way(s, n, pat, m);
+}
+
+const uint8_t* kk_memsearch_last(const uint8_t* s, size_t n, const uint8_t* pat, size_t m) {
+  if (m == 0) return (s + n);
+  if (m > n) return NULL;
+  // scan backwards for the first byte and compare (todo: use a reverse Two-Way for long patterns)
+  const uint8_t first_byte = pat[0];
+  for (const uint8_t* p = s + (n - m); ; p--) {
+    if (*p == first_byte && memcmp(p + 1, pat + 1, m - 1) == 0) return p;
+    if (p == s) break;
+  }
+  return NULL;
+}
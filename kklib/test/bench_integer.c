@@ -0,0 +1,251 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020 Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+#define __USE_MINGW_ANSI_STDIO 1  // so %z is valid on mingw
+#include <stdio.h>
+#include <string.h>
+#include "time.h"
+#include "kklib.h"
+
+/*--------------------------------------------------------------------------------------
+  Integer benchmarks
+  Measures the small integer fast paths, the transition to big integers, and the big
+  integer operations over a range of sizes (in digits of 18 decimals on 64-bit).
+  Each benchmark is repeated until it ran for at least `min_msecs` and reported as
+  nano-seconds per operation in CSV (default) or JSON (`--json`).
+  Use `--quick` for a short run (as done by `ctest`), or `--max-limbs=<n>` to change
+  the largest size (10^5 by default, up to 10^6).
+--------------------------------------------------------------------------------------*/
+
+#define LIMB_DIGITS  (18)
+
+static bool    json = false;
+static bool    first_result = true;
+static msecs_t min_msecs = 200;
+static size_t  max_limbs = 100000;
+static size_t  batch_work = 1000000;  // digit operations per batch
+
+static void report(const char* name, size_t limbs, size_t iters, msecs_t msecs) {
+  const double ns = (double)msecs * 1.0e6 / (double)iters;
+  if (json) {
+    printf("%s\n  { \"benchmark\": \"%s\", \"limbs\": %zu, \"iterations\": %zu, \"ns_per_op\": %.1f }",
+           (first_result ? "[" : ","), name, limbs, iters, ns);
+  }
+  else {
+    if (first_result) printf("benchmark,limbs,iterations,ns_per_op\n");
+    printf("%s,%zu,%zu,%.1f\n", name, limbs, iters, ns);
+  }
+  first_result = false;
+  fflush(stdout);
+}
+
+// Run `op` repeatedly (in batches of `batch`) until at least `min_msecs` passed.
+typedef void (bench_fun_t)(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx);
+
+static void bench(const char* name, size_t limbs, bench_fun_t* op, kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  size_t  iters = 0;
+  msecs_t start = _clock_start();
+  msecs_t elapsed;
+  do {
+    op(x, y, batch, ctx);
+    iters += batch;
+    elapsed = _clock_end(start);
+  } while (elapsed < min_msecs);
+  if (elapsed <= 0) elapsed = 1;
+  report(name, limbs, iters, elapsed);
+}
+
+// A pseudo random integer of `limbs` digits.
+static kk_integer_t make_integer(size_t limbs, uint32_t seed, kk_context_t* ctx) {
+  const size_t n = limbs * LIMB_DIGITS;
+  char* s = (char*)kk_malloc(n + 1, ctx);
+  uint32_t r = seed;
+  for (size_t i = 0; i < n; i++) {
+    r = r*1664525 + 1013904223;
+    s[i] = (char)('0' + (r >> 24) % 10);
+  }
+  s[0] = (char)('1' + seed%9);  // no leading zero
+  s[n] = 0;
+  kk_integer_t x = kk_integer_from_str(s, ctx);
+  kk_free(s);
+  return x;
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Operations
+--------------------------------------------------------------------------------------*/
+
+static void op_add(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_drop(kk_integer_add(kk_integer_dup(x), kk_integer_dup(y), ctx), ctx);
+  }
+}
+
+static void op_mul(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_drop(kk_integer_mul(kk_integer_dup(x), kk_integer_dup(y), ctx), ctx);
+  }
+}
+
+static void op_sqr(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  KK_UNUSED(y);
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_drop(kk_integer_sqr(kk_integer_dup(x), ctx), ctx);
+  }
+}
+
+static void op_div(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_drop(kk_integer_div(kk_integer_dup(x), kk_integer_dup(y), ctx), ctx);
+  }
+}
+
+static void op_pow(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_drop(kk_integer_pow(kk_integer_dup(x), kk_integer_dup(y), ctx), ctx);
+  }
+}
+
+static void op_print(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  KK_UNUSED(y);
+  for (size_t i = 0; i < batch; i++) {
+    kk_string_drop(kk_integer_to_string(kk_integer_dup(x), ctx), ctx);
+  }
+}
+
+static void op_parse(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  KK_UNUSED(y);
+  kk_string_t s = kk_integer_to_string(kk_integer_dup(x), ctx);
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_t z;
+    if (kk_integer_parse(kk_string_cbuf_borrow(s), &z, ctx)) kk_integer_drop(z, ctx);
+  }
+  kk_string_drop(s, ctx);
+}
+
+static void op_hex_print(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  KK_UNUSED(y);
+  for (size_t i = 0; i < batch; i++) {
+    kk_string_drop(kk_integer_to_hex_string(kk_integer_dup(x), false, ctx), ctx);
+  }
+}
+
+static void op_hex_parse(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  KK_UNUSED(y);
+  kk_string_t s = kk_integer_to_hex_string(kk_integer_dup(x), false, ctx);
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_t z;
+    if (kk_integer_hex_parse(kk_string_cbuf_borrow(s), &z, ctx)) kk_integer_drop(z, ctx);
+  }
+  kk_string_drop(s, ctx);
+}
+
+// Small integers: a dependent chain of operations on small integers only.
+static void op_small_arith(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  kk_integer_t acc = kk_integer_dup(x);
+  for (size_t i = 0; i < batch; i++) {
+    acc = kk_integer_add(acc, kk_integer_dup(y), ctx);
+    acc = kk_integer_mul(acc, kk_integer_from_small(3), ctx);
+    acc = kk_integer_div(acc, kk_integer_from_small(3), ctx);
+    acc = kk_integer_sub(acc, kk_integer_dup(y), ctx);
+  }
+  kk_integer_drop(acc, ctx);
+}
+
+// Overflow: additions that go from small to big integers and back.
+static void op_overflow(kk_integer_t x, kk_integer_t y, size_t batch, kk_context_t* ctx) {
+  for (size_t i = 0; i < batch; i++) {
+    kk_integer_t z = kk_integer_add(kk_integer_dup(x), kk_integer_dup(y), ctx);  // big
+    kk_integer_drop(kk_integer_sub(z, kk_integer_dup(y), ctx), ctx);              // small again
+  }
+}
+
+
+/*--------------------------------------------------------------------------------------
+  Suites
+--------------------------------------------------------------------------------------*/
+
+static size_t batch_for(size_t limbs, size_t work) {
+  const size_t cost = (work == 0 ? limbs : work);
+  return (cost >= batch_work ? 1 : batch_work / cost);
+}
+
+static void bench_small(kk_context_t* ctx) {
+  bench("small-arith", 0, &op_small_arith, kk_integer_from_small(12345), kk_integer_from_small(7), batch_work/10, ctx);
+  kk_integer_t x = kk_integer_from_small(KK_SMALLINT_MAX);
+  bench("small-overflow", 0, &op_overflow, x, kk_integer_one, batch_work/10, ctx);
+  bench("small-print", 0, &op_print, kk_integer_from_small(1234567), kk_integer_zero, batch_work/10, ctx);
+  bench("small-print-long", 0, &op_print, x, kk_integer_zero, batch_work/10, ctx);
+}
+
+static void bench_sizes(kk_context_t* ctx) {
+  static const size_t sizes[] = { 1, 3, 10, 30, 100, 300, 1000, 3000, 10000, 30000, 100000, 300000, 1000000 };
+  for (size_t k = 0; k < sizeof(sizes)/sizeof(sizes[0]) && sizes[k] <= max_limbs; k++) {
+    const size_t n = sizes[k];
+    kk_integer_t x = make_integer(n, 1, ctx);
+    kk_integer_t y = make_integer(n, 2, ctx);
+    const size_t mul_work = (n <= 100 ? n*n : n*100);
+    bench("add", n, &op_add, x, y, batch_for(n, 0), ctx);
+    bench("mul", n, &op_mul, x, y, batch_for(n, mul_work), ctx);
+    bench("sqr", n, &op_sqr, x, y, batch_for(n, mul_work), ctx);
+    kk_integer_t xy = kk_integer_mul(kk_integer_dup(x), kk_integer_dup(y), ctx);
+    bench("div", n, &op_div, xy, y, batch_for(n, 2*mul_work), ctx);
+    kk_integer_drop(xy, ctx);
+    // 3^e with about `n` limbs
+    kk_integer_t e = kk_integer_from_size_t((size_t)((double)(n*LIMB_DIGITS) / 0.47712125472), ctx);
+    bench("pow", n, &op_pow, kk_integer_from_small(3), e, batch_for(n, 2*mul_work), ctx);
+    bench("print", n, &op_print, x, kk_integer_zero, batch_for(n, mul_work), ctx);
+    bench("parse", n, &op_parse, x, kk_integer_zero, batch_for(n, mul_work), ctx);
+    bench("hex-print", n, &op_hex_print, x, kk_integer_zero, batch_for(n, mul_work), ctx);
+    bench("hex-parse", n, &op_hex_parse, x, kk_integer_zero, batch_for(n, mul_work), ctx);
+    kk_integer_drop(e, ctx);
+    kk_integer_drop(x, ctx);
+    kk_integer_drop(y, ctx);
+  }
+}
+
+// Multiplication sizes around the Karatsuba crossover (to tune `KK_BIGINT_KARATSUBA_CUTOFF`)
+static void bench_crossover(kk_context_t* ctx) {
+  for (size_t n = 8; n <= 64 && n <= max_limbs; n += 4) {
+    kk_integer_t x = make_integer(n, 3, ctx);
+    kk_integer_t y = make_integer(n, 4, ctx);
+    bench("mul-crossover", n, &op_mul, x, y, batch_for(n, n*n), ctx);
+    kk_integer_drop(x, ctx);
+    kk_integer_drop(y, ctx);
+  }
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--json") == 0) {
+      json = true;
+    }
+    else if (strcmp(arg, "--csv") == 0) {
+      json = false;
+    }
+    else if (strcmp(arg, "--quick") == 0) {
+      min_msecs = 2;
+      max_limbs = 1000;
+      batch_work = 10000;
+    }
+    else if (strncmp(arg, "--max-limbs=", 12) == 0) {
+      max_limbs = (size_t)strtoull(arg + 12, NULL, 10);
+    }
+    else {
+      fprintf(stderr, "usage: %s [--csv|--json] [--quick] [--max-limbs=<n>]\n", argv[0]);
+      return 1;
+    }
+  }
+  kk_context_t* ctx = kk_get_context();
+  bench_small(ctx);
+  bench_sizes(ctx);
+  bench_crossover(ctx);
+  if (json) printf("\n]\n");
+  return 0;
+}
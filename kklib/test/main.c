@@ -13,6 +13,12 @@
 #include <limits.h>
 #include <float.h>
 #include <inttypes.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <pthread.h>
+#endif
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 #pragma GCC diagnostic ignored "-Woverlength-strings"
@@ -112,21 +118,27 @@ static void test(kk_context_t* ctx) {
   test_op("*", &kk_integer_mul, &mul, ctx);
 }
 
+// `kk_integer_print` is buffered; flush since we mix it with `printf`
+static void print_integer(kk_integer_t x, kk_context_t* ctx) {
+  kk_integer_print(x, ctx);
+  kk_print_flush(ctx);
+}
+
 static void test_add(kk_integer_t x, kk_integer_t y, kk_integer_t expect, kk_context_t* ctx) {
   kk_integer_dup(x); kk_integer_dup(y);
-  kk_integer_print(x, ctx); printf(" + "); kk_integer_print(y, ctx); printf(" = ");
+  print_integer(x, ctx); printf(" + "); print_integer(y, ctx); printf(" = ");
   kk_integer_t z = kk_integer_add(x, y, ctx);
-  kk_integer_print(z, ctx); printf(", expected: ");
-  kk_integer_print(expect, ctx);
+  print_integer(z, ctx); printf(", expected: ");
+  print_integer(expect, ctx);
   printf("\n");
 }
 
 static void test_sub(kk_integer_t x, kk_integer_t y, kk_integer_t expect, kk_context_t* ctx) {
   kk_integer_dup(x); kk_integer_dup(y);
-  kk_integer_print(x, ctx); printf(" - "); kk_integer_print(y, ctx); printf(" = ");
+  print_integer(x, ctx); printf(" - "); print_integer(y, ctx); printf(" = ");
   kk_integer_t z = kk_integer_sub(x, y, ctx);
-  kk_integer_print(z, ctx); printf(", expected: ");
-  kk_integer_print(expect, ctx);
+  print_integer(z, ctx); printf(", expected: ");
+  print_integer(expect, ctx);
   printf("\n");
 }
 
@@ -160,13 +172,13 @@ static kk_integer_t fib(int n, kk_context_t* ctx) {
 
 static void test_fib(int i, kk_context_t* ctx) {
   printf("fib %i = ", i);
-  kk_integer_print(fib(i,ctx), ctx);
+  print_integer(fib(i,ctx), ctx);
   printf("\n");
 }
 
 static void test_read(const char* s, kk_context_t* ctx) {
   printf("read %s = ", s);
-  kk_integer_print(kk_integer_from_str(s,ctx), ctx);
+  print_integer(kk_integer_from_str(s,ctx), ctx);
   printf("\n");
 }
 
@@ -175,9 +187,12 @@ static void expect(bool b, bool exp) {
   assert(b==exp);
 }
 
+// always checked (also with NDEBUG); keep the operations under test out of `assert`
+#define require(cond)  do { if (!(cond)) { fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); exit(1); } } while(0)
+
 static void expect_eq(kk_integer_t x, kk_integer_t y, kk_context_t* ctx) {
   kk_integer_dup(x); kk_integer_dup(y);
-  printf(" "); kk_integer_print(x, ctx); printf(" == ");  kk_integer_print(y, ctx);
+  printf(" "); print_integer(x, ctx); printf(" == ");  print_integer(y, ctx);
   bool eq = kk_integer_eq(x, y, ctx);
   printf(" %s\n", (eq ? "ok" : "FAIL"));
   assert(eq);
@@ -295,6 +310,108 @@ static void test_large(kk_context_t* ctx) {
   expect_eq(kk_integer_cdiv(kk_integer_mul(kk_integer_dup(y), kk_integer_dup(x), ctx), y, ctx), x,ctx);
 }
 
+// check the multiplication algorithms (long, Karatsuba, Toom-3, NTT) against division and squaring
+static void test_mul_large(kk_context_t* ctx) {
+  const int exps[] = { 100, 1000, 5000, 20000, 60000, 120000 };
+  for (size_t i = 0; i < sizeof(exps)/sizeof(exps[0]); i++) {
+    kk_integer_t x = kk_integer_pow(kk_integer_from_small(3), kk_integer_from_int(exps[i], ctx), ctx);
+    for (size_t j = 0; j <= i; j++) {
+      kk_integer_t y = kk_integer_neg(kk_integer_pow(kk_integer_from_small(7), kk_integer_from_int(exps[j]/2 + 1, ctx), ctx), ctx);
+      kk_integer_t xy = kk_integer_mul(kk_integer_dup(x), kk_integer_dup(y), ctx);
+      kk_integer_t mod;
+      kk_integer_t q = kk_integer_cdiv_cmod(xy, kk_integer_dup(y), &mod, ctx);
+      require(kk_integer_eq(q, kk_integer_dup(x), ctx));
+      require(kk_integer_eq(mod, kk_integer_zero, ctx));
+      kk_integer_drop(y, ctx);
+    }
+    // (x+1)*(x-1) == x^2 - 1
+    kk_integer_t p = kk_integer_mul(kk_integer_inc(kk_integer_dup(x), ctx), kk_integer_dec(kk_integer_dup(x), ctx), ctx);
+    kk_integer_t s = kk_integer_dec(kk_integer_sqr(x, ctx), ctx);
+    require(kk_integer_eq(p, s, ctx));
+  }
+  printf("large multiplication ok\n");
+}
+
+// check large divisions with a remainder: x == q*y + r with |r| < |y|
+static void test_div_large(kk_context_t* ctx) {
+  const int exps[] = { 1000, 10000, 50000, 150000 };
+  for (size_t i = 0; i < sizeof(exps)/sizeof(exps[0]); i++) {
+    kk_integer_t x = kk_integer_add(kk_integer_pow(kk_integer_from_small(3), kk_integer_from_int(exps[i], ctx), ctx), kk_integer_from_small(12345), ctx);
+    for (size_t j = 0; j <= i; j++) {
+      kk_integer_t y = kk_integer_pow(kk_integer_from_small(7), kk_integer_from_int(exps[j]/3 + 1, ctx), ctx);
+      kk_integer_t y1 = kk_integer_dec(kk_integer_dup(y), ctx);
+      kk_integer_t xs[2] = { kk_integer_dup(x), kk_integer_neg(kk_integer_dup(x), ctx) };
+      kk_integer_t ys[2] = { y, kk_integer_neg(y1, ctx) };
+      for (size_t k = 0; k < 4; k++) {
+        kk_integer_t xk = xs[k/2];
+        kk_integer_t yk = ys[k%2];
+        kk_integer_t mod;
+        kk_integer_t q = kk_integer_cdiv_cmod(kk_integer_dup(xk), kk_integer_dup(yk), &mod, ctx);
+        kk_integer_t r = kk_integer_add(kk_integer_mul(q, kk_integer_dup(yk), ctx), kk_integer_dup(mod), ctx);
+        require(kk_integer_eq(r, kk_integer_dup(xk), ctx));
+        require(kk_integer_lt(kk_integer_abs(mod, ctx), kk_integer_abs(kk_integer_dup(yk), ctx), ctx));
+      }
+      for (size_t k = 0; k < 2; k++) { kk_integer_drop(xs[k], ctx); kk_integer_drop(ys[k], ctx); }
+    }
+    kk_integer_drop(x, ctx);
+  }
+  printf("large division ok\n");
+}
+
+// check the fused multiply-add against separate operations
+static void test_add_mul(kk_context_t* ctx) {
+  kk_integer_t acc1 = kk_integer_pow(kk_integer_from_small(3), kk_integer_from_small(200), ctx);
+  kk_integer_t acc2 = kk_integer_dup(acc1);
+  kk_integer_t h1 = kk_integer_dup(acc1);
+  kk_integer_t h2 = kk_integer_dup(acc1);
+  kk_integer_t y = kk_integer_pow(kk_integer_from_small(7), kk_integer_from_small(150), ctx);
+  for (int i = -500; i < 2000; i++) {
+    // summation: acc + x*y with small, big, and negative factors
+    kk_integer_t x = kk_integer_from_int(i*1000003, ctx);
+    kk_integer_t f = ((i%3)==0 ? kk_integer_dup(y) : (i%3)==1 ? kk_integer_neg(kk_integer_dup(y), ctx) : kk_integer_from_int(i, ctx));
+    acc1 = kk_integer_add_mul(acc1, kk_integer_dup(x), kk_integer_dup(f), ctx);
+    acc2 = kk_integer_add(acc2, kk_integer_mul(x, f, ctx), ctx);
+    // polynomial evaluation: h*x + c
+    kk_integer_t k = kk_integer_from_int(i%7 - 2, ctx);
+    kk_integer_t e = kk_integer_from_int((i%5)*123456789, ctx);
+    h1 = kk_integer_mul_add(h1, kk_integer_dup(k), kk_integer_dup(e), ctx);
+    h2 = kk_integer_add(kk_integer_mul(h2, k, ctx), e, ctx);
+    require(kk_integer_eq(kk_integer_dup(acc1), kk_integer_dup(acc2), ctx));
+    require(kk_integer_eq(kk_integer_dup(h1), kk_integer_dup(h2), ctx));
+  }
+  kk_integer_drop(acc1, ctx); kk_integer_drop(acc2, ctx);
+  kk_integer_drop(h1, ctx); kk_integer_drop(h2, ctx);
+  kk_integer_drop(y, ctx);
+  printf("fused multiply-add ok\n");
+}
+
+// check the (divide-and-conquer) hexadecimal conversions of large integers
+static void test_hex_large(kk_context_t* ctx) {
+  const int exps[] = { 10, 300, 5000, 40000 };
+  for (size_t i = 0; i < sizeof(exps)/sizeof(exps[0]); i++) {
+    // 16^n - 1 is all f's
+    const size_t n = (size_t)exps[i];
+    kk_integer_t x = kk_integer_dec(kk_integer_pow(kk_integer_from_small(16), kk_integer_from_int(exps[i], ctx), ctx), ctx);
+    kk_string_t s = kk_integer_to_hex_string(kk_integer_dup(x), false, ctx);
+    const char* cs = kk_string_cbuf_borrow(s);
+    require(strlen(cs) == n);
+    for (size_t j = 0; j < n; j++) { require(cs[j] == 'f'); }
+    kk_integer_t y;
+    bool ok = kk_integer_hex_parse(cs, &y, ctx);
+    require(ok);
+    require(kk_integer_eq(y, kk_integer_dup(x), ctx));
+    kk_string_drop(s, ctx);
+    // round trip
+    kk_integer_t z = kk_integer_mul(x, kk_integer_pow(kk_integer_from_small(3), kk_integer_from_int(exps[i], ctx), ctx), ctx);
+    s = kk_integer_to_hex_string(kk_integer_dup(z), true, ctx);
+    ok = kk_integer_hex_parse(kk_string_cbuf_borrow(s), &y, ctx);
+    require(ok);
+    require(kk_integer_eq(y, z, ctx));
+    kk_string_drop(s, ctx);
+  }
+  printf("large hex conversion ok\n");
+}
+
 static void test_cdiv(kk_context_t* ctx) {
   expect_eq(kk_integer_cdiv(kk_integer_from_str("163500573666152634716420931676158",ctx), kk_integer_from_int(13579, ctx), ctx), kk_integer_from_str("12040693251797086288859336598",ctx),ctx);
   expect_eq(kk_integer_cdiv(kk_integer_from_str("163500573666152634716420931676158",ctx), kk_integer_from_int(-13579, ctx), ctx), kk_integer_from_str("-12040693251797086288859336598",ctx),ctx);
@@ -440,7 +557,7 @@ static void test_double(kk_context_t* ctx) {
   do {
     dx = values[i++];
     kk_integer_t x = kk_integer_from_double(dx, ctx);
-    printf("value: %.20e, %.20e, integer: ", dx, round(dx)); kk_integer_print(x, ctx); printf("\n");
+    printf("value: %.20e, %.20e, integer: ", dx, round(dx)); print_integer(x, ctx); printf("\n");
   } while (!isnan(dx));
   // test boxing
   i = 0;
@@ -491,6 +608,1247 @@ static void test_random(kk_context_t* ctx) {
   printf("chacha20: final: 0x%x, %6.3fs\n", y, (double)end/1000.0);
 }
 
+static void test_random_fill(kk_context_t* ctx) {
+  // fill at odd sizes and alignments: every part of the buffer is written
+  uint8_t buf[4*64*KK_CHACHA_LANES + 8];
+  const size_t sizes[] = { 1, 3, 64, 64*KK_CHACHA_LANES + 5, sizeof(buf) - 1 };
+  for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+    memset(buf, 0, sizeof(buf));
+    kk_srandom_fill(buf + (i%2), sizes[i], ctx);
+    assert(buf[sizes[i] + (i%2)] == 0 || sizes[i] + (i%2) == sizeof(buf));
+    size_t zero = 0;
+    for (size_t j = 0; j < sizes[i]; j++) { if (buf[j + (i%2)] == 0) zero++; }
+    assert(zero <= 8 + sizes[i]/32);
+  }
+  // pseudo random numbers are deterministic; split streams are not
+  kk_prandom_t r1, r2, r3;
+  kk_prandom_init(42, &r1);
+  kk_prandom_init(42, &r2);
+  assert(kk_prandom_uint64(&r1) == kk_prandom_uint64(&r2));
+  kk_prandom_split(&r1, &r3);
+  assert(kk_prandom_uint32(&r1) != kk_prandom_uint32(&r3));
+  for (size_t i = 0; i < 1000; i++) {
+    assert(kk_prandom_range32(7, &r3) < 7);
+    const double d = kk_prandom_double(&r3);
+    assert(d >= 0.0 && d < 1.0);
+  }
+  kk_prandom_init_srandom(&r2, ctx);
+  kk_prandom_fill(buf, 7, &r2);
+  printf("random fill: ok\n");
+}
+
+static void test_delayed_free(kk_context_t* ctx) {
+  // dropping a long list frees at most `KK_FREE_BUDGET` blocks; the rest is freed incrementally
+  const size_t N = 1000000;
+  __data1__list xs = __data1_singleton_Nil;
+  for (size_t i = 0; i < N; i++) {
+    xs = __data1__new_Cons(kk_enum_box(i), xs, ctx);
+  }
+  kk_basetype_drop(xs, ctx);
+#if !KK_RECLAIM_THREAD
+  assert(KK_FREE_BUDGET <= 0 || ctx->delayed_free != NULL);
+#endif
+  kk_block_drop_free_delayed(0, ctx);
+  assert(ctx->delayed_free == NULL);
+  printf("delayed free: ok\n");
+}
+
+// a raw free function that counts the frees and drops another list once (a nested free)
+static size_t test_nested_frees;
+static __data1__list test_nested_list;
+
+static void test_nested_free_fun(void* p, kk_block_t* block) {
+  KK_UNUSED(block);
+  test_nested_frees++;
+  if (p != NULL) {
+    __data1__list ys = test_nested_list;
+    test_nested_list = __data1_singleton_Nil;
+    kk_basetype_drop(ys, kk_get_context());
+  }
+}
+
+static void test_delayed_free_nested(kk_context_t* ctx) {
+#if (KK_FREE_BUDGET > 0) && !KK_RECLAIM_THREAD
+  // a nested free (from a raw free function) does not reset the budget of the enclosing free
+  test_nested_list = __data1_singleton_Nil;
+  for (size_t i = 0; i < 100; i++) {
+    test_nested_list = __data1__new_Cons(kk_enum_box(i), test_nested_list, ctx);
+  }
+  const size_t N = 3*KK_FREE_BUDGET;
+  __data1__list xs = __data1_singleton_Nil;
+  for (size_t i = 0; i < N; i++) {
+    void* p = (i == N - KK_FREE_BUDGET/2 ? &test_nested_list : NULL);  // halfway the budget
+    xs = __data1__new_Cons(kk_cptr_raw_box(&test_nested_free_fun, p, ctx), xs, ctx);
+  }
+  test_nested_frees = 0;
+  kk_basetype_drop(xs, ctx);
+  const size_t frees = test_nested_frees;
+  kk_block_drop_free_delayed(0, ctx);
+  require(test_nested_frees == N && !__data1__is_Cons(test_nested_list));
+  require(frees <= KK_FREE_BUDGET + 1);
+  printf("delayed free nested: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+static void test_region(kk_context_t* ctx) {
+  // build a list in a region that references a heap string, and copy it out at the end
+  kk_string_t str = kk_string_alloc_dup("a heap allocated string", ctx);
+  kk_region_enter(ctx);
+  __data1__list xs = __data1_singleton_Nil;
+  for (size_t i = 0; i < 1000; i++) {
+    xs = __data1__new_Cons((i == 500 ? kk_string_box(kk_string_dup(str)) : kk_enum_box(i)), xs, ctx);
+  }
+  assert(xs->_block.header.refcount == KK_RC_REGION);
+  kk_basetype_drop(kk_basetype_dup_as(__data1__list, xs), ctx);  // no-op in a region
+  // region blocks cannot be reallocated; growing a region vector copies it
+  kk_vector_t v = kk_vector_alloc(4, kk_enum_box(7), ctx);
+  v = kk_vector_realloc_capacity(v, 64, ctx);
+  size_t vlen;
+  kk_box_t* vbuf = kk_vector_buf(v, &vlen);
+  require(vlen == 4 && kk_enum_unbox(kk_vector_as_large(v)->capacity) == 64);
+  for (size_t i = 0; i < vlen; i++) { require(kk_enum_unbox(vbuf[i]) == 7); }
+  kk_vector_drop(v, ctx);  // no-op in a region
+  xs = (__data1__list)kk_ptr_unbox(kk_region_exit(kk_ptr_box(&xs->_block), ctx));
+  size_t n = 0;
+  for (__data1__list ys = xs; __data1__is_Cons(ys); ys = __data1__as_Cons(ys)->tail) {
+    assert(kk_basetype_is_unique(ys));
+    n++;
+  }
+  assert(n == 1000);
+  kk_basetype_drop(xs, ctx);
+  assert(kk_datatype_is_unique(str));
+  kk_string_drop(str, ctx);
+  printf("region: ok\n");
+}
+
+static void test_block_pool(kk_context_t* ctx) {
+#if (KK_BLOCK_POOL_MAX > 0)
+  // a freed small block is reused for the next allocation of the same size class
+  kk_block_t* x = kk_block_alloc(3*sizeof(kk_box_t), 0, (kk_tag_t)1, ctx);
+  require(x->header.pool_wsize == 3);
+  kk_block_pool_free(x, ctx);
+  kk_block_t* y = kk_block_alloc(3*sizeof(kk_box_t) - 1, 0, (kk_tag_t)1, ctx);
+  require(y == x && y->header.pool_wsize == 3);
+  // a reallocated block is pooled at its new size (or not at all)
+  y = kk_block_realloc(y, 6*sizeof(kk_box_t), ctx);
+  require(y->header.pool_wsize == 6);
+  y = kk_block_realloc(y, 16*sizeof(kk_box_t), ctx);
+  require(y->header.pool_wsize == 0);
+  kk_block_pool_free(y, ctx);
+  kk_block_pool_collect(ctx);
+  printf("block pool: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+static void test_box_any(kk_context_t* ctx) {
+  // the `box_any` block is shared by all threads and must never be written
+  const uint32_t rc = ctx->kk_box_any->_block.header.refcount;
+  kk_box_t x = kk_box_any(ctx);
+  require(ctx->kk_box_any->_block.header.refcount == rc);
+  kk_box_drop(x, ctx);
+  kk_box_drop(kk_box_any(ctx), ctx);
+  require(ctx->kk_box_any->_block.header.refcount == rc);
+  printf("box any: ok\n");
+}
+
+#if !defined(_WIN32)
+static void* test_context_lazy_thread(void* arg) {
+  kk_context_t* ctx = kk_get_context();
+  const bool lazy = (ctx->shared_epoch == NULL);  // not yet online
+  kk_box_drop(kk_ref_get(kk_ref_dup((kk_ref_t)arg), ctx), ctx);
+  const bool online = (ctx->shared_epoch != NULL);
+  kk_context_done();
+  return (lazy && online ? arg : NULL);
+}
+#endif
+
+static void test_context_lazy(kk_context_t* ctx) {
+#if !defined(_WIN32)
+  // a new context goes online for the reclamation of thread-shared references once it reads one
+  kk_ref_t r = kk_ref_alloc(kk_integer_box(kk_integer_from_small(42)), ctx);
+  kk_block_mark_shared(&r->_block, ctx);
+  pthread_t thread;
+  void* res = NULL;
+  require(pthread_create(&thread, NULL, &test_context_lazy_thread, r) == 0);
+  require(pthread_join(thread, &res) == 0);
+  require(res == r);
+  kk_ref_drop(r, ctx);
+  kk_block_shared_flush(ctx);
+  printf("context lazy: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+static void test_mark_shared(kk_context_t* ctx) {
+  __data1__list xs = __data1_singleton_Nil;
+  for (size_t i = 0; i < 100000; i++) {
+    xs = __data1__new_Cons(kk_enum_box(i), xs, ctx);
+  }
+  __data1__list ys = kk_basetype_dup_as(__data1__list, xs);
+  kk_block_mark_shared(&xs->_block, ctx);
+  size_t n = 0;
+  for (__data1__list zs = xs; __data1__is_Cons(zs); zs = __data1__as_Cons(zs)->tail) {
+    assert(zs->_block.header.thread_shared);
+    n++;
+  }
+  assert(n == 100000);
+  kk_basetype_drop(ys, ctx);
+  assert(xs->_block.header.thread_shared);
+  kk_basetype_drop(xs, ctx);
+  printf("mark shared: ok\n");
+}
+
+struct test_task_fun_s {
+  struct kk_function_s _base;
+  kk_box_t n;
+};
+
+static kk_box_t test_task_sum(kk_function_t fself, kk_context_t* ctx) {
+  struct test_task_fun_s* self = kk_function_as(struct test_task_fun_s*, fself);
+  const int64_t n = (int64_t)kk_enum_unbox(self->n);
+  kk_function_drop(fself, ctx);
+  int64_t sum = 0;
+  for (int64_t i = 0; i < n; i++) { sum += i; }
+  return kk_integer_box(kk_integer_from_int64(sum, ctx));
+}
+
+static void test_task(kk_context_t* ctx) {
+  kk_task_t tasks[100];
+  for (size_t i = 0; i < 100; i++) {
+    struct test_task_fun_s* f = kk_function_alloc_as(struct test_task_fun_s, 2, ctx);
+    f->_base.fun = kk_cfun_ptr_box((kk_cfun_ptr_t)&test_task_sum, ctx);
+    f->n = kk_enum_box(i*10000);
+    tasks[i] = kk_task_spawn(&f->_base, ctx);
+  }
+  for (size_t i = 0; i < 100; i++) {
+    const int64_t n = (int64_t)(i*10000);
+    kk_integer_t r = kk_integer_unbox(kk_task_join(tasks[i], ctx));
+    require(kk_integer_clamp64(r, ctx) == (n*(n-1))/2 || n == 0);
+    kk_integer_drop(r, ctx);
+    kk_task_drop(tasks[i], ctx);
+  }
+  printf("tasks: ok (%zu workers)\n", kk_task_worker_count(ctx));
+}
+
+// i -> i*k, or x -> x*k, or (x,y) -> x + y, where `k` is a captured (big) integer
+struct test_par_fun_s {
+  struct kk_function_s _base;
+  kk_box_t k;
+};
+
+static kk_box_t test_par_init(kk_function_t fself, size_t i, kk_context_t* ctx) {
+  struct test_par_fun_s* self = kk_function_as(struct test_par_fun_s*, fself);
+  kk_integer_t k = kk_integer_unbox(kk_box_dup(self->k));
+  kk_function_drop(fself, ctx);
+  return kk_integer_box(kk_integer_mul(kk_integer_from_size_t(i, ctx), k, ctx));
+}
+
+static kk_box_t test_par_map(kk_function_t fself, kk_box_t x, kk_context_t* ctx) {
+  struct test_par_fun_s* self = kk_function_as(struct test_par_fun_s*, fself);
+  kk_integer_t k = kk_integer_unbox(kk_box_dup(self->k));
+  kk_function_drop(fself, ctx);
+  return kk_integer_box(kk_integer_mul(kk_integer_unbox(x), k, ctx));
+}
+
+static kk_box_t test_par_add(kk_function_t fself, kk_box_t x, kk_box_t y, kk_context_t* ctx) {
+  kk_function_drop(fself, ctx);
+  return kk_integer_box(kk_integer_add(kk_integer_unbox(x), kk_integer_unbox(y), ctx));
+}
+
+static kk_function_t test_par_fun(kk_cfun_ptr_t fun, kk_integer_t k, kk_context_t* ctx) {
+  struct test_par_fun_s* f = kk_function_alloc_as(struct test_par_fun_s, 2, ctx);
+  f->_base.fun = kk_cfun_ptr_box(fun, ctx);
+  f->k = kk_integer_box(k);
+  return &f->_base;
+}
+
+static void test_vector_par(kk_context_t* ctx) {
+  const size_t n = 100003;
+  kk_integer_t big = kk_integer_from_str("1000000000000000000000", ctx);
+  kk_vector_t v = kk_vector_init_par(n, test_par_fun((kk_cfun_ptr_t)&test_par_init, kk_integer_dup(big), ctx), ctx);
+  require(kk_vector_len(v) == n);
+  for (size_t i = 0; i < n; i += 997) {
+    kk_integer_t expect = kk_integer_mul(kk_integer_from_size_t(i, ctx), kk_integer_dup(big), ctx);
+    require(kk_integer_eq(kk_integer_unbox(kk_vector_at(v, i)), expect, ctx));
+  }
+  kk_vector_t w = kk_vector_map_par(kk_vector_dup(v), test_par_fun((kk_cfun_ptr_t)&test_par_map, kk_integer_from_small(3), ctx), ctx);
+  kk_integer_t sum = kk_integer_unbox(kk_vector_reduce_par(w, kk_integer_box(kk_integer_zero), test_par_fun((kk_cfun_ptr_t)&test_par_add, kk_integer_zero, ctx), ctx));
+  // 3*big*(n*(n-1)/2)
+  kk_integer_t expect = kk_integer_mul(kk_integer_mul(kk_integer_from_small(3), big, ctx), kk_integer_from_size_t(n*(n-1)/2, ctx), ctx);
+  require(kk_integer_eq(sum, expect, ctx));
+  // small vectors and the empty vector run sequentially
+  kk_integer_t empty = kk_integer_unbox(kk_vector_reduce_par(kk_vector_empty(), kk_integer_box(kk_integer_one), test_par_fun((kk_cfun_ptr_t)&test_par_add, kk_integer_zero, ctx), ctx));
+  require(kk_integer_eq(empty, kk_integer_one, ctx));
+  kk_vector_t u = kk_vector_map_par(kk_vector_dup(v), test_par_fun((kk_cfun_ptr_t)&test_par_map, kk_integer_zero, ctx), ctx);
+  kk_vector_drop(u, ctx);
+  kk_vector_drop(v, ctx);
+  printf("parallel vectors: ok (%zu chunks)\n", kk_task_chunks(n, KK_VECTOR_PAR_MIN/2, ctx));
+}
+
+static void test_task_for_sum(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx) {
+  KK_UNUSED(ctx);
+  int64_t* sums = (int64_t*)arg;
+  for (size_t i = lo; i < hi; i++) { sums[chunk] += (int64_t)i; }
+}
+
+static void test_task_for(kk_context_t* ctx) {
+  // with more chunks than processors, the chunks still all run (possibly on the current thread)
+  int64_t sums[13] = { 0 };
+  kk_task_for(100000, 13, &test_task_for_sum, sums, ctx);
+  int64_t sum = 0;
+  for (size_t i = 0; i < 13; i++) { assert(sums[i] > 0); sum += sums[i]; }
+  assert(sum == (int64_t)100000*99999/2);
+  printf("task for: ok\n");
+}
+
+typedef struct test_task_spread_s {
+  uintptr_t           main_id;   // thread id of the context that starts the loop
+  _Atomic(uintptr_t)  other_id;  // thread id of another context that ran a chunk (or 0)
+} test_task_spread_t;
+
+static void test_task_spread_chunk(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx) {
+  KK_UNUSED(chunk); KK_UNUSED(lo); KK_UNUSED(hi);
+  test_task_spread_t* spread = (test_task_spread_t*)arg;
+  if (ctx->thread_id != spread->main_id) kk_atomic_store_relaxed(&spread->other_id, ctx->thread_id);
+  // wait (at most a second) until some chunk runs on another thread
+  kk_timer_t start = kk_timer_start();
+  while (kk_atomic_load_relaxed(&spread->other_id) == 0 && kk_timer_end(start) < 1000000) {
+    #if !defined(_WIN32)
+    sched_yield();
+    #endif
+  }
+}
+
+static void test_task_spread(kk_context_t* ctx) {
+  // the chunks of a parallel loop run on more than one thread when there are workers
+  test_task_spread_t spread;
+  spread.main_id = ctx->thread_id;
+  kk_atomic_store_relaxed(&spread.other_id, 0);
+  kk_task_for(8, 8, &test_task_spread_chunk, &spread, ctx);
+  const uintptr_t other_id = kk_atomic_load_relaxed(&spread.other_id);
+  require(kk_task_worker_count(ctx) == 0 || (other_id != 0 && other_id != ctx->thread_id));
+  // with one processor, parallel operations on vectors run sequentially
+  if (kk_os_processor_count(ctx) <= 1) require(kk_task_chunks(1000000, 1, ctx) == 1);
+  printf("task spread: ok (%zu workers)\n", kk_task_worker_count(ctx));
+}
+
+struct test_ref_shared_s {
+  kk_ref_t r;    // holds a list `[k,k]`
+  kk_ref_t rv;   // holds a vector of such lists
+};
+
+static kk_box_t test_ref_pair(size_t k, kk_context_t* ctx) {
+  __data1__list xs = __data1__new_Cons(kk_enum_box(k), __data1__new_Cons(kk_enum_box(k), __data1_singleton_Nil, ctx), ctx);
+  return kk_basetype_box(xs);
+}
+
+static void test_ref_pair_check(kk_box_t x, kk_context_t* ctx) {
+  struct __data1_Cons* cell = __data1__as_Cons(kk_basetype_unbox_as(__data1__list, x));
+  assert(cell->x.box == __data1__as_Cons(cell->tail)->x.box);
+  kk_box_drop(x, ctx);
+}
+
+static void test_ref_shared_run(size_t chunk, size_t lo, size_t hi, void* arg, kk_context_t* ctx) {
+  struct test_ref_shared_s* refs = (struct test_ref_shared_s*)arg;
+  for (size_t i = lo; i < hi; i++) {
+    if (chunk == 0) {
+      // the writer
+      kk_ref_set(kk_ref_dup(refs->r), test_ref_pair(i, ctx), ctx);
+      kk_ref_vector_assign(kk_ref_dup(refs->rv), kk_integer_from_size_t(i % 8, ctx), test_ref_pair(i, ctx), ctx);
+      kk_box_drop(kk_ref_swap(kk_ref_dup(refs->r), test_ref_pair(i, ctx), ctx), ctx);
+    }
+    else {
+      // the readers
+      test_ref_pair_check(kk_ref_get(kk_ref_dup(refs->r), ctx), ctx);
+      kk_vector_t v = kk_vector_unbox(kk_ref_get(kk_ref_dup(refs->rv), ctx), ctx);
+      test_ref_pair_check(kk_vector_at(v, i % 8), ctx);
+      kk_vector_drop(v, ctx);
+    }
+  }
+}
+
+static void test_ref_shared(kk_context_t* ctx) {
+  struct test_ref_shared_s refs;
+  refs.r = kk_ref_alloc(test_ref_pair(0, ctx), ctx);
+  kk_vector_t v = kk_vector_alloc(8, kk_box_null, ctx);
+  for (size_t i = 0; i < 8; i++) { kk_vector_buf(v, NULL)[i] = test_ref_pair(i, ctx); }
+  refs.rv = kk_ref_alloc(kk_vector_box(v, ctx), ctx);
+  kk_block_mark_shared(&refs.r->_block, ctx);
+  kk_block_mark_shared(&refs.rv->_block, ctx);
+  // one writer overwrites the values that the other chunks read concurrently
+  kk_task_for(4*20000, 4, &test_ref_shared_run, &refs, ctx);
+  test_ref_pair_check(kk_ref_get(kk_ref_dup(refs.r), ctx), ctx);
+  kk_ref_drop(refs.r, ctx);
+  kk_ref_drop(refs.rv, ctx);
+  kk_block_shared_flush(ctx);
+  kk_block_drop_free_delayed(0, ctx);
+  printf("ref shared: ok\n");
+}
+
+static void test_shared_defer(kk_context_t* ctx) {
+  __data1__list xs = __data1_singleton_Nil;
+  for (size_t i = 0; i < 1000; i++) {
+    xs = __data1__new_Cons(kk_enum_box(i), xs, ctx);
+  }
+  kk_block_mark_shared(&xs->_block, ctx);
+  const uint32_t rc = xs->_block.header.refcount;
+  for (size_t i = 0; i < 100000; i++) {
+    __data1__list ys = kk_basetype_dup_as(__data1__list, xs);
+    kk_basetype_drop(ys, ctx);
+  }
+  __data1__list ys = kk_basetype_dup_as(__data1__list, xs);
+  kk_block_shared_flush(ctx);
+  assert(xs->_block.header.refcount == rc + 1);
+  kk_basetype_drop(ys, ctx);
+  kk_basetype_drop(xs, ctx);   // freed at the next flush
+  kk_block_shared_flush(ctx);
+  kk_block_drop_free_delayed(0, ctx);
+  printf("shared defer: ok\n");
+}
+
+#if (KK_SHARED_DEFER > 0) && !defined(_WIN32)
+static volatile bool test_evict_freed;  // set when the child is freed
+
+static void test_evict_free_fun(void* p, kk_block_t* block) {
+  KK_UNUSED(p); KK_UNUSED(block);
+  test_evict_freed = true;
+}
+
+static size_t test_evict_index(void* p) {  // the entry in the delta table (as in `refcount.c`)
+  return (((uintptr_t)p >> 4) ^ ((uintptr_t)p >> 12)) & (KK_SHARED_DEFER - 1);
+}
+
+static void* test_evict_drop(void* arg) {
+  kk_context_t* ctx = kk_get_context();
+  kk_basetype_drop((__data1__list)arg, ctx);  // the last reference to the parent
+  kk_context_done();                          // flushes the pending decrement
+  return NULL;
+}
+#endif
+
+static void test_shared_defer_evict(kk_context_t* ctx) {
+#if (KK_SHARED_DEFER > 0) && !defined(_WIN32)
+  // a shared parent with a child
+  kk_box_t child = kk_cptr_raw_box(&test_evict_free_fun, NULL, ctx);
+  __data1__list xs = __data1__new_Cons(child, __data1_singleton_Nil, ctx);
+  require(test_evict_index(xs) != test_evict_index(kk_ptr_unbox(child)));  // adjacent blocks
+  test_evict_freed = false;
+  kk_block_mark_shared(&xs->_block, ctx);
+  // a shared block that maps to the same entry as the parent (the other candidates stay
+  // alive until then so they are not allocated again at the same address)
+  __data1__list others = __data1__new_Cons(kk_enum_box(0), __data1_singleton_Nil, ctx);
+  while (test_evict_index(others) != test_evict_index(xs)) {
+    others = __data1__new_Cons(kk_enum_box(0), others, ctx);
+  }
+  __data1__list other = others;
+  kk_basetype_drop(__data1__as_Cons(other)->tail, ctx);
+  __data1__as_Cons(other)->tail = __data1_singleton_Nil;
+  kk_block_mark_shared(&other->_block, ctx);
+  __data1__list ys = kk_basetype_dup_as(__data1__list, xs);  // for the other thread
+  kk_block_shared_flush(ctx);
+  // dup the child (pending), drop the parent (pending), and evict the parent decrement
+  kk_box_t cx = kk_box_dup(__data1__as_Cons(xs)->x);
+  kk_basetype_drop(xs, ctx);
+  __data1__list o = kk_basetype_dup_as(__data1__list, other);
+  // the other thread now frees the parent; this must not free the child we still hold
+  pthread_t thread;
+  require(pthread_create(&thread, NULL, &test_evict_drop, ys) == 0);
+  require(pthread_join(thread, NULL) == 0);
+  require(!test_evict_freed);
+  kk_box_drop(cx, ctx);
+  kk_basetype_drop(o, ctx);
+  kk_basetype_drop(other, ctx);
+  kk_block_shared_flush(ctx);
+  kk_block_drop_free_delayed(0, ctx);
+  require(test_evict_freed);
+  printf("shared defer evict: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+static void test_heap_profile(kk_context_t* ctx) {
+#if KK_HEAP_PROFILE
+  kk_heap_profile_set_rate(256);
+  __data1__list xs = __data1_singleton_Nil;
+  for (size_t i = 0; i < 100000; i++) {
+    xs = __data1__new_Cons(kk_enum_box(i), xs, ctx);
+  }
+  const char* fname = "kklib-test-heap.prof";
+  int err = kk_heap_profile_write(fname);
+  require(err == 0);
+  FILE* f = fopen(fname, "r");
+  require(f != NULL);
+  char line[128];
+  const bool read = (fgets(line, sizeof(line), f) != NULL);
+  fclose(f);
+  remove(fname);
+  require(read && strncmp(line, "heap profile:", 13) == 0);
+  // cells that are reused in place are sampled again
+  size_t sampled = 0;
+  for (__data1__list ys = xs; __data1__is_Cons(ys); ys = __data1__as_Cons(ys)->tail) {
+    kk_block_t* cell = kk_block_alloc_at(&ys->_block, sizeof(struct __data1_Cons), 2, (kk_tag_t)1, ctx);
+    if (cell->header.heap_sampled) sampled++;
+  }
+  require(sampled > 0);
+  kk_basetype_drop(xs, ctx);
+  kk_block_drop_free_delayed(0, ctx);
+  kk_heap_profile_print(ctx);
+  kk_heap_profile_set_rate(KK_HEAP_SAMPLE_RATE);
+  printf("heap profile: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+static void test_trace(kk_context_t* ctx) {
+#if KK_TRACE
+  kk_trace_start(ctx);
+  kk_trace_begin("test \"trace\"", ctx);
+  kk_integer_t x = kk_integer_pow(kk_integer_from_small(7), kk_integer_from_small(2000), ctx);
+  kk_integer_t y = kk_integer_mul(kk_integer_dup(x), x, ctx);
+  kk_string_drop(kk_integer_to_string(y, ctx), ctx);
+  kk_trace_end("test \"trace\"", ctx);
+  const char* fname = "kklib-test-trace.json";
+  int err = kk_trace_write(fname);
+  require(err == 0);
+  FILE* f = fopen(fname, "r");
+  require(f != NULL);
+  char buf[4096];
+  const size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  buf[n] = 0;
+  fclose(f);
+  require(strncmp(buf, "{\"traceEvents\":[", 16) == 0);
+  require(strstr(buf, "{\"name\":\"test \\\"trace\\\"\",\"ph\":\"B\"") != NULL);
+  require(strstr(buf, "\"bigint mul\",\"ph\":\"E\"") != NULL);
+  remove(fname);
+  printf("trace: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
+// reference validation: valid UTF8 decodes and encodes to the same bytes
+static bool test_utf8_is_valid_ref(const uint8_t* s, size_t len) {
+  const uint8_t* p = s;
+  while (p < s + len) {
+    if (*p == 0) return false;
+    size_t count;
+    size_t wcount;
+    uint8_t buf[4];
+    kk_utf8_write(kk_utf8_read_validate(p, &count), buf, &wcount);
+    if (p + count > s + len || count != wcount || memcmp(p, buf, count) != 0) return false;
+    p += count;
+  }
+  return true;
+}
+
+static void test_utf8(kk_context_t* ctx) {
+  const char* chars[] = { "a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xED\x9F\xBF", "\xEF\xBF\xBD", "\xC0\x80", "z" };
+  const size_t nchars = sizeof(chars)/sizeof(chars[0]);
+  uint8_t buf[1024 + 8];
+  for (size_t seed = 0; seed < 64; seed++) {
+    // mixed text (with a mostly ASCII part)
+    size_t len = 0;
+    size_t count = 0;
+    uint32_t r = (uint32_t)seed;
+    while (len < 1024) {
+      r = r*1664525 + 1013904223;
+      const char* ch = chars[((r >> 24) % 4 == 0 ? (r >> 16) % nchars : 0)];
+      const size_t n = strlen(ch);
+      if (len + n > 1024) break;
+      memcpy(buf + len, ch, n);
+      len += n;
+      count++;
+    }
+    buf[len] = 0;
+    assert(kk_utf8_is_valid(buf, len));
+    assert(kk_utf8_count(buf, len) == count);
+    const uint8_t* p = buf;
+    for (size_t i = 0; i < count; i += 7) {
+      assert(kk_utf8_skip(buf, buf + len, i) == p);
+      for (size_t j = 0; j < 7; j++) { p = kk_utf8_next(p); }
+    }
+    assert(kk_utf8_skip(buf, buf + len, count + 100) == buf + len);
+    // corrupt single bytes and compare with the reference
+    for (size_t i = seed; i < len; i += 13) {
+      const uint8_t old = buf[i];
+      const uint8_t bad[] = { 0x00, 0x80, 0xBF, 0xC0, 0xC1, 0xE0, 0xED, 0xF0, 0xF4, 0xF5, 0xFF, 0x41 };
+      for (size_t k = 0; k < sizeof(bad); k++) {
+        buf[i] = bad[k];
+        assert(kk_utf8_is_valid(buf, len) == test_utf8_is_valid_ref(buf, len));
+      }
+      buf[i] = old;
+    }
+    // truncated at every length
+    for (size_t n = 0; n < 40; n++) {
+      assert(kk_utf8_is_valid(buf, n) == test_utf8_is_valid_ref(buf, n));
+    }
+  }
+  // invalid sequences become replacement characters
+  kk_string_t str = kk_string_validate_utf8(kk_string_alloc_dup("a\xFF" "b\xE2\x82" "c", ctx), ctx);
+  assert(strcmp(kk_string_cbuf_borrow(str), "a\xEF\xBF\xBD" "b\xEF\xBF\xBD" "c") == 0);
+  kk_string_drop(str, ctx);
+  printf("utf8: ok\n");
+}
+
+// reference search
+static const uint8_t* test_search_ref(const uint8_t* s, size_t n, const uint8_t* pat, size_t m, bool last) {
+  const uint8_t* found = NULL;
+  for (size_t i = 0; i + m <= n; i++) {
+    if (memcmp(s + i, pat, m) == 0) {
+      found = s + i;
+      if (!last) break;
+    }
+  }
+  return found;
+}
+
+static void test_string_search(kk_context_t* ctx) {
+  uint8_t hay[600];
+  uint8_t pat[100];
+  for (uint32_t seed = 0; seed < 400; seed++) {
+    // small alphabets to get many (periodic) partial matches
+    uint32_t r = seed;
+    const uint32_t alpha = 1 + seed % 3;
+    const size_t n = 1 + seed % sizeof(hay);
+    for (size_t i = 0; i < n; i++) {
+      r = r*1664525 + 1013904223;
+      hay[i] = (uint8_t)('a' + (r >> 24) % alpha);
+    }
+    for (size_t m = 1; m < sizeof(pat) && m <= n; m += 1 + m/8) {
+      r = r*1664525 + 1013904223;
+      if (r % 2 == 0) {
+        memcpy(pat, hay + (r >> 8) % (n - m + 1), m);  // a substring
+      }
+      else for (size_t i = 0; i < m; i++) {
+        r = r*1664525 + 1013904223;
+        pat[i] = (uint8_t)('a' + (r >> 24) % (alpha + 1));
+      }
+      require(kk_memsearch(hay, n, pat, m) == test_search_ref(hay, n, pat, m, false));
+      require(kk_memsearch_last(hay, n, pat, m) == test_search_ref(hay, n, pat, m, true));
+    }
+  }
+  // string primitives
+  kk_string_t str = kk_string_alloc_dup("ab--cd--ef----", ctx);
+  kk_string_t sep = kk_string_alloc_dup("--", ctx);
+  require(kk_string_count_pattern_borrow(str, sep) == 5);   // overlapping
+  require(kk_string_index_of1(kk_string_dup(str), kk_string_dup(sep), ctx) == 3);
+  require(kk_string_last_index_of1(kk_string_dup(str), kk_string_dup(sep), ctx) == 13);
+  kk_vector_t v = kk_string_splitv(kk_string_dup(str), kk_string_dup(sep), ctx);
+  size_t len;
+  kk_box_t* parts = kk_vector_buf(v, &len);
+  require(len == 5 && strcmp(kk_string_cbuf_borrow(kk_string_unbox(parts[2])), "ef") == 0 && kk_string_is_empty_borrow(kk_string_unbox(parts[4])));
+  kk_vector_drop(v, ctx);
+  kk_string_t t = kk_string_replace_all(str, sep, kk_string_alloc_dup("+", ctx), ctx);
+  require(strcmp(kk_string_cbuf_borrow(t), "ab+cd+ef++") == 0);
+  kk_string_drop(t, ctx);
+  printf("string search: ok\n");
+}
+
+static void test_string_append(kk_context_t* ctx) {
+  // repeated concatenation appends in-place to a unique left operand
+  char expect[4096 + 1];
+  kk_string_t str = kk_string_empty();
+  size_t reallocs = 0;
+  for (size_t i = 0; i < 1024; i++) {
+    const char* piece = (i % 3 == 0 ? "ab" : (i % 3 == 1 ? "cde" : "\xE2\x82\xAC"));
+    const uint8_t* before = kk_string_buf_borrow(str);
+    str = (i % 2 == 0 ? kk_string_cat(str, kk_string_alloc_dup(piece, ctx), ctx) : kk_string_cat_fromc(str, piece, ctx));
+    if (kk_string_buf_borrow(str) != before) reallocs++;
+  }
+  require(kk_string_len_borrow(str) == 1024/3*8 + 2 && reallocs < 32);
+  kk_string_t shared = kk_string_dup(str);   // no longer unique: must copy
+  kk_string_t str2 = kk_string_cat_fromc(str, "!", ctx);
+  require(!kk_datatype_eq(str2, shared) && kk_string_len_borrow(shared) + 1 == kk_string_len_borrow(str2));
+  kk_string_drop(str2, ctx);
+  // builder with small (copied) and large (shared) pieces
+  kk_string_builder_t sb = kk_string_builder_empty();
+  size_t n = 0;
+  for (size_t i = 0; i < 200; i++) {
+    if (i == 100) {
+      require(strlen(kk_string_builder_cbuf_borrow(&sb, ctx)) == n);
+    }
+    if (i % 50 == 7) {
+      kk_string_builder_append(&sb, kk_string_dup(shared), ctx);
+      n += kk_string_len_borrow(shared);
+    }
+    else {
+      snprintf(expect, sizeof(expect), "%zu,", i);
+      kk_string_builder_append_cstr(&sb, expect, ctx);
+      n += strlen(expect);
+    }
+  }
+  require(kk_string_builder_len_borrow(&sb) == n);
+  kk_string_t result = kk_string_builder_finish(&sb, ctx);
+  require(kk_string_len_borrow(result) == n && strncmp(kk_string_cbuf_borrow(result), "0,1,2,", 6) == 0);
+  require(kk_memsearch(kk_string_buf_borrow(result), n, (const uint8_t*)"6,abcde", 7) != NULL);
+  require(strcmp(kk_string_cbuf_borrow(result) + n - 4, "199,") == 0);
+  kk_string_drop(result, ctx);
+  kk_string_drop(shared, ctx);
+  sb = kk_string_builder_empty();
+  kk_string_builder_append_cstr(&sb, "dropped", ctx);
+  kk_string_builder_drop(&sb, ctx);
+  printf("string append: ok\n");
+}
+
+static void test_int_show_expect(kk_integer_t x, const char* expect, kk_context_t* ctx) {
+  kk_string_t s = kk_integer_to_string(x, ctx);
+  if (strcmp(kk_string_cbuf_borrow(s), expect) != 0) {
+    printf("integer show: expecting %s but got %s\n", expect, kk_string_cbuf_borrow(s));
+    assert(false);
+  }
+  kk_string_drop(s, ctx);
+}
+
+static void test_int_show(kk_context_t* ctx) {
+  char buf[64];
+  const kk_intx_t values[] = { 0, 1, -1, 9, 10, -10, 99, 100, 999999, 1000000, -1000000, 9999999, 10000000, KK_SMALLINT_MAX, KK_SMALLINT_MIN };
+  for (size_t i = 0; i < sizeof(values)/sizeof(values[0]); i++) {
+    snprintf(buf, 64, "%" PRId64, (int64_t)values[i]);
+    test_int_show_expect(kk_integer_from_int(values[i], ctx), buf, ctx);
+  }
+  // big integers with (partial) limbs that contain zeros
+  const char* bigs[] = { "1000000000000000000", "-1000000000000000000000000000000000000", "123456789012345678901234567890", "100000000000000000010000000000000000001", NULL };
+  for (size_t i = 0; bigs[i] != NULL; i++) {
+    test_int_show_expect(kk_integer_from_str(bigs[i], ctx), bigs[i], ctx);
+  }
+  uint64_t x = KU64(0x2545F4914F6CDD1D);
+  for (int i = 0; i < 10000; i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    const int64_t v = (int64_t)x >> (x % 64);
+    snprintf(buf, 64, "%" PRId64, v);
+    test_int_show_expect(kk_integer_from_int64(v, ctx), buf, ctx);
+  }
+  printf("integer show: ok\n");
+}
+
+static void test_double_show_expect(double d, int32_t prec, const char* expect, kk_context_t* ctx) {
+  kk_string_t s = kk_double_show(d, prec, ctx);
+  if (strcmp(kk_string_cbuf_borrow(s), expect) != 0) {
+    printf("double show %.17g: expecting %s but got %s\n", d, expect, kk_string_cbuf_borrow(s));
+    assert(false);
+  }
+  kk_string_drop(s, ctx);
+}
+
+// compare an explicit precision against `snprintf`
+static void test_double_show_prec(double d, int32_t prec, char spec) {
+  char buf[KK_DOUBLE_SHORTEST_MAX];
+  char expect[KK_DOUBLE_SHORTEST_MAX];
+  const size_t len = kk_double_to_prec(d, prec, spec, buf, sizeof(buf));
+  snprintf(expect, sizeof(expect), (spec == 'f' ? "%.*f" : (spec == 'e' ? "%.*e" : "%.*g")), (int)prec, d);
+  if (strcmp(buf, expect) != 0 || len != strlen(expect)) {
+    fprintf(stderr, "double show %.17g with %%.%i%c: expecting %s but got %s\n", d, (int)prec, spec, expect, buf);
+    require(false);
+  }
+}
+
+static void test_double_show(kk_context_t* ctx) {
+  test_double_show_expect(0.1, -17, "0.1", ctx);
+  test_double_show_expect(-0.0, -17, "-0", ctx);
+  test_double_show_expect(1.0/3.0, -17, "0.3333333333333333", ctx);
+  test_double_show_expect(123.456, -17, "123.456", ctx);
+  test_double_show_expect(1.0e16, -17, "10000000000000000", ctx);
+  test_double_show_expect(1.0e17, -17, "1e+17", ctx);
+  test_double_show_expect(1.5e-5, -17, "1.5e-05", ctx);
+  test_double_show_expect(0.00015, -17, "0.00015", ctx);
+  test_double_show_expect(5e-324, -17, "5e-324", ctx);
+  test_double_show_expect(DBL_MAX, -17, "1.7976931348623157e+308", ctx);
+  test_double_show_expect(3.14159, -2, "3.1", ctx);     // more digits than the precision
+  test_double_show_expect(HUGE_VAL, -17, "inf", ctx);
+  // round trip random bit patterns
+  uint64_t x = KU64(0x9E3779B97F4A7C15);
+  char buf[KK_DOUBLE_SHORTEST_MAX];
+  for (int i = 0; i < 100000; i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    double d;
+    memcpy(&d, &x, sizeof(d));
+    if (!isfinite(d)) continue;
+    const size_t len = kk_double_to_shortest(d, -17, buf, sizeof(buf));
+    const char* end;
+    const double e = kk_double_parse(buf, &end);
+    assert(memcmp(&d, &e, sizeof(d)) == 0 && end == buf + len);
+    assert(strtod(buf, NULL) == d);
+  }
+  // explicit precisions format like `snprintf`
+  const char specs[] = { 'f', 'e', 'g' };
+  for (int i = 0; i < 20000; i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    const double d = (double)(int64_t)(x % 2000001) / pow(10.0, (double)(x % 23)) * ((x>>40)%2 == 0 ? 1.0 : 1e10);
+    const char spec = specs[(x >> 32) % 3];
+    const int32_t prec = (int32_t)((x >> 48) % 21);
+    test_double_show_prec(d, prec, spec);
+  }
+  // subnormals have fewer significant bits than their shortest digits suggest
+  const double subnormals[] = { 5e-324, -5e-324, -0x0.099786f33ba8cp-1022, 0x0.fffffffffffffp-1022, 1e-310, 2.2250738585072e-308 };
+  for (size_t i = 0; i < sizeof(subnormals)/sizeof(subnormals[0]); i++) {
+    for (int32_t prec = 0; prec <= 20; prec++) {
+      for (size_t j = 0; j < 3; j++) { test_double_show_prec(subnormals[i], prec, specs[j]); }
+    }
+  }
+  for (int i = 0; i < 20000; i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    const uint64_t bits = (x & KU64(0x800FFFFFFFFFFFFF));  // zero exponent
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    test_double_show_prec(d, (int32_t)((x >> 52) % 17), specs[(x >> 32) % 3]);
+  }
+  // parse like `strtod`
+  const char* inputs[] = { "0", "-0", "1.5", "123.456e5", "1e22", "1e23", "12e30", "1e-22", "0.1x", "1e", ".5", "-.5e+1", "0x1p3", "inf", "  7", "12345678901234567890", NULL };
+  for (int i = 0; inputs[i] != NULL; i++) {
+    const char* end1;
+    char* end2;
+    const double d1 = kk_double_parse(inputs[i], &end1);
+    const double d2 = strtod(inputs[i], &end2);
+    assert(memcmp(&d1, &d2, sizeof(d1)) == 0 && end1 == end2);
+  }
+  printf("double show: ok\n");
+}
+
+static void test_read_file_size(size_t size, bool valid, kk_context_t* ctx) {
+  const char* path = "kklib-test-read.txt";
+  kk_string_t content = kk_string_alloc_buf(size, ctx);
+  char* p = (char*)kk_string_cbuf_borrow(content);
+  for (size_t i = 0; i < size; i++) {
+    p[i] = (i % 64 == 63 ? '\n' : (char)('a' + i%26));
+  }
+  if (!valid) p[size/2] = (char)0xFF;
+  int err = kk_os_write_text_file(kk_string_alloc_dup(path, ctx), kk_string_dup(content), ctx);
+  require(err == 0);
+  kk_string_t s;
+  err = kk_os_read_text_file(kk_string_alloc_dup(path, ctx), &s, ctx);
+  require(err == 0);
+  if (valid) {
+    require(kk_string_len_borrow(s) == size);
+    require(strncmp(kk_string_cbuf_borrow(s), p, size) == 0);
+    // replacing in-place must not write into the (mapped) file
+    s = kk_string_replace_all(s, kk_string_alloc_dup("abc", ctx), kk_string_alloc_dup("xyz", ctx), ctx);
+    require(kk_string_len_borrow(s) == size && strncmp(kk_string_cbuf_borrow(s), "xyzdef", 6) == 0);
+  }
+  else {
+    require(kk_string_len_borrow(s) == size + 2);  // replacement character
+  }
+  require(kk_string_cbuf_borrow(s)[kk_string_len_borrow(s)] == 0);
+  kk_string_drop(s, ctx);
+  kk_string_drop(content, ctx);
+  remove(path);
+}
+
+static void test_read_file(kk_context_t* ctx) {
+  test_read_file_size(1000, true, ctx);        // copied
+  test_read_file_size(1000, false, ctx);
+  test_read_file_size(1 << 20, true, ctx);     // mapped (with an extra zero page)
+  test_read_file_size((1 << 20) + 1, true, ctx);
+  test_read_file_size((1 << 20) + 1, false, ctx);
+  printf("read file: ok\n");
+}
+
+static void test_file_stream(kk_context_t* ctx) {
+  const char* path = "kklib-test-stream.txt";
+  kk_os_file_t f;
+  int err = kk_os_file_open(kk_string_alloc_dup(path, ctx), KK_OS_FILE_WRITE, &f, ctx);
+  require(err == 0);
+  // many short lines, one line longer than the read buffer, and a last line without a newline
+  char line[128];
+  const int nlines = 20000;
+  for (int i = 0; i < nlines; i++) {
+    snprintf(line, 128, "line %d: \xC3\xA9t\xC3\xA9%s\n", i, (i % 3 == 0 ? "\r" : ""));
+    err = kk_os_file_write_buf(f, (const uint8_t*)line, strlen(line), ctx);
+    require(err == 0);
+  }
+  kk_string_t longline = kk_string_alloc_buf(200000, ctx);
+  memset((char*)kk_string_cbuf_borrow(longline), 'x', 200000);
+  err = kk_os_file_write(f, kk_string_dup(longline), ctx);
+  require(err == 0);
+  kk_os_file_write_buf(f, (const uint8_t*)"\nbad \xFF\nlast", 11, ctx);
+  err = kk_os_file_close(f, ctx);
+  require(err == 0);
+  kk_os_file_free(f, ctx);
+  // read back lines
+  err = kk_os_file_open(kk_string_alloc_dup(path, ctx), KK_OS_FILE_READ, &f, ctx);
+  require(err == 0);
+  kk_string_t buf;
+  size_t start, len;
+  bool found;
+  kk_string_t first = kk_string_empty();
+  for (int i = 0; i < nlines; i++) {
+    err = kk_os_file_read_line(f, &buf, &start, &len, &found, ctx);
+    require(err == 0 && found);
+    const size_t n = (size_t)snprintf(line, 128, "line %d: \xC3\xA9t\xC3\xA9", i);
+    require(len == n && strncmp(kk_string_cbuf_borrow(buf) + start, line, n) == 0);
+    if (i == 0) first = buf;  // keep the first buffer alive
+           else kk_string_drop(buf, ctx);
+  }
+  require(kk_string_len_borrow(first) >= 8 && strncmp(kk_string_cbuf_borrow(first), "line 0: ", 8) == 0);
+  kk_string_drop(first, ctx);
+  err = kk_os_file_read_line(f, &buf, &start, &len, &found, ctx);
+  require(err == 0 && found && len == 200000 && strncmp(kk_string_cbuf_borrow(buf) + start, kk_string_cbuf_borrow(longline), 200000) == 0);
+  kk_string_drop(buf, ctx);
+  err = kk_os_file_read_line(f, &buf, &start, &len, &found, ctx);
+  require(err == 0 && found && len == 7 && strncmp(kk_string_cbuf_borrow(buf) + start, "bad \xEF\xBF\xBD", 7) == 0);  // replacement character
+  kk_string_drop(buf, ctx);
+  err = kk_os_file_read_line(f, &buf, &start, &len, &found, ctx);
+  require(err == 0 && found && len == 4 && strncmp(kk_string_cbuf_borrow(buf) + start, "last", 4) == 0);
+  kk_string_drop(buf, ctx);
+  err = kk_os_file_read_line(f, &buf, &start, &len, &found, ctx);
+  require(err == 0 && !found);
+  kk_os_file_free(f, ctx);
+  // read back in small chunks that never split a code point
+  err = kk_os_file_open(kk_string_alloc_dup(path, ctx), KK_OS_FILE_READ, &f, ctx);
+  require(err == 0);
+  size_t total = 0;
+  while (true) {
+    err = kk_os_file_read_chunk(f, 7, &buf, &start, &len, &found, ctx);  // (+2 for the replacement character)
+    require(err == 0);
+    if (!found) break;
+    require(len > 0 && len <= 7+2 && kk_utf8_is_valid(kk_string_buf_borrow(buf) + start, len));
+    total += len;
+    kk_string_drop(buf, ctx);
+  }
+  kk_os_file_free(f, ctx);
+  kk_string_drop(longline, ctx);
+  require(total > 200000);
+  remove(path);
+  printf("file stream: ok\n");
+}
+
+static void test_copy_file(kk_context_t* ctx) {
+  const char* from = "kklib-test-copy-from.txt";
+  const char* to = "kklib-test-copy-to.txt";
+  const size_t sizes[] = { 0, 10, (KUZ(1) << 20) + 3 };
+  for (size_t k = 0; k < sizeof(sizes)/sizeof(sizes[0]); k++) {
+    const size_t size = sizes[k];
+    kk_string_t content = kk_string_alloc_buf(size, ctx);
+    char* p = (char*)kk_string_cbuf_borrow(content);
+    for (size_t i = 0; i < size; i++) p[i] = (char)('a' + (i*7)%26);
+    int err = kk_os_write_text_file(kk_string_alloc_dup(from, ctx), kk_string_dup(content), ctx);
+    require(err == 0);
+    kk_os_write_text_file(kk_string_alloc_dup(to, ctx), kk_string_alloc_dup("an existing longer file", ctx), ctx);
+    err = kk_os_copy_file(kk_string_alloc_dup(from, ctx), kk_string_alloc_dup(to, ctx), true, ctx);
+    require(err == 0);
+    kk_string_t copy;
+    err = kk_os_read_text_file(kk_string_alloc_dup(to, ctx), &copy, ctx);
+    require(err == 0 && kk_string_len_borrow(copy) == size && strncmp(kk_string_cbuf_borrow(copy), p, size) == 0);
+    kk_string_drop(copy, ctx);
+    kk_string_drop(content, ctx);
+  }
+  remove(from);
+  remove(to);
+  printf("copy file: ok\n");
+}
+
+static size_t test_walk_count(const char* dir, size_t max_depth, bool follow_links, size_t* dirs, kk_context_t* ctx) {
+  kk_os_walker_t w;
+  int err = kk_os_walker_open(kk_string_alloc_dup(dir, ctx), max_depth, follow_links, &w, ctx);
+  require(err == 0);
+  size_t count = 0;
+  *dirs = 0;
+  kk_string_t path;
+  kk_os_entry_kind_t kind;
+  while (kk_os_walker_next(w, &path, &kind, ctx)) {
+    require(strncmp(kk_string_cbuf_borrow(path), dir, strlen(dir)) == 0);
+    if (kind == KK_OS_ENTRY_DIR) (*dirs)++;
+    count++;
+    kk_string_drop(path, ctx);
+  }
+  kk_os_walker_free(w, ctx);
+  return count;
+}
+
+static void test_walk_directory(kk_context_t* ctx) {
+  // a tree of 3 levels with 2 sub-directories and 3 files in each directory
+  char path[256];
+  const char* root = "kklib-test-walk";
+  for (int i = 0; i < 3*3*3; i++) {
+    snprintf(path, 256, "%s/d%d/d%d/d%d", root, i/9, (i/3)%3 % 2, i%3 % 2);
+    kk_os_ensure_dir(kk_string_alloc_dup(path, ctx), -1, ctx);
+  }
+  size_t files = 0;
+  kk_os_walker_t w;
+  int err = kk_os_walker_open(kk_string_alloc_dup(root, ctx), 100, false, &w, ctx);
+  require(err == 0);
+  kk_string_t p;
+  kk_os_entry_kind_t kind;
+  while (kk_os_walker_next(w, &p, &kind, ctx)) {
+    if (kind == KK_OS_ENTRY_DIR) {
+      for (int j = 0; j < 3; j++) {
+        snprintf(path, 256, "%s/f%d", kk_string_cbuf_borrow(p), j);
+        kk_os_write_text_file(kk_string_alloc_dup(path, ctx), kk_string_alloc_dup("x", ctx), ctx);
+        files++;
+      }
+    }
+    kk_string_drop(p, ctx);
+  }
+  kk_os_walker_free(w, ctx);
+  require(files == 3*(3 + 3*2 + 3*2*2));  // the directory d2 is always created
+  size_t dirs;
+  size_t count = test_walk_count(root, 100, false, &dirs, ctx);
+  require(count == files + dirs && dirs == 3 + 3*2 + 3*2*2);
+  count = test_walk_count(root, 0, false, &dirs, ctx);
+  require(count == 3 && dirs == 3);
+  count = test_walk_count(root, 1, false, &dirs, ctx);
+  require(count == 3 + 3*(2+3) && dirs == 3 + 3*2);
+  err = kk_os_walker_open(kk_string_alloc_dup("kklib-test-walk-none", ctx), 100, false, &w, ctx);
+  require(err != 0);
+  kk_string_t cmd = kk_string_alloc_dup("rm -rf kklib-test-walk", ctx);
+#if defined(_WIN32)
+  kk_string_drop(cmd, ctx);
+  cmd = kk_string_alloc_dup("rmdir /s /q kklib-test-walk", ctx);
+#endif
+  kk_os_run_system(cmd, ctx);
+  printf("walk directory: ok\n");
+}
+
+#if !defined(_WIN32)
+static kk_vector_t test_argv(size_t argc, const char** argv, kk_context_t* ctx) {
+  kk_vector_t v = kk_vector_alloc(argc, kk_box_null, ctx);
+  kk_box_t* buf = kk_vector_buf(v, NULL);
+  for (size_t i = 0; i < argc; i++) buf[i] = kk_string_box(kk_string_alloc_dup(argv[i], ctx));
+  return v;
+}
+
+static int test_spawn_wait(kk_os_process_t p, kk_context_t* ctx) {
+  int exit_code;
+  kk_msecs_t utime, stime;
+  size_t peak_rss, faults, reclaim;
+  int err = kk_os_process_wait(p, &exit_code, &utime, &stime, &peak_rss, &faults, &reclaim, ctx);
+  require(err == 0 && utime >= 0 && stime >= 0);
+  return exit_code;
+}
+
+static void test_spawn(kk_context_t* ctx) {
+  // both streams
+  const char* argv1[] = { "sh", "-c", "printf 'out\\n'; printf 'err' >&2; exit 3" };
+  kk_os_process_t p;
+  int err = kk_os_process_spawn(test_argv(3, argv1, ctx), true, true, &p, ctx);
+  require(err == 0);
+  kk_string_builder_t out = kk_string_builder_empty();
+  kk_string_builder_t errs = kk_string_builder_empty();
+  kk_string_t chunk;
+  bool is_err, found;
+  while ((err = kk_os_process_read(p, &chunk, &is_err, &found, ctx)) == 0 && found) {
+    kk_string_builder_append(is_err ? &errs : &out, chunk, ctx);
+  }
+  require(err == 0);
+  kk_string_t sout = kk_string_builder_finish(&out, ctx);
+  kk_string_t serr = kk_string_builder_finish(&errs, ctx);
+  require(strcmp(kk_string_cbuf_borrow(sout), "out\n") == 0 && strcmp(kk_string_cbuf_borrow(serr), "err") == 0);
+  kk_string_drop(sout, ctx);
+  kk_string_drop(serr, ctx);
+  require(test_spawn_wait(p, ctx) == 3);
+  require(test_spawn_wait(p, ctx) == 3);  // waiting again returns the same status
+  kk_os_process_free(p, ctx);
+  // large output in multiple chunks
+  const char* argv2[] = { "seq", "1", "100000" };
+  err = kk_os_process_spawn(test_argv(3, argv2, ctx), true, false, &p, ctx);
+  require(err == 0);
+  size_t len = 0;
+  size_t chunks = 0;
+  while (kk_os_process_read(p, &chunk, &is_err, &found, ctx) == 0 && found) {
+    require(!is_err);
+    len += kk_string_len_borrow(chunk);
+    chunks++;
+    kk_string_drop(chunk, ctx);
+  }
+  require(len == 588895 && chunks > 1);
+  require(test_spawn_wait(p, ctx) == 0);
+  kk_os_process_free(p, ctx);
+  // unread output is discarded on wait
+  err = kk_os_process_spawn(test_argv(3, argv2, ctx), true, false, &p, ctx);
+  require(err == 0);
+  require(test_spawn_wait(p, ctx) == 0);
+  kk_os_process_free(p, ctx);
+  // a missing program
+  const char* argv3[] = { "kklib-test-no-such-program" };
+  err = kk_os_process_spawn(test_argv(1, argv3, ctx), false, false, &p, ctx);
+  if (err == 0) {
+    require(test_spawn_wait(p, ctx) == 127);  // older libc's report the failure in the child
+    kk_os_process_free(p, ctx);
+  }
+  else {
+    require(err == ENOENT && p == NULL);
+  }
+  // a process that is freed without waiting does not block, but is still reaped (and does not linger as a zombie)
+  const char* argv4[] = { "sh", "-c", "sleep 0.5" };
+  err = kk_os_process_spawn(test_argv(3, argv4, ctx), false, false, &p, ctx);
+  require(err == 0);
+  kk_timer_t start = kk_timer_start();
+  kk_os_process_free(p, ctx);
+  require(kk_timer_end(start) < 250000);  // in usecs
+  siginfo_t info;
+  int res;
+  for (int i = 0; i < 500 && (res = waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT)) == 0; i++) {
+    usleep(10000);  // still running, or exited but not yet reaped
+  }
+  require(res < 0 && errno == ECHILD);
+  printf("spawn: ok\n");
+}
+#endif
+
+static size_t test_reactor_wait(kk_reactor_t r, kk_msecs_t timeout, kk_integer_t* first, kk_context_t* ctx) {
+  kk_vector_t ready;
+  int err = kk_reactor_wait(r, timeout, &ready, ctx);
+  require(err == 0);
+  size_t n;
+  kk_box_t* buf = kk_vector_buf(ready, &n);
+  *first = (n > 0 ? kk_integer_unbox(kk_box_dup(buf[0])) : kk_integer_from_small(0));
+  kk_vector_drop(ready, ctx);
+  return n;
+}
+
+static void test_reactor(kk_context_t* ctx) {
+  kk_reactor_t r;
+  int err = kk_reactor_create(&r, ctx);
+  require(err == 0);
+  kk_integer_t x;
+  require(test_reactor_wait(r, -1, &x, ctx) == 0);  // nothing pending
+  // timers complete in deadline order
+  kk_timer_t start = kk_timer_start();
+  kk_reactor_add_timer(r, 20, kk_integer_box(kk_integer_from_small(2)), ctx);
+  kk_reactor_add_timer(r, 0, kk_integer_box(kk_integer_from_small(1)), ctx);
+  require(kk_reactor_pending(r) == 2);
+  require(test_reactor_wait(r, -1, &x, ctx) == 1 && kk_integer_eq(x, kk_integer_from_small(1), ctx));
+  require(test_reactor_wait(r, -1, &x, ctx) == 1 && kk_integer_eq(x, kk_integer_from_small(2), ctx));
+  require(kk_timer_end(start) >= 19000);
+#if !defined(_WIN32)
+  // pipes
+  int fds[2];
+  err = pipe(fds);
+  require(err == 0);
+  err = kk_reactor_add_fd(r, fds[0], false, kk_integer_box(kk_integer_from_small(3)), ctx);
+  require(err == 0);
+  err = kk_reactor_add_fd(r, fds[0], false, kk_integer_box(kk_integer_from_small(4)), ctx);
+  require(err == EBUSY);
+  require(test_reactor_wait(r, 10, &x, ctx) == 0);  // not readable yet
+  err = kk_reactor_add_fd(r, fds[1], true, kk_integer_box(kk_integer_from_small(5)), ctx);
+  require(err == 0);
+  require(test_reactor_wait(r, -1, &x, ctx) == 1 && kk_integer_eq(x, kk_integer_from_small(5), ctx));
+  require(write(fds[1], "x", 1) == 1);
+  require(test_reactor_wait(r, -1, &x, ctx) == 1 && kk_integer_eq(x, kk_integer_from_small(3), ctx));
+  require(kk_reactor_pending(r) == 0);
+  // pending values are released with the reactor
+  kk_reactor_add_fd(r, fds[0], false, kk_string_box(kk_string_alloc_dup("pending read", ctx)), ctx);
+  kk_reactor_add_timer(r, 1000, kk_string_box(kk_string_alloc_dup("pending timer", ctx)), ctx);
+  kk_reactor_free(r, ctx);
+  close(fds[0]);
+  close(fds[1]);
+#else
+  kk_reactor_free(r, ctx);
+#endif
+  printf("reactor: ok\n");
+}
+
+static void test_vector_push(kk_context_t* ctx) {
+  const size_t n = 100000;
+  kk_vector_t v = kk_vector_empty();
+  kk_vector_t w = kk_vector_empty();
+  size_t reallocs = 0;
+  for (size_t i = 0; i < n; i++) {
+    const size_t cap = kk_vector_capacity(v);
+    v = kk_vector_push(v, kk_integer_box(kk_integer_from_size_t(i, ctx)), ctx);
+    if (kk_vector_capacity(v) != cap) reallocs++;
+    if (i == n/2) {
+      kk_vector_drop(w, ctx);
+      w = kk_vector_dup(v);  // a shared vector is copied
+    }
+  }
+  require(kk_vector_len(v) == n && kk_vector_capacity(v) >= n);
+  require(reallocs < 20);  // geometric growth
+  require(kk_vector_len(w) == n/2 + 1);
+  kk_box_t* buf = kk_vector_buf(v, NULL);
+  for (size_t i = 0; i < n; i++) {
+    require(kk_integer_eq(kk_integer_unbox(buf[i]), kk_integer_from_size_t(i, ctx), ctx));
+  }
+  // shrinking releases the excess storage and drops the elements
+  v = kk_vector_realloc(v, 10, kk_box_null, ctx);
+  require(kk_vector_len(v) == 10 && kk_vector_capacity(v) == 10);
+  v = kk_vector_realloc(v, 12, kk_integer_box(kk_integer_from_small(-1)), ctx);
+  require(kk_integer_eq(kk_integer_unbox(kk_vector_buf(v, NULL)[11]), kk_integer_from_small(-1), ctx));
+  kk_vector_drop(v, ctx);
+  kk_vector_drop(w, ctx);
+  printf("vector push: ok\n");
+}
+
+static void test_pvector(kk_context_t* ctx) {
+  const size_t n = 1003;  // not iv multiple of the unroll factor
+  kk_pvector_t x = kk_pvector_alloc_double(n, 0.0, ctx);
+  kk_pvector_t y = kk_pvector_alloc_double(n, 1.0, ctx);
+  double* px = kk_pvector_double_buf(x);
+  for (size_t i = 0; i < n; i++) { px[i] = (double)i; }
+  require(kk_pvector_double_sum_borrow(x) == (double)(n*(n-1)/2));
+  require(kk_pvector_double_dot_borrow(x, y) == (double)(n*(n-1)/2));
+  // copy on write: `y` is shared so axpy allocates
+  kk_pvector_t z = kk_pvector_double_axpy(2.0, kk_pvector_dup(x), kk_pvector_dup(y), ctx);
+  require(z != y && kk_pvector_double_buf(y)[5] == 1.0 && kk_pvector_double_buf(z)[5] == 11.0);
+  // in place when unique
+  kk_pvector_t z2 = kk_pvector_double_scale(z, 0.5, ctx);
+  require(z2 == z && kk_pvector_double_buf(z2)[5] == 5.5);
+  kk_pvector_drop(z2, ctx);
+  kk_pvector_drop(y, ctx);
+
+  // int32 and int64 kernels
+  kk_pvector_t iv = kk_pvector_alloc_int32(n, -3, ctx);
+  require(kk_pvector_len(iv) == n && kk_pvector_int32_sum_borrow(iv) == -3*(int64_t)n);
+  kk_pvector_t lv = kk_pvector_alloc_int64(n, (int64_t)1 << 40, ctx);
+  kk_pvector_t lw = kk_pvector_alloc_int64(4, 2, ctx);
+  require(kk_pvector_int64_dot_borrow(lv, lw) == (int64_t)8 << 40);  // over the shortest length
+  kk_pvector_drop(lw, ctx);
+  require(kk_pvector_int64_sum_borrow(lv) == (int64_t)n << 40);
+
+  // slicing, appending, and converting to and from boxed vectors
+  iv = kk_pvector_append(iv, kk_pvector_alloc_int32(7, 5, ctx), ctx);
+  require(kk_pvector_len(iv) == n + 7 && kk_pvector_int32_buf(iv)[n + 6] == 5);
+  iv = kk_pvector_slice(iv, n - 1, 100, ctx);
+  require(kk_pvector_len(iv) == 8 && kk_pvector_int32_sum_borrow(iv) == -3 + 7*5);
+  kk_vector_t va = kk_pvector_to_vector(iv, ctx);
+  require(kk_vector_len(va) == 8 && kk_int32_unbox(kk_vector_at(va, 0), ctx) == -3);
+  iv = kk_pvector_from_vector(va, KK_TAG_VECTOR_INT32, ctx);
+  require(kk_pvector_int32_sum_borrow(iv) == -3 + 7*5);
+  kk_pvector_t d = kk_pvector_from_vector(kk_pvector_to_vector(kk_pvector_dup(x), ctx), KK_TAG_VECTOR_DOUBLE, ctx);
+  require(kk_pvector_double_dot_borrow(d, x) == kk_pvector_double_dot_borrow(x, x));
+  kk_pvector_t bytes = kk_pvector_alloc_bytes(16, 0xAB, ctx);
+  assert(kk_pvector_bytes_buf(bytes)[15] == 0xAB);
+  kk_pvector_drop(bytes, ctx);
+  kk_pvector_drop(d, ctx);
+  kk_pvector_drop(iv, ctx);
+  kk_pvector_drop(lv, ctx);
+  kk_pvector_drop(x, ctx);
+  printf("primitive vectors: ok\n");
+}
+
+static void test_print(kk_context_t* ctx) {
+#if !defined(_WIN32)
+  // redirect stdout to a file: output is buffered until flushed
+  fflush(stdout);
+  FILE* f = tmpfile();
+  assert(f != NULL);
+  const int saved = dup(fileno(stdout));
+  dup2(fileno(f), fileno(stdout));
+  kk_println(kk_string_alloc_dup("line 1", ctx), ctx);
+  kk_print(kk_string_alloc_dup("line 2\n", ctx), ctx);
+  assert(fseek(f, 0, SEEK_END) == 0 && ftell(f) == 0);  // nothing written yet
+  kk_string_t big = kk_string_repeat(kk_string_alloc_dup("0123456789abcdef", ctx), 8192, ctx);  // larger than the buffer
+  kk_print(big, ctx);
+  kk_println(kk_string_alloc_dup("end", ctx), ctx);
+  kk_print_flush(ctx);
+  dup2(saved, fileno(stdout));
+  close(saved);
+  char buf[32];
+  assert(fseek(f, 0, SEEK_END) == 0 && ftell(f) == 14 + 16*8192 + 4);
+  assert(fseek(f, 0, SEEK_SET) == 0 && fread(buf, 1, 14, f) == 14 && memcmp(buf, "line 1\nline 2\n", 14) == 0);
+  fclose(f);
+  printf("print: ok\n");
+#else
+  KK_UNUSED(ctx);
+#endif
+}
+
 static void test_ovf(kk_context_t* ctx) {
   /*
   add + subtract, 100000000x
@@ -518,7 +1876,7 @@ static void test_ovf(kk_context_t* ctx) {
   for (; i < 100000000; i += delta) { n = kk_integer_inc(n, ctx); }
   for (; i > 0; i -= delta) { n = kk_integer_dec(n, ctx); }
   msecs_t end = _clock_end(start);
-  kk_integer_print(n, ctx);
+  print_integer(n, ctx);
   printf("\nint-inc-dec: %6.3fs\n", (double)end/1000.0);
 }
 
@@ -535,11 +1893,48 @@ int main() {
   test_addx(ctx);
   test_carry(ctx);
   test_large(ctx);
+  test_mul_large(ctx);
+  test_div_large(ctx);
+  test_add_mul(ctx);
+  test_hex_large(ctx);
   test_cdiv(ctx);
   test_count(ctx);
   test_pow10(ctx);
   test_double(ctx);
   test_ovf(ctx);
+  test_delayed_free(ctx);
+  test_delayed_free_nested(ctx);
+  test_region(ctx);
+  test_box_any(ctx);
+  test_context_lazy(ctx);
+  test_block_pool(ctx);
+  test_mark_shared(ctx);
+  test_task(ctx);
+  test_vector_par(ctx);
+  test_task_for(ctx);
+  test_task_spread(ctx);
+  test_ref_shared(ctx);
+  test_shared_defer(ctx);
+  test_shared_defer_evict(ctx);
+  test_heap_profile(ctx);
+  test_trace(ctx);
+  test_utf8(ctx);
+  test_string_search(ctx);
+  test_string_append(ctx);
+  test_int_show(ctx);
+  test_double_show(ctx);
+  test_read_file(ctx);
+  test_file_stream(ctx);
+  test_copy_file(ctx);
+  test_walk_directory(ctx);
+#if !defined(_WIN32)
+  test_spawn(ctx);
+#endif
+  test_reactor(ctx);
+  test_vector_push(ctx);
+  test_pvector(ctx);
+  test_print(ctx);
+  test_random_fill(ctx);
   // test_count10(ctx);
   // test_popcount();
   // test_bitcount();
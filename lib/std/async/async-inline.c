@@ -0,0 +1,38 @@
+/*---------------------------------------------------------------------------
+  Copyright 2020, Daan Leijen, Microsoft Corporation.
+
+  This is free software; you can redistribute it and/or modify it under the
+  terms of the Apache License, Version 2.0. A copy of the License can be
+  found in the file "license.txt" at the root of this distribution.
+---------------------------------------------------------------------------*/
+
+static kk_std_core__error kk_reactor_create_error( kk_context_t* ctx ) {
+  kk_reactor_t reactor;
+  const int err = kk_reactor_create(&reactor,ctx);
+  return kk_error_from_errno(err,(err==0 ? kk_reactor_box(reactor,ctx) : kk_unit_box(kk_Unit)),ctx);
+}
+
+static kk_std_core__error kk_reactor_add_fd_error( kk_box_t reactor, kk_integer_t fd, bool write, kk_function_t k, kk_context_t* ctx ) {
+  const int err = kk_reactor_add_fd(kk_reactor_unbox(reactor),kk_integer_clamp(fd,ctx),write,kk_function_box(k),ctx);
+  kk_box_drop(reactor,ctx);
+  return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_reactor_add_timer_error( kk_box_t reactor, kk_integer_t msecs, kk_function_t k, kk_context_t* ctx ) {
+  const int err = kk_reactor_add_timer(kk_reactor_unbox(reactor),kk_integer_clamp64(msecs,ctx),kk_function_box(k),ctx);
+  kk_box_drop(reactor,ctx);
+  return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_reactor_wait_error( kk_box_t reactor, kk_context_t* ctx ) {
+  kk_vector_t ready;
+  const int err = kk_reactor_wait(kk_reactor_unbox(reactor),-1,&ready,ctx);
+  kk_box_drop(reactor,ctx);
+  return kk_error_from_errno(err,kk_vector_box(ready,ctx),ctx);
+}
+
+static kk_integer_t kk_reactor_pending_prim( kk_box_t reactor, kk_context_t* ctx ) {
+  const size_t n = kk_reactor_pending(kk_reactor_unbox(reactor));
+  kk_box_drop(reactor,ctx);
+  return kk_integer_from_size_t(n,ctx);
+}
@@ -9,54 +9,78 @@
 ---------------------------------------------------------------------------*/
 
 kk_std_core__list kk_vector_to_list(kk_vector_t v, kk_std_core__list tail, kk_context_t* ctx) {
-  // todo: avoid boxed_dup if v is unique
   size_t n;
   kk_box_t* p = kk_vector_buf(v, &n);
   if (n == 0) {
     kk_vector_drop(v,ctx);
     return tail;
   }
-  kk_std_core__list nil  = kk_std_core__new_Nil(ctx);
-  struct kk_std_core_Cons* cons = NULL;
-  kk_std_core__list list = kk_std_core__new_Nil(ctx);
-  for( size_t i = 0; i < n; i++ ) {
-    kk_std_core__list hd = kk_std_core__new_Cons(kk_reuse_null,kk_box_dup(p[i]), nil, ctx);
-    if (cons==NULL) {
-      list = hd;
-    }
-    else {
-      cons->tail = hd;
-    }
-    cons = kk_std_core__as_Cons(hd);
+  // move the elements out of a unique vector
+  const bool owned = kk_datatype_is_unique(v);
+  // build the list from the back so every cell is complete when allocated
+  kk_std_core__list list = tail;
+  for( size_t i = n; i > 0; ) {
+    i--;
+    list = kk_std_core__new_Cons(kk_reuse_null, (owned ? p[i] : kk_box_dup(p[i])), list, ctx);
+  }
+  if (owned) {
+    kk_block_free(kk_datatype_as_ptr(v));  // only the vector itself as the elements are moved
+  }
+  else {
+    kk_vector_drop(v,ctx);
   }
-  cons->tail = tail;
-  kk_vector_drop(v,ctx);
   return list;
 }
 
 kk_vector_t kk_list_to_vector(kk_std_core__list xs, kk_context_t* ctx) {
-  // todo: avoid boxed_dup if xs is unique
-  // find the length
+  if (!kk_std_core__is_Cons(xs)) {
+    kk_std_core__list_drop(xs,ctx);
+    return kk_vector_empty();
+  }
+  // visit the list once while growing the vector geometrically; inside a region the
+  // vector cannot be reallocated so we count the elements first and allocate it exactly
+  size_t cap = 8;
   size_t len = 0;
-  kk_std_core__list ys = xs;
-  while (kk_std_core__is_Cons(ys)) {
-    struct kk_std_core_Cons* cons = kk_std_core__as_Cons(ys);
-    len++;
-    ys = cons->tail;
+  if (ctx->region != NULL) {
+    cap = 0;
+    for (kk_std_core__list ys = xs; kk_std_core__is_Cons(ys); ys = kk_std_core__as_Cons(ys)->tail) {
+      cap++;
+    }
   }
-  // alloc the vector and copy
-  kk_vector_t v = kk_vector_alloc(len,kk_box_null,ctx);
+  kk_vector_t v = kk_vector_alloc_capacity(0, cap, kk_box_null, ctx);
   kk_box_t* p = kk_vector_buf(v,NULL);
-  ys = xs;
-  for( size_t i = 0; i < len; i++) {
+  // as long as the cells are unique, move the elements and free the cells;
+  // once a cell is shared, the rest of the list is borrowed from it
+  bool owned = true;
+  kk_std_core__list shared = xs;
+  kk_std_core__list ys = xs;
+  while (kk_std_core__is_Cons(ys)) {
     struct kk_std_core_Cons* cons = kk_std_core__as_Cons(ys);
-    ys = cons->tail;
-    p[i] = kk_box_dup(cons->head);
+    if (len == cap) {
+      cap *= 2;
+      v = kk_vector_realloc_capacity(v, cap, ctx);
+      p = kk_vector_buf(v,NULL);
+    }
+    if (owned && kk_datatype_is_unique(ys)) {
+      p[len++] = cons->head;
+      kk_std_core__list tl = cons->tail;
+      kk_block_pool_free(kk_datatype_as_ptr(ys), ctx);
+      ys = tl;
+    }
+    else {
+      if (owned) { owned = false; shared = ys; }
+      p[len++] = kk_box_dup(cons->head);
+      ys = cons->tail;
+    }
   }
+  if (!owned) kk_std_core__list_drop(shared,ctx);
+  kk_vector_as_large(v)->_base.large_scan_fsize = kk_enum_box(len + KK_VECTOR_HEADER_FSIZE);
+  if (cap > len) v = kk_vector_realloc_capacity(v, len, ctx);  // release the slack
   return v;
 }
 
 kk_vector_t kk_vector_init( size_t n, kk_function_t init, kk_context_t* ctx) {
+  if (n >= KK_VECTOR_PAR_MIN) return kk_vector_init_par(n, init, ctx);  // `init` is total
   kk_vector_t v = kk_vector_alloc(n,kk_box_null,ctx);
   kk_box_t* p = kk_vector_buf(v,NULL);
   for(size_t i = 0; i < n; i++) {
@@ -67,6 +91,16 @@ kk_vector_t kk_vector_init( size_t n, kk_function_t init, kk_context_t* ctx) {
   return v;
 }
 
+kk_vector_t kk_vector_fill( size_t n, kk_box_t x, kk_context_t* ctx) {
+  kk_vector_t v = kk_vector_alloc(n,kk_box_null,ctx);
+  kk_box_t* p = kk_vector_buf(v,NULL);
+  for(size_t i = 0; i < n; i++) {
+    p[i] = kk_box_dup(x);
+  }
+  kk_box_drop(x,ctx);
+  return v;
+}
+
 kk_box_t kk_main_console( kk_function_t action, kk_context_t* ctx ) {
   return kk_function_call(kk_box_t,(kk_function_t,kk_unit_t,kk_context_t*),action,(action,kk_Unit,ctx));
 }
@@ -126,16 +160,10 @@ static inline void kk_sslice_start_end_borrow( kk_std_core__sslice sslice, const
 }
 
 kk_integer_t kk_slice_count( kk_std_core__sslice sslice, kk_context_t* ctx ) {
-  // TODO: optimize this by extending kk_string_count
   const uint8_t* start;
   const uint8_t* end;
   kk_sslice_start_end_borrow(sslice, &start, &end);
-  size_t count = 0;
-  while( start < end && *start != 0 ) {
-    const uint8_t* next = kk_utf8_next(start);
-    count++;
-    start = next;
-  }
+  const size_t count = kk_utf8_count(start, (size_t)(end - start));
   return kk_integer_from_size_t(count,ctx);
 }
 
@@ -190,17 +218,15 @@ kk_std_core_types__maybe kk_slice_next( struct kk_std_core_Sslice slice, kk_cont
 struct kk_std_core_Sslice kk_slice_extend( struct kk_std_core_Sslice slice, kk_integer_t count, kk_context_t* ctx ) {
   ptrdiff_t cnt = kk_integer_clamp(count,ctx);
   if (cnt==0 || (slice.len == 0 && cnt<0)) return slice;
-  const uint8_t* const s0 = kk_string_buf_borrow(slice.str);  // start
-  const uint8_t* const s1 = s0 + slice.start + slice.len;  // end
+  const uint8_t* const sstart = kk_string_buf_borrow(slice.str);
+  const uint8_t* const send = sstart + kk_string_len_borrow(slice.str);
+  const uint8_t* const s0 = sstart + slice.start;  // start
+  const uint8_t* const s1 = s0 + slice.len;        // end
   const uint8_t* t  = s1;
   if (cnt >= 0) {
-    do {
-      t = kk_utf8_next(t);
-      cnt--;
-    } while (cnt > 0 && *t != 0);
+    t = kk_utf8_skip(t, send, (size_t)cnt);
   }
   else {  // cnt < 0
-    const uint8_t* sstart = s0 - slice.start;
     do {
       t = kk_utf8_prev(t);
       cnt++;
@@ -214,17 +240,14 @@ struct kk_std_core_Sslice kk_slice_advance( struct kk_std_core_Sslice slice, kk_
   const ptrdiff_t cnt0 = kk_integer_clamp(count,ctx);
   ptrdiff_t cnt = cnt0;
   if (cnt==0 || (slice.start == 0 && cnt<0)) return slice;
-  const uint8_t* const s0 = kk_string_buf_borrow(slice.str);  // start
-  const uint8_t* const s1 = s0 + slice.start + slice.len;  // end
-  const uint8_t* const sstart = s0 - slice.start;
-  kk_assert_internal(sstart == kk_string_buf_borrow(slice.str));
+  const uint8_t* const sstart = kk_string_buf_borrow(slice.str);
+  const uint8_t* const send = sstart + kk_string_len_borrow(slice.str);
+  const uint8_t* const s0 = sstart + slice.start;  // start
+  const uint8_t* const s1 = s0 + slice.len;        // end
   // advance the start
   const uint8_t* t0  = s0;
   if (cnt >= 0) {
-    do {
-      t0 = kk_utf8_next(t0);
-      cnt--;
-    } while (cnt > 0 && *t0 != 0);
+    t0 = kk_utf8_skip(t0, send, (size_t)cnt);
   }
   else {  // cnt < 0
     do {
@@ -237,10 +260,7 @@ struct kk_std_core_Sslice kk_slice_advance( struct kk_std_core_Sslice slice, kk_
   const uint8_t* t1 = s1;
   cnt = cnt0;
   if (cnt >= 0) {
-    do {
-      t1 = kk_utf8_next(t1);
-      cnt--;
-    } while (cnt > 0 && *t1 != 0);
+    t1 = kk_utf8_skip(t1, send, (size_t)cnt);
   }
   else {  // cnt < 0
     do {
@@ -265,6 +285,99 @@ struct kk_std_core_Sslice kk_slice_common_prefix( kk_string_t str1, kk_string_t
   return kk_std_core__new_Sslice(str1, 0, count, ctx);
 }
 
+// Split a slice in at most `n` parts delimited by `sep` (or into characters if `sep` is empty).
+// The parts are slices that share the string of `slice`; only the slice headers are allocated.
+kk_vector_t kk_slice_splitv_atmost( struct kk_std_core_Sslice slice, kk_string_t sep, size_t n, kk_context_t* ctx ) {
+  const uint8_t* start;
+  const uint8_t* end;
+  kk_sslice_start_end_borrow(slice, &start, &end);
+  const uint8_t* const sstart = kk_string_buf_borrow(slice.str);
+  const uint8_t* const psep = kk_string_buf_borrow(sep);
+  const size_t seplen = kk_string_len_borrow(sep);
+  if (n < 1) n = 1;
+  size_t count;  // count of parts
+  if (seplen > 0) {
+    count = 1;
+    const uint8_t* r = start;
+    while (count < n && ((r = kk_memsearch(r, (size_t)(end - r), psep, seplen)) != NULL)) {
+      count++;
+      r += seplen;
+    }
+  }
+  else {
+    count = kk_utf8_count(start, slice.len);
+    if (count > n) count = n;
+    if (count == 0) count = 1;
+  }
+  kk_vector_t v = kk_vector_alloc(count, kk_box_null, ctx);
+  kk_box_t* parts = kk_vector_buf(v, NULL);
+  const uint8_t* p = start;
+  for (size_t i = 0; i < count - 1; i++) {
+    const uint8_t* r = (seplen > 0 ? kk_memsearch(p, (size_t)(end - p), psep, seplen) : kk_utf8_next(p));
+    kk_assert_internal(r != NULL && r <= end);
+    kk_std_core__sslice part = kk_std_core__new_Sslice(kk_string_dup(slice.str), (size_t)(p - sstart), (size_t)(r - p), ctx);
+    parts[i] = kk_std_core__sslice_box(part, ctx);
+    p = r + seplen;
+  }
+  kk_assert_internal(p <= end);
+  kk_std_core__sslice last = kk_std_core__new_Sslice(slice.str, (size_t)(p - sstart), (size_t)(end - p), ctx);  // takes ownership of the string
+  parts[count-1] = kk_std_core__sslice_box(last, ctx);
+  kk_string_drop(sep, ctx);
+  return v;
+}
+
+// Return `Just((field,rest))` where `field` spans from the start of `slice` to `fend`, and `rest` from `rstart` to the end of `slice`.
+static kk_std_core_types__maybe kk_slice_just_split( struct kk_std_core_Sslice slice, const uint8_t* fend, const uint8_t* rstart, kk_context_t* ctx ) {
+  const uint8_t* const sstart = kk_string_buf_borrow(slice.str);
+  const size_t end = slice.start + slice.len;
+  kk_std_core__sslice field = kk_std_core__new_Sslice(kk_string_dup(slice.str), slice.start, (size_t)(fend - sstart) - slice.start, ctx);
+  kk_std_core__sslice rest  = kk_std_core__new_Sslice(slice.str, (size_t)(rstart - sstart), end - (size_t)(rstart - sstart), ctx);
+  kk_std_core_types__tuple2_ res = kk_std_core_types__new_dash__lp__comma__rp_( kk_std_core__sslice_box(field,ctx), kk_std_core__sslice_box(rest,ctx), ctx);
+  return kk_std_core_types__new_Just( kk_std_core_types__tuple2__box(res,ctx), ctx );
+}
+
+// Return the field up to the first `sep` (or the end) and the rest after the separator, or `Nothing` for an empty slice.
+kk_std_core_types__maybe kk_slice_next_field( struct kk_std_core_Sslice slice, kk_string_t sep, kk_context_t* ctx ) {
+  if (slice.len == 0) {
+    kk_std_core__sslice_drop(slice,ctx);
+    kk_string_drop(sep,ctx);
+    return kk_std_core_types__new_Nothing(ctx);
+  }
+  const uint8_t* start;
+  const uint8_t* end;
+  kk_sslice_start_end_borrow(slice, &start, &end);
+  const size_t seplen = kk_string_len_borrow(sep);
+  const uint8_t* fend;
+  const uint8_t* rstart;
+  if (seplen == 0) {
+    fend = rstart = kk_utf8_skip(start, end, 1);  // a single character
+  }
+  else {
+    const uint8_t* r = kk_memsearch(start, slice.len, kk_string_buf_borrow(sep), seplen);
+    fend   = (r == NULL ? end : r);
+    rstart = (r == NULL ? end : r + seplen);
+  }
+  kk_string_drop(sep,ctx);
+  return kk_slice_just_split(slice, fend, rstart, ctx);
+}
+
+// Return the line up to the first newline (or the end) and the rest after the newline, or `Nothing` for an empty slice.
+// A carriage return before the newline is not part of the line.
+kk_std_core_types__maybe kk_slice_next_line( struct kk_std_core_Sslice slice, kk_context_t* ctx ) {
+  if (slice.len == 0) {
+    kk_std_core__sslice_drop(slice,ctx);
+    return kk_std_core_types__new_Nothing(ctx);
+  }
+  const uint8_t* start;
+  const uint8_t* end;
+  kk_sslice_start_end_borrow(slice, &start, &end);
+  const uint8_t* r = (const uint8_t*)memchr(start, '\n', slice.len);
+  const uint8_t* fend   = (r == NULL ? end : r);
+  const uint8_t* rstart = (r == NULL ? end : r + 1);
+  if (fend > start && fend[-1] == '\r') fend--;
+  return kk_slice_just_split(slice, fend, rstart, ctx);
+}
+
 
 
 kk_std_core__error kk_error_from_errno( int err, kk_box_t result, kk_context_t* ctx ) {
@@ -89,6 +89,13 @@ public static class Primitive
     return a;
   }
 
+  public static A[] ArrayPush<A>(A[] v, A x) {
+    A[] a = new A[v.Length + 1];
+    System.Array.Copy(v, a, v.Length);
+    a[v.Length] = x;
+    return a;
+  }
+
   public static __std_core._list<A> VList<A>(A[] v, __std_core._list<A> tail) {
     __std_core._list<A> xs = tail;
     for (int i = v.Length - 1; i >= 0; i--) {
@@ -351,6 +358,63 @@ public static class Primitive
                     (int)c, new __std_core._sslice(slice.str, slice.start + n, slice.len - n)));
   }
 
+  private static int SliceCharLen(string s, int i, int end) {
+    return (Char.IsHighSurrogate(s[i]) && i + 1 < end ? 2 : 1);
+  }
+
+  public static __std_core._sslice[] SliceSplit(__std_core._sslice slice, string sep, int n) {
+    var parts = new System.Collections.Generic.List<__std_core._sslice>();
+    int end = slice.start + slice.len;
+    int i = slice.start;
+    if (n < 1) n = 1;
+    while (parts.Count < n - 1 && i < end) {
+      int j;
+      int next;
+      if (sep.Length == 0) {
+        j = i + SliceCharLen(slice.str, i, end);
+        if (j >= end) break;
+        next = j;
+      }
+      else {
+        j = slice.str.IndexOf(sep, i, end - i, StringComparison.Ordinal);
+        if (j < 0) break;
+        next = j + sep.Length;
+      }
+      parts.Add(new __std_core._sslice(slice.str, i, j - i));
+      i = next;
+    }
+    parts.Add(new __std_core._sslice(slice.str, i, end - i));
+    return parts.ToArray();
+  }
+
+  private static __std_core._maybe<__std_core._Tuple2_<__std_core._sslice, __std_core._sslice>> SliceJustSplit(__std_core._sslice slice, int fend, int next) {
+    int end = slice.start + slice.len;
+    return new __std_core._maybe<__std_core._Tuple2_<__std_core._sslice, __std_core._sslice>>(
+                  new __std_core._Tuple2_<__std_core._sslice, __std_core._sslice>(
+                    new __std_core._sslice(slice.str, slice.start, fend - slice.start), new __std_core._sslice(slice.str, next, end - next)));
+  }
+
+  public static __std_core._maybe<__std_core._Tuple2_<__std_core._sslice, __std_core._sslice>> SliceNextField(__std_core._sslice slice, string sep) {
+    if (slice.len <= 0) return __std_core._maybe<__std_core._Tuple2_<__std_core._sslice, __std_core._sslice>>.Nothing_;
+    int end = slice.start + slice.len;
+    if (sep.Length == 0) {
+      int j = slice.start + SliceCharLen(slice.str, slice.start, end);
+      return SliceJustSplit(slice, j, j);
+    }
+    int i = slice.str.IndexOf(sep, slice.start, slice.len, StringComparison.Ordinal);
+    return (i < 0 ? SliceJustSplit(slice, end, end) : SliceJustSplit(slice, i, i + sep.Length));
+  }
+
+  public static __std_core._maybe<__std_core._Tuple2_<__std_core._sslice, __std_core._sslice>> SliceNextLine(__std_core._sslice slice) {
+    if (slice.len <= 0) return __std_core._maybe<__std_core._Tuple2_<__std_core._sslice, __std_core._sslice>>.Nothing_;
+    int end = slice.start + slice.len;
+    int i = slice.str.IndexOf('\n', slice.start, slice.len);
+    int next = (i < 0 ? end : i + 1);
+    int fend = (i < 0 ? end : i);
+    if (fend > slice.start && slice.str[fend - 1] == '\r') fend--;
+    return SliceJustSplit(slice, fend, next);
+  }
+
   //---------------------------------------
   // Trace
   //---------------------------------------
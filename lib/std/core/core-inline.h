@@ -61,6 +61,9 @@ struct kk_std_core_Sslice kk_slice_common_prefix( kk_string_t str1, kk_string_t
 struct kk_std_core_Sslice kk_slice_advance( struct kk_std_core_Sslice slice, kk_integer_t count, kk_context_t* ctx );
 struct kk_std_core_Sslice kk_slice_extend( struct kk_std_core_Sslice slice, kk_integer_t count, kk_context_t* ctx );
 kk_std_core_types__maybe kk_slice_next( struct kk_std_core_Sslice slice, kk_context_t* ctx );
+kk_std_core_types__maybe kk_slice_next_field( struct kk_std_core_Sslice slice, kk_string_t sep, kk_context_t* ctx );
+kk_std_core_types__maybe kk_slice_next_line( struct kk_std_core_Sslice slice, kk_context_t* ctx );
+kk_vector_t kk_slice_splitv_atmost( struct kk_std_core_Sslice slice, kk_string_t sep, size_t n, kk_context_t* ctx );
 
 
 static inline kk_unit_t kk_vector_unsafe_assign( kk_vector_t v, size_t i, kk_box_t x, kk_context_t* ctx  ) {
@@ -73,6 +76,7 @@ static inline kk_unit_t kk_vector_unsafe_assign( kk_vector_t v, size_t i, kk_box
 }
 
 kk_vector_t kk_vector_init( size_t n, kk_function_t init, kk_context_t* ctx);
+kk_vector_t kk_vector_fill( size_t n, kk_box_t x, kk_context_t* ctx);
 
 static inline kk_vector_t kk_vector_allocz( size_t n, kk_context_t* ctx ) {
   return kk_vector_alloc( n, kk_box_null, ctx);
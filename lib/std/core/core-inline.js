@@ -255,6 +255,16 @@ function _vector(n, f) {
   return a;
 }
 
+// Create a vector where every element is `x`
+function _vector_fill(n, x) {
+  if (n<=0) return [];
+  var a = new Array(n);
+  for(var i = 0; i < n; i++) {
+    a[i] = x;
+  }
+  return a;
+}
+
 // Index a vector
 function _vector_at( v, i ) {
   var j = _int_to_int32(i);
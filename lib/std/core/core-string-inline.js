@@ -213,6 +213,68 @@ function _sslice_next( slice ) {
   return $std_core_types.Just( {fst: c, snd: { str: slice.str, start: slice.start+n, len: slice.len-n }} );
 }
 
+// the length of the character at index `i` (before `end`)
+function _sslice_char_len( str, i, end ) {
+  return (_is_high_surrogate(str.charCodeAt(i)) && i+1 < end ? 2 : 1);
+}
+
+// split a slice in at most `n` slices (sharing the string) delimited by `sep`
+function _sslice_splitv( slice, sep, n ) {
+  var parts = [];
+  var end = slice.start + slice.len;
+  var i = slice.start;
+  if (n < 1) n = 1;
+  while (parts.length < n-1 && i < end) {
+    var j;
+    var next;
+    if (sep.length === 0) {
+      j = i + _sslice_char_len(slice.str,i,end);
+      if (j >= end) break;  // the last character is the final part
+      next = j;
+    }
+    else {
+      j = slice.str.indexOf(sep,i);
+      if (j < 0 || j + sep.length > end) break;
+      next = j + sep.length;
+    }
+    parts.push( { str: slice.str, start: i, len: j-i } );
+    i = next;
+  }
+  parts.push( { str: slice.str, start: i, len: end-i } );
+  return parts;
+}
+
+// the field up to `sep` and the rest of the slice
+function _sslice_next_field( slice, sep ) {
+  if (slice.len <= 0) return null;
+  var end = slice.start + slice.len;
+  var j;
+  var next;
+  if (sep.length === 0) {
+    next = j = slice.start + _sslice_char_len(slice.str,slice.start,end);
+  }
+  else {
+    j = slice.str.indexOf(sep,slice.start);
+    if (j < 0 || j + sep.length > end) { j = end; next = end; }
+                                  else { next = j + sep.length; }
+  }
+  return $std_core_types.Just( {fst: { str: slice.str, start: slice.start, len: j - slice.start },
+                                snd: { str: slice.str, start: next, len: end - next }} );
+}
+
+// the line up to a newline and the rest of the slice
+function _sslice_next_line( slice ) {
+  if (slice.len <= 0) return null;
+  var end = slice.start + slice.len;
+  var j = slice.str.indexOf("\n",slice.start);
+  var next;
+  if (j < 0 || j >= end) { j = end; next = end; }
+                    else { next = j + 1; }
+  if (j > slice.start && slice.str.charCodeAt(j-1) === 13) j--;
+  return $std_core_types.Just( {fst: { str: slice.str, start: slice.start, len: j - slice.start },
+                                snd: { str: slice.str, start: next, len: end - next }} );
+}
+
 // return the common prefix of two strings
 function _sslice_common_prefix( s, t, upto ) {
   var i;
@@ -61,19 +61,86 @@ kk_std_core_hnd__ev kk_ev_none(kk_context_t* ctx) {
 }
 
 
+/*-----------------------------------------------------------------------
+  Handler tags
+  Tag names are interned so equal tags share their string and can be
+  compared by pointer. Evidence vectors stay sorted by tag name as the
+  compiler computes static evidence indices in that order.
+-----------------------------------------------------------------------*/
+
+static kk_string_t*       kk_htag_names;
+static size_t             kk_htag_count;
+static size_t             kk_htag_capacity;
+static _Atomic(uintptr_t) kk_htag_lock;
+
+kk_string_t kk_htag_intern(kk_string_t tag, kk_context_t* ctx) {
+  uintptr_t expected = 0;
+  while (!kk_atomic_cas_weak_acq_rel(&kk_htag_lock, &expected, 1)) { expected = 0; }
+  kk_string_t name = tag;
+  size_t i;
+  for (i = 0; i < kk_htag_count; i++) {
+    if (kk_string_cmp_borrow(kk_htag_names[i], tag) == 0) break;
+  }
+  if (i < kk_htag_count) {
+    name = kk_string_dup(kk_htag_names[i]);
+  }
+  else {
+    if (kk_htag_count >= kk_htag_capacity) {
+      const size_t cap = (kk_htag_capacity == 0 ? 64 : 2*kk_htag_capacity);
+      kk_string_t* names = (kk_string_t*)realloc(kk_htag_names, cap*sizeof(kk_string_t));  // not in the heap of `ctx` as tags are shared by all threads
+      if (names == NULL) kk_fatal_error(ENOMEM, "unable to intern a handler tag");
+      kk_htag_names = names;
+      kk_htag_capacity = cap;
+    }
+    kk_box_mark_shared(kk_string_box(tag), ctx);
+    kk_htag_names[kk_htag_count++] = kk_string_dup(tag);  // keep forever
+    tag = kk_string_empty();
+  }
+  kk_atomic_store_release(&kk_htag_lock, 0);
+  kk_string_drop(tag, ctx);
+  return name;
+}
+
+static inline uintptr_t kk_htag_id(struct kk_std_core_hnd_Htag htag) {
+  return (uintptr_t)htag.tagname.ptr;
+}
+
+static inline bool kk_ev_has_tag(kk_std_core_hnd__ev ev, uintptr_t tag) {
+  return (kk_htag_id(kk_std_core_hnd__as_Ev(ev)->htag) == tag);
+}
+
+// Return the index of the first evidence with tag `htag`, or otherwise its insertion point.
+// The last index of each tag is cached in the context and validated before use.
 size_t kk_evv_index( struct kk_std_core_hnd_Htag htag, kk_context_t* ctx ) {
   // todo: drop htag?
   size_t len;
   kk_std_core_hnd__ev single;
   kk_std_core_hnd__ev* vec = kk_evv_as_vec(ctx->evv,&len,&single);
+  const uintptr_t tag = kk_htag_id(htag);
+  kk_evv_cache_t* entry = &ctx->evv_cache[(tag >> 4) & (KK_EVV_CACHE_SIZE - 1)];
+  if (entry->tag == tag) {
+    const size_t i = entry->index;
+    if (i < len && kk_ev_has_tag(vec[i],tag) && (i == 0 || !kk_ev_has_tag(vec[i-1],tag))) return i;
+  }
   for(size_t i = 0; i < len; i++) {
-    struct kk_std_core_hnd_Ev* ev = kk_std_core_hnd__as_Ev(vec[i]);
-    if (kk_string_cmp_borrow(htag.tagname,ev->htag.tagname) <= 0) return i; // break on insertion point
+    if (kk_ev_has_tag(vec[i],tag)) {
+      entry->tag = tag;
+      entry->index = i;
+      return i;
+    }
+  }
+  // not present: binary search for the insertion point
+  size_t lo = 0;
+  size_t hi = len;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo)/2;
+    if (kk_string_cmp_borrow(kk_std_core_hnd__as_Ev(vec[mid])->htag.tagname, htag.tagname) < 0) lo = mid + 1;
+    else hi = mid;
   }
   //string_t evvs = kk_evv_show(dup_datatype_as(kk_evv_t,ctx->evv),ctx);
   //fatal_error(EFAULT,"cannot find tag '%s' in: %s", string_cbuf_borrow(htag.htag), string_cbuf_borrow(evvs));
   //drop_string_t(evvs,ctx);
-  return len;
+  return lo;
 }
 
 kk_std_core_hnd__ev kk_evv_lookup( struct kk_std_core_hnd_Htag htag, kk_context_t* ctx ) {
@@ -151,7 +218,7 @@ kk_evv_t kk_evv_insert(kk_evv_t evvd, kk_std_core_hnd__ev evd, kk_context_t* ctx
     size_t i;
     for (i = 0; i < n; i++) {
       struct kk_std_core_hnd_Ev* ev1 = kk_std_core_hnd__as_Ev(evv1[i]);
-      if (kk_string_cmp_borrow(ev->htag.tagname, ev1->htag.tagname) <= 0) break;
+      if (kk_htag_id(ev->htag) == kk_htag_id(ev1->htag) || kk_string_cmp_borrow(ev->htag.tagname, ev1->htag.tagname) <= 0) break;
       evv2[i] = kk_std_core_hnd__ev_dup(&ev1->_base);
     }
     evv2[i] = evd;
@@ -246,34 +313,36 @@ struct kcompose_fun_s {
   kk_function_t conts[1];
 };
 
+// maximal number of continuations in a single composition (limited by the scan size of a block)
+#define KK_KCOMPOSE_MAX  (KK_SCAN_FSIZE_MAX - 3)
+
 // kleisli composition of continuations
 static kk_box_t kcompose( kk_function_t fself, kk_box_t x, kk_context_t* ctx) {
   struct kcompose_fun_s* self = kk_function_as(struct kcompose_fun_s*,fself);
   kk_intx_t count = kk_intx_unbox(self->count);
   kk_function_t* conts = &self->conts[0];
+  // if we own `fself`, we can move the continuations out instead of dup'ing them
+  const bool owned = kk_function_is_unique(fself);
   // call each continuation in order
   for(kk_intx_t i = 0; i < count; i++) {
-    // todo: take uniqueness of fself into account to avoid dup_function
-    kk_function_t f = kk_function_dup(conts[i]);
+    kk_function_t f = (owned ? conts[i] : kk_function_dup(conts[i]));
     x = kk_function_call(kk_box_t, (kk_function_t, kk_box_t, kk_context_t*), f, (f, x, ctx));
     if (kk_yielding(ctx)) {
       // if yielding, `yield_next` all continuations that still need to be done
       while(++i < count) {
-        // todo: if fself is unique, we could copy without dup?
-        kk_yield_extend(kk_function_dup(conts[i]),ctx);
+        kk_yield_extend((owned ? conts[i] : kk_function_dup(conts[i])),ctx);
       }
-      kk_function_drop(fself,ctx);
+      if (owned) { kk_block_pool_free(&fself->_block,ctx); } else { kk_function_drop(fself,ctx); }
       // kk_box_drop(x,ctx);  // don't drop as we were yielding
       return kk_box_any(ctx); // return yielding
     }
   }
-  kk_function_drop(fself,ctx);
+  if (owned) { kk_block_pool_free(&fself->_block,ctx); } else { kk_function_drop(fself,ctx); }
   return x;
 }
 
-static kk_function_t new_kcompose( kk_function_t* conts, size_t count, kk_context_t* ctx ) {
-  if (count==0) return kk_function_id(ctx);
-  if (count==1) return conts[0];
+static kk_function_t new_kcompose_flat( kk_function_t* conts, size_t count, kk_context_t* ctx ) {
+  kk_assert_internal(count >= 2 && count <= KK_KCOMPOSE_MAX);
   struct kcompose_fun_s* f = kk_block_as(struct kcompose_fun_s*,
                                kk_block_alloc(sizeof(struct kcompose_fun_s) - sizeof(kk_function_t) + (count*sizeof(kk_function_t)),
                                  2 + count /* scan size */, KK_TAG_FUNCTION, ctx));
@@ -283,10 +352,38 @@ static kk_function_t new_kcompose( kk_function_t* conts, size_t count, kk_contex
   return (&f->_base);
 }
 
+// Compose the continuations in `conts` (which is consumed and may be overwritten).
+static kk_function_t new_kcompose( kk_function_t* conts, size_t count, kk_context_t* ctx ) {
+  if (count==0) return kk_function_id(ctx);
+  if (count==1) return conts[0];
+  // more continuations than fit in one block: compose a maximal prefix first and continue with that
+  while (count > KK_KCOMPOSE_MAX) {
+    conts[KK_KCOMPOSE_MAX-1] = new_kcompose_flat(conts, KK_KCOMPOSE_MAX, ctx);
+    conts += KK_KCOMPOSE_MAX-1;
+    count -= KK_KCOMPOSE_MAX-1;
+  }
+  return new_kcompose_flat(conts, count, ctx);
+}
+
 /*-----------------------------------------------------------------------
   Yield extension
 -----------------------------------------------------------------------*/
 
+static kk_decl_noinline void kk_yield_conts_grow( kk_yield_t* yield, kk_context_t* ctx ) {
+  const size_t newsize = 2*yield->conts_size;
+  kk_function_t* conts;
+  if (yield->conts == &yield->conts_inline[0]) {
+    conts = (kk_function_t*)kk_malloc(newsize * sizeof(kk_function_t), ctx);
+    memcpy(conts, yield->conts, yield->conts_count * sizeof(kk_function_t));
+  }
+  else {
+    conts = (kk_function_t*)kk_realloc(yield->conts, newsize * sizeof(kk_function_t), ctx);
+  }
+  if (conts == NULL) kk_fatal_error(ENOMEM, "unable to extend the continuation of an operation");
+  yield->conts = conts;
+  yield->conts_size = newsize;
+}
+
 kk_box_t kk_yield_extend( kk_function_t next, kk_context_t* ctx ) {
   kk_yield_t* yield = &ctx->yield;
   kk_assert_internal(kk_yielding(ctx));  // cannot extend if not yielding
@@ -295,11 +392,8 @@ kk_box_t kk_yield_extend( kk_function_t next, kk_context_t* ctx ) {
     kk_function_drop(next,ctx); // ignore extension if never resuming
   }
   else {
-    if (kk_unlikely(yield->conts_count >= KK_YIELD_CONT_MAX)) {
-      // alloc a function to compose all continuations in the array
-      kk_function_t comp = new_kcompose( yield->conts, yield->conts_count, ctx );
-      yield->conts[0] = comp;
-      yield->conts_count = 1;
+    if (kk_unlikely(yield->conts_count >= yield->conts_size)) {
+      kk_yield_conts_grow(yield, ctx);
     }
     yield->conts[yield->conts_count++] = next;
   }
@@ -388,8 +482,9 @@ struct kk_std_core_hnd_yld_s kk_yield_prompt( struct kk_std_core_hnd_Marker m, k
     kk_function_t clause = yield->clause;
     ctx->yielding = KK_YIELD_NONE;
     #ifndef NDEBUG
-    memset(yield,0,sizeof(kk_yield_t));
+    memset(yield->conts,0,yield->conts_count*sizeof(kk_function_t));
     #endif
+    yield->conts_count = 0;
     return kk_std_core_hnd__new_Yield(clause, cont, ctx);
   }
 }
@@ -407,24 +502,18 @@ kk_unit_t  kk_evv_guard(kk_evv_t evv, kk_context_t* ctx) {
 typedef struct yield_info_s {
   struct kk_std_core_hnd__yield_info_s _base;
   kk_function_t clause;
-  kk_function_t conts[KK_YIELD_CONT_MAX];
-  size_t     conts_count;
+  kk_function_t cont;        // the composition of the continuations (if `has_cont`)
   int32_t    marker;
   uint8_t    yielding;
+  bool       has_cont;
 }* yield_info_t;
 
 kk_std_core_hnd__yield_info kk_yield_capture(kk_context_t* ctx) {
   kk_assert_internal(kk_yielding(ctx));
-  yield_info_t yld = kk_block_alloc_as(struct yield_info_s, 1 + KK_YIELD_CONT_MAX, (kk_tag_t)1, ctx);
+  yield_info_t yld = kk_block_alloc_as(struct yield_info_s, 2, (kk_tag_t)1, ctx);
   yld->clause = ctx->yield.clause;
-  size_t i = 0;
-  for( ; i < ctx->yield.conts_count; i++) {
-    yld->conts[i] = ctx->yield.conts[i];
-  }
-  for( ; i < KK_YIELD_CONT_MAX; i++) {
-    yld->conts[i] = kk_function_null(ctx);
-  }
-  yld->conts_count = ctx->yield.conts_count;
+  yld->has_cont = (ctx->yield.conts_count > 0);
+  yld->cont = (yld->has_cont ? new_kcompose(ctx->yield.conts, ctx->yield.conts_count, ctx) : kk_function_null(ctx));
   yld->marker = ctx->yield.marker;
   yld->yielding = ctx->yielding;
   ctx->yielding = 0;
@@ -437,10 +526,10 @@ kk_box_t kk_yield_reyield( kk_std_core_hnd__yield_info yldinfo, kk_context_t* ct
   yield_info_t yld = kk_datatype_as_assert(yield_info_t, yldinfo, (kk_tag_t)1);
   ctx->yield.clause = kk_function_dup(yld->clause);
   ctx->yield.marker = yld->marker;
-  ctx->yield.conts_count = yld->conts_count;
+  ctx->yield.conts_count = 0;
   ctx->yielding = yld->yielding;
-  for(size_t i = 0; i < yld->conts_count; i++) {
-    ctx->yield.conts[i] = kk_function_dup(yld->conts[i]);
+  if (yld->has_cont) {
+    ctx->yield.conts[ctx->yield.conts_count++] = kk_function_dup(yld->cont);
   }
   kk_constructor_drop(yld,ctx);
   return kk_box_any(ctx);
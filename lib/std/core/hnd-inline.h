@@ -115,6 +115,7 @@ struct kk_std_core_hnd_Marker;
 struct kk_std_core_hnd_yld_s;
 
 
+kk_string_t     kk_htag_intern(kk_string_t tag, kk_context_t* ctx);
 struct kk_std_core_hnd__ev_s* kk_ev_none(kk_context_t* cxt);
 struct kk_std_core_hnd__ev_s* kk_evv_lookup( struct kk_std_core_hnd_Htag htag, kk_context_t* ctx );
 int32_t         kk_evv_cfc(kk_context_t* ctx);
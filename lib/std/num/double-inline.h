@@ -22,8 +22,7 @@ static inline double kk_double_from_bits( int32_t lo, int32_t hi, kk_context_t*
 
 static inline double kk_prim_parse_double( kk_string_t str, kk_context_t* ctx) {
   const char* s = kk_string_cbuf_borrow(str);
-  char* end;
-  double d = strtod(s,&end);
+  double d = kk_double_parse(s,NULL);
   kk_string_drop(str,ctx);  
   return d;
 }
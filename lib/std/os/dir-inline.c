@@ -22,3 +22,19 @@ static kk_std_core__error kk_os_list_directory_prim( kk_string_t dir, kk_context
   const int err = kk_os_list_directory(dir,&contents,ctx);
   return kk_error_from_errno(err,kk_vector_box(contents,ctx),ctx);
 }
+
+static kk_std_core__error kk_os_walker_open_error( kk_string_t dir, kk_integer_t max_depth, bool follow_links, kk_context_t* ctx ) {
+  kk_os_walker_t walker;
+  const int err = kk_os_walker_open(dir,kk_integer_clamp_size_t(max_depth,ctx),follow_links,&walker,ctx);
+  return kk_error_from_errno(err,(err==0 ? kk_os_walker_box(walker,ctx) : kk_unit_box(kk_Unit)),ctx);
+}
+
+static kk_std_core_types__maybe kk_os_walker_next_prim( kk_box_t walker, kk_context_t* ctx ) {
+  kk_string_t path;
+  kk_os_entry_kind_t kind;
+  const bool found = kk_os_walker_next(kk_os_walker_unbox(walker),&path,&kind,ctx);
+  kk_box_drop(walker,ctx);
+  if (!found) return kk_std_core_types__new_Nothing(ctx);
+  kk_std_core_types__tuple2_ res = kk_std_core_types__new_dash__lp__comma__rp_( kk_string_box(path), kk_int32_box((int32_t)kind,ctx), ctx );
+  return kk_std_core_types__new_Just( kk_std_core_types__tuple2__box(res,ctx), ctx );
+}
@@ -16,3 +16,63 @@ static kk_std_core__error kk_os_write_text_file_error( kk_string_t path, kk_stri
   const int err = kk_os_write_text_file(path,content,ctx);
   return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
 }
+
+static kk_std_core__error kk_os_file_open_error( kk_string_t path, int32_t mode, kk_context_t* ctx ) {
+  kk_os_file_t file;
+  const int err = kk_os_file_open(path,(kk_os_file_mode_t)mode,&file,ctx);
+  return kk_error_from_errno(err,(err==0 ? kk_os_file_box(file,ctx) : kk_unit_box(kk_Unit)),ctx);
+}
+
+static kk_std_core__error kk_os_file_close_error( kk_box_t file, kk_context_t* ctx ) {
+  const int err = kk_os_file_close(kk_os_file_unbox(file),ctx);
+  kk_box_drop(file,ctx);
+  return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_os_file_flush_error( kk_box_t file, kk_context_t* ctx ) {
+  const int err = kk_os_file_flush(kk_os_file_unbox(file),ctx);
+  kk_box_drop(file,ctx);
+  return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_box_t kk_os_file_maybe_slice( bool found, kk_string_t buf, size_t start, size_t len, kk_context_t* ctx ) {
+  if (found) {
+    kk_std_core__sslice slice = kk_std_core__new_Sslice(buf,start,len,ctx);
+    return kk_std_core_types__maybe_box(kk_std_core_types__new_Just(kk_std_core__sslice_box(slice,ctx),ctx),ctx);
+  }
+  else {
+    kk_string_drop(buf,ctx);
+    return kk_std_core_types__maybe_box(kk_std_core_types__new_Nothing(ctx),ctx);
+  }
+}
+
+static kk_std_core__error kk_os_file_read_line_error( kk_box_t file, kk_context_t* ctx ) {
+  kk_string_t buf;
+  size_t start, len;
+  bool found;
+  const int err = kk_os_file_read_line(kk_os_file_unbox(file),&buf,&start,&len,&found,ctx);
+  kk_box_drop(file,ctx);
+  return kk_error_from_errno(err,kk_os_file_maybe_slice(found,buf,start,len,ctx),ctx);
+}
+
+static kk_std_core__error kk_os_file_read_chunk_error( kk_box_t file, kk_integer_t max, kk_context_t* ctx ) {
+  kk_string_t buf;
+  size_t start, len;
+  bool found;
+  const int err = kk_os_file_read_chunk(kk_os_file_unbox(file),kk_integer_clamp_size_t(max,ctx),&buf,&start,&len,&found,ctx);
+  kk_box_drop(file,ctx);
+  return kk_error_from_errno(err,kk_os_file_maybe_slice(found,buf,start,len,ctx),ctx);
+}
+
+static kk_std_core__error kk_os_file_write_error( kk_box_t file, kk_string_t s, kk_context_t* ctx ) {
+  const int err = kk_os_file_write(kk_os_file_unbox(file),s,ctx);
+  kk_box_drop(file,ctx);
+  return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+}
+
+static kk_std_core__error kk_os_file_write_slice_error( kk_box_t file, kk_std_core__sslice slice, kk_context_t* ctx ) {
+  const int err = kk_os_file_write_buf(kk_os_file_unbox(file),kk_string_buf_borrow(slice.str) + slice.start,slice.len,ctx);
+  kk_std_core__sslice_drop(slice,ctx);
+  kk_box_drop(file,ctx);
+  return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+}
@@ -7,6 +7,13 @@
 ---------------------------------------------------------------------------*/
 var _read_text_file_error;
 var _write_text_file_error;
+var _file_open_error;
+var _file_close_error;
+var _file_flush_error;
+var _file_read_line_error;
+var _file_read_chunk_error;
+var _file_write_error;
+var _file_write_slice_error;
 
 if ($std_core.host()=="node")
 {
@@ -33,6 +40,115 @@ if ($std_core.host()=="node")
     }
   };
 
+  // Streaming files: a file keeps the decoded but unread text in `pending`
+  var _file_buffer_size = 65536;
+
+  var _file_try = function( action ) {
+    try {
+      return $std_core.Ok( action() );
+    }
+    catch(exn) {
+      return $std_core._error_from_exception(exn);
+    }
+  };
+
+  var _file_fill = function( f ) {
+    var buf = Buffer.alloc(_file_buffer_size);
+    var n = fs.readSync(f.fd, buf, 0, buf.length, null);
+    if (n <= 0) {
+      f.eof = true;
+      f.pending = f.pending.substr(f.pos) + f.decoder.end();
+    }
+    else {
+      f.pending = f.pending.substr(f.pos) + f.decoder.write(buf.slice(0,n));
+    }
+    f.pos = 0;
+  };
+
+  var _file_write_flush = function( f ) {
+    if (f.wbuf.length > 0) {
+      fs.writeSync(f.fd, f.wbuf.join(""), null, 'utf8');
+      f.wbuf = [];
+      f.wlen = 0;
+    }
+  };
+
+  _file_open_error = function( path, mode ) {
+    return _file_try( function() {
+      var StringDecoder = require("string_decoder").StringDecoder;
+      var fd = fs.openSync(path, (mode===0 ? "r" : (mode===2 ? "a" : "w")));
+      return { fd: fd, write: (mode!==0), eof: false, pending: "", pos: 0, decoder: new StringDecoder("utf8"), wbuf: [], wlen: 0 };
+    });
+  };
+
+  _file_close_error = function( f ) {
+    return _file_try( function() {
+      if (f.fd < 0) throw new Error("file is already closed");
+      if (f.write) _file_write_flush(f);
+      fs.closeSync(f.fd);
+      f.fd = -1;
+      f.pending = "";
+      return $std_core_types._Unit_;
+    });
+  };
+
+  _file_flush_error = function( f ) {
+    return _file_try( function() {
+      if (f.write) _file_write_flush(f);
+      return $std_core_types._Unit_;
+    });
+  };
+
+  _file_read_line_error = function( f ) {
+    return _file_try( function() {
+      var scanned = f.pos;
+      var j;
+      while ((j = f.pending.indexOf("\n",scanned)) < 0 && !f.eof) {
+        scanned = f.pending.length - f.pos;
+        _file_fill(f);
+      }
+      var next;
+      if (j < 0) {
+        if (f.pos >= f.pending.length) return null;  // end of file
+        j = f.pending.length; next = j;
+      }
+      else {
+        next = j + 1;
+      }
+      var start = f.pos;
+      if (j > start && f.pending.charCodeAt(j-1) === 13) j--;
+      f.pos = next;
+      return $std_core_types.Just( { str: f.pending, start: start, len: j - start } );
+    });
+  };
+
+  _file_read_chunk_error = function( f, max ) {
+    return _file_try( function() {
+      if (f.pos >= f.pending.length && !f.eof) _file_fill(f);
+      var avail = f.pending.length - f.pos;
+      if (avail <= 0) return null;  // end of file
+      var n = Math.min(avail, Math.max(1,max));  // note: counted in UTF-16 units here
+      var c = f.pending.charCodeAt(f.pos + n - 1);
+      if (n < avail && c >= 0xD800 && c <= 0xDBFF) n++;  // do not split a surrogate pair
+      var start = f.pos;
+      f.pos += n;
+      return $std_core_types.Just( { str: f.pending, start: start, len: n } );
+    });
+  };
+
+  _file_write_error = function( f, s ) {
+    return _file_try( function() {
+      f.wbuf.push(s);
+      f.wlen += s.length;
+      if (f.wlen >= _file_buffer_size) _file_write_flush(f);
+      return $std_core_types._Unit_;
+    });
+  };
+
+  _file_write_slice_error = function( f, slice ) {
+    return _file_write_error( f, slice.str.substr(slice.start, slice.len) );
+  };
+
 }
 else {
   // TODO: write to local storage on the browser?
@@ -43,4 +159,15 @@ else {
   _write_text_file_error = function( path, content ) {
     return $std_core.Ok( $std_core_types._Unit_ );
   }
+
+  var _file_unsupported = function() {
+    return $std_core._error_from_exception(new Error("streaming files are not supported in the browser"));
+  };
+  _file_open_error = _file_unsupported;
+  _file_close_error = _file_unsupported;
+  _file_flush_error = _file_unsupported;
+  _file_read_line_error = _file_unsupported;
+  _file_read_chunk_error = _file_unsupported;
+  _file_write_error = _file_unsupported;
+  _file_write_slice_error = _file_unsupported;
 }
@@ -16,3 +16,52 @@ static kk_integer_t kk_os_run_system_prim( kk_string_t cmd, kk_context_t* ctx )
   const int exitcode = kk_os_run_system(cmd,ctx);
   return kk_integer_from_int(exitcode,ctx);
 }
+
+static kk_std_core__error kk_os_process_spawn_error( kk_vector_t argv, bool capture_out, bool capture_err, kk_context_t* ctx ) {
+  kk_os_process_t proc;
+  const int err = kk_os_process_spawn(argv,capture_out,capture_err,&proc,ctx);
+  return kk_error_from_errno(err,(err==0 ? kk_os_process_box(proc,ctx) : kk_unit_box(kk_Unit)),ctx);
+}
+
+static kk_std_core__error kk_os_process_read_error( kk_box_t proc, kk_context_t* ctx ) {
+  kk_string_t chunk;
+  bool is_err;
+  bool found;
+  const int err = kk_os_process_read(kk_os_process_unbox(proc),&chunk,&is_err,&found,ctx);
+  kk_box_drop(proc,ctx);
+  kk_box_t res;
+  if (found) {
+    kk_std_core_types__tuple2_ tup = kk_std_core_types__new_dash__lp__comma__rp_(kk_bool_box(is_err),kk_string_box(chunk),ctx);
+    res = kk_std_core_types__maybe_box(kk_std_core_types__new_Just(kk_std_core_types__tuple2__box(tup,ctx),ctx),ctx);
+  }
+  else {
+    kk_string_drop(chunk,ctx);
+    res = kk_std_core_types__maybe_box(kk_std_core_types__new_Nothing(ctx),ctx);
+  }
+  return kk_error_from_errno(err,res,ctx);
+}
+
+static kk_integer_t kk_os_process_fd_prim( kk_box_t proc, kk_context_t* ctx ) {
+  const intptr_t fd = kk_os_process_fd(kk_os_process_unbox(proc));
+  kk_box_drop(proc,ctx);
+  return kk_integer_from_int((kk_intx_t)fd,ctx);
+}
+
+// Returns a vector with the exit code, user time, system time, peak rss, page faults, and page reclaims.
+static kk_std_core__error kk_os_process_wait_error( kk_box_t proc, kk_context_t* ctx ) {
+  int exit_code;
+  kk_msecs_t utime, stime;
+  size_t peak_rss, page_faults, page_reclaim;
+  const int err = kk_os_process_wait(kk_os_process_unbox(proc),&exit_code,&utime,&stime,&peak_rss,&page_faults,&page_reclaim,ctx);
+  kk_box_drop(proc,ctx);
+  if (err != 0) return kk_error_from_errno(err,kk_unit_box(kk_Unit),ctx);
+  kk_vector_t v = kk_vector_alloc(6,kk_box_null,ctx);
+  kk_box_t* buf = kk_vector_buf(v,NULL);
+  buf[0] = kk_integer_box(kk_integer_from_int(exit_code,ctx));
+  buf[1] = kk_integer_box(kk_integer_from_int64(utime,ctx));
+  buf[2] = kk_integer_box(kk_integer_from_int64(stime,ctx));
+  buf[3] = kk_integer_box(kk_integer_from_size_t(peak_rss,ctx));
+  buf[4] = kk_integer_box(kk_integer_from_size_t(page_faults,ctx));
+  buf[5] = kk_integer_box(kk_integer_from_size_t(page_reclaim,ctx));
+  return kk_error_from_errno(0,kk_vector_box(v,ctx),ctx);
+}
@@ -333,6 +333,14 @@ genTopDefDecl genSig inlineC def@(Def name tp defBody vis sort inl rng comm)
                         Lit lit@(LitFloat f)
                           -> do let flt  = ppLit lit
                                 emitToH (text "#define" <+> ppName name <+> parens (text "(double)" <.> parens flt))
+                        -- special case small integers, int32's, and characters as constants too
+                        -- (so no module initialization is needed at startup)
+                        Lit lit@(LitInt i) | isSmallInt i
+                          -> emitToH (text "#define" <+> ppName name <+> parens (ppLit lit))
+                        Lit lit@(LitChar c)
+                          -> emitToH (text "#define" <+> ppName name <+> parens (text "(kk_char_t)" <.> parens (ppLit lit)))
+                        App (Var tname _) [Lit (LitInt i)] | getName tname == nameInt32 && isSmallInt32 i
+                          -> emitToH (text "#define" <+> ppName name <+> genLitInt32 i)
                         _ -> do doc <- genStat (ResultAssign (TName name tp) Nothing) (defBody)
                                 emitToInit (block doc)  -- must be scoped to avoid name clashes
                                 let decl = ppType tp <+> ppName name <.> unitSemi tp
@@ -1685,6 +1693,15 @@ genAppNormal (Var cfieldOf _) [App (Var box _) [Var con _], Lit (LitString conNa
           doc = genFieldAddress con (readQualified conName) (readQualified fieldName)
       return (drop,text "(kk_box_t*)" <.> parens doc)
 
+-- special: fused integer multiply-add which updates a unique (big integer) accumulator in-place
+genAppNormal f [x, App g [y,z]] | isExternC "kk_integer_add" f && isExternC "kk_integer_mul" g
+  = do (decls,argDocs) <- genInlineableExprs [x,y,z]
+       return (decls,text "kk_integer_add_mul" <.> arguments argDocs)
+
+genAppNormal f [App g [x,y], z] | isExternC "kk_integer_add" f && isExternC "kk_integer_mul" g
+  = do (decls,argDocs) <- genInlineableExprs [x,y,z]
+       return (decls,text "kk_integer_mul_add" <.> arguments argDocs)
+
 
 -- normal
 genAppNormal f args
@@ -1773,6 +1790,13 @@ extractExtern expr
       Var tname (InfoExternal formats) -> Just (tname,formats)
       _ -> Nothing
 
+-- is this an external with the given C definition?
+isExternC :: String -> Expr -> Bool
+isExternC cname expr
+  = case extractExtern expr of
+      Just (_,formats) -> lookup C formats == Just cname
+      Nothing          -> False
+
 -- inlined external sometimes  needs wrapping in a applied function block
 genInlineExternal :: TName -> [(Target,String)] -> [Doc] -> Asm Doc
 genInlineExternal tname formats argDocs
@@ -23,6 +23,8 @@ import Control.Monad.Reader
 import Control.Monad.State
 import Data.Char
 import Data.Maybe (catMaybes)
+import Data.List (sortBy)
+import Data.Ord (comparing)
 import qualified Data.Set as S
 import qualified Data.IntMap as M
 
@@ -413,17 +415,20 @@ constructorSize platform newtypes conRepr paramTypes
 -- return the ordered fields, the byte size of the allocation, and the scan count (including tags)
 orderConFieldsEx :: Platform -> Newtypes -> Bool -> [(Name,Type)] -> ([(Name,Type)],Int,Int)
 orderConFieldsEx platform newtypes isOpen fields
-  = visit ([],[],0,0) fields
+  = visit ([],[],[],0,0) fields
   where
-    visit (rraw, rscan, scanCount0, mixCount) []
+    visit (rmix, rraw, rscan, scanCount0, mixCount) []
       = if (mixCount > 1)
          then failure ("Backend.C.ParcReuse.orderConFields: multiple fields with mixed raw/scan fields itself in " ++ show fields)
          else let scanCount = scanCount0 + (if (isOpen) then 1 else 0)  -- +1 for the open datatype tag
                   ssize = scanCount * (sizePtr platform)
-                  rsize = alignedSum ssize (map snd (reverse rraw))
+                  -- the mixed raw/scan field comes first, followed by the raw fields from large to small
+                  -- (stable) to minimize the padding between them (e.g. `bool,double,bool` takes 16 instead of 24 bytes)
+                  raws  = reverse rmix ++ sortBy (comparing (negate . snd)) (reverse rraw)
+                  rsize = alignedSum ssize (map snd raws)
                   size  = alignUp rsize (sizeSize platform)
-              in (reverse rscan ++ map fst (reverse rraw), size, scanCount)
-    visit (rraw,rscan,scanCount,mixCount) (field@(name,tp) : fs)
+              in (reverse rscan ++ map fst raws, size, scanCount)
+    visit (rmix,rraw,rscan,scanCount,mixCount) (field@(name,tp) : fs)
       = let (dd,dataRepr) = newtypesDataDefRepr newtypes tp
         in case dd of
              DataDefValue raw scan
@@ -431,11 +436,11 @@ orderConFieldsEx platform newtypes isOpen fields
                   if (raw > 0 && scan > 0)
                    then -- mixed raw/scan: put it at the head of the raw fields (there should be only one of these as checked in Kind/Infer)
                         -- but we count them to be sure (and for function data)
-                        visit (rraw ++ [(field,raw)], rscan, scanCount + scan  + extra, mixCount + 1) fs
+                        visit ((field,raw):rmix, rraw, rscan, scanCount + scan  + extra, mixCount + 1) fs
                    else if (raw > 0)
-                         then visit ((field,raw):rraw, rscan, scanCount, mixCount) fs
-                         else visit (rraw, field:rscan, scanCount + scan + extra, mixCount) fs
-             _ -> visit (rraw, field:rscan, scanCount + 1, mixCount) fs
+                         then visit (rmix, (field,raw):rraw, rscan, scanCount, mixCount) fs
+                         else visit (rmix, rraw, field:rscan, scanCount + scan + extra, mixCount) fs
+             _ -> visit (rmix, rraw, field:rscan, scanCount + 1, mixCount) fs
 
 
 newtypesDataDefRepr :: Newtypes -> Type -> (DataDef,DataRepr)
@@ -1240,6 +1240,7 @@ codeGenC sourceFile newtypes unique0 term flags modules compileTarget outBase co
                      , ccIncludeDir cc (localShareDir flags ++ "/kklib/include")]
                      ++
                      map (ccAddDef cc) ((if (asan flags) then [] else ["KK_MIMALLOC","MI_MAX_ALIGN_SIZE=8"])
+                                        ++ (if (ctrace flags) then ["KK_TRACE"] else [])
                                         ++ ["KK_STATIC_LIB"])
                      ++
                      [ ccTargetObj cc outBase
@@ -1425,6 +1426,7 @@ cmakeLib term flags cc libName {-kklib-} libFile {-libkklib.a-} cmakeGeneratorFl
                                       , "-DCMAKE_INSTALL_PREFIX=" ++ (buildDir flags)
                                       , "-DKK_COMP_VERSION=" ++ version
                                       , (if (asan flags) then "-DKK_DEBUG_SAN=address" else "")
+                                      , (if (ctrace flags) then "-DKK_TRACE=ON" else "")
                                       ]
                                       ++ unquote (cmakeArgs flags) ++
                                       [ srcLibDir ]
@@ -148,6 +148,7 @@ data Flags
          , parcSpecialize   :: Bool
          , parcReuseSpec    :: Bool
          , asan             :: Bool
+         , ctrace           :: Bool
          }
 
 flagsNull :: Flags
@@ -213,6 +214,7 @@ flagsNull
           True -- parc specialize
           True -- parc reuse specialize
           False -- use asan
+          False -- trace function entry and exit
 
 isHelp Help = True
 isHelp _    = False
@@ -289,6 +291,7 @@ options = (\(xss,yss) -> (concat xss, concat yss)) $ unzip
 --  , option []    ["install-dir"]     (ReqArg installDirFlag "dir")       "set the install directory explicitly"
 
  , hide $ fflag       ["asan"]      (\b f -> f{asan=b})              "compile with address sanitizer (clang only)"
+ , hide $ fflag       ["ctrace"]    (\b f -> f{ctrace=b})            "trace function entry and exit (write with --kktrace=<file>)"
  , hide $ fnum 3 "n"  ["simplify"]  (\i f -> f{simplify=i})          "enable 'n' core simplification passes"
  , hide $ fnum 10 "n" ["maxdup"]    (\i f -> f{simplifyMaxDup=i})    "set 'n' as maximum code duplication threshold"
  , hide $ fnum 10 "n" ["inline"]    (\i f -> f{optInlineMax=i})      "set 'n' as maximum inline threshold (=10)"
@@ -690,14 +693,25 @@ ccFromPath flags path
         cc = cc0{ ccFlagsCompile = ccFlagsCompile cc0 ++ unquote (ccompCompileArgs flags)
                 , ccFlagsLink    = ccFlagsLink cc0 ++ unquote (ccompLinkArgs flags) }
 
-    in if (asan flags)
-         then if (not (ccName cc `startsWith` "clang"))
-                then do putStrLn "warning: can only use address sanitizer with clang (ignored)"
-                        return cc
-                else do return cc{ ccName         = ccName cc ++ "-asan"
-                                 , ccFlagsCompile = ccFlagsCompile cc ++ ["-fsanitize=address"]
-                                 , ccFlagsLink    = ccFlagsLink cc ++ ["-fsanitize=address"] }
-         else return cc
+    in do ccSan <- if (asan flags)
+                    then if (not (ccName cc `startsWith` "clang"))
+                           then do putStrLn "warning: can only use address sanitizer with clang (ignored)"
+                                   return cc
+                           else do return cc{ ccName         = ccName cc ++ "-asan"
+                                            , ccFlagsCompile = ccFlagsCompile cc ++ ["-fsanitize=address"]
+                                            , ccFlagsLink    = ccFlagsLink cc ++ ["-fsanitize=address"] }
+                    else return cc
+          if (ctrace flags)
+            then if (ccName ccSan `startsWith` "clang-cl" || (ccName ccSan `startsWith` "cl" && not (ccName ccSan `startsWith` "clang")))
+                   then do putStrLn "warning: can only trace function entry and exit with gcc or clang (ignored)"
+                           return ccSan
+                   else do let instr = if (ccName ccSan `startsWith` "clang")
+                                        then ["-finstrument-functions-after-inlining"]
+                                        else ["-finstrument-functions","-finstrument-functions-exclude-file-list=kklib/"]
+                           return ccSan{ ccName         = ccName ccSan ++ "-trace"
+                                       , ccFlagsCompile = ccFlagsCompile ccSan ++ instr
+                                       , ccFlagsLink    = ccFlagsLink ccSan ++ (if onWindows || onMacOS then [] else ["-rdynamic"]) }
+            else return ccSan
 
 -- unquote a shell argument string (as well as we can)
 unquote :: String -> [String]
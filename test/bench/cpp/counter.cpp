@@ -0,0 +1,22 @@
+// State counter loop in C++ (baseline for the koka `state` handler)
+#include <iostream>
+
+static long count(long& state, long acc) {
+  while (true) {
+    long i = state;
+    if (i <= 0) return acc;
+    state = i - 1;
+    acc += i;
+  }
+}
+
+int main(int argc, char** argv) {
+  long n = 10000000;
+  if (argc == 2) {
+    n = atol(argv[1]);
+  }
+  volatile long init = n;  // prevent computing the result at compile time
+  long state = init;
+  std::cout << count(state, 0) << "\n";
+  return 0;
+}
@@ -0,0 +1,26 @@
+// Exceptions in a tight loop in C++: a third of the iterations throws and is caught.
+#include <iostream>
+#include <stdexcept>
+
+static long safe_div(long x, long y) {
+  if (y == 0) throw std::runtime_error("divide by zero");
+  return x / y;
+}
+
+int main(int argc, char** argv) {
+  long n = 10000000;
+  if (argc == 2) {
+    n = atol(argv[1]);
+  }
+  long acc = 0;
+  for (long i = n; i > 0; i--) {
+    try {
+      acc += safe_div(i, i % 3);
+    }
+    catch (const std::runtime_error&) {
+      acc += 1;
+    }
+  }
+  std::cout << acc << "\n";
+  return 0;
+}
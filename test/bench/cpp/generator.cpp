@@ -0,0 +1,68 @@
+// Generators in C++: iterate over a balanced tree with an explicit stack
+// (baseline for the koka `yield` handler)
+#include <iostream>
+#include <vector>
+
+class tree {
+public:
+  tree* left;
+  long  value;
+  tree* right;
+  tree(tree* l, long v, tree* r) : left(l), value(v), right(r) { }
+  ~tree() {
+    delete left;
+    delete right;
+  }
+};
+
+static tree* make(long lo, long hi) {
+  if (lo > hi) return NULL;
+  long mid = (lo + hi) / 2;
+  return new tree(make(lo, mid - 1), mid, make(mid + 1, hi));
+}
+
+// An in-order iterator that suspends at each element
+class iterator {
+  std::vector<tree*> stack;
+  void push_left(tree* t) {
+    while (t != NULL) {
+      stack.push_back(t);
+      t = t->left;
+    }
+  }
+public:
+  iterator(tree* t) { push_left(t); }
+  bool next(long* x) {
+    if (stack.empty()) return false;
+    tree* t = stack.back();
+    stack.pop_back();
+    *x = t->value;
+    push_left(t->right);
+    return true;
+  }
+};
+
+static long sum(tree* t) {
+  long total = 0;
+  long x;
+  iterator iter(t);
+  while (iter.next(&x)) {
+    total += x;
+  }
+  return total;
+}
+
+int main(int argc, char** argv) {
+  long n = 1000000;
+  if (argc == 2) {
+    n = atol(argv[1]);
+  }
+  tree* t = make(1, n);
+  long total = 0;
+  for (int i = 0; i < 5; i++) {
+    total += sum(t);
+  }
+  std::cout << total << "\n";
+  delete t;
+  return 0;
+}
@@ -0,0 +1,36 @@
+// Count all N-queens solutions in C++ with backtracking
+// (baseline for the multi-shot `pick` handler in koka)
+#include <iostream>
+#include <vector>
+
+static bool safe(int queen, const std::vector<int>& sol) {
+  int diag = 1;
+  for (auto it = sol.rbegin(); it != sol.rend(); ++it, ++diag) {
+    int q = *it;
+    if (queen == q || queen == q + diag || queen == q - diag) return false;
+  }
+  return true;
+}
+
+static long count_all(int n, int col, std::vector<int>& sol) {
+  if (col > n) return 1;
+  long count = 0;
+  for (int queen = 1; queen <= n; queen++) {
+    if (safe(queen, sol)) {
+      sol.push_back(queen);
+      count += count_all(n, col + 1, sol);
+      sol.pop_back();
+    }
+  }
+  return count;
+}
+
+int main(int argc, char** argv) {
+  int n = 10;
+  if (argc == 2) {
+    n = atoi(argv[1]);
+  }
+  std::vector<int> sol;
+  std::cout << count_all(n, 1, sol) << "\n";
+  return 0;
+}
@@ -0,0 +1,9 @@
+let rec count state acc =
+  let i = !state in
+  if (i <= 0) then acc
+  else begin
+    state := i - 1;
+    count state (acc + i)
+  end;;
+
+Printf.printf "%d\n" (count (ref 10000000) 0);;
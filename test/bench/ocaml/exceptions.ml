@@ -0,0 +1,10 @@
+exception Divide_by_zero;;
+
+let safe_div x y =
+  if (y == 0) then raise Divide_by_zero else x / y;;
+
+let rec loop i acc =
+  if (i <= 0) then acc
+  else loop (i - 1) (acc + (try safe_div i (i mod 3) with Divide_by_zero -> 1));;
+
+Printf.printf "%d\n" (loop 10000000 0);;
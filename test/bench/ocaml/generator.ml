@@ -0,0 +1,21 @@
+type tree =
+  | Leaf
+  | Node of tree * int * tree;;
+
+let rec make lo hi =
+  if (lo > hi) then Leaf
+  else let mid = (lo + hi) / 2 in Node (make lo (mid - 1), mid, make (mid + 1) hi);;
+
+(* an in-order iterator as a lazy sequence that suspends at each element *)
+let rec iterate t rest () =
+  match t with
+  | Leaf -> rest ()
+  | Node (l, x, r) -> iterate l (fun () -> Seq.Cons (x, iterate r rest)) ();;
+
+let sum t =
+  Seq.fold_left (fun total x -> total + x) 0 (iterate t Seq.empty);;
+
+let rec repeat_sum n t acc =
+  if (n <= 0) then acc else repeat_sum (n - 1) t (acc + sum t);;
+
+Printf.printf "%d\n" (repeat_sum 5 (make 1 1000000) 0);;
@@ -0,0 +1,17 @@
+let rec safe queen diag xs =
+  match xs with
+  | q :: qs -> queen <> q && queen <> q + diag && queen <> q - diag && safe queen (diag + 1) qs
+  | [] -> true;;
+
+(* backtracking: try every candidate for the current column *)
+let rec count_all n col sol =
+  if (col > n) then 1
+  else begin
+    let count = ref 0 in
+    for queen = 1 to n do
+      if (safe queen 1 sol) then count := !count + count_all n (col + 1) (queen :: sol)
+    done;
+    !count
+  end;;
+
+Printf.printf "%d\n" (count_all 10 1 []);;